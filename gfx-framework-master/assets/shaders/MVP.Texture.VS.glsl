@@ -1,4 +1,5 @@
 #version 330
+#pragma features INSTANCED
 
 // Input
 layout(location = 0) in vec3 v_position;
@@ -6,6 +7,11 @@ layout(location = 1) in vec3 v_normal;
 layout(location = 2) in vec2 v_texture_coord;
 layout(location = 3) in vec3 v_color;
 
+#ifdef INSTANCED
+// Per-instance model matrix, uses locations 4 to 7
+layout(location = 4) in mat4 v_model;
+#endif
+
 // Uniform properties
 uniform mat4 Model;
 uniform mat4 View;
@@ -22,5 +28,9 @@ void main()
     frag_normal = v_normal;
     frag_color = v_color;
     tex_coord = v_texture_coord;
+#ifdef INSTANCED
+    gl_Position = Projection * View * v_model * vec4(v_position, 1.0);
+#else
     gl_Position = Projection * View * Model * vec4(v_position, 1.0);
+#endif
 }
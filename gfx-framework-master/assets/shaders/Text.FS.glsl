@@ -1,12 +1,21 @@
 #version 330 core
 in vec2 TexCoords;
+in vec4 TextColor;
 out vec4 color;
 
 uniform sampler2D text;
-uniform vec3 textColor;
+uniform bool sdf;
 
 void main()
 {
-	vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-	color = vec4(textColor, 1.0) * sampled;
+	float alpha = texture(text, TexCoords).r;
+
+	// Signed distance atlases store the glyph edge at 0.5
+	if (sdf)
+	{
+		float width = fwidth(alpha);
+		alpha = smoothstep(0.5 - width, 0.5 + width, alpha);
+	}
+
+	color = vec4(TextColor.rgb, TextColor.a * alpha);
 }
\ No newline at end of file
@@ -0,0 +1,493 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <regex>
+#include <thread>
+
+
+namespace bench
+{
+    struct Entry
+    {
+        std::string name;
+        Function function;
+        std::vector<int64_t> arguments;
+
+        // Set for checks instead of the function
+        CheckFunction check;
+    };
+
+
+    struct Result
+    {
+        std::string name;
+        std::string label;
+        uint64_t iterations;
+        unsigned int repetitions;
+
+        // Of the repetitions, the median is the one reported
+        double nsPerOp;
+        double minNsPerOp;
+        double maxNsPerOp;
+        double itemsPerSecond;
+    };
+
+
+    struct Options
+    {
+        std::string filter;
+        double minTime;
+        unsigned int repetitions;
+        std::string format;
+        std::string outPath;
+        bool list;
+        bool checks;
+    };
+
+
+    class Runner
+    {
+     public:
+        explicit Runner(const Options &options);
+
+        Result Run(const Entry &entry, int64_t argument) const;
+
+     private:
+        // Seconds of one run, the items it processed are returned in `items`
+        double Measure(const Entry &entry, uint64_t iterations, int64_t argument, uint64_t &items, std::string &label) const;
+
+     private:
+        Options options;
+    };
+}
+
+
+using namespace bench;
+
+
+// Stops the calibration of benchmarks the optimizer removed despite DoNotOptimize
+static const uint64_t MAX_ITERATIONS = 1000000000ull;
+
+
+// Without arguments, the name is the function name alone
+static std::string GetName(const Entry &entry, int64_t argument)
+{
+    return entry.arguments.empty() ? entry.name : entry.name + "/" + std::to_string(argument);
+}
+
+
+static std::vector<Entry> &GetRegistry()
+{
+    // Built on first use, the registrations run during static initialization
+    static std::vector<Entry> registry;
+    return registry;
+}
+
+
+State::State(uint64_t iterations, int64_t argument)
+    : iterations(iterations), argument(argument), itemsProcessed(iterations)
+{
+    started = false;
+    stopped = false;
+}
+
+
+void State::Start()
+{
+    started = true;
+    startTime = Clock::now();
+}
+
+
+void State::Stop()
+{
+    stopTime = Clock::now();
+    stopped = true;
+}
+
+
+Checker::Checker()
+    : failures(0)
+{
+}
+
+
+bool Checker::Expect(bool condition, const std::string &what)
+{
+    if (!condition)
+    {
+        std::cout << "  failed: " << what << std::endl;
+        failures++;
+    }
+    return condition;
+}
+
+
+Registration::Registration(const char *name, Function function, std::vector<int64_t> arguments)
+{
+    Entry entry;
+    entry.name = name;
+    entry.function = function;
+    entry.arguments = arguments;
+    entry.check = nullptr;
+    GetRegistry().push_back(entry);
+}
+
+
+Registration::Registration(const char *name, CheckFunction check)
+{
+    Entry entry;
+    entry.name = name;
+    entry.function = nullptr;
+    entry.check = check;
+    GetRegistry().push_back(entry);
+}
+
+
+#if defined(_MSC_VER)
+void bench::Escape(const void *pointer)
+{
+    // Out of line, the compiler cannot tell that the value is unused
+    static const void *volatile sink;
+    sink = pointer;
+}
+#endif
+
+
+Runner::Runner(const Options &options)
+    : options(options)
+{
+}
+
+
+double Runner::Measure(const Entry &entry, uint64_t iterations, int64_t argument, uint64_t &items, std::string &label) const
+{
+    State state(iterations, argument);
+
+    State::Clock::time_point callStart = State::Clock::now();
+    entry.function(state);
+    State::Clock::time_point callEnd = State::Clock::now();
+
+    items = state.itemsProcessed;
+    label = state.label;
+
+    State::Clock::time_point start = state.started ? state.startTime : callStart;
+    State::Clock::time_point stop = state.stopped ? state.stopTime : callEnd;
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+
+Result Runner::Run(const Entry &entry, int64_t argument) const
+{
+    uint64_t items = 0;
+    std::string label;
+
+    // Grows the iteration count until a run is long enough for the clock
+    uint64_t iterations = 1;
+    for (;;)
+    {
+        double seconds = Measure(entry, iterations, argument, items, label);
+        if (seconds >= options.minTime || iterations >= MAX_ITERATIONS)
+            break;
+
+        double scale = seconds > options.minTime / 100 ? 1.4 * options.minTime / seconds : 100.0;
+        scale = std::min(100.0, std::max(2.0, scale));
+        iterations = std::min(MAX_ITERATIONS, static_cast<uint64_t>(iterations * scale));
+    }
+
+    std::vector<double> nsPerOp(options.repetitions);
+    std::vector<double> itemsPerSecond(options.repetitions);
+    for (unsigned int i = 0; i < options.repetitions; i++)
+    {
+        double seconds = Measure(entry, iterations, argument, items, label);
+        nsPerOp[i] = seconds * 1e9 / iterations;
+        itemsPerSecond[i] = seconds > 0 ? items / seconds : 0.0;
+    }
+
+    Result result;
+    result.name = GetName(entry, argument);
+    result.label = label;
+    result.iterations = iterations;
+    result.repetitions = options.repetitions;
+
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    std::sort(itemsPerSecond.begin(), itemsPerSecond.end());
+    result.nsPerOp = nsPerOp[nsPerOp.size() / 2];
+    result.minNsPerOp = nsPerOp.front();
+    result.maxNsPerOp = nsPerOp.back();
+    result.itemsPerSecond = itemsPerSecond[itemsPerSecond.size() / 2];
+    return result;
+}
+
+
+static void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+        "  --filter REGEX       run the benchmarks whose name matches, e.g. Collision\n"
+        "  --min-time SECONDS   of a run after calibration, default 0.1\n"
+        "  --repetitions N      runs of every benchmark, the median is reported, default 5\n"
+        "  --format FORMAT      console, json or csv, default console\n"
+        "  --out PATH           writes the results there, the console keeps the table\n"
+        "  --list               prints the benchmark names and exits\n"
+        "  --checks             runs the checks instead, fails if one of them does\n";
+}
+
+
+// Every check runs once, the failures are listed under its name
+static int RunChecks(const std::regex &filter, bool list)
+{
+    unsigned int run = 0, failed = 0;
+
+    for (const Entry &entry : GetRegistry())
+    {
+        if (!entry.check || !std::regex_search(entry.name, filter))
+            continue;
+
+        if (list)
+        {
+            std::cout << entry.name << "\n";
+            continue;
+        }
+
+        std::cout << entry.name << std::endl;
+        Checker checker;
+        entry.check(checker);
+
+        run++;
+        if (checker.GetFailures()) {
+            failed++;
+        }
+    }
+
+    if (list)
+        return EXIT_SUCCESS;
+
+    std::cout << "\n" << run - failed << " of " << run << " checks passed" << std::endl;
+    return failed || !run ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+static std::string FormatRate(double rate)
+{
+    const char *suffixes[] = { "", "k", "M", "G", "T" };
+    int suffix = 0;
+    for (; rate >= 1000 && suffix < 4; suffix++) {
+        rate /= 1000;
+    }
+
+    char text[32];
+    snprintf(text, sizeof(text), "%.3g%s/s", rate, suffixes[suffix]);
+    return text;
+}
+
+
+static std::string EscapeJson(const std::string &text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += (c >= 0 && c < ' ') ? ' ' : c;
+    }
+    return escaped;
+}
+
+
+static void PrintConsoleHeader()
+{
+    printf("%-44s %14s %14s %14s %12s\n", "Benchmark", "ns/op", "min ns/op", "items/s", "iterations");
+    printf("%s\n", std::string(102, '-').c_str());
+}
+
+
+static void PrintConsoleResult(const Result &result)
+{
+    printf("%-44s %14.2f %14.2f %14s %12llu %s\n", result.name.c_str(), result.nsPerOp, result.minNsPerOp,
+        FormatRate(result.itemsPerSecond).c_str(), static_cast<unsigned long long>(result.iterations), result.label.c_str());
+    fflush(stdout);
+}
+
+
+// One benchmark per line, so that the files of two commits diff line by line
+static void WriteJson(FILE *file, const std::vector<Result> &results, const Options &options)
+{
+    char date[32] = "";
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+#if defined(_MSC_VER)
+    std::string compiler = "msvc " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+    std::string compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    std::string compiler = "gcc " __VERSION__;
+#else
+    std::string compiler = "unknown";
+#endif
+
+#ifdef NDEBUG
+    const char *build = "release";
+#else
+    const char *build = "debug";
+#endif
+
+    fprintf(file, "{\n\"context\":{\"date\":\"%s\",\"build\":\"%s\",\"compiler\":\"%s\",\"threads\":%u,\"min_time\":%.3f,\"repetitions\":%u},\n",
+        date, build, EscapeJson(compiler).c_str(), std::thread::hardware_concurrency(), options.minTime, options.repetitions);
+
+    fprintf(file, "\"benchmarks\":[\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &result = results[i];
+        fprintf(file, "{\"name\":\"%s\",\"ns_per_op\":%.3f,\"min_ns_per_op\":%.3f,\"max_ns_per_op\":%.3f,"
+            "\"items_per_second\":%.1f,\"iterations\":%llu,\"repetitions\":%u,\"label\":\"%s\"}%s\n",
+            EscapeJson(result.name).c_str(), result.nsPerOp, result.minNsPerOp, result.maxNsPerOp, result.itemsPerSecond,
+            static_cast<unsigned long long>(result.iterations), result.repetitions, EscapeJson(result.label).c_str(),
+            i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "]\n}\n");
+}
+
+
+static void WriteCsv(FILE *file, const std::vector<Result> &results)
+{
+    fprintf(file, "name,ns_per_op,min_ns_per_op,max_ns_per_op,items_per_second,iterations,repetitions,label\n");
+    for (const Result &result : results)
+    {
+        // The labels may have commas
+        std::string label = result.label;
+        for (size_t quote = label.find('"'); quote != std::string::npos; quote = label.find('"', quote + 2)) {
+            label.insert(quote, 1, '"');
+        }
+
+        fprintf(file, "%s,%.3f,%.3f,%.3f,%.1f,%llu,%u,\"%s\"\n", result.name.c_str(), result.nsPerOp, result.minNsPerOp,
+            result.maxNsPerOp, result.itemsPerSecond, static_cast<unsigned long long>(result.iterations),
+            result.repetitions, label.c_str());
+    }
+}
+
+
+int bench::Main(int argc, char **argv)
+{
+    Options options;
+    options.minTime = 0.1;
+    options.repetitions = 5;
+    options.format = "console";
+    options.list = false;
+    options.checks = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--filter") && hasValue) {
+            options.filter = argv[++i];
+        } else if (!strcmp(argv[i], "--min-time") && hasValue) {
+            options.minTime = std::max(0.001, atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--repetitions") && hasValue) {
+            options.repetitions = static_cast<unsigned int>(std::max(1, atoi(argv[++i])));
+        } else if (!strcmp(argv[i], "--format") && hasValue) {
+            options.format = argv[++i];
+        } else if (!strcmp(argv[i], "--out") && hasValue) {
+            options.outPath = argv[++i];
+        } else if (!strcmp(argv[i], "--list")) {
+            options.list = true;
+        } else if (!strcmp(argv[i], "--checks")) {
+            options.checks = true;
+        } else {
+            PrintUsage(argv[0]);
+            return strcmp(argv[i], "--help") ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+
+    if (options.format != "console" && options.format != "json" && options.format != "csv")
+    {
+        std::cout << "Unknown format " << options.format << ", expected console, json or csv" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::regex filter;
+    try
+    {
+        filter = std::regex(options.filter.empty() ? "." : options.filter);
+    }
+    catch (const std::regex_error &)
+    {
+        std::cout << "Invalid filter " << options.filter << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (options.checks)
+        return RunChecks(filter, options.list);
+
+    // The table goes to the console unless it would mix with the results
+    bool console = options.format == "console" || !options.outPath.empty();
+
+#ifndef NDEBUG
+    if (console) {
+        std::cout << "Warning: debug build, the timings are not representative\n" << std::endl;
+    }
+#endif
+
+    if (console && !options.list) {
+        PrintConsoleHeader();
+    }
+
+    Runner runner(options);
+    std::vector<Result> results;
+
+    for (const Entry &entry : GetRegistry())
+    {
+        if (entry.check)
+            continue;
+
+        std::vector<int64_t> arguments = entry.arguments.empty() ? std::vector<int64_t>(1, 0) : entry.arguments;
+        for (int64_t argument : arguments)
+        {
+            std::string name = GetName(entry, argument);
+            if (!std::regex_search(name, filter))
+                continue;
+
+            if (options.list)
+            {
+                std::cout << name << "\n";
+                continue;
+            }
+
+            results.push_back(runner.Run(entry, argument));
+            if (console) {
+                PrintConsoleResult(results.back());
+            }
+        }
+    }
+
+    if (options.list || options.format == "console")
+        return EXIT_SUCCESS;
+
+    FILE *file = options.outPath.empty() ? stdout : fopen(options.outPath.c_str(), "w");
+    if (!file)
+    {
+        std::cout << "Cannot write " << options.outPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (options.format == "json") {
+        WriteJson(file, results, options);
+    } else {
+        WriteCsv(file, results);
+    }
+
+    bool written = ferror(file) == 0;
+    if (file != stdout)
+    {
+        fclose(file);
+        std::cout << "\n" << results.size() << " results written to " << options.outPath << std::endl;
+    }
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// A small microbenchmark harness for the CPU side code of the labs. A
+// benchmark is a function that runs its measured code `GetIterations()`
+// times; the harness raises the iteration count until a run takes at least
+// the minimum time, repeats the run and reports the median. Benchmarks with
+// arguments run once per argument, e.g. once per obstacle count.
+//
+//     static void Translate(bench::State &state)
+//     {
+//         for (uint64_t i = 0; i < state.GetIterations(); i++) {
+//             bench::DoNotOptimize(transforms3D::Translate(1, 2, 3));
+//         }
+//     }
+//     BENCHMARK(Translate);
+//
+// Checks verify the results the measured code relies on, e.g. that the BVH
+// hits what brute force hits. They run with --checks instead of the
+// benchmarks, and any failed expectation makes the process exit non-zero.
+//
+//     static void TranslateOrigin(bench::Checker &checker)
+//     {
+//         checker.Expect(transforms3D::Translate(1, 2, 3)[3] == glm::vec4(1, 2, 3, 1), "translation column");
+//     }
+//     CHECK(TranslateOrigin);
+namespace bench
+{
+    class State
+    {
+     public:
+        typedef std::chrono::steady_clock Clock;
+
+     public:
+        State(uint64_t iterations, int64_t argument);
+
+        uint64_t GetIterations() const { return iterations; }
+        int64_t GetArgument() const { return argument; }
+
+        // The setup before Start and the cleanup after Stop are not measured.
+        // Without them, the whole call is.
+        void Start();
+        void Stop();
+
+        // Items processed by all the iterations, for the items/s column. One
+        // item per iteration by default.
+        void SetItemsProcessed(uint64_t items) { itemsProcessed = items; }
+
+        void SetLabel(const std::string &text) { label = text; }
+
+     private:
+        friend class Runner;
+
+        uint64_t iterations;
+        int64_t argument;
+        uint64_t itemsProcessed;
+        std::string label;
+
+        bool started;
+        bool stopped;
+        Clock::time_point startTime;
+        Clock::time_point stopTime;
+    };
+
+
+    typedef void (*Function)(State &state);
+
+
+    class Checker
+    {
+     public:
+        Checker();
+
+        // Reports `what` as a failure when the condition does not hold
+        bool Expect(bool condition, const std::string &what);
+
+        unsigned int GetFailures() const { return failures; }
+
+     private:
+        unsigned int failures;
+    };
+
+
+    typedef void (*CheckFunction)(Checker &checker);
+
+
+    // Registers the benchmark before main, see the macros below
+    class Registration
+    {
+     public:
+        Registration(const char *name, Function function, std::vector<int64_t> arguments = std::vector<int64_t>());
+        Registration(const char *name, CheckFunction check);
+    };
+
+
+    // Keeps the compiler from removing the computation of `value`
+#if defined(_MSC_VER)
+    void Escape(const void *pointer);
+
+    template <class T>
+    inline void DoNotOptimize(const T &value)
+    {
+        Escape(&value);
+    }
+#else
+    template <class T>
+    inline void DoNotOptimize(const T &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+#endif
+
+
+    // Runs the registered benchmarks, the command line is described by --help
+    int Main(int argc, char **argv);
+}
+
+
+#define BENCHMARK_CONCAT_(a, b)         a##b
+#define BENCHMARK_REGISTRATION_(line)   BENCHMARK_CONCAT_(benchmarkRegistration, line)
+
+#define BENCHMARK(function) \
+    static const bench::Registration BENCHMARK_REGISTRATION_(__LINE__)(#function, function)
+
+#define BENCHMARK_ARGS(function, ...) \
+    static const bench::Registration BENCHMARK_REGISTRATION_(__LINE__)(#function, function, { __VA_ARGS__ })
+
+#define CHECK(function) \
+    static const bench::Registration BENCHMARK_REGISTRATION_(__LINE__)(#function, static_cast<bench::CheckFunction>(function))
@@ -0,0 +1,176 @@
+#include "benchmark.h"
+
+#include "lab_m1/drone_challenge/headers/drone_challenge.h"
+#include "lab_m1/drone_challenge/headers/literals.h"
+#include "lab_m1/drone_challenge/headers/drone.h"
+#include "lab_m1/drone_challenge/headers/heightfield.h"
+#include "lab_m1/drone_challenge/headers/world_scale.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+
+// The collision tests of the drone against every obstacle shape. The argument
+// is the tilt level of the drone, which changes its bounding box. The drone
+// is placed at random around the obstacle so that some of the tests hit.
+namespace
+{
+    // Power of two, the iterations cycle through the positions
+    const size_t NUM_POSITIONS = 1024;
+
+
+    std::vector<glm::vec3> RandomPositions(glm::vec3 center, glm::vec3 extent)
+    {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        std::vector<glm::vec3> positions(NUM_POSITIONS);
+        for (glm::vec3 &position : positions) {
+            position = center + extent * glm::vec3(unit(generator), unit(generator), unit(generator));
+        }
+        return positions;
+    }
+
+
+    void SetHitLabel(bench::State &state, uint64_t hits)
+    {
+        state.SetLabel("hits " + std::to_string(hits * 100 / std::max<uint64_t>(1, state.GetIterations())) + "%");
+    }
+}
+
+
+static void DroneCollidingWithCube(bench::State &state)
+{
+    const glm::vec3 houseCenter(0.0f);
+    std::vector<glm::vec3> positions = RandomPositions(houseCenter + glm::vec3(0, lit::houseSide / 2, 0), glm::vec3(lit::houseSide));
+    int tilt = static_cast<int>(state.GetArgument());
+
+    uint64_t hits = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        bool hit = drone::isDroneCollidingWithCube(positions[i & (NUM_POSITIONS - 1)], houseCenter, tilt,
+            lit::houseSide, 1.1f, m1::PackageStatus::FREE);
+        hits += hit;
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(hits);
+    SetHitLabel(state, hits);
+}
+BENCHMARK_ARGS(DroneCollidingWithCube, 0, 1, 2);
+
+
+static void DroneCollidingWithPrism(bench::State &state)
+{
+    const glm::vec3 roofCenter(0.0f, lit::houseSide, 0.0f);
+    std::vector<glm::vec3> positions = RandomPositions(roofCenter + glm::vec3(0, lit::roofHeight / 2, 0), glm::vec3(lit::houseSide));
+    int tilt = static_cast<int>(state.GetArgument());
+
+    uint64_t hits = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        bool hit = drone::isDroneCollidingWithPrism(positions[i & (NUM_POSITIONS - 1)], roofCenter, tilt,
+            1.1f, m1::PackageStatus::FREE);
+        hits += hit;
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(hits);
+    SetHitLabel(state, hits);
+}
+BENCHMARK_ARGS(DroneCollidingWithPrism, 0, 1, 2);
+
+
+static void DroneCollidingWithCylinder(bench::State &state)
+{
+    const glm::vec3 trunkCenter(0.0f);
+    std::vector<glm::vec3> positions = RandomPositions(trunkCenter + glm::vec3(0, lit::treeTrunkHeight / 2, 0),
+        glm::vec3(lit::droneBodyOX + lit::treeTrunkRadius, lit::treeTrunkHeight, lit::droneBodyOX + lit::treeTrunkRadius));
+    int tilt = static_cast<int>(state.GetArgument());
+
+    uint64_t hits = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        bool hit = drone::isDroneCollidingWithCylinder(positions[i & (NUM_POSITIONS - 1)], trunkCenter, tilt,
+            1.0f, m1::PackageStatus::FREE);
+        hits += hit;
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(hits);
+    SetHitLabel(state, hits);
+}
+BENCHMARK_ARGS(DroneCollidingWithCylinder, 0, 1, 2);
+
+
+static void DroneCollidingWithCones(bench::State &state)
+{
+    const glm::vec3 crownCenter(0.0f, lit::treeTrunkHeight, 0.0f);
+    std::vector<glm::vec3> positions = RandomPositions(crownCenter + glm::vec3(0, lit::treeCrownHeight / 2, 0),
+        glm::vec3(lit::treeCrownRadius + lit::droneBodyOX, lit::treeCrownHeight, lit::treeCrownRadius + lit::droneBodyOX));
+    int tilt = static_cast<int>(state.GetArgument());
+
+    uint64_t hits = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        bool hit = drone::isDroneCollidingWithCones(positions[i & (NUM_POSITIONS - 1)], crownCenter, tilt,
+            m1::PackageStatus::ATTACHED);
+        hits += hit;
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(hits);
+    SetHitLabel(state, hits);
+}
+BENCHMARK_ARGS(DroneCollidingWithCones, 0, 1, 2);
+
+
+static void DroneCollidingWithField(bench::State &state)
+{
+    // The field of the default world, baked once per run. The drone flies low over it.
+    const scale::WorldScale world;
+    const glm::ivec2 samples = world.GetHeightSamples();
+    heightfield::HeightField field;
+    field.Bake(1.0f, lit::fieldNoiseFrequency, world.GetFieldMin(), world.GetFieldMax(), samples.x, samples.y);
+
+    std::vector<glm::vec3> positions = RandomPositions(glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(world.GetFieldMax().x - lit::droneBodyOX, 1.0f, world.GetFieldMax().y - lit::droneBodyOX));
+    int tilt = static_cast<int>(state.GetArgument());
+
+    uint64_t hits = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        bool hit = drone::isDroneCollidingWithField(positions[i & (NUM_POSITIONS - 1)], tilt, field,
+            m1::PackageStatus::FREE);
+        hits += hit;
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(hits);
+    SetHitLabel(state, hits);
+}
+BENCHMARK_ARGS(DroneCollidingWithField, 0, 1, 2);
+
+
+static void DroneInTheZone(bench::State &state)
+{
+    const glm::vec3 zoneCenter(0.0f);
+    std::vector<glm::vec3> positions = RandomPositions(zoneCenter, glm::vec3(2 * lit::squareSide, 1.0f, 2 * lit::squareSide));
+
+    uint64_t hits = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++) {
+        hits += drone::isDroneInTheZone(positions[i & (NUM_POSITIONS - 1)], zoneCenter);
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(hits);
+    SetHitLabel(state, hits);
+}
+BENCHMARK(DroneInTheZone);
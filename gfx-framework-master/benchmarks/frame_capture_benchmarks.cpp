@@ -0,0 +1,104 @@
+#include "benchmark.h"
+
+#include "core/gpu/capture_ring.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+
+// Drives the ring the way FrameCapture does, with the reads and the encodes
+// finishing at random and the encodes out of order, for many times more
+// frames than there are slots. Every frame is released once, in capture
+// order, and only after its own encode has finished, not the one of the
+// frame the slot held before.
+static void FrameCaptureRingCycles(bench::Checker &checker)
+{
+    const unsigned int numSlots = 4;
+    const unsigned int numFrames = 1000;
+
+    CaptureRing ring(numSlots);
+    std::vector<unsigned int> frameOf(numSlots, 0);
+    std::vector<bool> encoded(numFrames, false);
+    std::deque<unsigned int> jobs;
+
+    unsigned int captured = 0, released = 0, outOfOrder = 0, notEncoded = 0;
+    unsigned int random = 12345;
+
+    auto next = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return random >> 16;
+    };
+
+    auto release = [&]() {
+        unsigned int frame = frameOf[ring.GetOldest()];
+        if (frame != released)
+            outOfOrder++;
+        if (!encoded[frame])
+            notEncoded++;
+        ring.ReleaseOldest();
+        released++;
+    };
+
+    auto encode = [&](unsigned int job) {
+        unsigned int slot = jobs[job];
+        jobs.erase(jobs.begin() + job);
+        encoded[frameOf[slot]] = true;
+        ring.SetEncoded(slot);
+    };
+
+    while (released < numFrames)
+    {
+        unsigned int action = next() % 4;
+
+        if (action == 0 && captured < numFrames)
+        {
+            // A full ring waits for its oldest frame, as Capture does
+            if (ring.IsFull())
+            {
+                unsigned int oldest = ring.GetOldest();
+                if (ring.GetState(oldest) == CaptureRing::READING)
+                {
+                    ring.SetMapped(oldest);
+                    jobs.push_back(oldest);
+                }
+                while (!ring.IsEncoded(oldest))
+                    encode(0);
+                release();
+            }
+
+            unsigned int slot = ring.Begin();
+            frameOf[slot] = captured++;
+        }
+        else if (action == 1)
+        {
+            // The reads finish in order
+            for (unsigned int i = 0; i < ring.GetNumInFlight(); i++)
+            {
+                unsigned int slot = ring.GetInFlight(i);
+                if (ring.GetState(slot) == CaptureRing::READING)
+                {
+                    ring.SetMapped(slot);
+                    jobs.push_back(slot);
+                    break;
+                }
+            }
+        }
+        else if (action == 2 && !jobs.empty())
+        {
+            encode(next() % jobs.size());
+        }
+        else if (action == 3 || captured == numFrames)
+        {
+            while (ring.GetNumInFlight() > 0 && ring.IsEncoded(ring.GetOldest()))
+                release();
+        }
+    }
+
+    std::string suffix = " of " + std::to_string(released) + " frames released";
+    checker.Expect(captured == numFrames && released == numFrames, "every captured frame is released");
+    checker.Expect(outOfOrder == 0, std::to_string(outOfOrder) + " frames released out of order" + suffix);
+    checker.Expect(notEncoded == 0, std::to_string(notEncoded) + " frames released before they were encoded" + suffix);
+    checker.Expect(ring.GetNumInFlight() == 0 && jobs.empty(), "the ring is empty at the end");
+}
+CHECK(FrameCaptureRingCycles);
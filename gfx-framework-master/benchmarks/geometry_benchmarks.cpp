@@ -0,0 +1,141 @@
+#include "benchmark.h"
+
+#include "lab_m1/drone_challenge/headers/literals.h"
+#include "lab_m1/drone_challenge/headers/geometry3D.h"
+#include "lab_m1/drone_challenge/headers/world_scale.h"
+#include "core/gpu/mesh_optimizer.h"
+
+#include <algorithm>
+#include <string>
+
+
+// The mesh generators of the drone challenge, on the CPU only: objects3D
+// uploads the same geometry to the GPU. Items are the generated vertices.
+namespace
+{
+    template <class Generate>
+    void MeasureGeometry(bench::State &state, Generate generate)
+    {
+        uint64_t vertices = 0;
+        size_t indices = 0;
+
+        for (uint64_t i = 0; i < state.GetIterations(); i++)
+        {
+            geometry3D::Geometry geometry = generate();
+            bench::DoNotOptimize(geometry.vertices.data());
+
+            vertices += geometry.vertices.size();
+            indices = geometry.indices.size();
+        }
+
+        state.SetItemsProcessed(vertices);
+        state.SetLabel(std::to_string(vertices / std::max<uint64_t>(1, state.GetIterations())) + " vertices, "
+            + std::to_string(indices) + " indices");
+    }
+
+
+    // The triangle meshes go through the same optimization as when uploaded
+    void ExpectConsistentWinding(bench::Checker &checker, const std::string &name, geometry3D::Geometry geometry)
+    {
+        mesh_optimizer::Optimize(geometry.vertices, geometry.indices);
+        unsigned int errors = mesh_optimizer::CountWindingErrors(geometry.vertices, geometry.indices);
+        checker.Expect(errors == 0, name + ": " + std::to_string(errors) + " winding errors");
+    }
+}
+
+
+// The default field, a vertex on every height sample
+static void CreateField(bench::State &state)
+{
+    scale::WorldScale world;
+    glm::vec2 size(world.fieldX, world.fieldZ);
+    glm::ivec2 cells = world.GetFieldCells();
+    MeasureGeometry(state, [size, cells] { return geometry3D::CreateField(lit::origin, size, cells); });
+}
+BENCHMARK(CreateField);
+
+
+static void CreateTreeTrunk(bench::State &state)
+{
+    MeasureGeometry(state, [] { return geometry3D::CreateTreeTrunk(lit::origin, lit::darkBrown, 30); });
+}
+BENCHMARK(CreateTreeTrunk);
+
+
+static void CreateTreeCrown(bench::State &state)
+{
+    MeasureGeometry(state, [] { return geometry3D::CreateTreeCrown(lit::origin, lit::green, 30); });
+}
+BENCHMARK(CreateTreeCrown);
+
+
+static void CreateDroneBody(bench::State &state)
+{
+    MeasureGeometry(state, [] { return geometry3D::CreateDroneBody(lit::origin, lit::gray); });
+}
+BENCHMARK(CreateDroneBody);
+
+
+static void CreateDronePropeller(bench::State &state)
+{
+    MeasureGeometry(state, [] { return geometry3D::CreateDronePropeller(lit::origin, lit::black); });
+}
+BENCHMARK(CreateDronePropeller);
+
+
+static void CreateCube(bench::State &state)
+{
+    MeasureGeometry(state, [] { return geometry3D::CreateCube(lit::houseSide, lit::cream); });
+}
+BENCHMARK(CreateCube);
+
+
+static void CreateHouseRoof(bench::State &state)
+{
+    MeasureGeometry(state, [] { return geometry3D::CreateHouseRoof(lit::scarletRed); });
+}
+BENCHMARK(CreateHouseRoof);
+
+
+static void CreateSquare(bench::State &state)
+{
+    MeasureGeometry(state, [] { return geometry3D::CreateSquare(lit::origin, lit::squareSide, lit::lightBrown, false); });
+}
+BENCHMARK(CreateSquare);
+
+
+static void CreateArrow(bench::State &state)
+{
+    MeasureGeometry(state, [] { return geometry3D::CreateArrow(lit::origin, lit::scarletRed); });
+}
+BENCHMARK(CreateArrow);
+
+
+static void CreateTriangle(bench::State &state)
+{
+    MeasureGeometry(state, [] { return geometry3D::CreateTriangle(lit::origin, lit::lightBrown); });
+}
+BENCHMARK(CreateTriangle);
+
+
+static void OptimizedWinding(bench::Checker &checker)
+{
+    ExpectConsistentWinding(checker, "field", geometry3D::CreateField(lit::origin, glm::vec2(50.0f), glm::ivec2(50)));
+    ExpectConsistentWinding(checker, "treeTrunk", geometry3D::CreateTreeTrunk(lit::origin, lit::darkBrown, 30));
+    ExpectConsistentWinding(checker, "treeCrown", geometry3D::CreateTreeCrown(lit::origin, lit::green, 30));
+    ExpectConsistentWinding(checker, "droneBody", geometry3D::CreateDroneBody(lit::origin, lit::gray));
+    ExpectConsistentWinding(checker, "dronePropeller", geometry3D::CreateDronePropeller(lit::origin, lit::black));
+    ExpectConsistentWinding(checker, "cube", geometry3D::CreateCube(lit::houseSide, lit::cream));
+    ExpectConsistentWinding(checker, "houseRoof", geometry3D::CreateHouseRoof(lit::scarletRed));
+    ExpectConsistentWinding(checker, "arrow", geometry3D::CreateArrow(lit::origin, lit::scarletRed));
+    ExpectConsistentWinding(checker, "triangle", geometry3D::CreateTriangle(lit::origin, lit::lightBrown));
+
+    // Every other triangle of the cube turned around, the optimization rewinds them
+    geometry3D::Geometry cube = geometry3D::CreateCube(lit::houseSide, lit::cream);
+    for (size_t i = 0; i + 2 < cube.indices.size(); i += 6) {
+        std::swap(cube.indices[i + 1], cube.indices[i + 2]);
+    }
+    checker.Expect(mesh_optimizer::CountWindingErrors(cube.vertices, cube.indices) > 0, "flipped cube has winding errors");
+    ExpectConsistentWinding(checker, "flipped cube", cube);
+}
+CHECK(OptimizedWinding);
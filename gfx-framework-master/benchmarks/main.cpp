@@ -0,0 +1,7 @@
+#include "benchmark.h"
+
+
+int main(int argc, char **argv)
+{
+    return bench::Main(argc, argv);
+}
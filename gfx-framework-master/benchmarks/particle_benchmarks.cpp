@@ -0,0 +1,43 @@
+#include "benchmark.h"
+
+#include "lab_m1/drone_challenge/headers/literals.h"
+#include "lab_m1/drone_challenge/headers/particles.h"
+#include "lab_m1/drone_challenge/headers/world_scale.h"
+
+#include <string>
+
+
+// A step of the rain around a camera looking slightly down, like the drone's,
+// so part of the particles is culled. Each iteration hands the step to the
+// thread of the system and waits for it, as a frame does.
+static void ParticleSystemStep(bench::State &state)
+{
+    unsigned int capacity = static_cast<unsigned int>(state.GetArgument());
+    particles::ParticleSystem system(particles::RAIN, capacity);
+
+    scale::WorldScale world;
+    particles::Environment environment;
+    environment.camera = glm::vec3(0.0f, 5.0f, 0.0f);
+    environment.viewProjection = glm::perspective(lit::fov, 16.0f / 9.0f, world.cameraNear, world.cameraFar) *
+        glm::lookAt(environment.camera, glm::vec3(0.0f, 3.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    environment.wind = lit::weatherWind;
+    environment.groundHeight = 0.0f;
+    environment.washCenter = glm::vec3(0.0f);
+    environment.washStrength = 0.0f;
+
+    // The first step spreads the particles
+    system.Simulate(1.0f / 60.0f, environment);
+    system.Wait();
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        system.Simulate(1.0f / 60.0f, environment);
+        system.Wait();
+    }
+    state.Stop();
+
+    state.SetItemsProcessed(state.GetIterations() * system.GetCapacity());
+    state.SetLabel(std::to_string(system.GetNumVisible()) + " drawn");
+}
+BENCHMARK_ARGS(ParticleSystemStep, 1 << 16, 1 << 20);
@@ -0,0 +1,152 @@
+#include "benchmark.h"
+
+#include "lab_m1/drone_challenge/headers/drone_challenge.h"
+#include "lab_m1/drone_challenge/headers/literals.h"
+#include "lab_m1/drone_challenge/headers/heightfield.h"
+#include "lab_m1/drone_challenge/headers/obstacles.h"
+#include "lab_m1/drone_challenge/headers/raycast.h"
+#include "lab_m1/drone_challenge/headers/worker_pool.h"
+#include "lab_m1/drone_challenge/headers/world_scale.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+
+
+// The ray casts of the LiDAR against the default world: the obstacles the
+// game places and the field baked at one sample per texel. The rays start
+// above the field outside of everything, like the drone, in random directions.
+namespace
+{
+    struct CastWorld
+    {
+        CastWorld()
+        {
+            scale::WorldScale world;
+            std::vector<m1::Obstacle> packagesAndZones;
+            obstacles = obstacle::GeneratePositionsAndSizes(world, packagesAndZones);
+
+            glm::ivec2 samples = world.GetHeightSamples();
+            field.Bake(1.0f, lit::fieldNoiseFrequency, world.GetFieldMin(), world.GetFieldMax(), samples.x, samples.y);
+            caster.Build(obstacles, field);
+        }
+
+        std::vector<m1::Obstacle> obstacles;
+        heightfield::HeightField field;
+        raycast::RayCaster caster;
+    };
+
+
+    std::vector<raycast::Ray> RandomRays(const raycast::RayCaster &caster, unsigned int numRays)
+    {
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        glm::vec2 fieldMin = scale::WorldScale().GetFieldMin(), fieldMax = scale::WorldScale().GetFieldMax();
+
+        std::vector<raycast::Ray> rays(numRays);
+        for (raycast::Ray &ray : rays)
+        {
+            ray.maxDistance = 60.0f;
+
+            do {
+                ray.direction = glm::vec3(unit(generator), unit(generator), unit(generator));
+            } while (glm::length(ray.direction) > 1.0f || glm::length(ray.direction) < 0.1f);
+            ray.direction = glm::normalize(ray.direction);
+
+            raycast::Ray probe;
+            do {
+                glm::vec2 corner = glm::mix(fieldMin, fieldMax, (glm::vec2(unit(generator), unit(generator)) + 1.0f) * 0.5f);
+                ray.origin = glm::vec3(corner.x, 0.5f + (unit(generator) + 1.0f) * 4.0f, corner.y);
+                probe = ray;
+                probe.maxDistance = 0.0f;
+            } while (caster.CastBruteForce(probe).kind != raycast::NONE);
+        }
+        return rays;
+    }
+
+
+    // Whether the reference finds the ray inside a shape or under the field
+    // somewhere from `first` to `last`, probed every 10 micrometers
+    bool IsInside(const raycast::RayCaster &caster, const raycast::Ray &ray, float first, float last)
+    {
+        raycast::Ray probe = ray;
+        probe.maxDistance = 0.0f;
+
+        for (float t = first; t <= last; t += 1e-5f)
+        {
+            probe.origin = ray.origin + ray.direction * t;
+            if (caster.CastBruteForce(probe).kind != raycast::NONE)
+                return true;
+        }
+        return false;
+    }
+}
+
+
+// The argument is the number of threads, 1 casts on the calling thread
+static void RayCasterCast(bench::State &state)
+{
+    CastWorld world;
+    std::vector<raycast::Ray> rays = RandomRays(world.caster, 4096);
+    std::vector<raycast::RayHit> hits;
+    unsigned int numThreads = static_cast<unsigned int>(state.GetArgument());
+    workers::WorkerPool pool(numThreads);
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        world.caster.Cast(rays, hits, numThreads > 1 ? &pool : nullptr);
+        bench::DoNotOptimize(hits.data());
+    }
+    state.Stop();
+
+    state.SetItemsProcessed(state.GetIterations() * rays.size());
+    state.SetLabel(std::to_string(world.caster.GetNumShapes()) + " shapes");
+}
+BENCHMARK_ARGS(RayCasterCast, 1, 4);
+
+
+// The packets spread over the pool against the brute-force march. Rays that
+// graze a surface cross slivers thinner than the 5 mm step of the march, which
+// it may step over, and tangents that float roots may miss. A packet hit in
+// front of the reference only passes when the surface is right there, else it
+// is a false positive, and one behind it only when the reference hit a sliver.
+static void RayCasterMatchesBruteForce(bench::Checker &checker)
+{
+    const float tolerance = 0.01f, sliver = 0.005f;
+
+    CastWorld world;
+    std::vector<raycast::Ray> rays = RandomRays(world.caster, 2000);
+    std::vector<raycast::RayHit> hits;
+    workers::WorkerPool pool(4);
+    world.caster.Cast(rays, hits, &pool);
+
+    unsigned int falseHits = 0, missedHits = 0, kinds = 0, grazing = 0;
+    for (size_t i = 0; i < rays.size(); i++)
+    {
+        const raycast::RayHit &hit = hits[i];
+        raycast::RayHit expected = world.caster.CastBruteForce(rays[i]);
+
+        if (hit.distance < expected.distance - tolerance)
+        {
+            bool surface = IsInside(world.caster, rays[i], hit.distance, hit.distance + tolerance);
+            (surface ? grazing : falseHits)++;
+        }
+        else if (hit.distance > expected.distance + tolerance)
+        {
+            bool thin = !IsInside(world.caster, rays[i], expected.distance + sliver, expected.distance + sliver);
+            (thin ? grazing : missedHits)++;
+        }
+        else if (hit.kind != expected.kind)
+        {
+            kinds++;
+        }
+    }
+
+    std::string suffix = " of " + std::to_string(rays.size()) + " rays";
+    checker.Expect(falseHits == 0, std::to_string(falseHits) + " hits where the reference finds no surface" + suffix);
+    checker.Expect(missedHits == 0, std::to_string(missedHits) + " surfaces the packets pass through" + suffix);
+    checker.Expect(kinds == 0, std::to_string(kinds) + " hits on another kind of shape" + suffix);
+    checker.Expect(grazing <= rays.size() / 100, std::to_string(grazing) + " grazing hits" + suffix);
+}
+CHECK(RayCasterMatchesBruteForce);
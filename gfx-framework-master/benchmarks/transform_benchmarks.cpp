@@ -0,0 +1,147 @@
+#include "benchmark.h"
+
+#include "lab_m1/drone_challenge/headers/drone_challenge.h"
+#include "lab_m1/drone_challenge/headers/literals.h"
+#include "lab_m1/drone_challenge/headers/transforms3D.h"
+#include "lab_m1/drone_challenge/headers/drone.h"
+#include "lab_m1/drone_challenge/headers/camera.h"
+
+
+// The matrices of transforms3D and the camera math run every frame. The
+// inputs change with the iteration, so that nothing is computed only once.
+namespace
+{
+    float Angle(uint64_t i)
+    {
+        return static_cast<float>(i & 1023) * 0.001f;
+    }
+}
+
+
+static void Translate(bench::State &state)
+{
+    for (uint64_t i = 0; i < state.GetIterations(); i++) {
+        bench::DoNotOptimize(transforms3D::Translate(Angle(i), 2.0f, -Angle(i)));
+    }
+}
+BENCHMARK(Translate);
+
+
+static void Scale(bench::State &state)
+{
+    for (uint64_t i = 0; i < state.GetIterations(); i++) {
+        bench::DoNotOptimize(transforms3D::Scale(Angle(i), 2.0f, 1.0f + Angle(i)));
+    }
+}
+BENCHMARK(Scale);
+
+
+static void RotateOX(bench::State &state)
+{
+    for (uint64_t i = 0; i < state.GetIterations(); i++) {
+        bench::DoNotOptimize(transforms3D::RotateOX(Angle(i)));
+    }
+}
+BENCHMARK(RotateOX);
+
+
+static void RotateOY(bench::State &state)
+{
+    for (uint64_t i = 0; i < state.GetIterations(); i++) {
+        bench::DoNotOptimize(transforms3D::RotateOY(Angle(i)));
+    }
+}
+BENCHMARK(RotateOY);
+
+
+static void RotateOZ(bench::State &state)
+{
+    for (uint64_t i = 0; i < state.GetIterations(); i++) {
+        bench::DoNotOptimize(transforms3D::RotateOZ(Angle(i)));
+    }
+}
+BENCHMARK(RotateOZ);
+
+
+// The model matrix of the drone, a composition of the transforms above
+static void GenerateDrone(bench::State &state)
+{
+    for (uint64_t i = 0; i < state.GetIterations(); i++) {
+        bench::DoNotOptimize(drone::GenerateDrone(glm::vec3(Angle(i), 5.0f, 1.0f), Angle(i), 2 * Angle(i), -Angle(i)));
+    }
+}
+BENCHMARK(GenerateDrone);
+
+
+// The argument is the rotation axis, 0 for OX, 1 for OY and 2 for OZ
+static void CameraRotateFirstPerson(bench::State &state)
+{
+    camera::Camera camera;
+    camera.Set(glm::vec3(0, 2, 5), glm::vec3(0, 1, 0), glm::vec3(0, 1, 0));
+    int64_t axis = state.GetArgument();
+
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        if (axis == 0) {
+            camera.RotateFirstPerson_OX(0.001f);
+        } else if (axis == 1) {
+            camera.RotateFirstPerson_OY(0.001f);
+        } else {
+            camera.RotateFirstPerson_OZ(0.001f);
+        }
+    }
+
+    bench::DoNotOptimize(camera.GetTargetPosition());
+}
+BENCHMARK_ARGS(CameraRotateFirstPerson, 0, 1, 2);
+
+
+static void CameraRotateThirdPerson(bench::State &state)
+{
+    camera::Camera camera;
+    camera.Set(glm::vec3(0, 2, 5), glm::vec3(0, 1, 0), glm::vec3(0, 1, 0));
+    int64_t axis = state.GetArgument();
+
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        if (axis == 0) {
+            camera.RotateThirdPerson_OX(0.001f);
+        } else if (axis == 1) {
+            camera.RotateThirdPerson_OY(0.001f);
+        } else {
+            camera.RotateThirdPerson_OZ(0.001f);
+        }
+    }
+
+    bench::DoNotOptimize(camera.GetTargetPosition());
+}
+BENCHMARK_ARGS(CameraRotateThirdPerson, 0, 1, 2);
+
+
+// The follow camera of the drone, turned by its yaw every frame
+static void CameraUpdate(bench::State &state)
+{
+    camera::Camera camera;
+    camera.Set(glm::vec3(0, 2, 5), glm::vec3(0, 1, 0), glm::vec3(0, 1, 0));
+
+    for (uint64_t i = 0; i < state.GetIterations(); i++) {
+        camera.Update(Angle(i));
+    }
+
+    bench::DoNotOptimize(camera.GetTargetPosition());
+}
+BENCHMARK(CameraUpdate);
+
+
+static void CameraGetViewMatrix(bench::State &state)
+{
+    camera::Camera camera;
+    camera.Set(glm::vec3(0, 2, 5), glm::vec3(0, 1, 0), glm::vec3(0, 1, 0));
+
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        camera.position.x = Angle(i);
+        bench::DoNotOptimize(camera.GetViewMatrix());
+    }
+}
+BENCHMARK(CameraGetViewMatrix);
@@ -0,0 +1,75 @@
+#include "benchmark.h"
+
+#include "core/triple_buffer.h"
+
+#include <string>
+#include <thread>
+
+
+namespace
+{
+    // Every word is derived from the sequence number, a value mixed from
+    // two publishes has words that disagree
+    struct Payload
+    {
+        unsigned int sequence;
+        unsigned int words[15];
+    };
+
+
+    bool IsWhole(const Payload &payload)
+    {
+        for (unsigned int i = 0; i < 15; i++)
+        {
+            if (payload.words[i] != payload.sequence * (i + 2))
+                return false;
+        }
+        return true;
+    }
+}
+
+
+// A writer thread publishes numbered values as fast as it can while the
+// calling thread reads them. Every value read is one that was published
+// whole, and the values only move forward, up to the last one.
+static void TripleBufferHandOff(bench::Checker &checker)
+{
+    const unsigned int numPublished = 2000000;
+
+    TripleBuffer<Payload> buffer;
+    Payload &first = buffer.GetBack();
+    first = Payload();
+    buffer.Publish();
+
+    std::thread writer([&buffer, numPublished]()
+    {
+        for (unsigned int sequence = 1; sequence <= numPublished; sequence++)
+        {
+            Payload &payload = buffer.GetBack();
+            payload.sequence = sequence;
+            for (unsigned int i = 0; i < 15; i++)
+                payload.words[i] = sequence * (i + 2);
+            buffer.Publish();
+        }
+    });
+
+    unsigned int last = 0, torn = 0, backwards = 0, distinct = 0;
+    while (last < numPublished)
+    {
+        const Payload &payload = buffer.Read();
+        if (!IsWhole(payload))
+            torn++;
+        if (payload.sequence < last)
+            backwards++;
+        if (payload.sequence != last)
+            distinct++;
+        last = payload.sequence;
+    }
+    writer.join();
+
+    std::string suffix = " of " + std::to_string(distinct) + " values read";
+    checker.Expect(torn == 0, std::to_string(torn) + " reads mixed two publishes" + suffix);
+    checker.Expect(backwards == 0, std::to_string(backwards) + " reads went back to an older value" + suffix);
+    checker.Expect(buffer.Read().sequence == numPublished, "the last value is read");
+}
+CHECK(TripleBufferHandOff);
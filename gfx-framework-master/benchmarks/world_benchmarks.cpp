@@ -0,0 +1,266 @@
+#include "benchmark.h"
+
+#include "lab_m1/drone_challenge/headers/drone_challenge.h"
+#include "lab_m1/drone_challenge/headers/literals.h"
+#include "lab_m1/drone_challenge/headers/obstacles.h"
+#include "lab_m1/drone_challenge/headers/heightfield.h"
+#include "lab_m1/drone_challenge/headers/world_scale.h"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+
+
+// The generation of the world: the obstacle placement and the terrain noise.
+// The noise of the field is the one of the height field, baked at the size of
+// the argument in samples per side, then sampled and queried by collisions.
+namespace
+{
+    const size_t NUM_POINTS = 1024;
+
+    // The samples per side of the default field
+    const int GAME_SAMPLES = 50 * lit::heightSamplesPerUnit + 1;
+
+
+    glm::vec2 FieldMin() { return scale::WorldScale().GetFieldMin(); }
+    glm::vec2 FieldMax() { return scale::WorldScale().GetFieldMax(); }
+
+
+    std::vector<glm::vec2> RandomFieldPoints()
+    {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> x(FieldMin().x, FieldMax().x);
+        std::uniform_real_distribution<float> z(FieldMin().y, FieldMax().y);
+
+        std::vector<glm::vec2> points(NUM_POINTS);
+        for (glm::vec2 &point : points) {
+            point = glm::vec2(x(generator), z(generator));
+        }
+        return points;
+    }
+
+
+    void BakeField(heightfield::HeightField &field, int samples)
+    {
+        field.Bake(1.0f, lit::fieldNoiseFrequency, FieldMin(), FieldMax(), samples, samples);
+    }
+
+
+    // Rectangles of up to a tenth of the field on each side, clipped to it
+    void RandomFieldRects(std::vector<glm::vec2> &rectMin, std::vector<glm::vec2> &rectMax)
+    {
+        std::mt19937 generator(7);
+        std::uniform_real_distribution<float> corner(0.0f, 1.0f), extent(0.0f, 0.1f);
+        glm::vec2 size = FieldMax() - FieldMin();
+
+        rectMin.resize(NUM_POINTS);
+        rectMax.resize(NUM_POINTS);
+        for (size_t i = 0; i < NUM_POINTS; i++)
+        {
+            rectMin[i] = FieldMin() + size * glm::vec2(corner(generator), corner(generator));
+            rectMax[i] = glm::min(rectMin[i] + size * glm::vec2(extent(generator), extent(generator)), FieldMax());
+        }
+    }
+
+
+    // The maximum of the bilinear terrain over a rectangle is on one of its corners,
+    // on a sample inside it or where its sides cross the sample rows and columns
+    float SampleMaxHeight(const heightfield::HeightField &field, glm::vec2 rectMin, glm::vec2 rectMax)
+    {
+        std::vector<float> xs = { rectMin.x, rectMax.x }, zs = { rectMin.y, rectMax.y };
+        for (int x = 0; x < field.GetWidth(); x++)
+        {
+            float px = field.GetPoint(x, 0).x;
+            if (px > rectMin.x && px < rectMax.x) {
+                xs.push_back(px);
+            }
+        }
+        for (int z = 0; z < field.GetDepth(); z++)
+        {
+            float pz = field.GetPoint(0, z).y;
+            if (pz > rectMin.y && pz < rectMax.y) {
+                zs.push_back(pz);
+            }
+        }
+
+        float sampled = -std::numeric_limits<float>::max();
+        for (float z : zs)
+        {
+            for (float x : xs) {
+                sampled = std::max(sampled, field.Sample(x, z));
+            }
+        }
+        return sampled;
+    }
+}
+
+
+// The argument is the number of obstacles on the default field, the game places 35
+static void GeneratePositionsAndSizes(bench::State &state)
+{
+    scale::WorldScale world;
+    world.numOfObstacles = static_cast<int>(state.GetArgument());
+    int numOfObstacles = world.numOfObstacles;
+    std::vector<m1::Obstacle> packagesAndZones;
+
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        packagesAndZones.clear();
+        std::vector<m1::Obstacle> obstacles = obstacle::GeneratePositionsAndSizes(world, packagesAndZones);
+        bench::DoNotOptimize(obstacles.data());
+    }
+
+    state.SetItemsProcessed(state.GetIterations() * numOfObstacles);
+}
+BENCHMARK_ARGS(GeneratePositionsAndSizes, 35, 64, 256, 1024);
+
+
+static void NoiseLatticeValue(bench::State &state)
+{
+    float sum = 0.0f;
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        glm::vec2 point(static_cast<float>(i & 255), static_cast<float>((i >> 8) & 255));
+        sum += heightfield::LatticeValue(point, 1.0f);
+    }
+
+    bench::DoNotOptimize(sum);
+}
+BENCHMARK(NoiseLatticeValue);
+
+
+// Items are the height samples, the bake is spread over the hardware threads
+static void HeightFieldBake(bench::State &state)
+{
+    int samples = static_cast<int>(state.GetArgument());
+    heightfield::HeightField field;
+
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        BakeField(field, samples);
+        bench::DoNotOptimize(field.GetHeights().data());
+    }
+
+    state.SetItemsProcessed(state.GetIterations() * samples * samples);
+}
+BENCHMARK_ARGS(HeightFieldBake, 65, GAME_SAMPLES, 513, 1025);
+
+
+static void HeightFieldSample(bench::State &state)
+{
+    heightfield::HeightField field;
+    BakeField(field, static_cast<int>(state.GetArgument()));
+    std::vector<glm::vec2> points = RandomFieldPoints();
+
+    float sum = 0.0f;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        const glm::vec2 &point = points[i & (NUM_POINTS - 1)];
+        sum += field.Sample(point.x, point.y);
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(sum);
+}
+BENCHMARK_ARGS(HeightFieldSample, GAME_SAMPLES);
+
+
+// The query of the field collision, over a footprint the size of the drone
+static void HeightPyramidIntersects(bench::State &state)
+{
+    heightfield::HeightField field;
+    BakeField(field, static_cast<int>(state.GetArgument()));
+    std::vector<glm::vec2> points = RandomFieldPoints();
+    const glm::vec2 halfSize(lit::droneBodyOX / 2.0f);
+
+    uint64_t hits = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        const glm::vec2 &point = points[i & (NUM_POINTS - 1)];
+        hits += field.GetPyramid().Intersects(point - halfSize, point + halfSize, 0.5f);
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(hits);
+}
+BENCHMARK_ARGS(HeightPyramidIntersects, GAME_SAMPLES, 1025);
+
+
+static void HeightPyramidMaxHeight(bench::State &state)
+{
+    heightfield::HeightField field;
+    BakeField(field, static_cast<int>(state.GetArgument()));
+    std::vector<glm::vec2> rectMin, rectMax;
+    RandomFieldRects(rectMin, rectMax);
+
+    float sum = 0.0f;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        size_t r = i & (NUM_POINTS - 1);
+        sum += field.GetPyramid().GetMaxHeight(rectMin[r], rectMax[r]);
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(sum);
+}
+BENCHMARK_ARGS(HeightPyramidMaxHeight, GAME_SAMPLES, 1025);
+
+
+static void HeightPyramidExactMaxHeight(bench::State &state)
+{
+    heightfield::HeightField field;
+    BakeField(field, static_cast<int>(state.GetArgument()));
+    std::vector<glm::vec2> rectMin, rectMax;
+    RandomFieldRects(rectMin, rectMax);
+
+    float sum = 0.0f;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); i++)
+    {
+        size_t r = i & (NUM_POINTS - 1);
+        sum += field.GetPyramid().GetExactMaxHeight(rectMin[r], rectMax[r]);
+    }
+    state.Stop();
+
+    bench::DoNotOptimize(sum);
+}
+BENCHMARK_ARGS(HeightPyramidExactMaxHeight, GAME_SAMPLES, 1025);
+
+
+// The pyramid queries against the sampled terrain: the exact maximum matches it,
+// the bound is never below it and Intersects splits the heights around it
+static void HeightPyramidQueries(bench::Checker &checker)
+{
+    const int sizes[] = { GAME_SAMPLES, 1025 };
+    for (int samples : sizes)
+    {
+        heightfield::HeightField field;
+        BakeField(field, samples);
+        const heightfield::HeightPyramid &pyramid = field.GetPyramid();
+
+        std::vector<glm::vec2> rectMin, rectMax;
+        RandomFieldRects(rectMin, rectMax);
+
+        unsigned int exactErrors = 0, boundErrors = 0, intersectErrors = 0;
+        for (size_t i = 0; i < NUM_POINTS; i++)
+        {
+            float sampled = SampleMaxHeight(field, rectMin[i], rectMax[i]);
+            float exact = pyramid.GetExactMaxHeight(rectMin[i], rectMax[i]);
+
+            exactErrors += std::abs(exact - sampled) > 1e-5f;
+            boundErrors += pyramid.GetMaxHeight(rectMin[i], rectMax[i]) < exact - 1e-5f;
+            intersectErrors += !pyramid.Intersects(rectMin[i], rectMax[i], exact - 1e-3f)
+                || pyramid.Intersects(rectMin[i], rectMax[i], exact + 1e-3f);
+        }
+
+        std::string suffix = " of " + std::to_string(NUM_POINTS) + " queries on " + std::to_string(samples) + " samples";
+        checker.Expect(exactErrors == 0, std::to_string(exactErrors) + " exact maxima differ from the samples" + suffix);
+        checker.Expect(boundErrors == 0, std::to_string(boundErrors) + " bounds below the exact maximum" + suffix);
+        checker.Expect(intersectErrors == 0, std::to_string(intersectErrors) + " wrong intersections" + suffix);
+    }
+}
+CHECK(HeightPyramidQueries);
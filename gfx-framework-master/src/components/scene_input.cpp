@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "components/simple_scene.h"
+#include "core/profiler.h"
 
 
 gfxc::SceneInput::SceneInput(SimpleScene *scene)
@@ -13,16 +14,48 @@ gfxc::SceneInput::SceneInput(SimpleScene *scene)
 
 void gfxc::SceneInput::OnKeyPress(int key, int mods)
 {
+    // The keys that change what is drawn wait for the render thread, if any
     if (key == GLFW_KEY_F3)
     {
-        scene->ToggleGroundPlane();
+        scene->RunOnRenderThread([this]() { scene->ToggleGroundPlane(); });
     }
 
     if (key == GLFW_KEY_F5)
     {
-        scene->ReloadShaders();
+        scene->RunOnRenderThread([this]() { scene->ReloadShaders(); });
     }
 
+    if (key == GLFW_KEY_PAUSE || key == GLFW_KEY_F6)
+    {
+        scene->Pause();
+    }
+
+    if (key == GLFW_KEY_F9)
+    {
+        // Shift records a raw video stream instead of one PNG per frame
+        scene->RunOnRenderThread([this, mods]() {
+            if (scene->IsCapturing()) {
+                scene->StopCapture();
+            } else if (mods & GLFW_MOD_SHIFT) {
+                scene->StartCapture(PATH_JOIN(window->props.selfDir, "capture.rgb"), FrameCapture::RAW_VIDEO);
+            } else {
+                scene->StartCapture(PATH_JOIN(window->props.selfDir, "capture_"), FrameCapture::PNG);
+            }
+        });
+    }
+
+#ifdef PROFILE
+    if (key == GLFW_KEY_F8)
+    {
+        // The last 300 frames, the GPU zones of the newest ones are not read back yet.
+        // The render thread writes the frames, so they are exported from it.
+        scene->RunOnRenderThread([this]() {
+            uint64_t frame = Profiler::GetFrameIndex();
+            Profiler::ExportChromeTrace(PATH_JOIN(window->props.selfDir, "profile.json"), frame > 300 ? frame - 300 : 0, frame);
+        });
+    }
+#endif
+
     if (key == GLFW_KEY_ESCAPE)
     {
         scene->Exit();
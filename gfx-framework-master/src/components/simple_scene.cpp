@@ -6,6 +6,7 @@
 #include "components/camera_input.h"
 #include "components/scene_input.h"
 #include "components/transform.h"
+#include "core/gpu/render_stats.h"
 
 using namespace gfxc;
 
@@ -69,12 +70,14 @@ void SimpleScene::InitResources()
         simpleLine->SetDrawMode(GL_LINES);
     }
 
+    double shaderStartTime = Engine::GetElapsedTime();
+
     // Create a shader program for drawing face polygon with the color of the normal
     {
         Shader *shader = new Shader("Simple");
         shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "MVP.Texture.VS.glsl"), GL_VERTEX_SHADER);
         shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "Default.FS.glsl"), GL_FRAGMENT_SHADER);
-        shader->CreateAndLink();
+        shader->StartCompile();
         shaders[shader->GetName()] = shader;
     }
 
@@ -83,7 +86,7 @@ void SimpleScene::InitResources()
         Shader *shader = new Shader("Color");
         shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "MVP.Texture.VS.glsl"), GL_VERTEX_SHADER);
         shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "Color.FS.glsl"), GL_FRAGMENT_SHADER);
-        shader->CreateAndLink();
+        shader->StartCompile();
         shaders[shader->GetName()] = shader;
     }
 
@@ -92,7 +95,7 @@ void SimpleScene::InitResources()
         Shader *shader = new Shader("VertexNormal");
         shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "MVP.Texture.VS.glsl"), GL_VERTEX_SHADER);
         shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "Normals.FS.glsl"), GL_FRAGMENT_SHADER);
-        shader->CreateAndLink();
+        shader->StartCompile();
         shaders[shader->GetName()] = shader;
     }
 
@@ -101,10 +104,19 @@ void SimpleScene::InitResources()
         Shader *shader = new Shader("VertexColor");
         shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "MVP.Texture.VS.glsl"), GL_VERTEX_SHADER);
         shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "VertexColor.FS.glsl"), GL_FRAGMENT_SHADER);
-        shader->CreateAndLink();
+        shader->StartCompile();
         shaders[shader->GetName()] = shader;
     }
 
+    // The programs were all started above, so they compile concurrently
+    for (auto &shader : shaders) {
+        shader.second->CreateAndLink();
+    }
+
+    ShaderCache::Stats shaderStats = ShaderCache::GetStats();
+    std::cout << "Default shaders ready in " << 1000 * (Engine::GetElapsedTime() - shaderStartTime) << " ms ("
+        << shaderStats.loaded << " programs from the cache, " << shaderStats.compiled << " compiled)" << std::endl;
+
     // Default rendering mode will use depth buffer
     glDepthMask(GL_TRUE);
     glEnable(GL_DEPTH_TEST);
@@ -142,27 +154,31 @@ void SimpleScene::DrawCoordinateSystem(const glm::mat4 & viewMatrix, const glm::
         {
             objectModel->SetScale(glm::vec3(1));
             objectModel->SetWorldPosition(glm::vec3(0));
-            glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(objectModel->GetModel()));
+            glm::mat4 planeModel = objectModel->GetModel() * xozPlane->GetVertexLayout().GetPositionTransform();
+            glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(planeModel));
             glUniform3f(shader->GetUniformLocation("color"), 0.5f, 0.5f, 0.5f);
             xozPlane->Render();
         }
 
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
+        // Packed positions of the meshes are mapped back by their model matrix
+        glm::mat4 lineTransform = simpleLine->GetVertexLayout().GetPositionTransform();
+
         glLineWidth(3);
         objectModel->SetScale(glm::vec3(1, 25, 1));
         objectModel->SetWorldRotation(glm::quat());
-        glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(objectModel->GetModel()));
+        glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(objectModel->GetModel() * lineTransform));
         glUniform3f(shader->GetUniformLocation("color"), 0, 1, 0);
         simpleLine->Render();
 
         objectModel->SetWorldRotation(glm::vec3(0, 0, -90));
-        glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(objectModel->GetModel()));
+        glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(objectModel->GetModel() * lineTransform));
         glUniform3f(shader->GetUniformLocation("color"), 1, 0, 0);
         simpleLine->Render();
 
         objectModel->SetWorldRotation(glm::vec3(90, 0, 0));
-        glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(objectModel->GetModel()));
+        glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(objectModel->GetModel() * lineTransform));
         glUniform3f(shader->GetUniformLocation("color"), 0, 0, 1);
         simpleLine->Render();
 
@@ -185,8 +201,9 @@ void SimpleScene::RenderMesh(Mesh * mesh, Shader * shader, glm::vec3 position, g
 
     glm::mat4 model(1);
     model = glm::translate(model, position);
-    model = glm::scale(model, scale);
+    model = glm::scale(model, scale) * mesh->GetVertexLayout().GetPositionTransform();
     glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(model));
+    RenderStats::CountUniforms(3);
     mesh->Render();
 }
 
@@ -211,9 +228,10 @@ void SimpleScene::RenderMesh2D(Mesh * mesh, Shader * shader, const glm::mat3 &mo
         mm[0][0], mm[0][1], mm[0][2], 0.f,
         mm[1][0], mm[1][1], mm[1][2], 0.f,
         0.f, 0.f, mm[2][2], 0.f,
-        mm[2][0], mm[2][1], 0.f, 1.f);
+        mm[2][0], mm[2][1], 0.f, 1.f) * mesh->GetVertexLayout().GetPositionTransform();
 
     glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(model));
+    RenderStats::CountUniforms(3);
     mesh->Render();
 }
 
@@ -230,7 +248,7 @@ void SimpleScene::RenderMesh2D(Mesh * mesh, const glm::mat3 & modelMatrix, const
         mm[0][0], mm[0][1], mm[0][2], 0.f,
         mm[1][0], mm[1][1], mm[1][2], 0.f,
         0.f, 0.f, mm[2][2], 0.f,
-        mm[2][0], mm[2][1], 0.f, 1.f);
+        mm[2][0], mm[2][1], 0.f, 1.f) * mesh->GetVertexLayout().GetPositionTransform();
 
     // Render an object using the specified shader and the specified position
     shader->Use();
@@ -238,6 +256,7 @@ void SimpleScene::RenderMesh2D(Mesh * mesh, const glm::mat3 & modelMatrix, const
     glUniformMatrix4fv(shader->loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(camera->GetProjectionMatrix()));
     glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(model));
     glUniform3f(shader->GetUniformLocation("color"), color.r, color.g, color.b);
+    RenderStats::CountUniforms(4);
 
     mesh->Render();
 }
@@ -252,7 +271,9 @@ void SimpleScene::RenderMesh(Mesh * mesh, Shader * shader, const glm::mat4 & mod
     shader->Use();
     glUniformMatrix4fv(shader->loc_view_matrix, 1, GL_FALSE, glm::value_ptr(camera->GetViewMatrix()));
     glUniformMatrix4fv(shader->loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(camera->GetProjectionMatrix()));
-    glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+    glm::mat4 model = modelMatrix * mesh->GetVertexLayout().GetPositionTransform();
+    glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(model));
+    RenderStats::CountUniforms(3);
 
     mesh->Render();
 }
@@ -8,17 +8,28 @@
 ******************************************************************/
 #include "components/text_renderer.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include "utils/text_utils.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "core/managers/resource_path.h"
+#include "core/gpu/render_stats.h"
 
 #include "ft2build.h"
 #include FT_FREETYPE_H
 
 
+// Width of the glyph atlas, the height grows with the font size
+static const int ATLAS_WIDTH = 512;
+
+// Empty texels around every glyph, so linear filtering does not bleed
+static const int ATLAS_PADDING = 2;
+
+
 gfxc::TextRenderer::TextRenderer(const std::string &selfDir, GLuint width, GLuint height)
+    : stream(sizeof(TextVertex) * 4096 * 6)
 {
     // Load and configure shader
     Shader *shader = new Shader("ShaderText");
@@ -27,30 +38,45 @@ gfxc::TextRenderer::TextRenderer(const std::string &selfDir, GLuint width, GLuin
     shader->CreateAndLink();
     this->m_textShader = shader;
 
-    
+    // The uniforms are set once, the color travels with the vertices
+    glUseProgram(shader->program);
+
     int loc_projection_matrix = glGetUniformLocation(shader->program, "projection");
     glUniformMatrix4fv(loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(glm::ortho(0.0f, static_cast<GLfloat>(width), static_cast<GLfloat>(height), 0.0f)));
 
     int loc_text = glGetUniformLocation(shader->program, "text");
     glUniform1i(loc_text, 0);
 
+    loc_sdf = glGetUniformLocation(shader->program, "sdf");
+    glUniform1i(loc_sdf, 0);
+    glUseProgram(0);
+
+    memset(Characters, 0, sizeof(Characters));
+    atlas = 0;
+    sdf = false;
+    capHeight = 0;
+    staticCapacity = 0;
+
     // Configure VAO/VBO for texture quads
     glGenVertexArrays(1, &this->VAO);
     glGenBuffers(1, &this->VBO);
-    glBindVertexArray(this->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
 }
 
 
-void gfxc::TextRenderer::Load(std::string font, GLuint fontSize)
+gfxc::TextRenderer::~TextRenderer()
+{
+    glDeleteTextures(1, &atlas);
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+}
+
+
+void gfxc::TextRenderer::Load(std::string font, GLuint fontSize, bool sdf)
 {
     // First clear the previously loaded Characters
-    this->Characters.clear();
+    memset(Characters, 0, sizeof(Characters));
+    ClearStaticText();
+    this->sdf = sdf;
 
     // Initialize and load the freetype library. All freetype functions
     // return a value different than 0 whenever an error occurs.
@@ -59,6 +85,7 @@ void gfxc::TextRenderer::Load(std::string font, GLuint fontSize)
     if (FT_Init_FreeType(&ft))
     {
         std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+        return;
     }
 
     // Load font as face
@@ -66,124 +93,284 @@ void gfxc::TextRenderer::Load(std::string font, GLuint fontSize)
     if (FT_New_Face(ft, font.c_str(), 0, &face))
     {
         std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+        FT_Done_FreeType(ft);
+        return;
     }
 
     // Set size to load glyphs as
     FT_Set_Pixel_Sizes(face, 0, fontSize);
 
-    // Disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // Then for the first 128 ASCII characters, render them and place them in
+    // rows of the atlas, keeping the bitmaps until the atlas size is known
+    std::vector<std::vector<unsigned char>> bitmaps(128);
+    std::vector<glm::ivec2> offsets(128);
+    glm::ivec2 cursor(ATLAS_PADDING);
+    int rowHeight = 0;
 
-    // Then for the first 128 ASCII characters, pre-load/compile their characters and store them
     for (GLubyte c = 0; c < 128; c++)
     {
         // Load character glyph 
-        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+        bool failed = sdf
+            ? FT_Load_Char(face, c, FT_LOAD_DEFAULT) || FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF)
+            : FT_Load_Char(face, c, FT_LOAD_RENDER) != 0;
+
+        if (failed)
         {
             std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
             continue;
         }
 
-        // Generate texture
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-
-        // Set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // Now store character for later use
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            (GLuint)face->glyph->advance.x
-        };
-
-        Characters.insert(std::pair<GLchar, Character>(c, character));
-    }
+        const FT_Bitmap &bitmap = face->glyph->bitmap;
+        glm::ivec2 size(bitmap.width, bitmap.rows);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+        if (cursor.x + size.x + ATLAS_PADDING > ATLAS_WIDTH)
+        {
+            cursor = glm::ivec2(ATLAS_PADDING, cursor.y + rowHeight + ATLAS_PADDING);
+            rowHeight = 0;
+        }
+
+        offsets[c] = cursor;
+        for (int row = 0; row < size.y; row++) {
+            const unsigned char *src = bitmap.buffer + row * bitmap.pitch;
+            bitmaps[c].insert(bitmaps[c].end(), src, src + size.x);
+        }
+
+        // Now store character for later use, the atlas coordinates are set below
+        Character &character = Characters[c];
+        character.Size = size;
+        character.Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+        character.Advance = (GLuint)face->glyph->advance.x;
+
+        cursor.x += size.x + ATLAS_PADDING;
+        rowHeight = std::max(rowHeight, size.y);
+    }
 
     // Destroy freetype once we're finished
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
-}
 
+    int atlasHeight = 1;
+    while (atlasHeight < cursor.y + rowHeight + ATLAS_PADDING) {
+        atlasHeight *= 2;
+    }
 
-void gfxc::TextRenderer::RenderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
-{
-    // Activate corresponding render state    
-    if (this->m_textShader)
+    std::vector<unsigned char> pixels(ATLAS_WIDTH * atlasHeight, 0);
+    for (int c = 0; c < 128; c++)
     {
-        glUseProgram(this->m_textShader->program);
-        CheckOpenGLError();
+        Character &character = Characters[c];
+        for (int row = 0; row < character.Size.y; row++) {
+            memcpy(&pixels[(offsets[c].y + row) * ATLAS_WIDTH + offsets[c].x],
+                &bitmaps[c][row * character.Size.x], character.Size.x);
+        }
+
+        character.UVMin = glm::vec2(offsets[c]) / glm::vec2(ATLAS_WIDTH, atlasHeight);
+        character.UVMax = glm::vec2(offsets[c] + character.Size) / glm::vec2(ATLAS_WIDTH, atlasHeight);
     }
 
-    // TODO(developer): Update this class
-    int loc_text_color = glGetUniformLocation(this->m_textShader->program, "textColor");
-    glUniform3f(loc_text_color, color.r, color.g, color.b);
+    capHeight = Characters['H'].Bearing.y;
+
+    // Disable byte-alignment restriction
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (!atlas) {
+        glGenTextures(1, &atlas);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+
+    // Set texture options
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(this->VAO);
+
+void gfxc::TextRenderer::BuildQuads(const std::string &text, GLfloat x, GLfloat y, GLfloat scale,
+                                    const glm::vec3 &color, std::vector<TextVertex> &out) const
+{
+    glm::vec4 rgba(color, 1.0f);
 
     // Iterate through all characters
     for (auto c = text.cbegin(); c != text.cend(); c++)
     {
-        Character ch = Characters[*c];
+        const Character &ch = Characters[*c & 0x7F];
 
         GLfloat xpos = x + ch.Bearing.x * scale;
-        GLfloat ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+        GLfloat ypos = y + (capHeight - ch.Bearing.y) * scale;
 
         GLfloat w = ch.Size.x * scale;
         GLfloat h = ch.Size.y * scale;
 
-        // Update VBO for each character
-        GLfloat vertices[6][4] = {
-            { xpos,     ypos + h,   0.0, 1.0 },
-            { xpos + w, ypos,       1.0, 0.0 },
-            { xpos,     ypos,       0.0, 0.0 },
+        if (w > 0 && h > 0)
+        {
+            TextVertex quad[6] = {
+                { glm::vec4(xpos,     ypos + h,   ch.UVMin.x, ch.UVMax.y), rgba },
+                { glm::vec4(xpos + w, ypos,       ch.UVMax.x, ch.UVMin.y), rgba },
+                { glm::vec4(xpos,     ypos,       ch.UVMin.x, ch.UVMin.y), rgba },
+
+                { glm::vec4(xpos,     ypos + h,   ch.UVMin.x, ch.UVMax.y), rgba },
+                { glm::vec4(xpos + w, ypos + h,   ch.UVMax.x, ch.UVMax.y), rgba },
+                { glm::vec4(xpos + w, ypos,       ch.UVMax.x, ch.UVMin.y), rgba }
+            };
+            out.insert(out.end(), quad, quad + 6);
+        }
+
+        // Now advance cursors for next glyph. Bitshift by 6
+        // to get value in pixels.
+        x += (ch.Advance >> 6) * scale; 
+    }
+}
+
 
-            { xpos,     ypos + h,   0.0, 1.0 },
-            { xpos + w, ypos + h,   1.0, 1.0 },
-            { xpos + w, ypos,       1.0, 0.0 }
-        };
+void gfxc::TextRenderer::ReserveStatic()
+{
+    unsigned int staticCount = (unsigned int)staticVertices.size();
+    if (staticCount <= staticCapacity)
+        return;
 
-        // Render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
+    staticCapacity = std::max(staticCount, 2 * staticCapacity);
 
-        // Update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // Be sure to use glBufferSubData and not glBufferData
+    // The buffer is re-created, so the static strings are uploaded again
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(TextVertex) * staticCapacity, NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(TextVertex) * staticCount, staticVertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
+
+void gfxc::TextRenderer::SetupAttributes(GLuint buffer, GLintptr offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offset);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)(offset + sizeof(glm::vec4)));
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void gfxc::TextRenderer::RenderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
+{
+    AddText(text, x, y, scale, color);
+    Flush();
+}
+
+
+void gfxc::TextRenderer::AddText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
+{
+    BuildQuads(text, x, y, scale, color, dynamicVertices);
+}
+
+
+unsigned int gfxc::TextRenderer::CreateStaticText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
+{
+    Range range;
+    range.first = (GLint)staticVertices.size();
+    BuildQuads(text, x, y, scale, color, staticVertices);
+    range.count = (GLsizei)(staticVertices.size() - range.first);
+
+    if (staticVertices.size() > staticCapacity)
+    {
+        ReserveStatic();
+    }
+    else if (range.count)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(TextVertex) * range.first, sizeof(TextVertex) * range.count, &staticVertices[range.first]);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 
-        // Render quad
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glDisable(GL_BLEND);
+    staticRanges.push_back(range);
+    return (unsigned int)staticRanges.size() - 1;
+}
 
-        // Now advance cursors for next glyph. Bitshift by 6
-        // to get value in pixels.
-        x += (ch.Advance >> 6) * scale; 
+
+void gfxc::TextRenderer::AddStaticText(unsigned int id)
+{
+    if (id >= staticRanges.size() || staticRanges[id].count == 0)
+        return;
+
+    queuedFirsts.push_back(staticRanges[id].first);
+    queuedCounts.push_back(staticRanges[id].count);
+}
+
+
+void gfxc::TextRenderer::ClearStaticText()
+{
+    staticVertices.clear();
+    staticRanges.clear();
+    queuedFirsts.clear();
+    queuedCounts.clear();
+}
+
+
+void gfxc::TextRenderer::Flush()
+{
+    if (dynamicVertices.empty() && queuedFirsts.empty())
+        return;
+
+    // Write the strings of this batch to the stream buffer, no upload call waits for the GPU
+    StreamBuffer::Allocation allocation = { nullptr, 0, 0 };
+    if (!dynamicVertices.empty())
+    {
+        allocation = stream.Allocate(sizeof(TextVertex) * dynamicVertices.size(), sizeof(TextVertex));
+        if (allocation.IsValid())
+        {
+            memcpy(allocation.pointer, dynamicVertices.data(), allocation.size);
+            stream.Commit(allocation);
+        }
+    }
+
+    // Activate corresponding render state    
+    if (this->m_textShader)
+    {
+        glUseProgram(this->m_textShader->program);
+        glUniform1i(loc_sdf, sdf);
+        RenderStats::CountProgramBind();
+        RenderStats::CountUniforms(1);
+        CheckOpenGLError();
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glBindVertexArray(this->VAO);
+
+    // Render the static strings at once, then the streamed ones
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    if (!queuedFirsts.empty())
+    {
+        SetupAttributes(this->VBO, 0);
+        glMultiDrawArrays(GL_TRIANGLES, queuedFirsts.data(), queuedCounts.data(), (GLsizei)queuedFirsts.size());
+
+        unsigned long long staticCount = 0;
+        for (GLsizei count : queuedCounts) {
+            staticCount += count;
+        }
+        RenderStats::CountDraw(GL_TRIANGLES, staticCount);
+    }
+
+    if (allocation.IsValid())
+    {
+        SetupAttributes(stream.GetBufferID(), allocation.offset);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)dynamicVertices.size());
+        RenderStats::CountDraw(GL_TRIANGLES, dynamicVertices.size());
     }
 
+    glDisable(GL_BLEND);
+
     glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    dynamicVertices.clear();
+    queuedFirsts.clear();
+    queuedCounts.clear();
 }
@@ -9,14 +9,15 @@
 #ifndef TEXT_RENDERER_H
 #define TEXT_RENDERER_H
 
-#include <map>
 #include <string>
+#include <vector>
 
 #include "GL/glew.h"
 #include "glm/glm.hpp"
 
 #include "core/gpu/mesh.h"
 #include "core/gpu/shader.h"
+#include "core/gpu/stream_buffer.h"
 #include "core/engine.h"
 
 
@@ -25,21 +26,30 @@ namespace gfxc
     /// Holds all state information relevant to a character as loaded using FreeType
     struct Character
     {
-        GLuint TextureID;   // ID handle of the glyph texture
+        glm::vec2 UVMin;    // Top-left corner of the glyph in the atlas
+        glm::vec2 UVMax;    // Bottom-right corner of the glyph in the atlas
         glm::ivec2 Size;    // Size of glyph
         glm::ivec2 Bearing; // Offset from baseline to left/top of glyph
         GLuint Advance;     // Horizontal offset to advance to next glyph
     };
 
 
+    /// One corner of a glyph quad
+    struct TextVertex
+    {
+        glm::vec4 vertex;   // <vec2 pos, vec2 tex>
+        glm::vec4 color;
+    };
+
+
     // A renderer class for rendering text displayed by a font loaded using the 
-    // FreeType library. A single font is loaded, processed into a list of Character
-    // items for later rendering.
+    // FreeType library. A single font is loaded and packed into one atlas texture.
+    // The text of a frame is batched in one vertex buffer and drawn with one call.
     class TextRenderer
     {
      public:
-        // Holds a list of pre-compiled Characters
-        std::map<GLchar, Character> Characters;
+        // Holds the pre-compiled ASCII characters
+        Character Characters[128];
 
         // Shader used for text rendering
         Shader *m_textShader;
@@ -47,16 +57,65 @@ namespace gfxc
         public:
         // Constructor
         TextRenderer(const std::string &selfDir, GLuint width, GLuint height);
+        ~TextRenderer();
 
-        // Pre-compiles a list of characters from the given font
-        void Load(std::string font, GLuint fontSize);
+        // Pre-compiles the ASCII characters from the given font into the atlas. With
+        // `sdf` the atlas stores signed distances, so one size stays sharp at any scale.
+        void Load(std::string font, GLuint fontSize, bool sdf = false);
 
-        // Renders a string of text using the precompiled list of characters
+        // Renders a string of text right away, with one draw call
         void RenderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color = glm::vec3(1.0f));
-        
+
+        // Queues a string for the next Flush
+        void AddText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color = glm::vec3(1.0f));
+
+        // Builds the quads of a string once and keeps them in the vertex buffer.
+        // Returns an id for AddStaticText.
+        unsigned int CreateStaticText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color = glm::vec3(1.0f));
+        void AddStaticText(unsigned int id);
+        void ClearStaticText();
+
+        // Draws all the queued text with a single call and empties the queue
+        void Flush();
+
+        GLuint GetAtlasID() const { return atlas; }
+
      private:
+        void BuildQuads(const std::string &text, GLfloat x, GLfloat y, GLfloat scale,
+                        const glm::vec3 &color, std::vector<TextVertex> &out) const;
+
+        // Makes room for the static vertices, the buffer is re-created when they grow
+        void ReserveStatic();
+
+        // Points the vertex attributes of the VAO at the given buffer range
+        void SetupAttributes(GLuint buffer, GLintptr offset);
+
+     private:
+        struct Range
+        {
+            GLint first;
+            GLsizei count;
+        };
+
         // Render state
         GLuint VAO, VBO;
+        GLuint atlas;
+        GLint loc_sdf;
+        bool sdf;
+        GLint capHeight;
+
+        // The static strings stay in the VBO, the others are written to the
+        // stream buffer every Flush
+        std::vector<TextVertex> staticVertices;
+        std::vector<Range> staticRanges;
+        unsigned int staticCapacity;
+
+        std::vector<TextVertex> dynamicVertices;
+        StreamBuffer stream;
+
+        // Static strings queued for the next Flush
+        std::vector<GLint> queuedFirsts;
+        std::vector<GLsizei> queuedCounts;
     };
 }
 
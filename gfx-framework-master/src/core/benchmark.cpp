@@ -0,0 +1,375 @@
+#include "core/benchmark.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+#include "core/window/window_object.h"
+#include "utils/window_utils.h"
+
+#if defined(_WIN32)
+#   define NOMINMAX
+#   include <windows.h>
+#   include <psapi.h>
+#else
+#   include <sys/resource.h>
+#endif
+
+
+namespace
+{
+    const char *PHASE_NAMES[Benchmark::NUM_PHASES] = {
+        "events", "input", "simulate", "frame_start", "update", "frame_end", "capture", "swap"
+    };
+
+
+    // GLFW key code of a script key name, -1 if unknown
+    int ParseKey(std::string name)
+    {
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)toupper(c); });
+
+        // Letters and digits are their ASCII codes
+        if (name.size() == 1 && isalnum((unsigned char)name[0]))
+            return name[0];
+
+        if (name.size() > 1 && name[0] == 'F' && isdigit((unsigned char)name[1]))
+        {
+            int number = atoi(name.c_str() + 1);
+            return (number >= 1 && number <= 25) ? GLFW_KEY_F1 + number - 1 : -1;
+        }
+
+        static const struct { const char *name; int key; } namedKeys[] = {
+            { "SPACE", GLFW_KEY_SPACE },
+            { "ESCAPE", GLFW_KEY_ESCAPE },
+            { "ENTER", GLFW_KEY_ENTER },
+            { "TAB", GLFW_KEY_TAB },
+            { "UP", GLFW_KEY_UP },
+            { "DOWN", GLFW_KEY_DOWN },
+            { "LEFT", GLFW_KEY_LEFT },
+            { "RIGHT", GLFW_KEY_RIGHT },
+            { "LEFT_SHIFT", GLFW_KEY_LEFT_SHIFT },
+            { "LEFT_CONTROL", GLFW_KEY_LEFT_CONTROL },
+        };
+
+        for (const auto &namedKey : namedKeys)
+        {
+            if (name == namedKey.name)
+                return namedKey.key;
+        }
+        return -1;
+    }
+
+
+    // Nearest rank, `values` is sorted
+    double Percentile(const std::vector<double> &values, double percent)
+    {
+        if (values.empty())
+            return 0;
+
+        size_t rank = static_cast<size_t>(percent / 100.0 * values.size() + 0.5);
+        return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+
+    void WriteDistribution(FILE *file, std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+
+        double sum = 0;
+        for (double value : values) {
+            sum += value;
+        }
+
+        fprintf(file, "{\"avg\":%.4f,\"min\":%.4f,\"p50\":%.4f,\"p90\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}",
+            values.empty() ? 0.0 : sum / values.size(), values.empty() ? 0.0 : values.front(),
+            Percentile(values, 50), Percentile(values, 90), Percentile(values, 95), Percentile(values, 99),
+            values.empty() ? 0.0 : values.back());
+    }
+
+
+    // Set before the run starts, by the World being generated
+    std::vector<std::pair<std::string, double>> &GetMetrics()
+    {
+        static std::vector<std::pair<std::string, double>> metrics;
+        return metrics;
+    }
+
+
+    std::string EscapeJson(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += (c >= 0 && c < ' ') ? ' ' : c;
+        }
+        return escaped;
+    }
+}
+
+
+Benchmark::Config::Config()
+{
+    frames = 1000;
+    warmupFrames = 60;
+    timeStep = 1.0 / 60;
+}
+
+
+Benchmark::Benchmark(const Config &config)
+    : config(config)
+{
+    nextEvent = 0;
+    frame = 0;
+    current = Frame();
+    frames.reserve(config.frames);
+}
+
+
+bool Benchmark::LoadInput()
+{
+    events.clear();
+    nextEvent = 0;
+
+    if (config.inputPath.empty())
+        return true;
+
+    std::ifstream file(config.inputPath);
+    if (!file)
+    {
+        std::cout << "Benchmark: cannot read " << config.inputPath << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for (unsigned int lineNumber = 1; std::getline(file, line); lineNumber++)
+    {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        std::istringstream words(line);
+        std::string keyName, action;
+        long long eventFrame = -1;
+        words >> eventFrame >> keyName >> action;
+
+        int key = ParseKey(keyName);
+        if (eventFrame < 0 || key < 0 || (action != "press" && action != "release"))
+        {
+            std::cout << "Benchmark: " << config.inputPath << ":" << lineNumber << ": expected `frame key press|release`" << std::endl;
+            return false;
+        }
+
+        KeyEvent event;
+        event.frame = static_cast<unsigned int>(eventFrame);
+        event.key = key;
+        event.pressed = action == "press";
+        events.push_back(event);
+    }
+
+    // Events of the same frame keep their order
+    std::stable_sort(events.begin(), events.end(), [](const KeyEvent &a, const KeyEvent &b) {
+        return a.frame < b.frame;
+    });
+
+    std::cout << "Benchmark: " << events.size() << " key events from " << config.inputPath << std::endl;
+    return true;
+}
+
+
+bool Benchmark::IsDone() const
+{
+    return frame >= config.warmupFrames + config.frames;
+}
+
+
+void Benchmark::BeginFrame(WindowObject *window)
+{
+    if (window) {
+        QueueInput(window, frame);
+    }
+
+    frameStart = Clock::now();
+    phaseStart = frameStart;
+    if (frame == config.warmupFrames) {
+        runStart = frameStart;
+    }
+
+    current = Frame();
+}
+
+
+void Benchmark::QueueInput(WindowObject *window, unsigned int step)
+{
+    for (; nextEvent < events.size() && events[nextEvent].frame <= step; nextEvent++) {
+        window->InjectKey(events[nextEvent].key, events[nextEvent].pressed);
+    }
+}
+
+
+void Benchmark::EndPhase(Phase phase)
+{
+    Clock::time_point now = Clock::now();
+    current.phases[phase] += std::chrono::duration<double, std::milli>(now - phaseStart).count();
+    phaseStart = now;
+}
+
+
+void Benchmark::EndFrame()
+{
+    Clock::time_point now = Clock::now();
+
+    if (frame >= config.warmupFrames)
+    {
+        current.milliseconds = std::chrono::duration<double, std::milli>(now - frameStart).count();
+        current.counters = RenderStats::GetLastFrame();
+        frames.push_back(current);
+        runEnd = now;
+    }
+
+    frame++;
+}
+
+
+void Benchmark::SetMetric(const std::string &name, double value)
+{
+    for (auto &metric : GetMetrics())
+    {
+        if (metric.first == name)
+        {
+            metric.second = value;
+            return;
+        }
+    }
+    GetMetrics().push_back(std::make_pair(name, value));
+}
+
+
+double Benchmark::GetPeakMemoryMegabytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    // Bytes on macOS, kilobytes elsewhere
+#   if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#   else
+    return usage.ru_maxrss / 1024.0;
+#   endif
+#endif
+}
+
+
+double Benchmark::GetProcessCpuSeconds()
+{
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0;
+
+    // In 100 ns units
+    ULARGE_INTEGER kernelTime, userTime;
+    kernelTime.LowPart = kernel.dwLowDateTime;
+    kernelTime.HighPart = kernel.dwHighDateTime;
+    userTime.LowPart = user.dwLowDateTime;
+    userTime.HighPart = user.dwHighDateTime;
+    return (kernelTime.QuadPart + userTime.QuadPart) * 1e-7;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+
+bool Benchmark::WriteReport(const std::string &renderer, const std::string &version, int width, int height) const
+{
+    if (frames.empty())
+    {
+        std::cout << "Benchmark: no frames were measured" << std::endl;
+        return false;
+    }
+
+    FILE *file = fopen(config.reportPath.c_str(), "w");
+    if (!file)
+    {
+        std::cout << "Benchmark: cannot write " << config.reportPath << std::endl;
+        return false;
+    }
+
+    double seconds = std::chrono::duration<double>(runEnd - runStart).count();
+
+    fprintf(file, "{\n\"renderer\":\"%s\",\n\"version\":\"%s\",\n", EscapeJson(renderer).c_str(), EscapeJson(version).c_str());
+    fprintf(file, "\"resolution\":[%d,%d],\n\"input\":\"%s\",\n", width, height, EscapeJson(config.inputPath).c_str());
+    fprintf(file, "\"frames\":%zu,\n\"warmup_frames\":%u,\n\"time_step\":%.6f,\n\"seconds\":%.4f,\n\"fps\":%.3f,\n",
+        frames.size(), config.warmupFrames, config.timeStep, seconds, seconds > 0 ? frames.size() / seconds : 0.0);
+
+    std::vector<double> values(frames.size());
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        values[i] = frames[i].milliseconds;
+    }
+    fprintf(file, "\"frame_ms\":");
+    WriteDistribution(file, values);
+
+    fprintf(file, ",\n\"phases_ms\":{");
+    for (int phase = 0; phase < NUM_PHASES; phase++)
+    {
+        for (size_t i = 0; i < frames.size(); i++) {
+            values[i] = frames[i].phases[phase];
+        }
+        fprintf(file, "%s\n  \"%s\":", phase ? "," : "", PHASE_NAMES[phase]);
+        WriteDistribution(file, values);
+    }
+
+    // Counted on the CPU, see RenderStats
+    fprintf(file, "},\n\"counters\":{");
+    const char *counterNames[] = { "draw_calls", "triangles", "program_binds", "uniform_uploads", "buffer_bytes" };
+    for (int counter = 0; counter < 5; counter++)
+    {
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            const RenderStats::Counters &counters = frames[i].counters;
+            const unsigned long long perCounter[] = {
+                counters.drawCalls, counters.triangles, counters.programBinds, counters.uniformUploads, counters.bufferBytes
+            };
+            values[i] = static_cast<double>(perCounter[counter]);
+        }
+        fprintf(file, "%s\n  \"%s\":", counter ? "," : "", counterNames[counter]);
+        WriteDistribution(file, values);
+    }
+    fprintf(file, "},\n\"peak_memory_mb\":%.2f,\n\"metrics\":{", GetPeakMemoryMegabytes());
+    for (size_t i = 0; i < GetMetrics().size(); i++) {
+        fprintf(file, "%s\n  \"%s\":%.4f", i ? "," : "", EscapeJson(GetMetrics()[i].first).c_str(), GetMetrics()[i].second);
+    }
+    fprintf(file, "}\n}\n");
+
+    bool written = ferror(file) == 0;
+    fclose(file);
+
+    std::vector<double> milliseconds(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        milliseconds[i] = frames[i].milliseconds;
+    }
+    std::sort(milliseconds.begin(), milliseconds.end());
+
+    std::cout << "Benchmark: " << frames.size() << " frames in " << seconds << " s, p50 " << Percentile(milliseconds, 50)
+        << " ms, p99 " << Percentile(milliseconds, 99) << " ms, report written to " << config.reportPath << std::endl;
+    return written;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "core/gpu/render_stats.h"
+
+
+class WindowObject;
+
+
+// Frames of a World run as a benchmark: a script of key events replays the
+// same flight every run, the simulation advances by a fixed time step, and
+// the wall time of every frame and of its phases is measured. The report is
+// JSON with the frame time percentiles, the phase times and the averages of
+// the render counters, for comparing runs on the CI hosts.
+//
+// Script lines are `frame key press|release`, keys by name (W, UP, SPACE,
+// F1...) and `#` starting a comment. Frames count from 0, warm-up included.
+class Benchmark
+{
+ public:
+    struct Config
+    {
+        Config();
+
+        unsigned int frames;
+
+        // Run before the measured frames, the shaders and caches settle
+        unsigned int warmupFrames;
+
+        // Simulated seconds per frame
+        double timeStep;
+
+        std::string inputPath;
+        std::string reportPath;
+    };
+
+    // The phases of World::LoopUpdate, in order. With the render thread
+    // only the ones from FRAME_START are measured, the others run on the
+    // simulation thread while the frame before is drawn.
+    enum Phase
+    {
+        EVENTS,
+        INPUT,
+        SIMULATE,
+        FRAME_START,
+        UPDATE,
+        FRAME_END,
+        CAPTURE,
+        SWAP,
+        NUM_PHASES
+    };
+
+    struct KeyEvent
+    {
+        unsigned int frame;
+        int key;
+        bool pressed;
+    };
+
+ public:
+    explicit Benchmark(const Config &config);
+
+    // Reads the script, false if it cannot be opened or has invalid lines
+    bool LoadInput();
+
+    double GetTimeStep() const { return config.timeStep; }
+    bool IsDone() const;
+
+    // Warm-up included
+    unsigned int GetNumFrames() const { return config.warmupFrames + config.frames; }
+
+    // Called by the World around a frame, BeginFrame queues the key events
+    // of the frame to the window. With the render thread the frames are
+    // timed on it and the simulation thread queues the events of its steps,
+    // the window is then null.
+    void BeginFrame(WindowObject *window);
+    void QueueInput(WindowObject *window, unsigned int step);
+    void EndPhase(Phase phase);
+    void EndFrame();
+
+    bool WriteReport(const std::string &renderer, const std::string &version, int width, int height) const;
+
+    // A value of the run written under "metrics" in the report, e.g. the
+    // milliseconds the World took to generate. Set again, it is replaced.
+    static void SetMetric(const std::string &name, double value);
+
+    // Of the process so far, 0 where it cannot be read
+    static double GetPeakMemoryMegabytes();
+
+    // User and system time of all the threads of the process so far
+    static double GetProcessCpuSeconds();
+
+ private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Frame
+    {
+        double milliseconds;
+        double phases[NUM_PHASES];
+        RenderStats::Counters counters;
+    };
+
+ private:
+    Config config;
+    std::vector<KeyEvent> events;
+    size_t nextEvent;
+
+    unsigned int frame;
+    Clock::time_point frameStart;
+    Clock::time_point phaseStart;
+    Frame current;
+
+    // Measured frames only
+    std::vector<Frame> frames;
+    Clock::time_point runStart;
+    Clock::time_point runEnd;
+};
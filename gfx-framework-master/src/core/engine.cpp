@@ -1,25 +1,49 @@
 #include "core/engine.h"
 
+#include <cstdlib>
 #include <iostream>
 
+#include "core/gpu/frame_buffer.h"
+
+#include "core/managers/shader_cache.h"
 #include "core/managers/texture_manager.h"
 #include "utils/gl_utils.h"
 
 
+// From GLFW 3.4, the bundled headers predate them. Older libraries ignore the hint.
+#ifndef GLFW_PLATFORM
+#   define GLFW_PLATFORM        0x00050003
+#   define GLFW_PLATFORM_NULL   0x00060005
+#endif
+
+
 WindowObject* Engine::window = nullptr;
+FrameBuffer* Engine::offscreen = nullptr;
 
 
 WindowObject* Engine::Init(const WindowProperties & props)
 {
+#if defined(__linux__)
+    // Without a display the null platform still makes surfaceless contexts
+    if (props.headless && !getenv("DISPLAY") && !getenv("WAYLAND_DISPLAY"))
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+
     /* Initialize the library */
     if (!glfwInit()) // openGl context
+    {
+        if (props.headless)
+            fprintf(stderr, "Error: no display, headless runs need GLFW 3.4 or a virtual display (xvfb-run)\n");
         exit(0);
+    }
 
     window = new WindowObject(props);
 
     glewExperimental = true;
     GLenum err = glewInit(); // glew extensions
-    if (GLEW_OK != err)
+
+    // EGL contexts have no GLX display, GLEW reports it after loading the functions
+    if (GLEW_OK != err && !(props.headless && GLEW_VERSION_3_3))
     {
         // Serious problem
         fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
@@ -27,6 +51,19 @@ WindowObject* Engine::Init(const WindowProperties & props)
     }
 
     TextureManager::Init(window->props.selfDir); // texture manager
+    ShaderCache::Init(window->props.selfDir); // program binaries of previous runs
+
+    if (props.headless)
+    {
+        glm::ivec2 resolution = window->GetResolution();
+        offscreen = new FrameBuffer();
+        offscreen->Generate(resolution.x, resolution.y, 1, true, 8);
+        FrameBuffer::SetDefault(offscreen);
+        FrameBuffer::BindDefault(resolution);
+
+        std::cout << "Headless " << resolution.x << "x" << resolution.y << " on "
+            << (const char *)glGetString(GL_RENDERER) << ", OpenGL " << (const char *)glGetString(GL_VERSION) << std::endl;
+    }
 
     return window;
 }
@@ -42,6 +79,18 @@ void Engine::Exit()
 {
     std::cout << "=====================================================" << std::endl;
     std::cout << "Engine closed. Exit" << std::endl;
+
+    // The programs compiled after the last save, e.g. variants made on demand
+    ShaderCache::Save();
+
+    if (offscreen)
+    {
+        FrameBuffer::SetDefault(nullptr);
+        offscreen->Clean();
+        delete offscreen;
+        offscreen = nullptr;
+    }
+
     glfwTerminate();
 }
 
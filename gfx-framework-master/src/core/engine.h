@@ -7,6 +7,9 @@
 #include "core/window/window_object.h"
 
 
+class FrameBuffer;
+
+
 class Engine
 {
  public:
@@ -21,4 +24,7 @@ class Engine
 
  private:
     static WindowObject* window;
+
+    // Drawn into instead of the window framebuffer when headless
+    static FrameBuffer* offscreen;
 };
@@ -0,0 +1,312 @@
+#include "core/frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "core/window/window_object.h"
+
+
+namespace
+{
+    // Frames between a timestamp and the read of its query
+    const unsigned int GPU_LATENCY = 4;
+
+    // Frames of the budget of render late and of the latency statistics
+    const unsigned int DURATION_WINDOW = 32;
+    const unsigned int LATENCY_WINDOW = 240;
+
+    // Bounds of the spin after a sleep, the sleeps overshoot by about 1 ms
+    // on Windows with a raised timer resolution and far less elsewhere
+    const double MIN_SPIN_SECONDS = 0.0002;
+    const double MAX_SPIN_SECONDS = 0.02;
+
+    // A wait longer than this is a wrong prediction, the frame starts at once
+    const double MAX_WAIT_SECONDS = 0.25;
+
+    const char *SWAP_MODE_NAMES[] = { "immediate", "vsync", "adaptive vsync" };
+}
+
+
+FramePacer::Config::Config()
+{
+    targetFps = 0;
+    swapMode = SWAP_VSYNC;
+    renderLate = false;
+    lateMarginMilliseconds = 1.0;
+}
+
+
+FramePacer::FramePacer(const Config &config)
+    : config(config)
+{
+    vSync = false;
+    adaptive = false;
+    refreshPeriod = 0;
+    spinSeconds = 0.002;
+
+    origin = std::chrono::steady_clock::now();
+    nextStart = 0;
+    lastInput = 0;
+    lastVblank = -1;
+    lastWait = 0;
+
+    frameDurations.resize(DURATION_WINDOW);
+    latencies.resize(LATENCY_WINDOW);
+    numDurations = 0;
+    numLatencies = 0;
+    frameIndex = 0;
+
+    timerSupported = false;
+}
+
+
+FramePacer::~FramePacer()
+{
+    for (Pending &slot : pending) {
+        glDeleteQueries(1, &slot.query);
+    }
+}
+
+
+void FramePacer::Apply(WindowObject *window)
+{
+    if (config.swapMode == SWAP_ADAPTIVE)
+    {
+        adaptive = window->SetAdaptiveVSync();
+        if (!adaptive)
+        {
+            std::cout << "Frame pacing: adaptive vsync is not supported, using the vsync" << std::endl;
+            window->SetVSync(true);
+        }
+    }
+    else
+    {
+        window->SetVSync(config.swapMode == SWAP_VSYNC);
+    }
+
+    // A headless window presents nothing, its swap never waits
+    vSync = config.swapMode != SWAP_IMMEDIATE && !window->props.headless;
+
+    int refreshRate = window->GetRefreshRate();
+    refreshPeriod = refreshRate > 0 ? 1.0 / refreshRate : 0;
+
+    if (config.renderLate && (!vSync || refreshPeriod <= 0))
+    {
+        std::cout << "Frame pacing: render late needs the vsync and a known refresh rate, it is off" << std::endl;
+        config.renderLate = false;
+    }
+
+    timerSupported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if (timerSupported && pending.empty())
+    {
+        pending.resize(GPU_LATENCY);
+        for (Pending &slot : pending)
+        {
+            glGenQueries(1, &slot.query);
+            slot.issued = false;
+        }
+    }
+
+    std::cout << "Frame pacing: " << ToString() << std::endl;
+}
+
+
+double FramePacer::Now() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
+}
+
+
+void FramePacer::WaitUntil(double deadline)
+{
+    double remaining = deadline - Now();
+    if (remaining <= 0)
+        return;
+
+    // The sleep overshoot grows the spin at once and shrinks it slowly
+    if (remaining > spinSeconds)
+    {
+        double sleep = remaining - spinSeconds;
+        double before = Now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(sleep));
+
+        double overshoot = Now() - before - sleep;
+        spinSeconds = overshoot > spinSeconds ? overshoot : 0.99 * spinSeconds + 0.01 * overshoot;
+        spinSeconds = std::min(MAX_SPIN_SECONDS, std::max(MIN_SPIN_SECONDS, spinSeconds));
+    }
+
+    while (Now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+
+void FramePacer::WaitForFrameStart()
+{
+    double now = Now();
+    double framePeriod = config.targetFps > 0 ? 1.0 / config.targetFps : 0;
+    double limitStart = config.targetFps > 0 ? std::max(nextStart, 0.0) : now;
+
+    // Just in time for the vblank after the last one
+    double lateStart = now;
+    if (config.renderLate && lastVblank >= 0) {
+        lateStart = lastVblank + refreshPeriod - GetFrameBudget() - config.lateMarginMilliseconds / 1000;
+    }
+
+    double deadline = std::max(limitStart, lateStart);
+    if (deadline - now > MAX_WAIT_SECONDS) {
+        deadline = now;
+    }
+
+    WaitUntil(deadline);
+
+    double start = Now();
+    lastWait = (start - now) * 1000;
+
+    // More than a frame late, the missed frames are not caught up
+    if (config.targetFps > 0) {
+        nextStart = limitStart + framePeriod < start ? start + framePeriod : limitStart + framePeriod;
+    }
+}
+
+
+void FramePacer::InputSampled(double time)
+{
+    lastInput = time;
+}
+
+
+void FramePacer::BeforeSwap()
+{
+    if (!timerSupported)
+    {
+        // Without timestamps only the CPU part of the frame is known
+        AddFrameDuration(Now() - lastInput);
+        frameIndex++;
+        return;
+    }
+
+    Pending &slot = pending[frameIndex % GPU_LATENCY];
+    ReadPending(slot);
+
+    // Written when the GPU is done with the commands of the frame
+    glQueryCounter(slot.query, GL_TIMESTAMP);
+
+    // The timestamp of the commands that reached the GPU so far, not of their execution
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+
+    slot.issued = true;
+    slot.input = lastInput;
+    slot.offset = Now() - gpuNow * 1e-9;
+    frameIndex++;
+}
+
+
+void FramePacer::AfterSwap()
+{
+    if (!config.renderLate)
+        return;
+
+    // The swap is done at the vblank that shows the frame. Waiting for it
+    // also keeps the driver from queuing frames, which would add latency.
+    glFinish();
+    lastVblank = Now();
+}
+
+
+void FramePacer::Reset()
+{
+    nextStart = 0;
+    lastVblank = -1;
+}
+
+
+void FramePacer::ReadPending(Pending &slot)
+{
+    if (!slot.issued)
+        return;
+
+    slot.issued = false;
+
+    // Not done after GPU_LATENCY frames, the frame is not counted
+    GLint available = 0;
+    glGetQueryObjectiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+
+    GLuint64 timestamp = 0;
+    glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &timestamp);
+
+    double drawn = timestamp * 1e-9 + slot.offset;
+    AddFrameDuration(drawn - slot.input);
+
+    double shown = drawn;
+    if (vSync && refreshPeriod > 0)
+    {
+        // The first vblank after the frame is drawn
+        if (lastVblank >= 0) {
+            shown = lastVblank + std::ceil((drawn - lastVblank) / refreshPeriod) * refreshPeriod;
+        } else {
+            shown = drawn + refreshPeriod / 2;
+        }
+    }
+
+    latencies[numLatencies % LATENCY_WINDOW] = (shown - slot.input) * 1000;
+    numLatencies++;
+}
+
+
+void FramePacer::AddFrameDuration(double seconds)
+{
+    frameDurations[numDurations % DURATION_WINDOW] = std::max(0.0, seconds);
+    numDurations++;
+}
+
+
+double FramePacer::GetFrameBudget() const
+{
+    unsigned int count = std::min(numDurations, DURATION_WINDOW);
+    if (count == 0)
+        return refreshPeriod;
+
+    return *std::max_element(frameDurations.begin(), frameDurations.begin() + count);
+}
+
+
+FramePacer::Latency FramePacer::GetLatency() const
+{
+    Latency latency = Latency();
+    latency.numFrames = std::min(numLatencies, LATENCY_WINDOW);
+    if (latency.numFrames == 0)
+        return latency;
+
+    std::vector<double> sorted(latencies.begin(), latencies.begin() + latency.numFrames);
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double value : sorted) {
+        sum += value;
+    }
+
+    latency.average = sum / sorted.size();
+    latency.p99 = sorted[std::min(sorted.size() - 1, static_cast<size_t>(0.99 * sorted.size()))];
+    return latency;
+}
+
+
+std::string FramePacer::ToString() const
+{
+    Latency latency = GetLatency();
+
+    char text[256];
+    snprintf(text, sizeof(text), "%s%s, %s, latency %.2f ms avg %.2f p99, wait %.2f ms",
+        SWAP_MODE_NAMES[adaptive ? SWAP_ADAPTIVE : config.swapMode == SWAP_ADAPTIVE ? SWAP_VSYNC : config.swapMode],
+        config.renderLate ? " render late" : "",
+        config.targetFps > 0 ? (std::to_string(static_cast<int>(config.targetFps)) + " FPS limit").c_str() : "no limit",
+        latency.average, latency.p99, lastWait);
+    return text;
+}
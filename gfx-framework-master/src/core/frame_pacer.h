@@ -0,0 +1,145 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "utils/gl_utils.h"
+
+
+class WindowObject;
+
+
+// Paces the frames of a World. The limiter waits before the events of a
+// frame until its start time, 1 / targetFps after the previous one: it
+// sleeps for most of the wait and spins for the last part, the sleep
+// overshoot of the system is measured to size that part. With the vsync
+// on, the render late mode also delays the start of the frame until just
+// before the next predicted vblank, by the time the recent frames took to
+// be ready plus a margin, so the input is sampled as late as possible.
+//
+// The input to photon latency is approximated from a GPU timestamp written
+// before the swap of every frame: the time the GPU finished drawing it, moved
+// to the CPU clock, plus the wait for the vblank that shows it when the vsync
+// is on, minus the time the events of the frame were polled. Scanout is not
+// counted. Render late waits for the swap to finish, which is when the vblank
+// happened, to know the phase of the vblanks; without it half a refresh period
+// is added as the expected wait.
+class FramePacer
+{
+ public:
+    enum SwapMode
+    {
+        SWAP_IMMEDIATE,
+        SWAP_VSYNC,
+
+        // Tears instead of waiting for the next vblank when a frame is late,
+        // the vsync where the driver does not support it
+        SWAP_ADAPTIVE
+    };
+
+    struct Config
+    {
+        Config();
+
+        // 0 for no limit
+        double targetFps;
+        SwapMode swapMode;
+
+        bool renderLate;
+        double lateMarginMilliseconds;
+    };
+
+    // In milliseconds, over the frames of the rolling window
+    struct Latency
+    {
+        double average;
+        double p99;
+        unsigned int numFrames;
+    };
+
+ public:
+    explicit FramePacer(const Config &config);
+    ~FramePacer();
+
+    // Sets the swap interval of the window, call with its context current
+    void Apply(WindowObject *window);
+
+    // Called by the World around a frame: before its events and around the
+    // swap
+    void WaitForFrameStart();
+    void BeforeSwap();
+    void AfterSwap();
+
+    // The input of the frame was sampled at a time of Now, possibly on
+    // another thread
+    void InputSampled(double time);
+
+    // Seconds since the pacer was created, only reads the clock so any
+    // thread can call it
+    double Now() const;
+
+    // The next frame starts without waiting, after frames were skipped
+    void Reset();
+
+    Latency GetLatency() const;
+
+    // Milliseconds waited before the start of the last frame
+    double GetLastWait() const { return lastWait; }
+
+    // One line with the mode, the wait and the latency
+    std::string ToString() const;
+
+ private:
+    // A GPU timestamp and the CPU times of its frame, read a few frames later
+    struct Pending
+    {
+        GLuint query;
+        bool issued;
+
+        // Seconds, see Now
+        double input;
+
+        // CPU seconds minus GPU seconds, when the timestamp was queued
+        double offset;
+    };
+
+ private:
+    void WaitUntil(double deadline);
+    void ReadPending(Pending &pending);
+    void AddFrameDuration(double seconds);
+
+    // Seconds from the sampling of the input to the frame being drawn, of
+    // the slowest recent frame
+    double GetFrameBudget() const;
+
+ private:
+    Config config;
+    bool vSync;
+    bool adaptive;
+
+    // Seconds between vblanks, 0 when unknown
+    double refreshPeriod;
+
+    // Of the sleeps, the part left to spin
+    double spinSeconds;
+
+    std::chrono::steady_clock::time_point origin;
+    double nextStart;
+    double lastInput;
+
+    // Negative while unknown
+    double lastVblank;
+    double lastWait;
+
+    // Rolling windows, from the input to the frame being drawn and to it
+    // being shown
+    std::vector<double> frameDurations;
+    std::vector<double> latencies;
+    unsigned int numDurations;
+    unsigned int numLatencies;
+    unsigned int frameIndex;
+
+    bool timerSupported;
+    std::vector<Pending> pending;
+};
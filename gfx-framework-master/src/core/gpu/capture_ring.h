@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+
+
+// The order and the states of the slots of FrameCapture, without the GL
+// objects. A slot goes from FREE to READING when a frame is read into it,
+// to ENCODING when its buffer is mapped, and back to FREE once the encoder
+// is done with it. Slots are taken and given back in capture order, so the
+// slots in flight are always the `GetNumInFlight()` ones from the oldest.
+//
+// Nothing here is synchronized. The encoder threads only call SetEncoded,
+// and IsEncoded reads what they set, so FrameCapture calls both with its
+// mutex held.
+class CaptureRing
+{
+ public:
+    enum State
+    {
+        FREE,
+        READING,
+        ENCODING
+    };
+
+ public:
+    explicit CaptureRing(unsigned int numSlots = 0)
+        : slots(numSlots), oldest(0), numInFlight(0)
+    {
+    }
+
+    unsigned int GetNumSlots() const { return static_cast<unsigned int>(slots.size()); }
+    unsigned int GetNumInFlight() const { return numInFlight; }
+    bool IsFull() const { return numInFlight == slots.size(); }
+
+    // The slot of the i-th frame in flight, 0 is the oldest
+    unsigned int GetInFlight(unsigned int i) const
+    {
+        return (oldest + i) % GetNumSlots();
+    }
+
+    unsigned int GetOldest() const { return oldest; }
+    State GetState(unsigned int slot) const { return slots[slot].state; }
+
+    // Takes the free slot after the newest one, the ring must not be full.
+    // It was encoded if it was used before, that was for another frame.
+    unsigned int Begin()
+    {
+        assert(!IsFull());
+        unsigned int slot = GetInFlight(numInFlight);
+        slots[slot].state = READING;
+        slots[slot].encoded = false;
+        numInFlight++;
+        return slot;
+    }
+
+    // The read finished and the buffer is mapped, the encoders get it next
+    void SetMapped(unsigned int slot)
+    {
+        assert(slots[slot].state == READING);
+        slots[slot].state = ENCODING;
+        slots[slot].encoded = false;
+    }
+
+    void SetEncoded(unsigned int slot)
+    {
+        slots[slot].encoded = true;
+    }
+
+    // Only the frame now in the slot counts, not one encoded before it
+    bool IsEncoded(unsigned int slot) const
+    {
+        return slots[slot].state == ENCODING && slots[slot].encoded;
+    }
+
+    // Gives back the oldest slot once its frame is encoded
+    void ReleaseOldest()
+    {
+        assert(numInFlight > 0 && IsEncoded(oldest));
+        slots[oldest].state = FREE;
+        oldest = (oldest + 1) % GetNumSlots();
+        numInFlight--;
+    }
+
+ private:
+    struct Slot
+    {
+        Slot() : state(FREE), encoded(false) {}
+
+        State state;
+        bool encoded;
+    };
+
+    std::vector<Slot> slots;
+    unsigned int oldest;
+    unsigned int numInFlight;
+};
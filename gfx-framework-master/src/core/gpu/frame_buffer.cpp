@@ -9,11 +9,16 @@
 
 
 glm::vec4 FrameBuffer::defaultClearColor = glm::vec4(0);
+unsigned int FrameBuffer::defaultFBO = 0;
 
 
 FrameBuffer::FrameBuffer()
 {
     FBO = 0;
+    width = 0;
+    height = 0;
+    layers = 0;
+    nrTextures = 0;
     depthTexture = nullptr;
     textures = nullptr;
     DrawBuffers = nullptr;
@@ -48,24 +53,71 @@ void FrameBuffer::Generate(int width, int height, int nrTextures, bool hasDepthT
 
     this->width = width;
     this->height = height;
+    this->layers = 0;
     this->nrTextures = nrTextures;
 
     // Create FrameBufferObject
     glGenFramebuffers(1, &FBO);
     glBindFramebuffer(GL_FRAMEBUFFER, FBO);
 
+    CreateTextures(precision, hasDepthTexture);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "FRAMEBUFFER NOT COMPLETE" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+    CheckOpenGLError();
+}
+
+
+void FrameBuffer::GenerateLayered(int width, int height, int layers, int nrTextures, bool hasDepthTexture, int precision)
+{
+    Clean();
+
+    precision = (precision / 8) * 8;
+
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if (layers > maxLayers) {
+        std::cout << "FBO: " << layers << " layers requested, the driver allows " << maxLayers << std::endl;
+        layers = maxLayers;
+    }
+
+    this->width = width;
+    this->height = height;
+    this->layers = layers;
+    this->nrTextures = nrTextures;
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    CreateTextures(precision, hasDepthTexture);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "FRAMEBUFFER NOT COMPLETE" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+    CheckOpenGLError();
+}
+
+
+void FrameBuffer::CreateTextures(int precision, bool hasDepthTexture)
+{
     if (nrTextures > 0) {
         DrawBuffers = new GLenum[nrTextures];
 
         // Add attachments to drawing buffer
-        for (int i = 0; i < nrTextures; i++)
+        for (unsigned int i = 0; i < nrTextures; i++)
             DrawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
 
         // Create attached textures
         textures = new Texture2D[nrTextures];
-        for (int i = 0; i < nrTextures; i++)
+        for (unsigned int i = 0; i < nrTextures; i++)
         {
-            textures[i].CreateFrameBufferTexture(width, height, i, precision);
+            if (layers)
+                textures[i].CreateFrameBufferTextureArray(width, height, layers, i, precision);
+            else
+                textures[i].CreateFrameBufferTexture(width, height, i, precision);
         }
 
         glDrawBuffers(nrTextures, DrawBuffers);
@@ -73,15 +125,13 @@ void FrameBuffer::Generate(int width, int height, int nrTextures, bool hasDepthT
 
     // Create depth texture
     if (hasDepthTexture) {
+        SAFE_FREE(depthTexture);
         depthTexture = new Texture2D();
-        depthTexture->CreateDepthBufferTexture(width, height);
+        if (layers)
+            depthTexture->CreateDepthBufferTextureArray(width, height, layers);
+        else
+            depthTexture->CreateDepthBufferTexture(width, height);
     }
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "FRAMEBUFFER NOT COMPLETE" << std::endl;
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    CheckOpenGLError();
 }
 
 
@@ -95,11 +145,17 @@ void FrameBuffer::Resize(int width, int height, int precision)
 
     for (unsigned int i = 0; i < nrTextures; i++)
     {
-        textures[i].CreateFrameBufferTexture(width, height, i, precision);
+        if (layers)
+            textures[i].CreateFrameBufferTextureArray(width, height, layers, i, precision);
+        else
+            textures[i].CreateFrameBufferTexture(width, height, i, precision);
     }
 
     if (depthTexture) {
-        depthTexture->CreateDepthBufferTexture(width, height);
+        if (layers)
+            depthTexture->CreateDepthBufferTextureArray(width, height, layers);
+        else
+            depthTexture->CreateDepthBufferTexture(width, height);
     }
 }
 
@@ -115,6 +171,26 @@ void FrameBuffer::Bind(bool clearBuffer) const
 }
 
 
+void FrameBuffer::CopyFromDefault(const glm::ivec2 &defaultSize) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, defaultFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+    glBlitFramebuffer(0, 0, defaultSize.x, defaultSize.y, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+    CheckOpenGLError();
+}
+
+
+void FrameBuffer::CopyToDefault(const glm::ivec2 &defaultSize) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, defaultFBO);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, defaultSize.x, defaultSize.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+    CheckOpenGLError();
+}
+
+
 void FrameBuffer::SendResolution(Shader *shader) const
 {
     glUniform2i(shader->loc_resolution, width, height);
@@ -138,6 +214,12 @@ unsigned int FrameBuffer::GetNumberOfRenderTargets() const
 }
 
 
+unsigned int FrameBuffer::GetNumberOfLayers() const
+{
+    return layers;
+}
+
+
 void FrameBuffer::BindTexture(int textureID, unsigned int TextureUnit) const
 {
     textures[textureID].BindToTextureUnit(TextureUnit);
@@ -176,15 +258,27 @@ void FrameBuffer::BindAllTextures() const
 }
 
 
+void FrameBuffer::SetDefault(const FrameBuffer *frameBuffer)
+{
+    defaultFBO = frameBuffer ? frameBuffer->FBO : 0;
+}
+
+
+unsigned int FrameBuffer::GetDefaultID()
+{
+    return defaultFBO;
+}
+
+
 void FrameBuffer::BindDefault()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
 }
 
 
 void FrameBuffer::BindDefault(const glm::ivec2 &viewportSize, bool clearBuffer)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
     glViewport(0, 0, viewportSize.x, viewportSize.y);
     if (clearBuffer) {
         glClearColor(defaultClearColor.r, defaultClearColor.g, defaultClearColor.b, defaultClearColor.a);
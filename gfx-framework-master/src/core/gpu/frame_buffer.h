@@ -16,6 +16,10 @@ class FrameBuffer
     void Generate(int width, int height, int nrTextures, bool hasDepthTexture = true, int precision = 32);
     void Resize(int width, int height, int precision = 32);
 
+    // Every target is a GL_TEXTURE_2D_ARRAY of `layers` images. Bind and Clear
+    // act on all the layers, shaders select one per primitive with gl_Layer.
+    void GenerateLayered(int width, int height, int layers, int nrTextures, bool hasDepthTexture = true, int precision = 32);
+
     void Bind(bool clearBuffer = true) const;
     void BindTexture(int textureID, unsigned int TextureUnit) const;
     void BindAllTextures() const;
@@ -25,18 +29,33 @@ class FrameBuffer
     Texture2D* GetDepthTexture() const;
     unsigned int GetTextureID(unsigned int index) const;
     unsigned int GetNumberOfRenderTargets() const;
+    // 0 for the framebuffers made by Generate
+    unsigned int GetNumberOfLayers() const;
 
     glm::ivec2 GetResolution() const;
 
+    // Copies the color of the default framebuffer of `defaultSize` into the
+    // first target, or the first target back, scaled with linear filtering
+    void CopyFromDefault(const glm::ivec2 &defaultSize) const;
+    void CopyToDefault(const glm::ivec2 &defaultSize) const;
+
     void SendResolution(Shader *shader) const;
     void SetClearColor(glm::vec4 clearColor);
 
     static void Clear();
+
+    // BindDefault binds `frameBuffer` instead of the window framebuffer, for
+    // the headless contexts that have none. nullptr restores the window.
+    static void SetDefault(const FrameBuffer *frameBuffer);
+    static unsigned int GetDefaultID();
     static void BindDefault();
     static void BindDefault(const glm::ivec2 &viewportSize, bool clearBuffer = false);
     static void SetViewport(const glm::ivec2 &viewportSize, const glm::ivec2 offset = glm::ivec2(0, 0));
     static void SetDefaultClearColor(glm::vec4 clearColor);
 
+ private:
+    void CreateTextures(int precision, bool hasDepthTexture);
+
  private:
     Texture2D *textures;
     Texture2D *depthTexture;
@@ -46,7 +65,9 @@ class FrameBuffer
 
     int width;
     int height;
+    int layers;
     unsigned int nrTextures;
     glm::vec4 clearColor;
     static glm::vec4 defaultClearColor;
+    static unsigned int defaultFBO;
 };
@@ -0,0 +1,341 @@
+#include "core/gpu/frame_capture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "stb/stb_image_write.h"
+
+
+FrameCapture::FrameCapture()
+{
+    format = PNG;
+    capturing = false;
+    stopping = false;
+    videoFile = nullptr;
+
+    frame = 0;
+    written = 0;
+    stalls = 0;
+    totalMilliseconds = 0;
+    maxMilliseconds = 0;
+}
+
+
+FrameCapture::~FrameCapture()
+{
+    Stop();
+
+    for (auto &slot : slots) {
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+
+bool FrameCapture::Start(const std::string &path, Format format, unsigned int numSlots, unsigned int numThreads)
+{
+    Stop();
+
+    if (format == RAW_VIDEO)
+    {
+        videoFile = fopen(path.c_str(), "wb");
+        if (!videoFile) {
+            std::cout << "FrameCapture: cannot open " << path << std::endl;
+            return false;
+        }
+    }
+
+    this->path = path;
+    this->format = format;
+
+    for (auto &slot : slots) {
+        glDeleteBuffers(1, &slot.buffer);
+    }
+
+    slots.assign(std::max(numSlots, 2u), Slot());
+    for (auto &slot : slots)
+    {
+        glGenBuffers(1, &slot.buffer);
+        slot.fence = 0;
+        slot.size = 0;
+        slot.width = 0;
+        slot.height = 0;
+        slot.frame = 0;
+        slot.pixels = nullptr;
+    }
+    ring = CaptureRing(static_cast<unsigned int>(slots.size()));
+
+    // The frames of a video have to be written in order
+    if (format == RAW_VIDEO) {
+        numThreads = 1;
+    } else if (numThreads == 0) {
+        numThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    stopping = false;
+    for (unsigned int i = 0; i < numThreads; i++) {
+        threads.emplace_back(&FrameCapture::EncodeLoop, this);
+    }
+
+    frame = 0;
+    written = 0;
+    stalls = 0;
+    totalMilliseconds = 0;
+    maxMilliseconds = 0;
+    capturing = true;
+
+    std::cout << "FrameCapture: recording to " << path << " with " << slots.size() << " buffers and "
+        << numThreads << " encoder threads" << std::endl;
+    return true;
+}
+
+
+void FrameCapture::Capture(int width, int height)
+{
+    if (!capturing || width <= 0 || height <= 0)
+        return;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    Collect(false);
+
+    // Every buffer still in use, the oldest frame has to be finished first
+    if (ring.IsFull())
+    {
+        if (ring.GetState(ring.GetOldest()) == CaptureRing::READING) {
+            Map(ring.GetOldest(), true);
+        }
+
+        ReleaseOldest(true);
+        stalls++;
+    }
+
+    // Begin clears what the encoder left from the last frame of the slot
+    unsigned int index;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        index = ring.Begin();
+    }
+    Slot &slot = slots[index];
+    size_t size = (size_t)width * height * 3;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.size != size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        slot.size = size;
+    }
+
+    // With a pack buffer bound the copy is queued, it does not wait for the frame to finish
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.frame = frame++;
+    CheckOpenGLError();
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    totalMilliseconds += milliseconds;
+    maxMilliseconds = std::max(maxMilliseconds, milliseconds);
+}
+
+
+void FrameCapture::Collect(bool wait)
+{
+    // The reads finish in order, so the first one still running ends the search
+    for (unsigned int i = 0; i < ring.GetNumInFlight(); i++)
+    {
+        unsigned int index = ring.GetInFlight(i);
+        if (ring.GetState(index) != CaptureRing::READING)
+            continue;
+
+        if (!wait)
+        {
+            GLenum status = glClientWaitSync(slots[index].fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                break;
+        }
+
+        Map(index, wait);
+    }
+
+    // The buffers are given back in capture order, the ring stays contiguous.
+    // A slot still reading is not encoded, whatever its last frame was.
+    while (ring.GetNumInFlight() > 0)
+    {
+        if (!wait)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ring.IsEncoded(ring.GetOldest()))
+                break;
+        }
+
+        ReleaseOldest(wait);
+    }
+}
+
+
+void FrameCapture::Map(unsigned int index, bool wait)
+{
+    Slot &slot = slots[index];
+    if (wait) {
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    slot.pixels = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)slot.width * slot.height * 3, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ring.SetMapped(index);
+    if (slot.pixels)
+    {
+        // The encoders read the mapped memory directly, it stays mapped until they are done
+        jobs.push_back(index);
+        jobAdded.notify_one();
+    }
+    else
+    {
+        std::cout << "FrameCapture: frame " << slot.frame << " could not be mapped" << std::endl;
+        ring.SetEncoded(index);
+    }
+}
+
+
+void FrameCapture::ReleaseOldest(bool wait)
+{
+    unsigned int index = ring.GetOldest();
+    Slot &slot = slots[index];
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (wait) {
+        jobDone.wait(lock, [this, index] { return ring.IsEncoded(index); });
+    }
+    lock.unlock();
+
+    if (slot.pixels)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.pixels = nullptr;
+    }
+
+    lock.lock();
+    ring.ReleaseOldest();
+}
+
+
+void FrameCapture::EncodeLoop()
+{
+    while (true)
+    {
+        unsigned int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAdded.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+            if (jobs.empty())
+                return;
+
+            index = jobs.front();
+            jobs.pop_front();
+        }
+
+        Encode(slots[index]);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ring.SetEncoded(index);
+            written++;
+        }
+        jobDone.notify_all();
+    }
+}
+
+
+void FrameCapture::Encode(const Slot &slot)
+{
+    int rowSize = slot.width * 3;
+
+    // OpenGL rows start at the bottom, both outputs start at the top
+    if (format == PNG)
+    {
+        std::ostringstream name;
+        name << path << std::setw(6) << std::setfill('0') << slot.frame << ".png";
+
+        stbi_write_png(name.str().c_str(), slot.width, slot.height, 3,
+            slot.pixels + (size_t)(slot.height - 1) * rowSize, -rowSize);
+    }
+    else
+    {
+        for (int y = slot.height - 1; y >= 0; y--) {
+            fwrite(slot.pixels + (size_t)y * rowSize, 1, rowSize, videoFile);
+        }
+    }
+}
+
+
+void FrameCapture::Stop()
+{
+    if (!capturing)
+        return;
+
+    Collect(true);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAdded.notify_all();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    if (videoFile)
+    {
+        fclose(videoFile);
+        videoFile = nullptr;
+    }
+
+    capturing = false;
+    PrintStats();
+}
+
+
+bool FrameCapture::IsCapturing() const
+{
+    return capturing;
+}
+
+
+FrameCapture::Stats FrameCapture::GetStats() const
+{
+    Stats stats;
+    stats.captured = frame;
+    stats.written = written;
+    stats.stalls = stalls;
+    stats.averageMilliseconds = frame ? totalMilliseconds / frame : 0.0;
+    stats.maxMilliseconds = maxMilliseconds;
+    return stats;
+}
+
+
+void FrameCapture::PrintStats() const
+{
+    Stats stats = GetStats();
+
+    std::cout << "FrameCapture: " << stats.captured << " frames captured, " << stats.written << " written, "
+        << stats.stalls << " stalls, " << stats.averageMilliseconds << " ms per frame on the render thread ("
+        << stats.maxMilliseconds << " ms max)" << std::endl;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/gpu/capture_ring.h"
+#include "utils/gl_utils.h"
+
+
+// Records the frames of the default framebuffer without stalling the render
+// thread. Every frame is read into a pixel pack buffer of a ring, mapped a few
+// frames later once its fence has passed, and encoded by worker threads
+// straight from the mapped memory. No frame is skipped: when the ring is full
+// the oldest frame is waited for, which shows up in the stats as a stall.
+class FrameCapture
+{
+ public:
+    enum Format
+    {
+        // One file per frame, `path` followed by the frame number
+        PNG,
+        // RGB24 frames appended to the `path` file, top row first. Play with
+        // ffmpeg -f rawvideo -pixel_format rgb24 -video_size WxH -i path
+        RAW_VIDEO
+    };
+
+    struct Stats
+    {
+        unsigned int captured;
+        unsigned int written;
+        unsigned int stalls;
+
+        // Time spent in Capture on the render thread
+        double averageMilliseconds;
+        double maxMilliseconds;
+    };
+
+ public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // `numThreads` 0 uses the free hardware threads for PNG. Raw video is
+    // written by one thread, in order.
+    bool Start(const std::string &path, Format format, unsigned int numSlots = 4, unsigned int numThreads = 0);
+
+    // Queues the copy of the bound read framebuffer, call it after the frame
+    // is drawn and before the buffers are swapped
+    void Capture(int width, int height);
+
+    // Waits for the frames in flight and the encoders
+    void Stop();
+
+    bool IsCapturing() const;
+    Stats GetStats() const;
+    void PrintStats() const;
+
+ private:
+    // The GL side of a slot, its state is in the ring
+    struct Slot
+    {
+        GLuint buffer;
+        GLsync fence;
+        size_t size;
+
+        int width;
+        int height;
+        unsigned int frame;
+        const unsigned char *pixels;
+    };
+
+    // Maps the reads that have finished and releases the encoded slots. With
+    // `wait` every slot is brought back to FREE.
+    void Collect(bool wait);
+    void Map(unsigned int index, bool wait);
+    void ReleaseOldest(bool wait);
+
+    void EncodeLoop();
+    void Encode(const Slot &slot);
+
+ private:
+    std::string path;
+    Format format;
+    bool capturing;
+
+    // Indexed like the ring, which keeps their capture order
+    std::vector<Slot> slots;
+    CaptureRing ring;
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable jobAdded;
+    std::condition_variable jobDone;
+    std::deque<unsigned int> jobs;
+    bool stopping;
+
+    FILE *videoFile;
+
+    unsigned int frame;
+    unsigned int written;
+    unsigned int stalls;
+    double totalMilliseconds;
+    double maxMilliseconds;
+};
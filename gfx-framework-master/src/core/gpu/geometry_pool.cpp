@@ -0,0 +1,291 @@
+#include "core/gpu/geometry_pool.h"
+#include "core/gpu/mesh_optimizer.h"
+#include "core/gpu/render_stats.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+FreeListAllocator::FreeListAllocator(unsigned int capacity)
+{
+    this->capacity = capacity;
+    used = 0;
+
+    if (capacity) {
+        freeBlocks[0] = capacity;
+    }
+}
+
+
+bool FreeListAllocator::Allocate(unsigned int size, unsigned int &offset)
+{
+    if (size == 0)
+        return false;
+
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+    {
+        if (it->second < size)
+            continue;
+
+        offset = it->first;
+        unsigned int remaining = it->second - size;
+        freeBlocks.erase(it);
+
+        if (remaining) {
+            freeBlocks[offset + size] = remaining;
+        }
+
+        used += size;
+        return true;
+    }
+
+    return false;
+}
+
+
+void FreeListAllocator::Free(unsigned int offset, unsigned int size)
+{
+    if (size == 0)
+        return;
+
+    used -= size;
+    auto it = freeBlocks.emplace(offset, size).first;
+
+    // Merge with the next block
+    auto next = std::next(it);
+    if (next != freeBlocks.end() && it->first + it->second == next->first)
+    {
+        it->second += next->second;
+        freeBlocks.erase(next);
+    }
+
+    // Merge with the previous block
+    if (it != freeBlocks.begin())
+    {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first)
+        {
+            prev->second += it->second;
+            freeBlocks.erase(it);
+        }
+    }
+}
+
+
+unsigned int FreeListAllocator::GetCapacity() const
+{
+    return capacity;
+}
+
+
+unsigned int FreeListAllocator::GetUsed() const
+{
+    return used;
+}
+
+
+unsigned int FreeListAllocator::GetLargestFreeBlock() const
+{
+    unsigned int largest = 0;
+    for (const auto &block : freeBlocks) {
+        largest = std::max(largest, block.second);
+    }
+    return largest;
+}
+
+
+unsigned int FreeListAllocator::GetNumFreeBlocks() const
+{
+    return static_cast<unsigned int>(freeBlocks.size());
+}
+
+
+GeometryPool::GeometryPool(unsigned int maxVertices, unsigned int maxIndices,
+                           const VertexLayout &layout, GLenum indexType)
+    : layout(layout), indexType(indexType), vertexAllocator(maxVertices), indexAllocator(maxIndices)
+{
+    numRanges = 0;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &IBO);
+
+    glBindVertexArray(VAO);
+
+    // The constant attributes of the layout are stored before the vertices
+    std::vector<unsigned char> constants;
+    layout.PackConstants(constants);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, layout.GetBufferSize(maxVertices), NULL, GL_STATIC_DRAW);
+    if (!constants.empty()) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, constants.size(), &constants[0]);
+    }
+    SetupVertexAttributes();
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_optimizer::GetIndexSize(indexType) * maxIndices, NULL, GL_STATIC_DRAW);
+
+    // Make sure the VAO is not changed from the outside
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    CheckOpenGLError();
+}
+
+
+GeometryPool::~GeometryPool()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &IBO);
+}
+
+
+void GeometryPool::SetupVertexAttributes() const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    layout.SetupAttributes(0, layout.GetConstantsSize());
+}
+
+
+GeometryRange GeometryPool::Allocate(const std::vector<VertexFormat> &vertices,
+                                     const std::vector<unsigned int> &indices)
+{
+    GeometryRange range;
+    unsigned int baseVertex = 0, firstIndex = 0;
+
+    if (mesh_optimizer::GetIndexType((unsigned int)vertices.size()) == GL_UNSIGNED_INT && indexType != GL_UNSIGNED_INT)
+    {
+        std::cout << "GeometryPool: " << vertices.size() << " vertices do not fit 16-bit indices" << std::endl;
+        return range;
+    }
+
+    if (layout.GetPositionFormat() == VertexLayout::POSITION_HALF && !VertexLayout::FitsHalfPositions(vertices))
+    {
+        std::cout << "GeometryPool: " << vertices.size() << " vertices are too far apart for half float positions" << std::endl;
+        return range;
+    }
+
+    if (!vertexAllocator.Allocate((unsigned int)vertices.size(), baseVertex))
+    {
+        std::cout << "GeometryPool: out of vertex space for " << vertices.size() << " vertices" << std::endl;
+        return range;
+    }
+
+    if (!indexAllocator.Allocate((unsigned int)indices.size(), firstIndex))
+    {
+        std::cout << "GeometryPool: out of index space for " << indices.size() << " indices" << std::endl;
+        vertexAllocator.Free(baseVertex, (unsigned int)vertices.size());
+        return range;
+    }
+
+    range.baseVertex = baseVertex;
+    range.numVertices = (unsigned int)vertices.size();
+    range.firstIndex = firstIndex;
+    range.numIndices = (unsigned int)indices.size();
+
+    std::vector<unsigned char> data;
+    layout.PackVertices(vertices, data);
+
+    // Indices stay relative to the mesh, the base vertex is applied at draw time
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, layout.GetBufferSize(baseVertex), data.size(), &data[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    RenderStats::CountBufferBytes(data.size());
+
+    std::vector<unsigned char> indexData;
+    mesh_optimizer::PackIndices(indices, indexType, indexData);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, mesh_optimizer::GetIndexSize(indexType) * firstIndex, indexData.size(), &indexData[0]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    RenderStats::CountBufferBytes(indexData.size());
+    CheckOpenGLError();
+
+    numRanges++;
+    return range;
+}
+
+
+void GeometryPool::Free(const GeometryRange &range)
+{
+    if (!range.IsValid())
+        return;
+
+    vertexAllocator.Free(range.baseVertex, range.numVertices);
+    indexAllocator.Free(range.firstIndex, range.numIndices);
+    numRanges--;
+}
+
+
+void GeometryPool::Bind() const
+{
+    glBindVertexArray(VAO);
+}
+
+
+void GeometryPool::Draw(const GeometryRange &range, GLenum drawMode) const
+{
+    glDrawElementsBaseVertex(drawMode, range.numIndices, indexType,
+        (void*)(size_t)(mesh_optimizer::GetIndexSize(indexType) * range.firstIndex), range.baseVertex);
+    RenderStats::CountDraw(drawMode, range.numIndices);
+}
+
+
+GeometryPool::Stats GeometryPool::GetStats() const
+{
+    Stats stats;
+    stats.usedVertices = vertexAllocator.GetUsed();
+    stats.maxVertices = vertexAllocator.GetCapacity();
+    stats.usedIndices = indexAllocator.GetUsed();
+    stats.maxIndices = indexAllocator.GetCapacity();
+    stats.freeBlocks = vertexAllocator.GetNumFreeBlocks() + indexAllocator.GetNumFreeBlocks();
+    stats.numRanges = numRanges;
+    stats.vertexBytes = layout.GetBufferSize(stats.maxVertices);
+    return stats;
+}
+
+
+void GeometryPool::PrintStats() const
+{
+    Stats stats = GetStats();
+
+    std::cout << "GeometryPool: " << stats.numRanges << " meshes, "
+        << stats.usedVertices << "/" << stats.maxVertices << " vertices ("
+        << (stats.maxVertices ? 100.0f * stats.usedVertices / stats.maxVertices : 0.0f) << "%), "
+        << stats.usedIndices << "/" << stats.maxIndices << " indices ("
+        << (stats.maxIndices ? 100.0f * stats.usedIndices / stats.maxIndices : 0.0f) << "%), "
+        << stats.freeBlocks << " free blocks, " << stats.vertexBytes / 1024 << " KB vertex buffer ("
+        << layout.ToString() << ")" << std::endl;
+}
+
+
+GLuint GeometryPool::GetVAO() const
+{
+    return VAO;
+}
+
+
+GLuint GeometryPool::GetVertexBuffer() const
+{
+    return VBO;
+}
+
+
+GLuint GeometryPool::GetIndexBuffer() const
+{
+    return IBO;
+}
+
+
+const VertexLayout & GeometryPool::GetVertexLayout() const
+{
+    return layout;
+}
+
+
+GLenum GeometryPool::GetIndexType() const
+{
+    return indexType;
+}
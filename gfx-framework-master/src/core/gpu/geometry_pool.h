@@ -0,0 +1,114 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "core/gpu/vertex_format.h"
+#include "core/gpu/vertex_layout.h"
+#include "utils/gl_utils.h"
+
+
+// A region of the shared buffers, in vertices and indices
+struct GeometryRange
+{
+    GeometryRange()
+    {
+        baseVertex = 0;
+        numVertices = 0;
+        firstIndex = 0;
+        numIndices = 0;
+    }
+
+    bool IsValid() const
+    {
+        return numVertices > 0 && numIndices > 0;
+    }
+
+    unsigned int baseVertex;
+    unsigned int numVertices;
+    unsigned int firstIndex;
+    unsigned int numIndices;
+};
+
+
+// First-fit allocator over a linear range of elements. Freed blocks are
+// merged with their neighbours so they can be reused by larger requests.
+class FreeListAllocator
+{
+ public:
+    explicit FreeListAllocator(unsigned int capacity);
+
+    bool Allocate(unsigned int size, unsigned int &offset);
+    void Free(unsigned int offset, unsigned int size);
+
+    unsigned int GetCapacity() const;
+    unsigned int GetUsed() const;
+    unsigned int GetLargestFreeBlock() const;
+    unsigned int GetNumFreeBlocks() const;
+
+ private:
+    unsigned int capacity;
+    unsigned int used;
+
+    // offset -> size of every free block
+    std::map<unsigned int, unsigned int> freeBlocks;
+};
+
+
+// One interleaved vertex buffer and one index buffer shared by many meshes,
+// all drawn from the same VAO with glDrawElementsBaseVertex or multi-draw.
+class GeometryPool
+{
+ public:
+    struct Stats
+    {
+        unsigned int usedVertices;
+        unsigned int maxVertices;
+        unsigned int usedIndices;
+        unsigned int maxIndices;
+        unsigned int freeBlocks;
+        unsigned int numRanges;
+        unsigned int vertexBytes;
+    };
+
+ public:
+    // Every mesh in the pool is packed with the same vertex layout and index type.
+    // With GL_UNSIGNED_SHORT each mesh is limited to 65536 vertices. The positions
+    // are float or half, POSITION_SNORM16 needs the bounds of each mesh.
+    GeometryPool(unsigned int maxVertices, unsigned int maxIndices,
+                 const VertexLayout &layout = VertexLayout(),
+                 GLenum indexType = GL_UNSIGNED_INT);
+    ~GeometryPool();
+
+    // Returns an invalid range if the pool is full or the vertices do not fit its layout
+    GeometryRange Allocate(const std::vector<VertexFormat> &vertices,
+                           const std::vector<unsigned int> &indices);
+    void Free(const GeometryRange &range);
+
+    void Bind() const;
+    void Draw(const GeometryRange &range, GLenum drawMode) const;
+
+    Stats GetStats() const;
+    void PrintStats() const;
+
+    GLuint GetVAO() const;
+    GLuint GetVertexBuffer() const;
+    GLuint GetIndexBuffer() const;
+    const VertexLayout& GetVertexLayout() const;
+    GLenum GetIndexType() const;
+
+    // Points the currently bound VAO to the pool buffers, using the
+    // VertexFormat attribute locations
+    void SetupVertexAttributes() const;
+
+ private:
+    GLuint VAO;
+    GLuint VBO;
+    GLuint IBO;
+
+    VertexLayout layout;
+    GLenum indexType;
+    FreeListAllocator vertexAllocator;
+    FreeListAllocator indexAllocator;
+    unsigned int numRanges;
+};
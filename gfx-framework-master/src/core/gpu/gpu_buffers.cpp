@@ -1,5 +1,6 @@
 #include "core/gpu/gpu_buffers.h"
 #include "core/gpu/vertex_format.h"
+#include "core/gpu/mesh_optimizer.h"
 
 
 enum VERTEX_ATTRIBUTE_LOC
@@ -184,3 +185,35 @@ GPUBuffers gpu_utils::UploadData(const std::vector<VertexFormat> &vertices,
 
         return buffers;
     }
+
+
+GPUBuffers gpu_utils::UploadData(const std::vector<VertexFormat> &vertices,
+                                 const std::vector<unsigned int>& indices,
+                                 const VertexLayout &layout,
+                                 GLenum indexType)
+{
+    std::vector<unsigned char> data;
+    layout.Pack(vertices, data);
+
+    std::vector<unsigned char> indexData;
+    mesh_optimizer::PackIndices(indices, indexType, indexData);
+
+    // Create the VAO
+    GPUBuffers buffers;
+    buffers.CreateBuffers(2);
+    glBindVertexArray(buffers.m_VAO);
+
+    // The constant attributes are stored before the vertices
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.m_VBO[0]);
+    glBufferData(GL_ARRAY_BUFFER, data.size(), &data[0], GL_STATIC_DRAW);
+    layout.SetupAttributes(0, layout.GetConstantsSize());
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.m_VBO[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), &indexData[0], GL_STATIC_DRAW);
+
+    // Make sure the VAO is not changed from the outside
+    glBindVertexArray(0);
+    CheckOpenGLError();
+
+    return buffers;
+}
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "core/gpu/vertex_format.h"
+#include "core/gpu/vertex_layout.h"
 #include "utils/gl_utils.h"
 #include "utils/glm_utils.h"
 
@@ -45,4 +46,11 @@ namespace gpu_utils
 
     GPUBuffers UploadData(const std::vector<VertexFormat> &vertices,
                           const std::vector<unsigned int>& indices);
+
+    // Uploads the vertices packed with the given layout, and the indices as
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GPUBuffers UploadData(const std::vector<VertexFormat> &vertices,
+                          const std::vector<unsigned int>& indices,
+                          const VertexLayout &layout,
+                          GLenum indexType = GL_UNSIGNED_INT);
 }   // namespace gpu_utils
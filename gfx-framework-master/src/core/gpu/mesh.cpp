@@ -1,11 +1,16 @@
 #include "core/gpu/mesh.h"
 
+#include <algorithm>
+#include <iostream>
 #include <utility>
 
 #include "assimp/Importer.hpp"          // C++ importer interface
 #include "assimp/postprocess.h"         // Post processing flags
 
+#include "core/profiler.h"
+#include "core/gpu/render_stats.h"
 #include "core/gpu/gpu_buffers.h"
+#include "core/gpu/mesh_optimizer.h"
 #include "core/gpu/texture2D.h"
 #include "core/managers/texture_manager.h"
 
@@ -22,6 +27,9 @@ Mesh::Mesh(std::string meshID)
     useMaterial = true;
     glDrawMode = GL_TRIANGLES;
     buffers = new GPUBuffers();
+    pool = nullptr;
+    indexType = GL_UNSIGNED_INT;
+    cullable = false;
 }
 
 
@@ -29,6 +37,7 @@ Mesh::~Mesh()
 {
     ClearData();
     meshEntries.clear();
+    ReleasePoolRange();
     SAFE_FREE(buffers);
 
     ClearAnimations(anim, numAnim);
@@ -42,6 +51,36 @@ const GPUBuffers * Mesh::GetBuffers() const
 }
 
 
+GeometryPool * Mesh::GetGeometryPool() const
+{
+    return pool;
+}
+
+
+const GeometryRange & Mesh::GetGeometryRange() const
+{
+    return poolRange;
+}
+
+
+const VertexLayout & Mesh::GetVertexLayout() const
+{
+    return layout;
+}
+
+
+GLenum Mesh::GetIndexType() const
+{
+    return indexType;
+}
+
+
+bool Mesh::SupportsBackFaceCulling() const
+{
+    return cullable;
+}
+
+
 const char * Mesh::GetMeshID() const
 {
     return meshID.c_str();
@@ -108,13 +147,16 @@ void Mesh::ClearRootNode(aiNode* node)
 bool Mesh::LoadMesh(const std::string& fileLocation,
     const std::string& fileName)
 {
+    PROFILE_ZONE("LoadMesh");
+
     ClearData();
     this->fileLocation = fileLocation;
     std::string file = (fileLocation + '/' + fileName).c_str();
 
     Assimp::Importer Importer;
 
-    unsigned int flags = aiProcess_GenSmoothNormals | aiProcess_FlipUVs;
+    unsigned int flags = aiProcess_GenSmoothNormals | aiProcess_FlipUVs |
+        aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality;
     if (glDrawMode == GL_TRIANGLES) flags |= aiProcess_Triangulate;
 
     const aiScene* pScene = Importer.ReadFile(file, flags);
@@ -141,6 +183,29 @@ void Mesh::InitFromData()
     meshEntries.push_back(M);
 
     buffers->ReleaseMemory();
+    ReleasePoolRange();
+    indexType = GL_UNSIGNED_INT;
+    cullable = false;
+}
+
+
+void Mesh::OptimizeTriangles()
+{
+    if (glDrawMode != GL_TRIANGLES)
+        return;
+
+    cullable = mesh_optimizer::Optimize(vertices, indices).cullable;
+}
+
+
+void Mesh::ReleasePoolRange()
+{
+    if (pool)
+    {
+        pool->Free(poolRange);
+        pool = nullptr;
+        poolRange = GeometryRange();
+    }
 }
 
 
@@ -157,6 +222,8 @@ bool Mesh::InitFromBuffer(unsigned int VAO,
     meshEntries.push_back(M);
 
     buffers->ReleaseMemory();
+    ReleasePoolRange();
+    indexType = GL_UNSIGNED_INT;
     buffers->m_VAO = VAO;
 
     return true;
@@ -170,11 +237,48 @@ bool Mesh::InitFromData(const std::vector<VertexFormat> &vertices,
     this->indices = indices;
 
     InitFromData();
-    *buffers = gpu_utils::UploadData(vertices, indices);
+    OptimizeTriangles();
+
+    indexType = mesh_optimizer::GetIndexType((unsigned int)this->vertices.size());
+    layout = VertexLayout::Choose(this->vertices);
+    *buffers = gpu_utils::UploadData(this->vertices, this->indices, layout, indexType);
     return buffers->m_VAO != 0;
 }
 
 
+bool Mesh::InitFromData(GeometryPool *pool,
+                        const std::vector<VertexFormat> &vertices,
+                        const std::vector<unsigned int>& indices)
+{
+    this->vertices = vertices;
+    this->indices = indices;
+
+    InitFromData();
+    OptimizeTriangles();
+
+    GeometryRange range = pool->Allocate(this->vertices, this->indices);
+    if (!range.IsValid())
+    {
+        // The pool printed why, the mesh gets buffers of its own instead
+        std::cout << "Mesh '" << meshID << "': not in the geometry pool, uploaded on its own" << std::endl;
+        indexType = mesh_optimizer::GetIndexType((unsigned int)this->vertices.size());
+        layout = VertexLayout::Choose(this->vertices);
+        *buffers = gpu_utils::UploadData(this->vertices, this->indices, layout, indexType);
+        return buffers->m_VAO != 0;
+    }
+
+    // The pool owns the VAO, the buffers only reference it
+    this->pool = pool;
+    poolRange = range;
+    layout = pool->GetVertexLayout();
+    indexType = pool->GetIndexType();
+    meshEntries[0].baseVertex = range.baseVertex;
+    meshEntries[0].baseIndex = range.firstIndex;
+    buffers->m_VAO = pool->GetVAO();
+    return true;
+}
+
+
 bool Mesh::InitFromData(const std::vector<glm::vec3>& positions,
                         const std::vector<glm::vec3>& normals,
                         const std::vector<unsigned int>& indices)
@@ -217,8 +321,12 @@ bool Mesh::InitFromScene(const aiScene* pScene)
     unsigned int nrIndices = 0;
 
     // Count the number of vertices and indices
+    bool hasBones = false;
+    unsigned int maxVertices = 0;
     for (unsigned int i = 0; i < pScene->mNumMeshes; i++)
     {
+        hasBones = hasBones || pScene->mMeshes[i]->HasBones();
+        maxVertices = std::max(maxVertices, pScene->mMeshes[i]->mNumVertices);
         meshEntries[i].materialIndex = pScene->mMeshes[i]->mMaterialIndex;
         meshEntries[i].nrIndices = (pScene->mMeshes[i]->mNumFaces * (glDrawMode == GL_TRIANGLES ? 3 : 4));
         meshEntries[i].baseVertex = nrVertices;
@@ -232,7 +340,8 @@ bool Mesh::InitFromScene(const aiScene* pScene)
     positions.reserve(nrVertices);
     normals.reserve(nrVertices);
     texCoords.reserve(nrVertices);
-    bones.resize(nrVertices);
+    if (hasBones)
+        bones.resize(nrVertices);
     indices.reserve(nrIndices);
 
     // Initialize the meshes in the scene one by one
@@ -246,7 +355,27 @@ bool Mesh::InitFromScene(const aiScene* pScene)
         return false;
 
     buffers->ReleaseMemory();
-    *buffers = gpu_utils::UploadData(positions, normals, texCoords, bones, indices);
+    ReleasePoolRange();
+
+    if (hasBones)
+    {
+        layout = VertexLayout();
+        indexType = GL_UNSIGNED_INT;
+        *buffers = gpu_utils::UploadData(positions, normals, texCoords, bones, indices);
+        return buffers->m_VAO != 0;
+    }
+
+    // Without bones the vertex attributes are packed, the bone stream is skipped
+    std::vector<VertexFormat> packedVertices;
+    packedVertices.reserve(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        packedVertices.push_back(VertexFormat(positions[i], glm::vec3(1), normals[i], texCoords[i]));
+    }
+
+    // The indices of every entry are relative to its base vertex
+    indexType = mesh_optimizer::GetIndexType(maxVertices);
+    layout = VertexLayout::Choose(packedVertices, VertexLayout::POSITION | VertexLayout::NORMAL | VertexLayout::TEX_COORD);
+    *buffers = gpu_utils::UploadData(packedVertices, indices, layout, indexType);
     return buffers->m_VAO != 0;
 }
 
@@ -470,8 +599,9 @@ void Mesh::Render() const
         }
 
         glDrawElementsBaseVertex(glDrawMode, meshEntries[i].nrIndices,
-            GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * meshEntries[i].baseIndex),
+            indexType, (void*)(size_t)(mesh_optimizer::GetIndexSize(indexType) * meshEntries[i].baseIndex),
             meshEntries[i].baseVertex);
+        RenderStats::CountDraw(glDrawMode, meshEntries[i].nrIndices);
     }
     glBindVertexArray(0);
 }
@@ -7,6 +7,7 @@
 #include "core/gpu/vertex_format.h"
 #include "core/gpu/texture2D.h"
 #include "core/gpu/gpu_buffers.h"
+#include "core/gpu/geometry_pool.h"
 
 #include "assimp/scene.h"   // Output data structure
 
@@ -60,10 +61,18 @@ class Mesh
     bool InitFromBuffer(unsigned int VAO,
                         unsigned int nrIndices);
 
-    // Initializes the mesh object and upload data to GPU using the provided data buffers
+    // Initializes the mesh object and upload data to GPU using the provided data buffers,
+    // packed with the smallest layout that keeps the attributes of these vertices. Triangle
+    // meshes are deduplicated, rewound consistently and reordered for the vertex cache.
     bool InitFromData(const std::vector<VertexFormat> &vertices,
                       const std::vector<unsigned int>& indices);
 
+    // Initializes the mesh object as a range of a shared geometry pool, the range
+    // is returned to the pool when the mesh is destroyed or initialized again
+    bool InitFromData(GeometryPool *pool,
+                      const std::vector<VertexFormat> &vertices,
+                      const std::vector<unsigned int>& indices);
+
     // Initializes the mesh object and upload data to GPU using the provided data buffers
     bool InitFromData(const std::vector<glm::vec3>& positions,
                       const std::vector<glm::vec3>& normals,
@@ -89,10 +98,19 @@ class Mesh
     void Render() const;
 
     const GPUBuffers* GetBuffers() const;
+    GeometryPool* GetGeometryPool() const;
+    const GeometryRange& GetGeometryRange() const;
+    const VertexLayout& GetVertexLayout() const;
+    GLenum GetIndexType() const;
+
+    // True when the winding is consistent and no back face is ever seen
+    bool SupportsBackFaceCulling() const;
     const char* GetMeshID() const;
 
  protected:
     void InitFromData();
+    void ReleasePoolRange();
+    void OptimizeTriangles();
 
     void InitMesh(int index, const aiMesh* paiMesh);
     void LoadBones(int MeshIndex, const aiMesh* pMesh);
@@ -131,6 +149,12 @@ class Mesh
     GLenum glDrawMode;
     GPUBuffers *buffers;
 
+    GeometryPool *pool;
+    GeometryRange poolRange;
+    VertexLayout layout;
+    GLenum indexType;
+    bool cullable;
+
     std::vector<MeshEntry> meshEntries;
     std::vector<Material*> materials;
 };
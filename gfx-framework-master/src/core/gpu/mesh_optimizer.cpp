@@ -0,0 +1,526 @@
+#include "core/gpu/mesh_optimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+
+typedef unsigned long long EdgeKey;
+
+
+static EdgeKey UndirectedEdge(unsigned int a, unsigned int b)
+{
+    return (EdgeKey(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+
+static EdgeKey DirectedEdge(unsigned int a, unsigned int b)
+{
+    return (EdgeKey(a) << 32) | b;
+}
+
+
+// Vertices with the same position get the same id, so parts split by the other
+// attributes (colors, normals, texture coordinates) are still connected
+static std::vector<unsigned int> WeldPositions(const std::vector<VertexFormat> &vertices)
+{
+    std::map<std::tuple<float, float, float>, unsigned int> ids;
+    std::vector<unsigned int> welded(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const glm::vec3 &p = vertices[i].position;
+        welded[i] = ids.emplace(std::make_tuple(p.x, p.y, p.z), (unsigned int)i).first->second;
+    }
+
+    return welded;
+}
+
+
+namespace
+{
+    // Triangles sharing edges, using the welded vertex ids
+    struct Topology
+    {
+        Topology(const std::vector<VertexFormat> &vertices, const std::vector<unsigned int> &indices)
+            : welded(WeldPositions(vertices)), indices(indices)
+        {
+            unsigned int numTriangles = (unsigned int)indices.size() / 3;
+            for (unsigned int t = 0; t < numTriangles; t++)
+            {
+                for (unsigned int e = 0; e < 3; e++)
+                {
+                    unsigned int a = Vertex(t, e), b = Vertex(t, (e + 1) % 3);
+                    if (a != b) {
+                        edges[UndirectedEdge(a, b)].push_back(t);
+                    }
+                }
+            }
+        }
+
+        unsigned int Vertex(unsigned int triangle, unsigned int corner) const
+        {
+            return welded[indices[3 * triangle + corner]];
+        }
+
+        bool HasDirectedEdge(unsigned int triangle, unsigned int a, unsigned int b) const
+        {
+            for (unsigned int e = 0; e < 3; e++)
+            {
+                if (Vertex(triangle, e) == a && Vertex(triangle, (e + 1) % 3) == b)
+                    return true;
+            }
+            return false;
+        }
+
+        // Splits the triangles in connected parts. `flip` is filled so that the
+        // triangles of a part wind the same way as its first triangle.
+        std::vector<std::vector<unsigned int>> GetParts(std::vector<bool> &flip, std::vector<bool> &closed) const
+        {
+            unsigned int numTriangles = (unsigned int)indices.size() / 3;
+            std::vector<bool> visited(numTriangles, false);
+            std::vector<std::vector<unsigned int>> parts;
+
+            flip.assign(numTriangles, false);
+            closed.clear();
+
+            for (unsigned int seed = 0; seed < numTriangles; seed++)
+            {
+                if (visited[seed])
+                    continue;
+
+                std::vector<unsigned int> part(1, seed);
+                bool isClosed = true;
+                visited[seed] = true;
+
+                for (size_t next = 0; next < part.size(); next++)
+                {
+                    unsigned int t = part[next];
+                    for (unsigned int e = 0; e < 3; e++)
+                    {
+                        unsigned int a = Vertex(t, e), b = Vertex(t, (e + 1) % 3);
+                        if (a == b)
+                            continue;
+
+                        // Edges of more than two triangles, like a box resting on another one,
+                        // do not tell how the triangles wind, the part ends there
+                        const std::vector<unsigned int> &shared = edges.at(UndirectedEdge(a, b));
+                        isClosed = isClosed && shared.size() % 2 == 0;
+                        if (shared.size() != 2)
+                            continue;
+
+                        if (flip[t])
+                            std::swap(a, b);
+
+                        for (unsigned int u : shared)
+                        {
+                            if (visited[u])
+                                continue;
+
+                            // Neighbours must run along the shared edge in the opposite direction
+                            visited[u] = true;
+                            flip[u] = HasDirectedEdge(u, a, b);
+                            part.push_back(u);
+                        }
+                    }
+                }
+
+                parts.push_back(part);
+                closed.push_back(isClosed);
+            }
+
+            return parts;
+        }
+
+        std::vector<unsigned int> welded;
+        const std::vector<unsigned int> &indices;
+        std::unordered_map<EdgeKey, std::vector<unsigned int>> edges;
+    };
+
+
+    struct PartShape
+    {
+        // Six times the signed volume, measured from the part centroid
+        float volume;
+        glm::vec3 normal;
+        bool flat;
+    };
+}
+
+
+static PartShape MeasurePart(const std::vector<VertexFormat> &vertices, const std::vector<unsigned int> &indices,
+                             const std::vector<unsigned int> &part, const std::vector<bool> &flip)
+{
+    glm::vec3 centroid(0), min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+    for (unsigned int t : part)
+    {
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            const glm::vec3 &p = vertices[indices[3 * t + c]].position;
+            centroid += p;
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+    }
+    centroid /= 3.0f * part.size();
+
+    PartShape shape;
+    shape.volume = 0;
+    shape.normal = glm::vec3(0);
+    float area = 0;
+
+    for (unsigned int t : part)
+    {
+        glm::vec3 p0 = vertices[indices[3 * t]].position - centroid;
+        glm::vec3 p1 = vertices[indices[3 * t + 1]].position - centroid;
+        glm::vec3 p2 = vertices[indices[3 * t + 2]].position - centroid;
+        if (flip[t])
+            std::swap(p1, p2);
+
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        shape.normal += n;
+        shape.volume += glm::dot(p0, glm::cross(p1, p2));
+        area += glm::length(n);
+    }
+
+    shape.flat = std::abs(shape.volume) <= 1e-3f * area * glm::length(max - min);
+    return shape;
+}
+
+
+void mesh_optimizer::RemoveDuplicateVertices(std::vector<VertexFormat> &vertices,
+                                             std::vector<unsigned int> &indices)
+{
+    struct Hash
+    {
+        size_t operator()(const VertexFormat &v) const
+        {
+            // FNV-1a over the attribute bytes
+            const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&v);
+            size_t hash = 2166136261u;
+            for (size_t i = 0; i < sizeof(VertexFormat); i++) {
+                hash = (hash ^ bytes[i]) * 16777619u;
+            }
+            return hash;
+        }
+    };
+
+    struct Equal
+    {
+        bool operator()(const VertexFormat &a, const VertexFormat &b) const
+        {
+            return memcmp(&a, &b, sizeof(VertexFormat)) == 0;
+        }
+    };
+
+    std::unordered_map<VertexFormat, unsigned int, Hash, Equal> unique;
+    std::vector<VertexFormat> result;
+    std::vector<unsigned int> remap(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        auto it = unique.emplace(vertices[i], (unsigned int)result.size());
+        if (it.second) {
+            result.push_back(vertices[i]);
+        }
+        remap[i] = it.first->second;
+    }
+
+    if (result.size() == vertices.size())
+        return;
+
+    for (auto &index : indices) {
+        index = remap[index];
+    }
+    vertices.swap(result);
+}
+
+
+mesh_optimizer::WindingInfo mesh_optimizer::NormalizeWinding(const std::vector<VertexFormat> &vertices,
+                                                             std::vector<unsigned int> &indices)
+{
+    WindingInfo info;
+    info.flippedTriangles = 0;
+    info.cullable = true;
+
+    std::vector<bool> flip, closed;
+    Topology topology(vertices, indices);
+    auto parts = topology.GetParts(flip, closed);
+
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        PartShape shape = MeasurePart(vertices, indices, parts[i], flip);
+        bool reverse = false;
+
+        if (closed[i]) {
+            reverse = shape.volume < 0;
+        } else if (shape.flat) {
+            // Only surfaces facing up or down have a side that is never seen
+            bool horizontal = std::abs(shape.normal.y) >= 0.99f * glm::length(shape.normal);
+            reverse = horizontal && shape.normal.y < 0;
+            info.cullable = info.cullable && horizontal;
+        } else {
+            reverse = shape.volume < 0;
+            info.cullable = false;
+        }
+
+        for (unsigned int t : parts[i])
+        {
+            if (flip[t] != reverse)
+            {
+                std::swap(indices[3 * t + 1], indices[3 * t + 2]);
+                info.flippedTriangles++;
+            }
+        }
+    }
+
+    return info;
+}
+
+
+unsigned int mesh_optimizer::CountWindingErrors(const std::vector<VertexFormat> &vertices,
+                                                const std::vector<unsigned int> &indices)
+{
+    unsigned int errors = 0;
+
+    std::vector<bool> flip, closed;
+    Topology topology(vertices, indices);
+    auto parts = topology.GetParts(flip, closed);
+
+    std::unordered_map<EdgeKey, unsigned int> directed;
+    for (unsigned int t = 0; t < indices.size() / 3; t++)
+    {
+        for (unsigned int e = 0; e < 3; e++)
+        {
+            unsigned int a = topology.Vertex(t, e), b = topology.Vertex(t, (e + 1) % 3);
+            if (a == b)
+                continue;
+
+            // Only the edges of two triangles have a direction the winding fixes
+            if (topology.edges.at(UndirectedEdge(a, b)).size() == 2 && ++directed[DirectedEdge(a, b)] > 1) {
+                errors++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        if (closed[i] && MeasurePart(vertices, indices, parts[i], flip).volume < 0) {
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+
+static int SkipDeadEnd(const std::vector<unsigned int> &liveTriangles, std::vector<unsigned int> &deadEnds,
+                       unsigned int &cursor)
+{
+    while (!deadEnds.empty())
+    {
+        unsigned int v = deadEnds.back();
+        deadEnds.pop_back();
+        if (liveTriangles[v] > 0)
+            return (int)v;
+    }
+
+    for (; cursor < liveTriangles.size(); cursor++)
+    {
+        if (liveTriangles[cursor] > 0)
+            return (int)cursor;
+    }
+
+    return -1;
+}
+
+
+void mesh_optimizer::OptimizeVertexCache(std::vector<unsigned int> &indices,
+                                         unsigned int numVertices,
+                                         unsigned int cacheSize)
+{
+    unsigned int numTriangles = (unsigned int)indices.size() / 3;
+    if (numTriangles == 0)
+        return;
+
+    // Triangles using every vertex
+    std::vector<unsigned int> offsets(numVertices + 1, 0);
+    for (unsigned int index : indices) {
+        offsets[index + 1]++;
+    }
+    for (unsigned int v = 0; v < numVertices; v++) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (unsigned int i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<unsigned int> liveTriangles(numVertices);
+    for (unsigned int v = 0; v < numVertices; v++) {
+        liveTriangles[v] = offsets[v + 1] - offsets[v];
+    }
+
+    std::vector<unsigned int> cacheTime(numVertices, 0);
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    unsigned int time = cacheSize + 1;
+    unsigned int cursor = 0;
+    int fanning = SkipDeadEnd(liveTriangles, deadEnds, cursor);
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+
+        // Emit every triangle around the fanning vertex
+        for (unsigned int i = offsets[fanning]; i < offsets[fanning + 1]; i++)
+        {
+            unsigned int t = adjacency[i];
+            if (emitted[t])
+                continue;
+
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                unsigned int v = indices[3 * t + c];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // Next, the candidate that stays longest in the cache
+        int best = -1, bestPriority = -1;
+        for (unsigned int v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = time - cacheTime[v];
+            }
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+
+        fanning = best >= 0 ? best : SkipDeadEnd(liveTriangles, deadEnds, cursor);
+    }
+
+    indices.swap(result);
+}
+
+
+void mesh_optimizer::OptimizeVertexFetch(std::vector<VertexFormat> &vertices,
+                                         std::vector<unsigned int> &indices)
+{
+    const unsigned int unused = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<VertexFormat> result;
+    result.reserve(vertices.size());
+
+    for (auto &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = (unsigned int)result.size();
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(result);
+}
+
+
+float mesh_optimizer::ComputeACMR(const std::vector<unsigned int> &indices,
+                                  unsigned int numVertices,
+                                  unsigned int cacheSize)
+{
+    if (indices.size() < 3)
+        return 0;
+
+    std::vector<unsigned int> cacheTime(numVertices, 0);
+    unsigned int time = cacheSize + 1;
+    unsigned int misses = 0;
+
+    for (unsigned int index : indices)
+    {
+        if (time - cacheTime[index] > cacheSize)
+        {
+            cacheTime[index] = time++;
+            misses++;
+        }
+    }
+
+    return (float)misses / (indices.size() / 3);
+}
+
+
+mesh_optimizer::WindingInfo mesh_optimizer::Optimize(std::vector<VertexFormat> &vertices,
+                                                     std::vector<unsigned int> &indices)
+{
+    RemoveDuplicateVertices(vertices, indices);
+    WindingInfo info = NormalizeWinding(vertices, indices);
+
+    // Small meshes are often generated in a cache friendly order already
+    std::vector<unsigned int> reordered = indices;
+    OptimizeVertexCache(reordered, (unsigned int)vertices.size());
+    if (ComputeACMR(reordered, (unsigned int)vertices.size()) < ComputeACMR(indices, (unsigned int)vertices.size())) {
+        indices.swap(reordered);
+    }
+
+    OptimizeVertexFetch(vertices, indices);
+    return info;
+}
+
+
+GLenum mesh_optimizer::GetIndexType(unsigned int numVertices)
+{
+    return numVertices <= std::numeric_limits<GLushort>::max() + 1u ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+
+unsigned int mesh_optimizer::GetIndexSize(GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+
+void mesh_optimizer::PackIndices(const std::vector<unsigned int> &indices,
+                                 GLenum indexType,
+                                 std::vector<unsigned char> &data)
+{
+    data.resize(indices.size() * GetIndexSize(indexType));
+
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        GLushort *dst = reinterpret_cast<GLushort*>(data.data());
+        for (size_t i = 0; i < indices.size(); i++) {
+            dst[i] = (GLushort)indices[i];
+        }
+        return;
+    }
+
+    if (!indices.empty()) {
+        memcpy(data.data(), indices.data(), data.size());
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include "core/gpu/vertex_format.h"
+#include "utils/gl_utils.h"
+
+
+// Post-processing for triangle lists before they are uploaded
+namespace mesh_optimizer
+{
+    struct WindingInfo
+    {
+        unsigned int flippedTriangles;
+
+        // Every connected part is closed or a flat surface facing +Y,
+        // so the mesh can be drawn with back-face culling
+        bool cullable;
+    };
+
+    // Merges the vertices with identical attributes
+    void RemoveDuplicateVertices(std::vector<VertexFormat> &vertices,
+                                 std::vector<unsigned int> &indices);
+
+    // Makes the triangles of every connected part wind the same way, counter-clockwise
+    // seen from outside for closed parts and from above for flat ones
+    WindingInfo NormalizeWinding(const std::vector<VertexFormat> &vertices,
+                                 std::vector<unsigned int> &indices);
+
+    // Number of edges shared by two triangles with the same direction, plus the
+    // closed parts facing inwards. Zero for meshes that went through NormalizeWinding.
+    unsigned int CountWindingErrors(const std::vector<VertexFormat> &vertices,
+                                    const std::vector<unsigned int> &indices);
+
+    // Tipsify triangle reordering for the post-transform vertex cache
+    void OptimizeVertexCache(std::vector<unsigned int> &indices,
+                             unsigned int numVertices,
+                             unsigned int cacheSize = 16);
+
+    // Reorders the vertices in the order they are first used by the indices
+    void OptimizeVertexFetch(std::vector<VertexFormat> &vertices,
+                             std::vector<unsigned int> &indices);
+
+    // Average cache misses per triangle for a FIFO cache of the given size
+    float ComputeACMR(const std::vector<unsigned int> &indices,
+                      unsigned int numVertices,
+                      unsigned int cacheSize = 16);
+
+    // All the steps above, for GL_TRIANGLES meshes
+    WindingInfo Optimize(std::vector<VertexFormat> &vertices,
+                         std::vector<unsigned int> &indices);
+
+    // GL_UNSIGNED_SHORT when every index fits in 16 bits
+    GLenum GetIndexType(unsigned int numVertices);
+    unsigned int GetIndexSize(GLenum indexType);
+
+    // The indices converted to the given type, as bytes ready for upload
+    void PackIndices(const std::vector<unsigned int> &indices,
+                     GLenum indexType,
+                     std::vector<unsigned char> &data);
+}   // namespace mesh_optimizer
@@ -11,7 +11,9 @@
 
 #include "core/gpu/shader.h"
 #include "core/gpu/texture2D.h"
+#include "core/gpu/render_stats.h"
 #include "core/gpu/ssbo.h"
+#include "core/gpu/stream_buffer.h"
 
 
 // TODO(developer): Decouple gfxc components from this class
@@ -23,7 +25,18 @@ class ParticleEffect
     virtual ~ParticleEffect();
 
     virtual void Generate(unsigned int particleCount, bool createLocalBuffer = false);
+    // Writes the generated particles straight into the storage buffer, nothing
+    // is read back. The local buffer, when there is one, gets them too.
     virtual void FillRandomData(std::function<T(void)> generator);
+
+    // Initializes the particles on the GPU with a compute shader that writes
+    // the storage buffer at binding 0, given the `seed` and `particle_count`
+    // uniforms. Nothing crosses the bus and the local buffer is not updated.
+    virtual void FillOnGPU(Shader *initShader, unsigned int seed);
+
+    // Replaces the particles of the next Render with ones simulated on the CPU.
+    // They are written to a stream buffer, the storage buffer is left as it is.
+    virtual void StreamParticles(const T *data, unsigned int count);
     virtual void Render(gfxc::Camera *camera, Shader *shader, unsigned int nrParticles = -1);
 
     virtual SSBO<T>* GetParticleBuffer() const
@@ -44,6 +57,10 @@ class ParticleEffect
     GLuint VAO;
     GLuint VBO;
     SSBO<T> *particles;
+
+    StreamBuffer *stream;
+    StreamBuffer::Allocation streamed;
+    unsigned int streamedCount;
 };
 
 
@@ -52,6 +69,11 @@ ParticleEffect<T>::ParticleEffect()
 {
     source = new gfxc::Transform();
     particles = nullptr;
+    particleCount = 0;
+
+    stream = nullptr;
+    streamed.pointer = nullptr;
+    streamedCount = 0;
 }
 
 
@@ -60,6 +82,7 @@ ParticleEffect<T>::~ParticleEffect()
 {
     SAFE_FREE(source);
     SAFE_FREE(particles);
+    SAFE_FREE(stream);
 }
 
 
@@ -72,12 +95,23 @@ void ParticleEffect<T>::Render(gfxc::Camera *camera, Shader *shader, unsigned in
     glUniformMatrix4fv(shader->loc_projection_matrix, 1, false, glm::value_ptr(camera->GetProjectionMatrix()));
     glUniform3fv(shader->loc_eye_pos, 1, glm::value_ptr(camera->m_transform->GetWorldPosition()));
 
-    // Bind Particle Storage
-    particles->BindBuffer(0);
+    // Bind Particle Storage, the streamed particles are used once
+    unsigned int count = particleCount;
+    if (streamed.IsValid())
+    {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, stream->GetBufferID(), streamed.offset, streamed.size);
+        count = streamedCount;
+        streamed.pointer = nullptr;
+    }
+    else
+    {
+        particles->BindBuffer(0);
+    }
 
     // Render Particles
     glBindVertexArray(VAO);
-    glDrawElements(GL_POINTS, MIN(particleCount, nrParticles), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_POINTS, MIN(count, nrParticles), GL_UNSIGNED_INT, 0);
+    RenderStats::CountDraw(GL_POINTS, MIN(count, nrParticles));
 }
 
 
@@ -115,10 +149,62 @@ void ParticleEffect<T>::Generate(unsigned int particleCount, bool createLocalBuf
 template <class T>
 void ParticleEffect<T>::FillRandomData(std::function<T(void)> generator)
 {
-    particles->ReadBuffer();
-    auto data = const_cast<T*>(particles->GetBuffer());
+    T *mapped = particles->MapForWrite();
+    if (!mapped)
+        return;
+
+    auto local = const_cast<T*>(particles->GetBuffer());
     for (unsigned int i = 0; i < particleCount; i++) {
-        data[i] = generator();
+        mapped[i] = generator();
+    }
+
+    if (local) {
+        memcpy(local, mapped, particleCount * sizeof(T));
     }
-    particles->SetBufferData(data);
+    particles->Unmap();
+}
+
+
+template <class T>
+void ParticleEffect<T>::FillOnGPU(Shader *initShader, unsigned int seed)
+{
+    GLint workGroupSize[3];
+    glGetProgramiv(initShader->program, GL_COMPUTE_WORK_GROUP_SIZE, workGroupSize);
+
+    glUseProgram(initShader->program);
+    glUniform1ui(glGetUniformLocation(initShader->program, "seed"), seed);
+    glUniform1ui(glGetUniformLocation(initShader->program, "particle_count"), particleCount);
+
+    particles->BindBuffer(0);
+    glDispatchCompute((particleCount + workGroupSize[0] - 1) / workGroupSize[0], 1, 1);
+
+    // The particles are read next from the storage buffer or as vertex attributes
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    glUseProgram(0);
+    CheckOpenGLError();
+}
+
+
+template <class T>
+void ParticleEffect<T>::StreamParticles(const T *data, unsigned int count)
+{
+    // The indices of Generate limit the number of particles drawn
+    count = MIN(count, particleCount);
+    if (count == 0)
+        return;
+
+    if (!stream) {
+        stream = new StreamBuffer(particleCount * sizeof(T));
+    }
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    streamed = stream->Allocate(count * sizeof(T), MAX(alignment, 16));
+    if (!streamed.IsValid())
+        return;
+
+    memcpy(streamed.pointer, data, count * sizeof(T));
+    stream->Commit(streamed);
+    streamedCount = count;
 }
@@ -0,0 +1,141 @@
+#include "core/gpu/render_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#include "core/gpu/stream_buffer.h"
+
+
+// Frames of the rolling window, a few seconds
+static const unsigned int WINDOW_FRAMES = 300;
+
+// Frames kept for the CSV file, about 50 MB at most
+static const size_t MAX_CSV_FRAMES = 1 << 20;
+
+
+RenderStats::Counters RenderStats::current = {};
+std::vector<RenderStats::Frame> RenderStats::window;
+unsigned int RenderStats::numFrames = 0;
+unsigned long long RenderStats::frameIndex = 0;
+std::string RenderStats::csvPath;
+std::vector<RenderStats::Frame> RenderStats::csvFrames;
+
+
+void RenderStats::EndFrame(double frameSeconds)
+{
+    // The stream buffers count their own bytes, their frame ends right after
+    current.bufferBytes += StreamBuffer::GetStats().bytesThisFrame;
+
+    Frame frame;
+    frame.counters = current;
+    frame.milliseconds = frameSeconds * 1000.0;
+
+    if (window.empty()) {
+        window.resize(WINDOW_FRAMES);
+    }
+
+    window[frameIndex % WINDOW_FRAMES] = frame;
+    numFrames = std::min(numFrames + 1, WINDOW_FRAMES);
+    frameIndex++;
+
+    if (!csvPath.empty() && csvFrames.size() < MAX_CSV_FRAMES) {
+        csvFrames.push_back(frame);
+    }
+
+    current = Counters();
+}
+
+
+const RenderStats::Counters &RenderStats::GetLastFrame()
+{
+    static const Counters none = {};
+    return numFrames ? window[(frameIndex - 1) % WINDOW_FRAMES].counters : none;
+}
+
+
+RenderStats::Counters RenderStats::GetAverage()
+{
+    Counters average = {};
+    if (numFrames == 0)
+        return average;
+
+    unsigned long long drawCalls = 0, programBinds = 0, uniformUploads = 0;
+    for (unsigned int i = 0; i < numFrames; i++)
+    {
+        const Counters &counters = window[i].counters;
+        drawCalls += counters.drawCalls;
+        average.triangles += counters.triangles;
+        programBinds += counters.programBinds;
+        uniformUploads += counters.uniformUploads;
+        average.bufferBytes += counters.bufferBytes;
+    }
+
+    average.drawCalls = static_cast<unsigned int>(drawCalls / numFrames);
+    average.triangles /= numFrames;
+    average.programBinds = static_cast<unsigned int>(programBinds / numFrames);
+    average.uniformUploads = static_cast<unsigned int>(uniformUploads / numFrames);
+    average.bufferBytes /= numFrames;
+    return average;
+}
+
+
+RenderStats::FrameTimes RenderStats::GetFrameTimes()
+{
+    FrameTimes times = {};
+    times.numFrames = numFrames;
+    if (numFrames == 0)
+        return times;
+
+    std::vector<double> milliseconds(numFrames);
+    for (unsigned int i = 0; i < numFrames; i++) {
+        milliseconds[i] = window[i].milliseconds;
+        times.average += milliseconds[i];
+    }
+    times.average /= numFrames;
+
+    // The frame that 99% of the window is not slower than
+    size_t p99 = std::min<size_t>(numFrames - 1, (numFrames * 99) / 100);
+    std::nth_element(milliseconds.begin(), milliseconds.begin() + p99, milliseconds.end());
+    times.p99 = milliseconds[p99];
+
+    auto range = std::minmax_element(milliseconds.begin(), milliseconds.end());
+    times.min = *range.first;
+    times.max = *range.second;
+    return times;
+}
+
+
+void RenderStats::EnableCsv(const std::string &path)
+{
+    csvPath = path;
+}
+
+
+bool RenderStats::WriteCsv()
+{
+    if (csvPath.empty() || csvFrames.empty())
+        return false;
+
+    FILE *file = fopen(csvPath.c_str(), "w");
+    if (!file)
+    {
+        std::cout << "RenderStats: cannot write " << csvPath << std::endl;
+        return false;
+    }
+
+    fprintf(file, "frame,milliseconds,draw_calls,triangles,program_binds,uniform_uploads,buffer_bytes\n");
+    for (size_t i = 0; i < csvFrames.size(); i++)
+    {
+        const Frame &frame = csvFrames[i];
+        fprintf(file, "%zu,%.3f,%u,%llu,%u,%u,%llu\n", i, frame.milliseconds, frame.counters.drawCalls,
+            frame.counters.triangles, frame.counters.programBinds, frame.counters.uniformUploads, frame.counters.bufferBytes);
+    }
+
+    bool written = ferror(file) == 0;
+    fclose(file);
+
+    std::cout << "RenderStats: " << csvFrames.size() << " frames written to " << csvPath << std::endl;
+    csvFrames.clear();
+    return written;
+}
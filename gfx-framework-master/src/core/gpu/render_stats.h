@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "utils/gl_utils.h"
+
+
+// Per-frame counters of the draw paths: the draw wrappers of the framework and
+// the labs report their calls here, the World closes the frame after FrameEnd.
+// The last frames are kept for rolling averages and frame time percentiles,
+// and every frame can be written to a CSV file for regression tracking.
+class RenderStats
+{
+ public:
+    struct Counters
+    {
+        unsigned int drawCalls;
+
+        // Known on the CPU only, the indirect draws add none
+        unsigned long long triangles;
+
+        unsigned int programBinds;
+        unsigned int uniformUploads;
+
+        // Buffer uploads, including the stream buffers
+        unsigned long long bufferBytes;
+    };
+
+    // In milliseconds, over the frames of the rolling window
+    struct FrameTimes
+    {
+        double average;
+        double min;
+        double max;
+        double p99;
+        unsigned int numFrames;
+    };
+
+ public:
+    // `count` vertices or indices per instance, as passed to the draw call
+    static void CountDraw(GLenum mode, unsigned long long count, unsigned long long instances = 1)
+    {
+        current.drawCalls++;
+        current.triangles += GetTriangles(mode, count) * instances;
+    }
+
+    static void CountProgramBind()                      { current.programBinds++; }
+    static void CountUniforms(unsigned int count)       { current.uniformUploads += count; }
+    static void CountBufferBytes(unsigned long long n)  { current.bufferBytes += n; }
+
+    // Closes the counters of a frame, called by the World once per frame
+    static void EndFrame(double frameSeconds);
+
+    static const Counters &GetLastFrame();
+    static Counters GetAverage();
+    static FrameTimes GetFrameTimes();
+
+    // Keeps every frame from now on, WriteCsv writes them, the World calls it
+    // when it is destroyed
+    static void EnableCsv(const std::string &path);
+    static bool WriteCsv();
+
+ private:
+    static unsigned long long GetTriangles(GLenum mode, unsigned long long count)
+    {
+        switch (mode)
+        {
+        case GL_TRIANGLES:          return count / 3;
+        case GL_TRIANGLE_STRIP:
+        case GL_TRIANGLE_FAN:       return count > 2 ? count - 2 : 0;
+        default:                    return 0;
+        }
+    }
+
+ private:
+    struct Frame
+    {
+        Counters counters;
+        double milliseconds;
+    };
+
+    static Counters current;
+
+    // Ring of the last frames, `numFrames` of them valid
+    static std::vector<Frame> window;
+    static unsigned int numFrames;
+    static unsigned long long frameIndex;
+
+    static std::string csvPath;
+    static std::vector<Frame> csvFrames;
+};
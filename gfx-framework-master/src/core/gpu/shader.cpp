@@ -1,12 +1,40 @@
 #include "core/gpu/shader.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+
+#include "core/profiler.h"
+#include "core/gpu/render_stats.h"
+
+
+static std::string InjectDefines(const std::string &shaderCode, const std::vector<std::string> &variantDefines)
+{
+    std::string defines;
+    size_t pos = shaderCode.find_first_of("\n");
+
+#ifdef SOLVED
+    defines += "\n#define SOLVED";
+#endif
+
+    for (const auto &define : variantDefines)
+        defines += "\n#define " + define;
+
+    if (pos == std::string::npos)
+    {
+        return shaderCode + defines;
+    }
+
+    return shaderCode.substr(0, pos) + defines + shaderCode.substr(pos, std::string::npos);
+}
 
 
 Shader::Shader(const std::string &name)
 {
     program = 0;
+    pendingProgram = 0;
+    cacheKey = 0;
     shaderName = name;
     shaderFiles.reserve(5);
 }
@@ -14,6 +42,13 @@ Shader::Shader(const std::string &name)
 
 Shader::~Shader()
 {
+    for (auto &variant : variants)
+        delete variant.second;
+
+    for (const auto &S : pendingShaders)
+        glDeleteShader(S.object);
+
+    glDeleteProgram(pendingProgram);
     glDeleteProgram(program);
 }
 
@@ -35,6 +70,7 @@ void Shader::Use() const
     if (program)
     {
         glUseProgram(program);
+        RenderStats::CountProgramBind();
         CheckOpenGLError();
     }
 }
@@ -47,6 +83,9 @@ unsigned int Shader::Reload()
         program = 0;
     }
 
+    for (auto &variant : variants)
+        variant.second->Reload();
+
     return CreateAndLink();
 }
 
@@ -66,6 +105,56 @@ GLint Shader::GetUniformLocation(const char *uniformName) const
 }
 
 
+const std::vector<std::string> &Shader::GetFeatures() const
+{
+    return features;
+}
+
+
+Shader *Shader::GetVariant(const std::string &features, bool wait)
+{
+    std::vector<std::string> keywords;
+    std::istringstream stream(features);
+    std::string keyword;
+
+    while (stream >> keyword)
+    {
+        if (std::find(this->features.begin(), this->features.end(), keyword) == this->features.end()) {
+            std::cout << "Shader " << shaderName << " does not declare the feature " << keyword << std::endl;
+            continue;
+        }
+        keywords.push_back(keyword);
+    }
+
+    if (keywords.empty())
+        return this;
+
+    // The same set in any order is the same program
+    std::sort(keywords.begin(), keywords.end());
+    keywords.erase(std::unique(keywords.begin(), keywords.end()), keywords.end());
+
+    std::string key;
+    for (const auto &K : keywords)
+        key += (key.empty() ? "" : " ") + K;
+
+    Shader *&variant = variants[key];
+    if (variant == nullptr)
+    {
+        variant = new Shader(shaderName + "[" + key + "]");
+        variant->shaderFiles = shaderFiles;
+        variant->shaderCodes = shaderCodes;
+        variant->defines = keywords;
+        variant->StartCompile();
+    }
+
+    if (wait && variant->IsCompiling()) {
+        variant->CreateAndLink();
+    }
+
+    return variant;
+}
+
+
 void Shader::OnLoad(std::function<void()> onLoad)
 {
     loadObservers.push_back(onLoad);
@@ -129,75 +218,132 @@ void Shader::AddShaderCode(const std::string &shaderCode, GLenum shaderType)
 }
 
 
-unsigned int Shader::CreateAndLink()
+bool Shader::StartCompile()
 {
-    std::vector<unsigned int> shaders;
+    if (pendingProgram)
+        return true;
+
+    PROFILE_ZONE("Shader::StartCompile");
+
+    std::vector<ShaderCache::Source> sources;
+    std::vector<std::string> files;
+    features.clear();
 
-    // Compile shaders
     for (auto S : shaderFiles) {
-        auto shaderID = Shader::CreateShader(S.file, S.type);
-        if (shaderID) {
-            shaders.push_back(shaderID);
-        } else {
-            return 0;
+        std::string shaderCode;
+        if (!Shader::ReadShader(S.file, shaderCode)) {
+            return false;
         }
+        ParseFeatures(shaderCode, features);
+        sources.push_back({ InjectDefines(shaderCode, defines), S.type });
+        files.push_back(S.file);
+    }
+
+    for (auto S : shaderCodes) {
+        ParseFeatures(S.file, features);
+        sources.push_back({ defines.empty() ? S.file : InjectDefines(S.file, defines), S.type });
+        files.push_back("");
+    }
+
+    if (sources.empty())
+        return false;
+
+    // Use the binary of a previous run when the sources and driver are the same
+    cacheKey = ShaderCache::GetKey(sources);
+    pendingProgram = ShaderCache::Load(cacheKey);
+    if (pendingProgram) {
+        return true;
     }
 
-    for (auto S : shaderCodes)
+    // Queue the compile and link, their status is checked in CreateAndLink
+    pendingProgram = glCreateProgram();
+    ShaderCache::PrepareProgram(pendingProgram);
+
+    for (size_t i = 0; i < sources.size(); i++)
     {
-        auto shaderID = Shader::CompileShader(S.file, S.type);
-        if (shaderID) {
-            shaders.push_back(shaderID);
-        } else {
-            return 0;
+        auto shaderID = Shader::CompileShader(sources[i].code, sources[i].type);
+        if (shaderID == 0) {
+            break;
         }
+
+        pendingShaders.push_back({ shaderID, sources[i].type, files[i] });
+        glAttachShader(pendingProgram, shaderID);
     }
 
-    // Create Program and Link
-    if (shaders.size()) {
-        program = Shader::CreateProgram(shaders);
-
-        if (program)
-        {
-            glUseProgram(program);
-            GetUniforms();
-            for (auto Observer : loadObservers) {
-                Observer();
-            }
-            return program;
-        }
+    if (pendingShaders.size() == sources.size()) {
+        glLinkProgram(pendingProgram);
     }
-    return 0;
+
+    return true;
 }
 
 
-void Shader::ClearShaders()
+bool Shader::IsCompiling() const
 {
-    shaderFiles.clear();
+    return pendingProgram != 0;
 }
 
 
-static std::string InjectDefines(const std::string &shaderCode)
+unsigned int Shader::CreateAndLink()
 {
-    std::string defines;
-    size_t pos = shaderCode.find_first_of("\n");
+    PROFILE_ZONE("Shader::CreateAndLink");
 
-#ifdef SOLVED
-    defines += "\n#define SOLVED";
-#endif
+    if (!StartCompile())
+        return 0;
 
-    if (pos == std::string::npos)
-    {
-        return shaderCode + defines;
+    GLuint glProgramObject = pendingProgram;
+    bool compiled = pendingShaders.size() == shaderFiles.size() + shaderCodes.size();
+    bool fromCache = pendingShaders.empty();
+    pendingProgram = 0;
+
+    // Compile shaders
+    for (const auto &S : pendingShaders) {
+        if (!S.file.empty()) {
+            std::cout << "\tFILE = " << S.file;
+        }
+
+        compiled = Shader::CheckShader(S.object, S.type) && compiled;
     }
 
-    return shaderCode.substr(0, pos) + defines + shaderCode.substr(pos, std::string::npos);
+    // Link
+    bool linked = fromCache || (compiled && Shader::CheckProgram(glProgramObject));
+
+    // Delete the shader objects because we do not need them any more
+    for (const auto &S : pendingShaders)
+        glDeleteShader(S.object);
+    pendingShaders.clear();
+
+    if (!linked) {
+        glDeleteProgram(glProgramObject);
+        return 0;
+    }
+
+    if (fromCache) {
+        std::cout << "\tPROGRAM = " << shaderName << "\t ..... CACHED " << std::endl;
+    } else {
+        ShaderCache::Store(cacheKey, glProgramObject);
+    }
+
+    CheckOpenGLError();
+
+    program = glProgramObject;
+    glUseProgram(program);
+    GetUniforms();
+    for (auto Observer : loadObservers) {
+        Observer();
+    }
+    return program;
 }
 
 
-unsigned int Shader::CreateShader(const std::string &shaderFile, GLenum shaderType)
+void Shader::ClearShaders()
+{
+    shaderFiles.clear();
+}
+
+
+bool Shader::ReadShader(const std::string &shaderFile, std::string &shaderCode)
 {
-    std::string shader_code;
     std::ifstream file(shaderFile.c_str(), std::ios::in);
 
     if (!file.good()) {
@@ -205,23 +351,41 @@ unsigned int Shader::CreateShader(const std::string &shaderFile, GLenum shaderTy
         std::terminate();
     }
 
-    std::cout << "\tFILE = " << shaderFile;
-
     // Get file content
     file.seekg(0, std::ios::end);
-    shader_code.resize((unsigned int)file.tellg());
+    shaderCode.resize((unsigned int)file.tellg());
     file.seekg(0, std::ios::beg);
-    file.read(&shader_code[0], shader_code.size());
+    file.read(&shaderCode[0], shaderCode.size());
     file.close();
 
-    return CompileShader(InjectDefines(shader_code), shaderType);
+    return true;
+}
+
+
+void Shader::ParseFeatures(const std::string &shaderCode, std::vector<std::string> &features)
+{
+    std::istringstream lines(shaderCode);
+    std::string line;
+
+    while (std::getline(lines, line))
+    {
+        std::istringstream tokens(line);
+        std::string directive, pragma, feature;
+        tokens >> directive >> pragma;
+
+        if (directive != "#pragma" || pragma != "features")
+            continue;
+
+        while (tokens >> feature) {
+            if (std::find(features.begin(), features.end(), feature) == features.end())
+                features.push_back(feature);
+        }
+    }
 }
 
 
 unsigned int Shader::CompileShader(const std::string shaderCode, GLenum shaderType)
 {
-    int infoLogLength = 0;
-    int compileResult = 0;
     unsigned int glShaderObject;
 
     // Create new shader object
@@ -234,8 +398,19 @@ unsigned int Shader::CompileShader(const std::string shaderCode, GLenum shaderTy
     const char *shader_code_ptr = shaderCode.c_str();
     const int shader_code_size = (int)shaderCode.size();
 
+    // The result is read by CheckShader, so the driver may compile in the background
     glShaderSource(glShaderObject, 1, &shader_code_ptr, &shader_code_size);
     glCompileShader(glShaderObject);
+
+    return glShaderObject;
+}
+
+
+bool Shader::CheckShader(unsigned int glShaderObject, GLenum shaderType)
+{
+    int infoLogLength = 0;
+    int compileResult = 0;
+
     glGetShaderiv(glShaderObject, GL_COMPILE_STATUS, &compileResult);
 
     // LOG COMPILE ERRORS
@@ -253,7 +428,7 @@ unsigned int Shader::CompileShader(const std::string shaderCode, GLenum shaderTy
         if (shaderType == GL_COMPUTE_SHADER)             str_shader_type="COMPUTE";
 
         glGetShaderiv(glShaderObject, GL_INFO_LOG_LENGTH, &infoLogLength);
-        std::vector<char> shader_log(infoLogLength);
+        std::vector<char> shader_log(infoLogLength + 1);
         glGetShaderInfoLog(glShaderObject, infoLogLength, NULL, &shader_log[0]);
 
         std::cout << "\n-----------------------------------------------------\n";
@@ -261,46 +436,33 @@ unsigned int Shader::CompileShader(const std::string shaderCode, GLenum shaderTy
         std::cout << &shader_log[0] << "\n";
         std::cout << "-----------------------------------------------------" << std::endl;
 
-        return 0;
+        return false;
     }
 
     std::cout << "\t ..... COMPILED " << std::endl;
 
-    return glShaderObject;
+    return true;
 }
 
 
-unsigned int Shader::CreateProgram(const std::vector<unsigned int> &shaderObjects)
+bool Shader::CheckProgram(unsigned int glProgramObject)
 {
     int infoLogLength = 0;
     int linkResult = 0;
 
-    // build OpenGL program object and link all the OpenGL shader objects
-    unsigned int glProgramObject = glCreateProgram();
-
-    for (auto shader : shaderObjects)
-        glAttachShader(glProgramObject, shader);
-
-    glLinkProgram(glProgramObject);
     glGetProgramiv(glProgramObject, GL_LINK_STATUS, &linkResult);
 
     // LOG LINK ERRORS
     if (linkResult == GL_FALSE) {
         glGetProgramiv(glProgramObject, GL_INFO_LOG_LENGTH, &infoLogLength);
-        std::vector<char> program_log(infoLogLength);
+        std::vector<char> program_log(infoLogLength + 1);
         glGetProgramInfoLog(glProgramObject, infoLogLength, NULL, &program_log[0]);
 
         std::cout << "Shader Loader : LINK ERROR" << std::endl;
         std::cout << &program_log[0] << std::endl;
 
-        return 0;
+        return false;
     }
 
-    // Delete the shader objects because we do not need them any more
-    for (auto shader : shaderObjects)
-        glDeleteShader(shader);
-
-    CheckOpenGLError();
-
-    return glProgramObject;
+    return true;
 }
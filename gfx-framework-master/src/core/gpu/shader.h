@@ -3,8 +3,10 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <map>
 #include <functional>
 
+#include "core/managers/shader_cache.h"
 #include "utils/gl_utils.h"
 
 
@@ -27,8 +29,23 @@ class Shader
     void AddShader(const std::string &shaderFile, GLenum shaderType);
     void AddShaderCode(const std::string &shaderCode, GLenum shaderType);
     void ClearShaders();
+
+    // Starts loading the program from the cache or compiling it, without
+    // waiting for the driver. Start all programs first, then link them.
+    bool StartCompile();
+    bool IsCompiling() const;
+
+    // Finishes the compile started above, or does all of it when none was started
     unsigned int CreateAndLink();
 
+    // Feature keywords a source declares with `#pragma features NAME ...`
+    const std::vector<std::string> &GetFeatures() const;
+
+    // The program specialized for the space separated `features`, compiled with
+    // a #define for each one on first use. Keywords not declared by the sources
+    // are ignored. With `wait` false the compile is only started.
+    Shader *GetVariant(const std::string &features, bool wait = true);
+
     void BindTexturesUnits();
     GLint GetUniformLocation(const char * uniformName) const;
 
@@ -36,9 +53,11 @@ class Shader
 
  private:
     void GetUniforms();
-    static unsigned int CreateShader(const std::string &shaderFile, GLenum shaderType);
+    static bool ReadShader(const std::string &shaderFile, std::string &shaderCode);
+    static void ParseFeatures(const std::string &shaderCode, std::vector<std::string> &features);
     static unsigned int CompileShader(const std::string shaderCode, GLenum shaderType);
-    static unsigned int CreateProgram(const std::vector<unsigned int> &shaderObjects);
+    static bool CheckShader(unsigned int shaderObject, GLenum shaderType);
+    static bool CheckProgram(unsigned int programObject);
 
  public:
     GLuint program;
@@ -79,5 +98,22 @@ class Shader
     std::string shaderName;
     std::vector<ShaderFile> shaderFiles;
     std::vector<ShaderFile> shaderCodes;
+
+    // State of the compile between StartCompile and CreateAndLink
+    struct PendingShader
+    {
+        unsigned int object;
+        GLenum type;
+        std::string file;
+    };
+
+    GLuint pendingProgram;
+    std::vector<PendingShader> pendingShaders;
+    uint64_t cacheKey;
     std::list<std::function<void()>> loadObservers;
+
+    // Permutations
+    std::vector<std::string> features;
+    std::vector<std::string> defines;
+    std::map<std::string, Shader *> variants;
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstring>
+
 #include "utils/gl_utils.h"
 #include "utils/memory_utils.h"
 
@@ -14,6 +16,13 @@ class SSBO
         memorySize = size * sizeof(StorageEntry);
         data = createLocalBuffer ? new StorageEntry[size] : nullptr;
 
+        for (auto &readback : readbacks) {
+            readback.buffer = 0;
+            readback.fence = 0;
+        }
+        firstReadback = 0;
+        numPendingReads = 0;
+
         #ifdef GLEW_ARB_shader_storage_buffer_object
         {
             glGenBuffers(1, &ssbo);
@@ -26,6 +35,14 @@ class SSBO
 
     ~SSBO()
     {
+        for (auto &readback : readbacks)
+        {
+            if (readback.fence) {
+                glDeleteSync(readback.fence);
+            }
+            glDeleteBuffers(1, &readback.buffer);
+        }
+
         glDeleteBuffers(1, &ssbo);
         SAFE_FREE_ARRAY(data);
     };
@@ -33,7 +50,24 @@ class SSBO
     void SetBufferData(const StorageEntry *data, GLenum usage = GL_DYNAMIC_DRAW)
     {
         Bind();
-        glBufferData(GL_SHADER_STORAGE_BUFFER, memorySize, data, GL_DYNAMIC_DRAW);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, memorySize, data, usage);
+        Unbind();
+    }
+
+    // Maps the whole buffer for writing. The previous contents are discarded,
+    // so the driver does not wait for the GPU and nothing is read back.
+    StorageEntry* MapForWrite()
+    {
+        Bind();
+        void *p = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, memorySize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        Unbind();
+        return static_cast<StorageEntry*>(p);
+    }
+
+    void Unmap()
+    {
+        Bind();
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
         Unbind();
     }
 
@@ -65,6 +99,80 @@ class SSBO
         Unbind();
     }
 
+    // Queues a copy of the buffer to a staging buffer and fences it, without
+    // waiting. PollReadBuffer moves the copy to the local buffer once the GPU
+    // is done, usually one or two frames later. False when all the staging
+    // buffers are still in flight.
+    bool RequestReadBuffer()
+    {
+        if (numPendingReads == READBACK_SLOTS)
+            return false;
+
+        Readback &readback = readbacks[(firstReadback + numPendingReads) % READBACK_SLOTS];
+        if (!readback.buffer)
+        {
+            glGenBuffers(1, &readback.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, readback.buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, memorySize, NULL, GL_STREAM_READ);
+        }
+
+        // Shader writes to the buffer have to land before the copy
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, ssbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, readback.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, memorySize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        CheckOpenGLError();
+
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        numPendingReads++;
+        return true;
+    }
+
+    // True when GetBuffer holds a newer copy than before the call
+    bool PollReadBuffer()
+    {
+        bool updated = false;
+
+        while (numPendingReads > 0)
+        {
+            Readback &readback = readbacks[firstReadback];
+            GLenum status = glClientWaitSync(readback.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                break;
+
+            glDeleteSync(readback.fence);
+            readback.fence = 0;
+
+            if (data == nullptr)
+            {
+                data = new StorageEntry[size];
+            }
+
+            glBindBuffer(GL_COPY_READ_BUFFER, readback.buffer);
+            const void *p = glMapBufferRange(GL_COPY_READ_BUFFER, 0, memorySize, GL_MAP_READ_BIT);
+            if (p) {
+                memcpy(data, p, memorySize);
+                updated = true;
+            }
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            CheckOpenGLError();
+
+            firstReadback = (firstReadback + 1) % READBACK_SLOTS;
+            numPendingReads--;
+        }
+
+        return updated;
+    }
+
+    unsigned int GetPendingReads() const
+    {
+        return numPendingReads;
+    }
+
     const StorageEntry* GetBuffer() const
     {
         return data;
@@ -75,6 +183,13 @@ class SSBO
         return size;
     }
 
+    // The same buffer can also be bound to other targets, for example
+    // GL_DRAW_INDIRECT_BUFFER or GL_ARRAY_BUFFER
+    GLuint GetBufferID() const
+    {
+        return ssbo;
+    }
+
     void ClearBuffer() const
     {
         Bind();
@@ -97,9 +212,23 @@ class SSBO
         CheckOpenGLError();
     }
 
+ private:
+    static const unsigned int READBACK_SLOTS = 3;
+
+    struct Readback
+    {
+        GLuint buffer;
+        GLsync fence;
+    };
+
  private:
     unsigned int ssbo;
     unsigned int size;
     unsigned int memorySize;
     StorageEntry *data;
+
+    // Staging buffers in request order, starting from `firstReadback`
+    Readback readbacks[READBACK_SLOTS];
+    unsigned int firstReadback;
+    unsigned int numPendingReads;
 };
@@ -0,0 +1,233 @@
+#include "core/gpu/stream_buffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+StreamBuffer::Stats StreamBuffer::stats = {};
+
+
+static GLintptr AlignUp(GLintptr value, GLsizeiptr alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+
+StreamBuffer::StreamBuffer(GLsizeiptr sectionSize, unsigned int numSections)
+{
+    buffer = 0;
+    mapped = nullptr;
+    pendingCommit = false;
+    this->numSections = std::max(numSections, 2u);
+
+    // Without buffer storage the buffer is orphaned instead, there is nothing to fence
+    persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+    Create(sectionSize);
+}
+
+
+StreamBuffer::~StreamBuffer()
+{
+    Release();
+}
+
+
+void StreamBuffer::Create(GLsizeiptr sectionSize)
+{
+    // Sections start at offsets that satisfy every buffer offset alignment
+    this->sectionSize = AlignUp(std::max<GLsizeiptr>(sectionSize, 256), 256);
+    GLsizeiptr capacity = GetCapacity();
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+    if (persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, NULL, flags);
+        mapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags);
+
+        if (!mapped)
+        {
+            std::cout << "StreamBuffer: persistent mapping failed, falling back to orphaning" << std::endl;
+            persistent = false;
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+            Create(sectionSize);
+            return;
+        }
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    CheckOpenGLError();
+
+    fences.assign(numSections, (GLsync)0);
+    section = 0;
+    head = 0;
+}
+
+
+void StreamBuffer::Release()
+{
+    for (GLsync fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    fences.clear();
+
+    // Deleting the buffer also unmaps it. Draws already queued keep their storage alive.
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    mapped = nullptr;
+    pendingCommit = false;
+}
+
+
+StreamBuffer::Allocation StreamBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    Allocation allocation = { nullptr, 0, size };
+    if (size <= 0)
+        return allocation;
+
+    // Only one range can be mapped at a time without buffer storage
+    Unmap();
+
+    GLintptr offset = AlignUp(head, alignment);
+
+    if (AlignUp(size, 256) > sectionSize)
+    {
+        // The section is too small for a single allocation, grow the whole ring
+        GLsizeiptr grown = std::max(2 * sectionSize, AlignUp(size, 256));
+        Release();
+        Create(grown);
+        stats.reallocations++;
+        offset = 0;
+    }
+    else if (offset + size > (GLintptr)(section + 1) * sectionSize)
+    {
+        NextSection();
+        offset = AlignUp(head, alignment);
+    }
+
+    if (persistent)
+    {
+        allocation.pointer = mapped + offset;
+    }
+    else
+    {
+        // The range was not used since the buffer was last orphaned, no need to synchronize.
+        // Commit flushes what was written.
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        allocation.pointer = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        pendingCommit = allocation.pointer != nullptr;
+    }
+
+    allocation.offset = offset;
+    head = offset + size;
+    stats.bytesThisFrame += size;
+    return allocation;
+}
+
+
+void StreamBuffer::Commit(const Allocation &allocation)
+{
+    // Coherent mappings need no flush, the writes are seen by the next commands
+    if (!pendingCommit)
+        return;
+
+    // The mapping covers only the allocation, the flushed range is relative to it
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, allocation.size);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    Unmap();
+}
+
+
+void StreamBuffer::Unmap()
+{
+    if (!pendingCommit)
+        return;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    pendingCommit = false;
+}
+
+
+void StreamBuffer::NextSection()
+{
+    if (persistent)
+    {
+        // Everything drawn from the section so far has to finish before it is written again
+        fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        section = (section + 1) % numSections;
+
+        GLsync fence = fences[section];
+        if (fence)
+        {
+            GLenum status = glClientWaitSync(fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            {
+                stats.stalls++;
+                glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            }
+
+            glDeleteSync(fence);
+            fences[section] = 0;
+        }
+    }
+    else
+    {
+        section++;
+        if (section == numSections)
+        {
+            // The driver gives the buffer new storage, the old one lives until the GPU is done with it
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, GetCapacity(), NULL, GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            section = 0;
+        }
+    }
+
+    head = (GLintptr)section * sectionSize;
+}
+
+
+GLuint StreamBuffer::GetBufferID() const
+{
+    return buffer;
+}
+
+
+GLsizeiptr StreamBuffer::GetCapacity() const
+{
+    return sectionSize * numSections;
+}
+
+
+bool StreamBuffer::IsPersistent() const
+{
+    return persistent;
+}
+
+
+void StreamBuffer::EndFrame()
+{
+    stats.bytesLastFrame = stats.bytesThisFrame;
+    stats.bytesThisFrame = 0;
+}
+
+
+StreamBuffer::Stats StreamBuffer::GetStats()
+{
+    return stats;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+#include "utils/gl_utils.h"
+
+
+// Ring buffer for data the CPU writes every frame: text quads, particles,
+// instance data. With GL 4.4 or ARB_buffer_storage the buffer stays mapped,
+// persistent and coherent, and is split into sections that are fenced when
+// the allocations move on to the next one, so the CPU never writes memory the
+// GPU may still read. On 3.3 contexts each allocation maps its range
+// unsynchronized and the whole buffer is orphaned when the ring wraps.
+class StreamBuffer
+{
+ public:
+    struct Allocation
+    {
+        // Write only, valid until Commit
+        void *pointer;
+
+        // Byte offset in the buffer, for attribute pointers and buffer ranges
+        GLintptr offset;
+        GLsizeiptr size;
+
+        bool IsValid() const { return pointer != nullptr; }
+    };
+
+    // Totals of every stream buffer
+    struct Stats
+    {
+        unsigned long long bytesLastFrame;
+        unsigned long long bytesThisFrame;
+
+        // Allocations that had to wait for the GPU to release a section
+        unsigned int stalls;
+
+        // Buffers re-created because one allocation did not fit a section
+        unsigned int reallocations;
+    };
+
+ public:
+    explicit StreamBuffer(GLsizeiptr sectionSize, unsigned int numSections = 3);
+    ~StreamBuffer();
+
+    // Space for `size` bytes at an offset multiple of `alignment`. The data has
+    // to be written and committed before the draw that reads it.
+    Allocation Allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+    void Commit(const Allocation &allocation);
+
+    GLuint GetBufferID() const;
+    GLsizeiptr GetCapacity() const;
+    bool IsPersistent() const;
+
+    // Starts counting the bytes of a new frame, called by the World once per frame
+    static void EndFrame();
+    static Stats GetStats();
+
+ private:
+    void Create(GLsizeiptr sectionSize);
+    void Release();
+    void Unmap();
+
+    // Fences the current section and moves to the next one
+    void NextSection();
+
+ private:
+    GLuint buffer;
+    bool persistent;
+    unsigned char *mapped;
+    bool pendingCommit;
+
+    GLsizeiptr sectionSize;
+    unsigned int numSections;
+    unsigned int section;
+    GLintptr head;
+    std::vector<GLsync> fences;
+
+    static Stats stats;
+};
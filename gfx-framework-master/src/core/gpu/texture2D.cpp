@@ -31,6 +31,7 @@ Texture2D::Texture2D()
 {
     width = 0;
     height = 0;
+    layers = 1;
     channels = 0;
     textureID = 0;
     bitsPerPixel = 8;
@@ -198,9 +199,33 @@ void Texture2D::CreateDepthBufferTexture(unsigned int width, unsigned int height
 }
 
 
+void Texture2D::CreateFrameBufferTextureArray(unsigned int width, unsigned int height, unsigned int layers, unsigned int targetID, unsigned int precision)
+{
+    bitsPerPixel = precision;
+    int prec = precision / 8 - 1;
+    targetType = GL_TEXTURE_2D_ARRAY;
+    this->layers = layers;
+    Init2DTexture(width, height, 4);
+    glTexImage3D(targetType, 0, internalFormat[prec][4], width, height, layers, 0, pixelFormat[4], GL_UNSIGNED_BYTE, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + targetID, textureID, 0);
+    UnBind();
+}
+
+
+void Texture2D::CreateDepthBufferTextureArray(unsigned int width, unsigned int height, unsigned int layers)
+{
+    targetType = GL_TEXTURE_2D_ARRAY;
+    this->layers = layers;
+    Init2DTexture(width, height, 1);
+    glTexImage3D(targetType, 0, GL_DEPTH_COMPONENT32F, width, height, layers, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textureID, 0);
+    UnBind();
+}
+
+
 void Texture2D::Bind() const
 {
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    glBindTexture(targetType, textureID);
 }
 
 
@@ -208,7 +233,7 @@ void Texture2D::BindToTextureUnit(GLenum TextureUnit) const
 {
     if (!textureID) return;
     glActiveTexture(TextureUnit);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    glBindTexture(targetType, textureID);
 }
 
 
@@ -243,6 +268,12 @@ unsigned int Texture2D::GetHeight() const
 }
 
 
+unsigned int Texture2D::GetLayers() const
+{
+    return layers;
+}
+
+
 void Texture2D::GetSize(unsigned int &width, unsigned int &height) const
 {
     width = this->width;
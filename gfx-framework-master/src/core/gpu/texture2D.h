@@ -24,12 +24,18 @@ class Texture2D
     void CreateFrameBufferTexture(unsigned int width, unsigned int height, unsigned int targetID, unsigned int precision = 32);
     void CreateDepthBufferTexture(unsigned int width, unsigned int height);
 
+    // GL_TEXTURE_2D_ARRAY render targets, attached as layered so a geometry
+    // shader picks the layer of every primitive with gl_Layer
+    void CreateFrameBufferTextureArray(unsigned int width, unsigned int height, unsigned int layers, unsigned int targetID, unsigned int precision = 32);
+    void CreateDepthBufferTextureArray(unsigned int width, unsigned int height, unsigned int layers);
+
     bool Load2D(const char* fileName, GLenum wrappingMode = GL_REPEAT);
     void SaveToFile(const char* fileName);
     void CacheInMemory(bool state);
 
     unsigned int GetWidth() const;
     unsigned int GetHeight() const;
+    unsigned int GetLayers() const;
     void GetSize(unsigned int &width, unsigned int &height) const;
     unsigned char *GetImageData() const;
 
@@ -49,6 +55,7 @@ class Texture2D
     unsigned int bitsPerPixel;
     unsigned int width;
     unsigned int height;
+    unsigned int layers;
     unsigned int channels;
 
     GLuint targetType;
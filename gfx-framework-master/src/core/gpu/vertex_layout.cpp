@@ -0,0 +1,429 @@
+#include "core/gpu/vertex_layout.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "glm/gtc/packing.hpp"
+
+
+// Constants are stored as floats: normal, texture coordinates, color
+static const unsigned int CONSTANTS_SIZE = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
+
+static float MaxComponent(const glm::vec3 &v)
+{
+    return std::max(v.x, std::max(v.y, v.z));
+}
+
+
+// Largest position error accepted for half floats, relative to the mesh size
+static const float HALF_POSITION_TOLERANCE = 1.0f / 1024;
+
+// Largest position error accepted for half floats in object space units. Half
+// floats keep 11 bits, so large meshes move their far vertices by whole units.
+// Normalized positions have to meet both bounds too.
+static const float HALF_POSITION_MAX_ERROR = 1.0f / 64;
+
+// Largest texture coordinate error accepted for half floats
+static const float HALF_TEX_COORD_TOLERANCE = 1.0f / 4096;
+
+
+static const VertexLayout::Attribute ATTRIBUTES[] = {
+    VertexLayout::POSITION,
+    VertexLayout::NORMAL,
+    VertexLayout::TEX_COORD,
+    VertexLayout::COLOR
+};
+
+
+VertexLayout::VertexLayout()
+    : constants(glm::vec3(0))
+{
+    perVertex = ALL;
+    constant = 0;
+    packed = 0;
+    positionFormat = POSITION_FLOAT;
+    boundsMin = glm::vec3(-1);
+    boundsMax = glm::vec3(1);
+}
+
+
+VertexLayout::VertexLayout(unsigned int perVertex, unsigned int constant,
+                           PositionFormat positionFormat, unsigned int packed)
+    : constants(glm::vec3(0))
+{
+    this->perVertex = perVertex;
+    this->constant = constant & ~perVertex & ~POSITION;
+    this->packed = packed & ~POSITION;
+    this->positionFormat = positionFormat;
+    boundsMin = glm::vec3(-1);
+    boundsMax = glm::vec3(1);
+}
+
+
+VertexLayout VertexLayout::Choose(const std::vector<VertexFormat> &vertices,
+                                  unsigned int candidates)
+{
+    if (vertices.empty())
+        return VertexLayout();
+
+    const VertexFormat &first = vertices[0];
+    bool sameNormal = true, sameTexCoord = true, sameColor = true;
+    bool unitNormals = true, unitColors = true;
+    glm::vec3 min = first.position, max = first.position;
+    float texCoordError = 0;
+
+    for (const auto &v : vertices)
+    {
+        sameNormal = sameNormal && v.normal == first.normal;
+        sameTexCoord = sameTexCoord && v.text_coord == first.text_coord;
+        sameColor = sameColor && v.color == first.color;
+
+        unitNormals = unitNormals && std::abs(glm::length(v.normal) - 1.0f) < 1e-3f;
+        unitColors = unitColors && glm::all(glm::greaterThanEqual(v.color, glm::vec3(0)))
+            && glm::all(glm::lessThanEqual(v.color, glm::vec3(1)));
+
+        glm::vec2 error = glm::abs(glm::unpackHalf2x16(glm::packHalf2x16(v.text_coord)) - v.text_coord);
+        texCoordError = std::max(texCoordError, std::max(error.x, error.y));
+
+        min = glm::min(min, v.position);
+        max = glm::max(max, v.position);
+    }
+
+    unsigned int perVertex = POSITION, constant = 0, packed = 0;
+
+    if (candidates & NORMAL) {
+        (sameNormal ? constant : perVertex) |= NORMAL;
+        if (unitNormals) packed |= NORMAL;
+    }
+
+    if (candidates & TEX_COORD) {
+        (sameTexCoord ? constant : perVertex) |= TEX_COORD;
+        if (texCoordError <= HALF_TEX_COORD_TOLERANCE) packed |= TEX_COORD;
+    }
+
+    if (candidates & COLOR) {
+        (sameColor ? constant : perVertex) |= COLOR;
+        if (unitColors) packed |= COLOR;
+    }
+
+    PositionFormat positionFormat = POSITION_FLOAT;
+    if (FitsHalfPositions(vertices)) {
+        positionFormat = POSITION_HALF;
+    } else {
+        // 16 bits over the bounds of the mesh, whatever its distance to the origin
+        glm::vec3 center = (min + max) * 0.5f;
+        glm::vec3 extent = glm::max((max - min) * 0.5f, glm::vec3(1e-6f));
+
+        float positionError = 0;
+        for (const auto &v : vertices)
+        {
+            for (int i = 0; i < 3; i++) {
+                float stored = glm::unpackSnorm1x16(glm::packSnorm1x16((v.position[i] - center[i]) / extent[i]));
+                positionError = std::max(positionError, std::abs(center[i] + extent[i] * stored - v.position[i]));
+            }
+        }
+
+        float size = MaxComponent(max - min);
+        if (size > 0 && positionError <= std::min(size * HALF_POSITION_TOLERANCE, HALF_POSITION_MAX_ERROR)) {
+            positionFormat = POSITION_SNORM16;
+        }
+    }
+
+    VertexLayout layout(perVertex, constant, positionFormat, packed);
+    layout.SetPositionBounds(min, max);
+    layout.SetConstants(first);
+    return layout;
+}
+
+
+bool VertexLayout::FitsHalfPositions(const std::vector<VertexFormat> &vertices)
+{
+    if (vertices.empty())
+        return true;
+
+    glm::vec3 min = vertices[0].position, max = vertices[0].position;
+    float positionError = 0;
+    for (const auto &v : vertices)
+    {
+        min = glm::min(min, v.position);
+        max = glm::max(max, v.position);
+
+        for (int i = 0; i < 3; i++) {
+            positionError = std::max(positionError,
+                std::abs(glm::unpackHalf1x16(glm::packHalf1x16(v.position[i])) - v.position[i]));
+        }
+    }
+
+    float size = MaxComponent(max - min);
+    return size > 0 && positionError <= std::min(size * HALF_POSITION_TOLERANCE, HALF_POSITION_MAX_ERROR);
+}
+
+
+unsigned int VertexLayout::GetAttributeSize(Attribute attribute) const
+{
+    if (!(perVertex & attribute))
+        return 0;
+
+    switch (attribute)
+    {
+    case POSITION:
+        // Packed positions are padded to 4 shorts
+        return positionFormat == POSITION_FLOAT ? sizeof(glm::vec3) : 4 * sizeof(GLushort);
+    case NORMAL:
+        return (packed & NORMAL) ? sizeof(GLuint) : sizeof(glm::vec3);
+    case TEX_COORD:
+        return (packed & TEX_COORD) ? sizeof(GLuint) : sizeof(glm::vec2);
+    case COLOR:
+        return (packed & COLOR) ? sizeof(GLuint) : sizeof(glm::vec3);
+    default:
+        return 0;
+    }
+}
+
+
+unsigned int VertexLayout::GetAttributeOffset(Attribute attribute) const
+{
+    unsigned int offset = 0;
+    for (Attribute a : ATTRIBUTES)
+    {
+        if (a == attribute)
+            break;
+        offset += GetAttributeSize(a);
+    }
+    return offset;
+}
+
+
+unsigned int VertexLayout::GetStride() const
+{
+    return GetAttributeOffset(COLOR) + GetAttributeSize(COLOR);
+}
+
+
+unsigned int VertexLayout::GetConstantsSize() const
+{
+    return constant ? CONSTANTS_SIZE : 0;
+}
+
+
+unsigned int VertexLayout::GetBufferSize(unsigned int numVertices) const
+{
+    return GetConstantsSize() + GetStride() * numVertices;
+}
+
+
+void VertexLayout::Pack(const std::vector<VertexFormat> &vertices, std::vector<unsigned char> &data) const
+{
+    data.clear();
+    PackConstants(data);
+    PackVertices(vertices, data);
+}
+
+
+void VertexLayout::PackConstants(std::vector<unsigned char> &data) const
+{
+    if (!constant)
+        return;
+
+    size_t start = data.size();
+    data.resize(start + CONSTANTS_SIZE);
+
+    unsigned char *dst = &data[start];
+    memcpy(dst, &constants.normal, sizeof(glm::vec3));
+    memcpy(dst + sizeof(glm::vec3), &constants.text_coord, sizeof(glm::vec2));
+    memcpy(dst + sizeof(glm::vec3) + sizeof(glm::vec2), &constants.color, sizeof(glm::vec3));
+}
+
+
+void VertexLayout::PackVertices(const std::vector<VertexFormat> &vertices, std::vector<unsigned char> &data) const
+{
+    unsigned int stride = GetStride();
+    size_t start = data.size();
+    data.resize(start + stride * vertices.size());
+
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 extent = glm::max((boundsMax - boundsMin) * 0.5f, glm::vec3(1e-6f));
+
+    unsigned int normalOffset = GetAttributeOffset(NORMAL);
+    unsigned int texCoordOffset = GetAttributeOffset(TEX_COORD);
+    unsigned int colorOffset = GetAttributeOffset(COLOR);
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const VertexFormat &v = vertices[i];
+        unsigned char *dst = &data[start + i * stride];
+
+        if (perVertex & POSITION)
+        {
+            if (positionFormat == POSITION_FLOAT) {
+                memcpy(dst, &v.position, sizeof(glm::vec3));
+            } else {
+                GLushort p[4];
+                for (int c = 0; c < 3; c++) {
+                    p[c] = positionFormat == POSITION_HALF
+                        ? glm::packHalf1x16(v.position[c])
+                        : glm::packSnorm1x16((v.position[c] - center[c]) / extent[c]);
+                }
+                p[3] = 0;
+                memcpy(dst, p, sizeof(p));
+            }
+        }
+
+        if (perVertex & NORMAL)
+        {
+            if (packed & NORMAL) {
+                GLuint n = glm::packSnorm3x10_1x2(glm::vec4(v.normal, 0));
+                memcpy(dst + normalOffset, &n, sizeof(n));
+            } else {
+                memcpy(dst + normalOffset, &v.normal, sizeof(glm::vec3));
+            }
+        }
+
+        if (perVertex & TEX_COORD)
+        {
+            if (packed & TEX_COORD) {
+                GLuint t = glm::packHalf2x16(v.text_coord);
+                memcpy(dst + texCoordOffset, &t, sizeof(t));
+            } else {
+                memcpy(dst + texCoordOffset, &v.text_coord, sizeof(glm::vec2));
+            }
+        }
+
+        if (perVertex & COLOR)
+        {
+            if (packed & COLOR) {
+                GLuint c = glm::packUnorm4x8(glm::vec4(v.color, 1));
+                memcpy(dst + colorOffset, &c, sizeof(c));
+            } else {
+                memcpy(dst + colorOffset, &v.color, sizeof(glm::vec3));
+            }
+        }
+    }
+}
+
+
+void VertexLayout::SetupAttributes(GLintptr constantsOffset, GLintptr verticesOffset) const
+{
+    GLsizei stride = GetStride();
+    GLintptr constantOffsets[] = {
+        0,
+        0,
+        sizeof(glm::vec3),
+        sizeof(glm::vec3) + sizeof(glm::vec2)
+    };
+    GLint components[] = { 3, 3, 2, 3 };
+
+    for (GLuint loc = 0; loc < 4; loc++)
+    {
+        Attribute a = ATTRIBUTES[loc];
+
+        if (perVertex & a)
+        {
+            void *offset = (void*)(verticesOffset + GetAttributeOffset(a));
+            glEnableVertexAttribArray(loc);
+            glVertexAttribDivisor(loc, 0);
+
+            if (a == POSITION && positionFormat == POSITION_HALF) {
+                glVertexAttribPointer(loc, 3, GL_HALF_FLOAT, GL_FALSE, stride, offset);
+            } else if (a == POSITION && positionFormat == POSITION_SNORM16) {
+                glVertexAttribPointer(loc, 3, GL_SHORT, GL_TRUE, stride, offset);
+            } else if (a == NORMAL && (packed & NORMAL)) {
+                glVertexAttribPointer(loc, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, offset);
+            } else if (a == TEX_COORD && (packed & TEX_COORD)) {
+                glVertexAttribPointer(loc, 2, GL_HALF_FLOAT, GL_FALSE, stride, offset);
+            } else if (a == COLOR && (packed & COLOR)) {
+                glVertexAttribPointer(loc, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset);
+            } else {
+                glVertexAttribPointer(loc, components[loc], GL_FLOAT, GL_FALSE, stride, offset);
+            }
+        }
+        else if (constant & a)
+        {
+            // Generic attribute values are not part of the VAO state, so the constant is
+            // read from the buffer with a divisor that keeps every vertex on the first element
+            glEnableVertexAttribArray(loc);
+            glVertexAttribPointer(loc, components[loc], GL_FLOAT, GL_FALSE, 0, (void*)(constantsOffset + constantOffsets[loc]));
+            glVertexAttribDivisor(loc, std::numeric_limits<GLuint>::max());
+        }
+        else
+        {
+            glDisableVertexAttribArray(loc);
+        }
+    }
+}
+
+
+glm::mat4 VertexLayout::GetPositionTransform() const
+{
+    if (positionFormat != POSITION_SNORM16)
+        return glm::mat4(1);
+
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 extent = glm::max((boundsMax - boundsMin) * 0.5f, glm::vec3(1e-6f));
+    return glm::scale(glm::translate(glm::mat4(1), center), extent);
+}
+
+
+void VertexLayout::SetPositionBounds(const glm::vec3 &min, const glm::vec3 &max)
+{
+    boundsMin = min;
+    boundsMax = max;
+}
+
+
+void VertexLayout::SetConstants(const VertexFormat &vertex)
+{
+    constants = vertex;
+}
+
+
+bool VertexLayout::HasAttribute(Attribute attribute) const
+{
+    return ((perVertex | constant) & attribute) != 0;
+}
+
+
+VertexLayout::PositionFormat VertexLayout::GetPositionFormat() const
+{
+    return positionFormat;
+}
+
+
+std::string VertexLayout::ToString() const
+{
+    static const char *names[] = { "position", "normal", "uv", "color" };
+    static const char *packedNames[] = { "", "10_10_10", "half", "rgba8" };
+    static const char *positionNames[] = { "float", "half", "snorm16" };
+
+    std::string result;
+    for (int i = 0; i < 4; i++)
+    {
+        Attribute a = ATTRIBUTES[i];
+        if (!result.empty())
+            result += ", ";
+        result += names[i];
+        result += " ";
+
+        if (perVertex & a) {
+            result += a == POSITION ? positionNames[positionFormat] : ((packed & a) ? packedNames[i] : "float");
+        } else {
+            result += (constant & a) ? "const" : "-";
+        }
+    }
+    return result;
+}
+
+
+void VertexLayout::PrintStats(const std::string &name, unsigned int numVertices) const
+{
+    unsigned int full = sizeof(VertexFormat) * numVertices;
+    unsigned int size = GetBufferSize(numVertices);
+
+    std::cout << "Mesh '" << name << "': " << numVertices << " vertices, " << ToString() << ", "
+        << GetStride() << " B/vertex instead of " << sizeof(VertexFormat) << ", "
+        << full / 1024.0f << " KB -> " << size / 1024.0f << " KB ("
+        << (full ? 100.0f * (full - std::min(full, size)) / full : 0.0f)
+        << "% less memory and vertex fetch)" << std::endl;
+}
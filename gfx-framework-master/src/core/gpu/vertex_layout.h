@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "core/gpu/vertex_format.h"
+#include "utils/gl_utils.h"
+#include "utils/glm_utils.h"
+
+
+// Describes how VertexFormat data is stored in a vertex buffer. Attributes
+// can be packed (half float, normalized integers), stored once for the whole
+// mesh when every vertex has the same value, or left out entirely. The shader
+// inputs stay the same, all packed formats are expanded by the vertex fetch.
+class VertexLayout
+{
+ public:
+    enum Attribute
+    {
+        POSITION    = 1 << 0,
+        NORMAL      = 1 << 1,
+        TEX_COORD   = 1 << 2,
+        COLOR       = 1 << 3,
+        ALL         = POSITION | NORMAL | TEX_COORD | COLOR
+    };
+
+    enum PositionFormat
+    {
+        POSITION_FLOAT,
+        POSITION_HALF,
+        // Normalized to the mesh bounds, see GetPositionTransform
+        POSITION_SNORM16
+    };
+
+ public:
+    // The VertexFormat layout, every attribute as floats
+    VertexLayout();
+
+    // `perVertex` attributes are stored for every vertex, `constant` ones only once.
+    // The normals, texture coordinates and colors in `packed` use 4 bytes each.
+    VertexLayout(unsigned int perVertex, unsigned int constant,
+                 PositionFormat positionFormat, unsigned int packed);
+
+    // Picks the smallest layout that keeps the data of these vertices. Only the
+    // `candidates` attributes are uploaded, the others stay disabled. Meshes too
+    // large for half float positions get POSITION_SNORM16 when it is precise enough.
+    static VertexLayout Choose(const std::vector<VertexFormat> &vertices,
+                               unsigned int candidates = ALL);
+
+    // Half float positions of these vertices stay within the accepted error
+    static bool FitsHalfPositions(const std::vector<VertexFormat> &vertices);
+
+    unsigned int GetStride() const;
+    unsigned int GetConstantsSize() const;
+    unsigned int GetBufferSize(unsigned int numVertices) const;
+
+    // The constants are written first, followed by the vertices
+    void Pack(const std::vector<VertexFormat> &vertices, std::vector<unsigned char> &data) const;
+    void PackVertices(const std::vector<VertexFormat> &vertices, std::vector<unsigned char> &data) const;
+    void PackConstants(std::vector<unsigned char> &data) const;
+
+    // Sets the attribute pointers of the bound VAO to the bound GL_ARRAY_BUFFER
+    void SetupAttributes(GLintptr constantsOffset, GLintptr verticesOffset) const;
+
+    // Maps POSITION_SNORM16 positions back to object space, identity otherwise.
+    // Callers using that format fold it into the model matrix.
+    glm::mat4 GetPositionTransform() const;
+    void SetPositionBounds(const glm::vec3 &min, const glm::vec3 &max);
+
+    void SetConstants(const VertexFormat &vertex);
+
+    bool HasAttribute(Attribute attribute) const;
+    PositionFormat GetPositionFormat() const;
+    std::string ToString() const;
+
+    // Memory and vertex-fetch bandwidth of this layout against the float one
+    void PrintStats(const std::string &name, unsigned int numVertices) const;
+
+ private:
+    unsigned int GetAttributeSize(Attribute attribute) const;
+    unsigned int GetAttributeOffset(Attribute attribute) const;
+
+ private:
+    unsigned int perVertex;
+    unsigned int constant;
+    unsigned int packed;
+    PositionFormat positionFormat;
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+
+    // Values of the attributes stored only once
+    VertexFormat constants;
+};
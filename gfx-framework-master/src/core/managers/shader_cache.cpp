@@ -0,0 +1,219 @@
+#include "core/managers/shader_cache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "core/managers/resource_path.h"
+
+
+std::unordered_map<uint64_t, ShaderCache::Entry> ShaderCache::entries;
+bool ShaderCache::dirty = false;
+std::string ShaderCache::cacheFile;
+uint64_t ShaderCache::driverHash = 0;
+ShaderCache::Stats ShaderCache::stats = { 0, 0 };
+
+
+static const char cacheMagic[4] = { 'P', 'R', 'G', '2' };
+
+
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size)
+{
+    // FNV-1a
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+
+static uint64_t HashString(uint64_t hash, const char *str)
+{
+    // Hash the terminator too, so "ab" + "c" differs from "a" + "bc"
+    return str ? HashBytes(hash, str, strlen(str) + 1) : HashBytes(hash, "", 1);
+}
+
+
+void ShaderCache::Init(const std::string &selfDir)
+{
+    cacheFile = PATH_JOIN(selfDir, "shader_cache.bin");
+
+    // Binaries are only valid for the driver that created them
+    driverHash = 14695981039346656037ull;
+    driverHash = HashString(driverHash, (const char *)glGetString(GL_VENDOR));
+    driverHash = HashString(driverHash, (const char *)glGetString(GL_RENDERER));
+    driverHash = HashString(driverHash, (const char *)glGetString(GL_VERSION));
+    driverHash = HashString(driverHash, (const char *)glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+    // Let the driver compile on its own threads, the compile and link
+    // status is only queried once the program is needed
+    if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+
+    if (!IsSupported())
+        return;
+
+    std::ifstream file(cacheFile.c_str(), std::ios::in | std::ios::binary);
+    if (!file.good())
+        return;
+
+    char magic[4];
+    uint64_t fileDriverHash = 0;
+    uint32_t count = 0;
+    file.read(magic, sizeof(magic));
+    file.read((char *)&fileDriverHash, sizeof(fileDriverHash));
+    file.read((char *)&count, sizeof(count));
+
+    // The binaries of another driver are never loaded, the next Save drops them
+    if (!file.good() || memcmp(magic, cacheMagic, sizeof(magic)) != 0 || fileDriverHash != driverHash)
+    {
+        dirty = true;
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t key = 0;
+        uint32_t header[2] = { 0, 0 };
+        file.read((char *)&key, sizeof(key));
+        file.read((char *)header, sizeof(header));
+
+        if (!file.good() || header[1] > (64u << 20))
+            break;
+
+        Entry entry;
+        entry.format = header[0];
+        entry.used = false;
+        entry.binary.resize(header[1]);
+        file.read(entry.binary.data(), entry.binary.size());
+
+        if ((size_t)file.gcount() != entry.binary.size())
+            break;
+
+        entries[key] = std::move(entry);
+    }
+}
+
+
+bool ShaderCache::IsSupported()
+{
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+        return false;
+
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    return numFormats > 0;
+}
+
+
+uint64_t ShaderCache::GetKey(const std::vector<Source> &sources)
+{
+    uint64_t key = driverHash;
+    for (const auto &source : sources)
+    {
+        key = HashBytes(key, &source.type, sizeof(source.type));
+        key = HashString(key, source.code.c_str());
+    }
+    return key;
+}
+
+
+GLuint ShaderCache::Load(uint64_t key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, it->second.format, it->second.binary.data(), (GLsizei)it->second.binary.size());
+
+    // A driver update can reject binaries even when the version string matches
+    GLint linkResult = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkResult);
+    if (linkResult == GL_FALSE)
+    {
+        glDeleteProgram(program);
+        entries.erase(it);
+        dirty = true;
+        return 0;
+    }
+
+    it->second.used = true;
+    stats.loaded++;
+    return program;
+}
+
+
+void ShaderCache::PrepareProgram(GLuint program)
+{
+    stats.compiled++;
+
+    if (IsSupported()) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+
+void ShaderCache::Store(uint64_t key, GLuint program)
+{
+    if (cacheFile.empty() || !IsSupported())
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    Entry entry;
+    GLsizei written = 0;
+    entry.used = true;
+    entry.binary.resize(length);
+    glGetProgramBinary(program, length, &written, &entry.format, entry.binary.data());
+    entry.binary.resize(written);
+
+    entries[key] = std::move(entry);
+    dirty = true;
+}
+
+
+ShaderCache::Stats ShaderCache::GetStats()
+{
+    return stats;
+}
+
+
+void ShaderCache::Save()
+{
+    if (!dirty || cacheFile.empty())
+        return;
+
+    dirty = false;
+    std::ofstream file(cacheFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.good()) {
+        std::cout << "Could not write the shader cache: " << cacheFile << std::endl;
+        return;
+    }
+
+    // The programs of this run only, the other entries are from older sources
+    uint32_t count = 0;
+    for (const auto &entry : entries) {
+        count += entry.second.used ? 1 : 0;
+    }
+
+    file.write(cacheMagic, sizeof(cacheMagic));
+    file.write((const char *)&driverHash, sizeof(driverHash));
+    file.write((const char *)&count, sizeof(count));
+
+    for (const auto &entry : entries)
+    {
+        if (!entry.second.used)
+            continue;
+
+        uint32_t header[2] = { entry.second.format, (uint32_t)entry.second.binary.size() };
+        file.write((const char *)&entry.first, sizeof(entry.first));
+        file.write((const char *)header, sizeof(header));
+        file.write(entry.second.binary.data(), entry.second.binary.size());
+    }
+}
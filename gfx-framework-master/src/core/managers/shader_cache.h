@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/gl_utils.h"
+
+
+// Keeps the linked programs on disk, so later launches can skip the GLSL
+// compiler. Entries are keyed by a hash of the shader sources (with the
+// injected defines) and the driver strings, so a change of either one
+// falls back to compiling. The file is written by Save, only with the
+// programs used since Init, and only when one of them was compiled.
+class ShaderCache
+{
+ public:
+    struct Source
+    {
+        std::string code;
+        GLenum type;
+    };
+
+    struct Stats
+    {
+        unsigned int loaded;
+        unsigned int compiled;
+    };
+
+ public:
+    static void Init(const std::string &selfDir);
+
+    // Program binaries need GL 4.1 or ARB_get_program_binary
+    static bool IsSupported();
+
+    static uint64_t GetKey(const std::vector<Source> &sources);
+
+    // Creates a program from the stored binary. Returns 0 when there is no
+    // entry for the key or the driver rejects it.
+    static GLuint Load(uint64_t key);
+
+    // Call before linking a program that will be stored
+    static void PrepareProgram(GLuint program);
+    static void Store(uint64_t key, GLuint program);
+
+    // Writes the cache when programs were stored since the last Save, e.g.
+    // once the programs of the startup are linked. The Engine calls it on exit.
+    static void Save();
+
+    static Stats GetStats();
+
+ protected:
+    ShaderCache() = delete;
+    ~ShaderCache() = delete;
+
+ private:
+    struct Entry
+    {
+        GLenum format;
+        std::vector<char> binary;
+
+        // Loaded or stored since Init, the others are dropped by Save
+        bool used;
+    };
+
+    static std::unordered_map<uint64_t, Entry> entries;
+    static bool dirty;
+    static std::string cacheFile;
+    static uint64_t driverHash;
+    static Stats stats;
+};
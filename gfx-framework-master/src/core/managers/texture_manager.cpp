@@ -1,5 +1,6 @@
 #include "core/managers/texture_manager.h"
 
+#include "core/profiler.h"
 #include "core/gpu/texture2D.h"
 #include "core/managers/resource_path.h"
 #include "utils/memory_utils.h"
@@ -38,6 +39,8 @@ Texture2D *TextureManager::LoadTexture(const std::string &path, const char *file
 
     if (forceLoad || texture == nullptr)
     {
+        PROFILE_ZONE("LoadTexture");
+
         if (texture == nullptr)
         {
             texture = new Texture2D();
@@ -0,0 +1,365 @@
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "utils/gl_utils.h"
+
+
+namespace
+{
+    // Events kept per thread, 1.5 MB each
+    const uint64_t THREAD_EVENTS = 1 << 16;
+
+    // Frames whose start times are kept, the range that can be exported
+    const uint64_t FRAME_HISTORY = 1024;
+
+    // Frames between the GPU zones and the read of their queries
+    const unsigned int GPU_LATENCY = 4;
+
+    struct ThreadBuffer
+    {
+        std::vector<Profiler::Event> events;
+        std::atomic<uint64_t> written;
+        uint32_t depth;
+
+        // Trace thread id
+        unsigned int index;
+        std::string name;
+    };
+
+    struct GpuZone
+    {
+        const char *name;
+        unsigned int begin;
+        unsigned int end;
+        uint32_t depth;
+        bool closed;
+    };
+
+    struct GpuFrame
+    {
+        // Reused from frame to frame, grown when a frame has more zones
+        std::vector<GLuint> queries;
+        unsigned int usedQueries;
+        std::vector<GpuZone> zones;
+
+        // CPU time minus GPU time, measured when the frame started
+        int64_t offset;
+    };
+
+    std::mutex registryMutex;
+    thread_local ThreadBuffer *threadBuffer = nullptr;
+
+    // Only touched on the thread of the GL context
+    uint64_t currentFrame = 0;
+    uint64_t frameStarts[FRAME_HISTORY] = {};
+    GpuFrame gpuFrames[GPU_LATENCY];
+    uint32_t gpuDepth = 0;
+    int gpuSupported = -1;
+    unsigned int droppedGpuFrames = 0;
+    ThreadBuffer *gpuBuffer = nullptr;
+
+
+    // Buffers are never freed, the events of finished threads stay exportable
+    std::vector<std::unique_ptr<ThreadBuffer>> &Registry()
+    {
+        static std::vector<std::unique_ptr<ThreadBuffer>> registry;
+        return registry;
+    }
+
+
+    ThreadBuffer *CreateBuffer(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        std::vector<std::unique_ptr<ThreadBuffer>> &registry = Registry();
+
+        ThreadBuffer *buffer = new ThreadBuffer();
+        buffer->events.resize(THREAD_EVENTS);
+        buffer->written.store(0, std::memory_order_relaxed);
+        buffer->depth = 0;
+        buffer->index = static_cast<unsigned int>(registry.size());
+        buffer->name = name.empty() ? "Thread " + std::to_string(buffer->index) : name;
+        registry.emplace_back(buffer);
+        return buffer;
+    }
+
+
+    ThreadBuffer *GetThreadBuffer()
+    {
+        if (!threadBuffer) {
+            threadBuffer = CreateBuffer("");
+        }
+        return threadBuffer;
+    }
+
+
+    // Single writer, the readers only see the events published before `written`
+    void Push(ThreadBuffer &buffer, const Profiler::Event &event)
+    {
+        uint64_t written = buffer.written.load(std::memory_order_relaxed);
+        buffer.events[written % THREAD_EVENTS] = event;
+        buffer.written.store(written + 1, std::memory_order_release);
+    }
+
+
+    unsigned int NextQuery(GpuFrame &frame)
+    {
+        if (frame.usedQueries == frame.queries.size())
+        {
+            GLuint query = 0;
+            glGenQueries(1, &query);
+            frame.queries.push_back(query);
+        }
+        return frame.usedQueries++;
+    }
+
+
+    // Moves the zones of a frame to the GPU buffer, or drops them when the
+    // last query is still not available
+    void ReadGpuFrame(GpuFrame &frame)
+    {
+        if (frame.zones.empty())
+            return;
+
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            droppedGpuFrames++;
+            return;
+        }
+
+        for (const GpuZone &zone : frame.zones)
+        {
+            if (!zone.closed)
+                continue;
+
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(frame.queries[zone.begin], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.queries[zone.end], GL_QUERY_RESULT, &end);
+
+            Profiler::Event event;
+            event.name = zone.name;
+            event.start = static_cast<uint64_t>(std::max<int64_t>(0, static_cast<int64_t>(begin) + frame.offset));
+            event.end = static_cast<uint64_t>(std::max<int64_t>(0, static_cast<int64_t>(end) + frame.offset));
+            event.depth = zone.depth;
+            Push(*gpuBuffer, event);
+        }
+    }
+
+
+    // Names are literals from the code, only quotes and backslashes need escaping
+    std::string EscapeJson(const char *text)
+    {
+        std::string escaped;
+        for (const char *c = text; *c; c++)
+        {
+            if (*c == '"' || *c == '\\') {
+                escaped += '\\';
+            }
+            escaped += (*c >= 0 && *c < ' ') ? ' ' : *c;
+        }
+        return escaped;
+    }
+}
+
+
+uint64_t Profiler::Now()
+{
+    static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - startTime).count());
+}
+
+
+void Profiler::SetThreadName(const char *name)
+{
+    if (!threadBuffer) {
+        threadBuffer = CreateBuffer(name);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    threadBuffer->name = name;
+}
+
+
+void Profiler::BeginFrame()
+{
+    currentFrame++;
+    frameStarts[currentFrame % FRAME_HISTORY] = Now();
+
+    if (gpuSupported < 0)
+    {
+        gpuSupported = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query) ? 1 : 0;
+        if (gpuSupported) {
+            gpuBuffer = CreateBuffer("GPU");
+        }
+    }
+
+    if (!gpuSupported)
+        return;
+
+    // The slot of the frame GPU_LATENCY frames ago
+    GpuFrame &frame = gpuFrames[currentFrame % GPU_LATENCY];
+    ReadGpuFrame(frame);
+
+    frame.usedQueries = 0;
+    frame.zones.clear();
+    gpuDepth = 0;
+
+    // The timestamp of the commands that reached the GPU so far, not of their execution
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    frame.offset = static_cast<int64_t>(Now()) - static_cast<int64_t>(gpuNow);
+}
+
+
+uint64_t Profiler::GetFrameIndex()
+{
+    return currentFrame;
+}
+
+
+bool Profiler::ExportChromeTrace(const std::string &path, uint64_t firstFrame, uint64_t lastFrame)
+{
+    uint64_t oldestFrame = currentFrame >= FRAME_HISTORY ? currentFrame - FRAME_HISTORY + 1 : 0;
+    firstFrame = std::max(firstFrame, oldestFrame);
+    lastFrame = std::min(lastFrame, currentFrame);
+
+    if (firstFrame > lastFrame)
+    {
+        std::cout << "Profiler: frames " << firstFrame << "-" << lastFrame << " are not in the history" << std::endl;
+        return false;
+    }
+
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        std::cout << "Profiler: cannot write " << path << std::endl;
+        return false;
+    }
+
+    // The current frame ends now
+    uint64_t begin = frameStarts[firstFrame % FRAME_HISTORY];
+    uint64_t end = lastFrame < currentFrame ? frameStarts[(lastFrame + 1) % FRAME_HISTORY] : Now();
+    unsigned int numEvents = 0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"gfx-framework\"}}");
+
+    for (uint64_t frame = firstFrame; frame <= lastFrame; frame++)
+    {
+        fprintf(file, ",\n{\"name\":\"Frame %llu\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":0}",
+            static_cast<unsigned long long>(frame), frameStarts[frame % FRAME_HISTORY] / 1000.0);
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto &buffer : Registry())
+    {
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            buffer->index, EscapeJson(buffer->name.c_str()).c_str());
+
+        // Other threads may be overwriting the oldest events of a full ring, skip a quarter of it
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t first = written > THREAD_EVENTS ? written - THREAD_EVENTS * 3 / 4 : 0;
+        const char *category = buffer.get() == gpuBuffer ? "gpu" : "cpu";
+
+        for (uint64_t i = first; i < written; i++)
+        {
+            const Event &event = buffer->events[i % THREAD_EVENTS];
+            if (event.end < begin || event.start > end)
+                continue;
+
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                EscapeJson(event.name).c_str(), category, event.start / 1000.0, (event.end - event.start) / 1000.0, buffer->index);
+            numEvents++;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    bool written = ferror(file) == 0;
+    fclose(file);
+
+    std::cout << "Profiler: " << numEvents << " zones of frames " << firstFrame << "-" << lastFrame
+        << " written to " << path << std::endl;
+    return written;
+}
+
+
+Profiler::Stats Profiler::GetStats()
+{
+    Stats stats;
+    stats.frameIndex = currentFrame;
+    stats.droppedGpuFrames = droppedGpuFrames;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    stats.numThreads = static_cast<unsigned int>(Registry().size());
+    return stats;
+}
+
+
+uint64_t Profiler::BeginZone()
+{
+    GetThreadBuffer()->depth++;
+    return Now();
+}
+
+
+void Profiler::EndZone(const char *name, uint64_t start)
+{
+    ThreadBuffer *buffer = GetThreadBuffer();
+    buffer->depth--;
+
+    Event event;
+    event.name = name;
+    event.start = start;
+    event.end = Now();
+    event.depth = buffer->depth;
+    Push(*buffer, event);
+}
+
+
+int Profiler::BeginGpuZone(const char *name)
+{
+    // Before the first frame the support is not known yet
+    if (gpuSupported <= 0)
+        return -1;
+
+    GpuFrame &frame = gpuFrames[currentFrame % GPU_LATENCY];
+
+    GpuZone zone;
+    zone.name = name;
+    zone.begin = NextQuery(frame);
+    zone.end = zone.begin;
+    zone.depth = gpuDepth++;
+    zone.closed = false;
+    glQueryCounter(frame.queries[zone.begin], GL_TIMESTAMP);
+
+    frame.zones.push_back(zone);
+    return static_cast<int>(frame.zones.size() - 1);
+}
+
+
+void Profiler::EndGpuZone(int zone)
+{
+    if (zone < 0)
+        return;
+
+    GpuFrame &frame = gpuFrames[currentFrame % GPU_LATENCY];
+    if (zone >= static_cast<int>(frame.zones.size()))
+        return;
+
+    GpuZone &gpuZone = frame.zones[zone];
+    gpuZone.end = NextQuery(frame);
+    gpuZone.closed = true;
+    glQueryCounter(frame.queries[gpuZone.end], GL_TIMESTAMP);
+    gpuDepth--;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+
+// Zones are compiled in with PROFILE, which CMake defines for the Debug and
+// RelWithDebInfo builds. Without it every macro expands to nothing.
+#ifdef PROFILE
+#   define PROFILE_CONCAT_INNER(a, b)   a##b
+#   define PROFILE_CONCAT(a, b)         PROFILE_CONCAT_INNER(a, b)
+#   define PROFILE_ZONE(name)           ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#   define PROFILE_GPU_ZONE(name)       GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(name)
+#   define PROFILE_THREAD(name)         Profiler::SetThreadName(name)
+#   define PROFILE_BEGIN_FRAME()        Profiler::BeginFrame()
+#else
+#   define PROFILE_ZONE(name)
+#   define PROFILE_GPU_ZONE(name)
+#   define PROFILE_THREAD(name)
+#   define PROFILE_BEGIN_FRAME()
+#endif
+
+
+// Frame profiler. CPU zones are timed with a steady clock in nanoseconds and
+// written to a ring buffer owned by the thread, so recording a zone takes no
+// lock: the only shared state is the write counter, published with release
+// ordering. GPU zones put timestamp queries around their commands, the
+// queries of a frame are read back a few frames later, once the GPU is done,
+// and moved to the CPU timeline with an offset measured every frame.
+//
+// Zone names must outlive the profiler, string literals in practice.
+class Profiler
+{
+ public:
+    struct Event
+    {
+        const char *name;
+
+        // Nanoseconds since the profiler started
+        uint64_t start;
+        uint64_t end;
+
+        // Nesting level in the thread, 0 for the outermost zones
+        uint32_t depth;
+    };
+
+    struct Stats
+    {
+        uint64_t frameIndex;
+        unsigned int numThreads;
+
+        // GPU frames whose queries were not ready after the whole latency
+        unsigned int droppedGpuFrames;
+    };
+
+ public:
+    // Nanoseconds since the first call
+    static uint64_t Now();
+
+    // Shown instead of the thread number in the exported traces
+    static void SetThreadName(const char *name);
+
+    // Called by the World before the events of each frame, on the thread of
+    // the GL context. Reads the GPU zones of older frames.
+    static void BeginFrame();
+    static uint64_t GetFrameIndex();
+
+    // Writes the zones of frames [firstFrame, lastFrame] that are still in
+    // the buffers as Chrome trace JSON, for chrome://tracing or Perfetto.
+    // The range is clipped to the frames kept in the history.
+    static bool ExportChromeTrace(const std::string &path, uint64_t firstFrame, uint64_t lastFrame);
+
+    static Stats GetStats();
+
+    // Used by the zones
+    static uint64_t BeginZone();
+    static void EndZone(const char *name, uint64_t start);
+    static int BeginGpuZone(const char *name);
+    static void EndGpuZone(int zone);
+};
+
+
+// Times its scope on the calling thread
+class ProfileZone
+{
+ public:
+    explicit ProfileZone(const char *name) : name(name), start(Profiler::BeginZone()) {}
+    ~ProfileZone() { Profiler::EndZone(name, start); }
+
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone &operator=(const ProfileZone &) = delete;
+
+ private:
+    const char *name;
+    uint64_t start;
+};
+
+
+// Times the GPU work of the commands issued in its scope. Only on the thread
+// of the GL context, nested zones are allowed.
+class GpuProfileZone
+{
+ public:
+    explicit GpuProfileZone(const char *name) : zone(Profiler::BeginGpuZone(name)) {}
+    ~GpuProfileZone() { Profiler::EndGpuZone(zone); }
+
+    GpuProfileZone(const GpuProfileZone &) = delete;
+    GpuProfileZone &operator=(const GpuProfileZone &) = delete;
+
+ private:
+    int zone;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+
+
+// Hands values from one writer thread to one reader thread without a lock.
+// Each thread owns one of the three slots, the writer its back slot and the
+// reader its front slot, and the third one is in the middle. Publishing
+// swaps the back slot with the middle one and marks it fresh, reading swaps
+// the fresh middle slot with the front one. The index of the middle slot is
+// the only shared state, exchanged with acquire and release ordering, so the
+// value written into a slot is complete when the other thread gets it.
+//
+// Neither side waits: the writer may publish again before the reader took
+// the last value, which is then skipped, and the reader gets the same value
+// again until a new one is published.
+template <typename T>
+class TripleBuffer
+{
+ public:
+    TripleBuffer()
+        : front(0), back(1), middle(2)
+    {
+    }
+
+    // Writer side, the slot to fill before Publish. It still holds an older
+    // value, not the last published one.
+    T &GetBack()
+    {
+        return slots[back];
+    }
+
+    void Publish()
+    {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader side, the newest published value. The reference is valid until
+    // the next call.
+    const T &Read()
+    {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        }
+
+        return slots[front];
+    }
+
+ private:
+    static const unsigned int INDEX = 3;
+    static const unsigned int FRESH = 4;
+
+    T slots[3];
+    unsigned int front;
+    unsigned int back;
+    std::atomic<unsigned int> middle;
+};
@@ -41,6 +41,24 @@ void WindowCallbacks::OnResize(GLFWwindow *W, int width, int height)
 }
 
 
+void WindowCallbacks::OnIconify(GLFWwindow *W, int iconified)
+{
+    Engine::GetWindow()->SetIconified(iconified != 0);
+}
+
+
+void WindowCallbacks::OnFocus(GLFWwindow *W, int focused)
+{
+    Engine::GetWindow()->SetFocused(focused != 0);
+}
+
+
+void WindowCallbacks::OnRefresh(GLFWwindow *W)
+{
+    Engine::GetWindow()->Expose();
+}
+
+
 void WindowCallbacks::OnError(int error, const char * description)
 {
     std::cout << "[GLFW ERROR]\t" << error << "\t" << description << std::endl;
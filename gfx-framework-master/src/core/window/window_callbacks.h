@@ -13,6 +13,9 @@ class WindowCallbacks
     static void OnClose(GLFWwindow *W);
     static void OnResize(GLFWwindow *W, int width, int height);
     static void OnError(int error, const char* description);
+    static void OnIconify(GLFWwindow *W, int iconified);
+    static void OnFocus(GLFWwindow *W, int focused);
+    static void OnRefresh(GLFWwindow *W);
 
     // KeyBoard
     static void KeyCallback(GLFWwindow *W, int key, int scancode, int action, int mods);
@@ -33,6 +33,8 @@ WindowProperties::WindowProperties()
     visible = true;
     hideOnClose = false;
     vSync = true;
+    headless = false;
+    glVersion = glm::ivec2(3, 3);
 }
 
 
@@ -43,26 +45,32 @@ WindowObject::WindowObject(WindowProperties properties)
     window->handle = nullptr;
 
     resizeEvent = false;
+    exposeEvent = false;
     scrollEvent = false;
     mouseMoveEvent = false;
 
     frameID = 0;
     deltaFrameTime = 0;
+    fixedFrameTime = 0;
     props.aspectRatio = float(props.resolution.x) / props.resolution.y;
 
-    // Set context version, meaning 3.3 core profile
+    // Set context version, by default 3.3 core profile
     glfwWindowHint(GLFW_VISIBLE, props.visible);
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, props.glVersion.x);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, props.glVersion.y);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #if defined(__APPLE__)
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
     // Init OpenGL Window
-    props.fullScreen ? FullScreen() : WindowMode();
-    SetVSync(props.vSync);
+    if (props.headless) {
+        Headless();
+    } else {
+        props.fullScreen ? FullScreen() : WindowMode();
+        SetVSync(props.vSync);
+    }
 
     // Set default state
     mouseButtonAction = 0;
@@ -73,6 +81,9 @@ WindowObject::WindowObject(WindowProperties properties)
 
     SetWindowCallbacks(); // input - window comm
 
+    iconified = glfwGetWindowAttrib(window->handle, GLFW_ICONIFIED) != 0;
+    focused = glfwGetWindowAttrib(window->handle, GLFW_FOCUSED) != 0;
+
     elapsedTime = Engine::GetElapsedTime();
 }
 
@@ -106,6 +117,32 @@ void WindowObject::SetVSync(bool state)
 }
 
 
+bool WindowObject::SetAdaptiveVSync()
+{
+    if (props.headless || (!glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")))
+        return false;
+
+    props.vSync = true;
+    glfwSwapInterval(-1);
+    return true;
+}
+
+
+int WindowObject::GetRefreshRate() const
+{
+    if (props.headless)
+        return 0;
+
+    GLFWmonitor *monitor = glfwGetWindowMonitor(window->handle);
+    if (!monitor) {
+        monitor = glfwGetPrimaryMonitor();
+    }
+
+    const GLFWvidmode *mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+    return mode ? mode->refreshRate : 0;
+}
+
+
 bool WindowObject::ToggleVSync()
 {
     SetVSync(!props.vSync);
@@ -187,20 +224,98 @@ void WindowObject::PollEvents() const
 }
 
 
+void WindowObject::WaitEvents(double timeoutSeconds) const
+{
+    glfwWaitEventsTimeout(timeoutSeconds);
+}
+
+
+bool WindowObject::IsIconified() const
+{
+    return iconified && !props.headless;
+}
+
+
+bool WindowObject::IsFocused() const
+{
+    return focused || props.headless;
+}
+
+
+bool WindowObject::TakeExposeEvent()
+{
+    bool exposed = exposeEvent;
+    exposeEvent = false;
+    return exposed;
+}
+
+
+void WindowObject::SetIconified(bool iconified)
+{
+    this->iconified = iconified;
+    exposeEvent = true;
+}
+
+
+void WindowObject::SetFocused(bool focused)
+{
+    this->focused = focused;
+}
+
+
+void WindowObject::Expose()
+{
+    exposeEvent = true;
+}
+
+
+void WindowObject::SetFixedFrameTime(double seconds)
+{
+    fixedFrameTime = seconds;
+}
+
+
+void WindowObject::ResetFrameTime()
+{
+    elapsedTime = Engine::GetElapsedTime();
+}
+
+
 void WindowObject::ComputeFrameTime()
 {
     frameID++;
     double currentTime = Engine::GetElapsedTime();
-    deltaFrameTime = currentTime - elapsedTime;
+    deltaFrameTime = fixedFrameTime > 0 ? fixedFrameTime : currentTime - elapsedTime;
     elapsedTime = currentTime;
 }
 
 
+// Creates the window with the requested context version and retries with
+// 3.3 core profile if the driver does not support it
+static GLFWwindow *CreateWindowHandle(WindowProperties &props, int width, int height, GLFWmonitor *monitor)
+{
+    GLFWwindow *handle = glfwCreateWindow(width, height, props.name.c_str(), monitor, NULL);
+
+    if (handle == nullptr && props.glVersion != glm::ivec2(3, 3))
+    {
+        std::cout << "OpenGL " << props.glVersion.x << "." << props.glVersion.y
+            << " core profile is not available, falling back to 3.3" << std::endl;
+
+        props.glVersion = glm::ivec2(3, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        handle = glfwCreateWindow(width, height, props.name.c_str(), monitor, NULL);
+    }
+
+    return handle;
+}
+
+
 void WindowObject::FullScreen()
 {
     GLFWmonitor *monitor = glfwGetPrimaryMonitor();
     const GLFWvidmode *videoDisplay = glfwGetVideoMode(monitor);
-    window->handle = glfwCreateWindow(videoDisplay->width, videoDisplay->height, props.name.c_str(), monitor, NULL);
+    window->handle = CreateWindowHandle(props, videoDisplay->width, videoDisplay->height, monitor);
     assert(window->handle != nullptr);
 
     glfwMakeContextCurrent(window->handle);
@@ -219,7 +334,7 @@ void WindowObject::WindowMode()
 {
     glfwSetErrorCallback(error_callback);
     if (!glfwInit()) { fprintf(stderr, "Failed to initialize GLFW\n"); }
-    window->handle = glfwCreateWindow(props.resolution.x, props.resolution.y, props.name.c_str(), NULL, NULL);
+    window->handle = CreateWindowHandle(props, props.resolution.x, props.resolution.y, NULL);
     assert(window->handle != nullptr);
     glfwMakeContextCurrent(window->handle);
 
@@ -237,6 +352,37 @@ void WindowObject::WindowMode()
 }
 
 
+// Engine::Init selects the GLFW null platform when there is no display, its
+// EGL contexts are surfaceless and Mesa runs them on llvmpipe without a GPU.
+// With a display the window is only hidden. There is no swap interval to set.
+void WindowObject::Headless()
+{
+    glfwSetErrorCallback(error_callback);
+
+    props.visible = false;
+    props.fullScreen = false;
+    props.centered = false;
+    props.vSync = false;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    window->handle = CreateWindowHandle(props, props.resolution.x, props.resolution.y, NULL);
+
+    if (window->handle == nullptr)
+    {
+        std::cout << "EGL context is not available, using the native one" << std::endl;
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+        window->handle = CreateWindowHandle(props, props.resolution.x, props.resolution.y, NULL);
+    }
+
+    assert(window->handle != nullptr);
+    glfwMakeContextCurrent(window->handle);
+
+    SetSize(props.resolution.x, props.resolution.y);
+    resizeEvent = false;
+}
+
+
 void WindowObject::SubscribeToEvents(InputController * IC)
 {
     observers.push_back(IC);
@@ -257,6 +403,9 @@ void WindowObject::SetWindowCallbacks()
     glfwSetMouseButtonCallback(window->handle, WindowCallbacks::MouseClick);
     glfwSetCursorPosCallback(window->handle, WindowCallbacks::CursorMove);
     glfwSetScrollCallback(window->handle, WindowCallbacks::MouseScroll);
+    glfwSetWindowIconifyCallback(window->handle, WindowCallbacks::OnIconify);
+    glfwSetWindowFocusCallback(window->handle, WindowCallbacks::OnFocus);
+    glfwSetWindowRefreshCallback(window->handle, WindowCallbacks::OnRefresh);
 }
 
 
@@ -295,6 +444,12 @@ void WindowObject::KeyCallback(int key, int scanCode, int action, int mods)
 }
 
 
+void WindowObject::InjectKey(int keyCode, bool pressed, int mods)
+{
+    KeyCallback(keyCode, 0, pressed ? GLFW_PRESS : GLFW_RELEASE, mods);
+}
+
+
 void WindowObject::MouseButtonCallback(int button, int action, int mods)
 {
     // Only button events and mods are kept
@@ -328,7 +483,7 @@ void WindowObject::MouseScroll(double offsetX, double offsetY)
 }
 
 
-void WindowObject::UpdateObservers()
+void WindowObject::UpdateObservers(bool inputUpdate)
 {
     ComputeFrameTime();
 
@@ -387,8 +542,11 @@ void WindowObject::UpdateObservers()
     }
 
     // Continuous events
-    for (auto obs : observers) {
-        obs->OnInputUpdate(static_cast<float>(deltaFrameTime), keyMods);
+    if (inputUpdate)
+    {
+        for (auto obs : observers) {
+            obs->OnInputUpdate(static_cast<float>(deltaFrameTime), keyMods);
+        }
     }
 
     mouseButtonAction = 0;
@@ -401,6 +559,12 @@ void WindowObject::MakeCurrentContext() const
 }
 
 
+void WindowObject::ReleaseContext() const
+{
+    glfwMakeContextCurrent(NULL);
+}
+
+
 void WindowObject::SetSize(int width, int height)
 {
     int frameBufferWidth, frameBufferHeight;
@@ -413,6 +577,7 @@ void WindowObject::SetSize(int width, int height)
     props.resolution = glm::ivec2(frameBufferWidth, frameBufferHeight);
     props.aspectRatio = float(width) / height;
     resizeEvent = true;
+    exposeEvent = true;
 }
 
 
@@ -431,5 +596,11 @@ glm::ivec2 WindowObject::GetResolution(bool unscaled) const
 
 void WindowObject::SwapBuffers() const
 {
+    // Nothing is presented, the frame is waited for as a swap would throttle it
+    if (props.headless) {
+        glFinish();
+        return;
+    }
+
     glfwSwapBuffers(window->handle);
 }
@@ -28,6 +28,15 @@ class WindowProperties
     bool centered;
     bool hideOnClose;
     bool vSync;
+
+    // No window on screen. The context is surfaceless when GLFW can create
+    // one, a hidden window otherwise, and the frames are drawn into an
+    // offscreen framebuffer that takes the place of the window framebuffer.
+    bool headless;
+
+    // Requested OpenGL core profile version (major, minor). If the driver
+    // cannot create it, the window falls back to 3.3 and this is updated.
+    glm::ivec2 glVersion;
 };
 
 
@@ -66,10 +75,26 @@ class WindowObject
 
     void SwapBuffers() const;
     void SetVSync(bool state);
+
+    // Swap interval -1, the late frames tear instead of waiting for the next
+    // vblank. False without the swap_control_tear extension, nothing is set.
+    bool SetAdaptiveVSync();
+
+    // Hz of the monitor showing the window, or of the primary one, 0 when
+    // headless or unknown
+    int GetRefreshRate() const;
+
+    // Seconds between frames reported to the observers instead of the
+    // measured ones, 0 measures them again. For reproducible replays.
+    void SetFixedFrameTime(double seconds);
     bool ToggleVSync();
 
     void MakeCurrentContext() const;
 
+    // No context is current on the calling thread, so another thread can
+    // make the context of the window current
+    void ReleaseContext() const;
+
     // Window Information
     void SetSize(int width, int height);
 
@@ -80,6 +105,18 @@ class WindowObject
     // Window Event
     void PollEvents() const;
 
+    // Sleeps until an event arrives or the timeout passes, then handles it
+    void WaitEvents(double timeoutSeconds) const;
+
+    // Minimized, or not the window receiving the input. A headless window
+    // is never either.
+    bool IsIconified() const;
+    bool IsFocused() const;
+
+    // True once after the window content was damaged or resized, when
+    // nothing is drawn the last frame has to be presented again
+    bool TakeExposeEvent();
+
     // Get Input State
     bool KeyHold(int keyCode) const;
     bool MouseHold(int button) const;
@@ -88,8 +125,16 @@ class WindowObject
     // Use unscaled resolution when working with mouse coordinates.
     glm::ivec2 GetCursorPosition() const;
 
-    // Update event listeners (key press / mouse move / window events)
-    void UpdateObservers();
+    // Update event listeners (key press / mouse move / window events).
+    // Without inputUpdate OnInputUpdate is not called, nothing held moves.
+    void UpdateObservers(bool inputUpdate = true);
+
+    // The next frame time is measured from now, after frames were skipped
+    void ResetFrameTime();
+
+    // Queues a key event as if it came from the window, it is sent to the
+    // observers by the next UpdateObservers
+    void InjectKey(int keyCode, bool pressed, int mods = 0);
 
  protected:
     // Frame time
@@ -98,6 +143,7 @@ class WindowObject
     // Window Creation
     void FullScreen();
     void WindowMode();
+    void Headless();
 
     // Input Processing
     void KeyCallback(int key, int scanCode, int action, int mods);
@@ -105,6 +151,11 @@ class WindowObject
     void MouseMove(int posX, int posY);
     void MouseScroll(double offsetX, double offsetY);
 
+    // Window state
+    void SetIconified(bool iconified);
+    void SetFocused(bool focused);
+    void Expose();
+
     // Subscribe to receive input events
     void SubscribeToEvents(InputController * IC);
     void UnsubscribeFromEvents(InputController * IC);
@@ -121,10 +172,14 @@ class WindowObject
     unsigned int frameID;
     double elapsedTime;
     double deltaFrameTime;
+    double fixedFrameTime;
 
     // Window state and events
     bool hiddenPointer;
     bool resizeEvent;
+    bool exposeEvent;
+    bool iconified;
+    bool focused;
 
     // Mouse button callback
     int mouseButtonCallback;            // bit field for button callback
@@ -1,40 +1,238 @@
 #include "core/world.h"
 
 #include "core/engine.h"
+#include "core/profiler.h"
+#include "core/gpu/render_stats.h"
+#include "core/gpu/stream_buffer.h"
 #include "components/camera_input.h"
 #include "components/transform.h"
 
+#include <algorithm>
+#include <iostream>
+
+
+// Wakes of an idle World without events, it sleeps otherwise
+static const double IDLE_WAIT_SECONDS = 0.5;
+
 
 World::World()
 {
     previousTime = 0;
     elapsedTime = 0;
     deltaTime = 0;
+    frameTime = 0;
     paused = false;
     shouldClose = false;
+    frameCapture = nullptr;
+    benchmark = nullptr;
+    framePacer = nullptr;
+
+    useRenderThread = false;
+    renderThread = nullptr;
+    renderThreadRunning = false;
+    publishedSteps = 0;
+    takenSteps = 0;
+    stopRendering = false;
+    stepInputTime = 0;
+    stepResolution = glm::ivec2(0);
+    frameResolution = glm::ivec2(0);
+    simulatedSteps = 0;
+    simulationSeconds = 0;
+
+    idle = false;
+    idleInBackground = true;
+    lastFrame = nullptr;
+    cpuTimes[0] = cpuTimes[1] = 0;
+    wallTimes[0] = wallTimes[1] = 0;
+    accountedCpu = 0;
+    accountedWall = 0;
 
     window = Engine::GetWindow();
 }
 
 
+World::~World()
+{
+    delete frameCapture;
+    delete framePacer;
+    ReleaseLastFrame();
+    RenderStats::WriteCsv();
+}
+
+
 void World::Run()
 {
     if (!window)
         return;
 
+    // The frames start on this thread, the render thread names itself
+    PROFILE_THREAD("Main");
+
+    accountedCpu = Benchmark::GetProcessCpuSeconds();
+    accountedWall = Engine::GetElapsedTime();
+
     while (!window->ShouldClose())
     {
-        LoopUpdate();
+        if (IsIdle() != idle) {
+            idle ? LeaveIdle() : EnterIdle();
+        }
+
+        if (idle) {
+            IdleUpdate();
+        } else if (useRenderThread) {
+            ThreadedUpdate();
+        } else {
+            LoopUpdate();
+        }
+    }
+
+    StopRenderThread();
+    AccountCpuTime();
+    PrintCpuTime();
+
+    if (framePacer) {
+        std::cout << "Frame pacing: " << framePacer->ToString() << std::endl;
     }
 }
 
 
+bool World::RunBenchmark(const Benchmark::Config &config)
+{
+    if (!window)
+        return false;
+
+    PROFILE_THREAD("Main");
+    benchmark = new Benchmark(config);
+    bool succeeded = benchmark->LoadInput();
+
+    if (succeeded)
+    {
+        window->SetFixedFrameTime(config.timeStep);
+        if (useRenderThread)
+        {
+            // The render thread counts the frames, the steps are counted here
+            simulatedSteps = 0;
+            simulationSeconds = 0;
+            double warmupSeconds = 0;
+
+            while (simulatedSteps < benchmark->GetNumFrames() && !window->ShouldClose())
+            {
+                if (simulatedSteps == config.warmupFrames) {
+                    warmupSeconds = simulationSeconds;
+                }
+                ThreadedUpdate();
+            }
+            StopRenderThread();
+
+            // Not in the phases, which are those of the render thread
+            Benchmark::SetMetric("simulation_ms", 1000 * (simulationSeconds - warmupSeconds) / std::max(config.frames, 1u));
+        }
+        else
+        {
+            while (!benchmark->IsDone() && !window->ShouldClose())
+            {
+                LoopUpdate();
+            }
+        }
+        window->SetFixedFrameTime(0);
+
+        if (framePacer)
+        {
+            FramePacer::Latency latency = framePacer->GetLatency();
+            Benchmark::SetMetric("latency_avg_ms", latency.average);
+            Benchmark::SetMetric("latency_p99_ms", latency.p99);
+        }
+
+        glm::ivec2 resolution = window->GetResolution();
+        succeeded = benchmark->WriteReport((const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION),
+            resolution.x, resolution.y);
+    }
+
+    delete benchmark;
+    benchmark = nullptr;
+    return succeeded;
+}
+
+
 void World::Pause()
 {
     paused = !paused;
 }
 
 
+void World::SetFramePacing(const FramePacer::Config &config)
+{
+    FramePacer::Config pacing = config;
+    if (useRenderThread && pacing.renderLate)
+    {
+        std::cout << "Frame pacing: the render thread draws steps simulated ahead of it, render late is off" << std::endl;
+        pacing.renderLate = false;
+    }
+
+    delete framePacer;
+    framePacer = new FramePacer(pacing);
+    framePacer->Apply(window);
+}
+
+
+const FramePacer *World::GetFramePacer() const
+{
+    return framePacer;
+}
+
+
+bool World::IsPaused() const
+{
+    return paused;
+}
+
+
+void World::SetIdleInBackground(bool idleInBackground)
+{
+    this->idleInBackground = idleInBackground;
+}
+
+
+bool World::IsIdle() const
+{
+    if (benchmark || !window)
+        return false;
+
+    return paused || (idleInBackground && (window->IsIconified() || !window->IsFocused()));
+}
+
+
+void World::SetRenderThread(bool enabled)
+{
+    if (enabled && !SupportsRenderThread())
+    {
+        std::cout << "Render thread: not supported by this World, the frames stay on one thread" << std::endl;
+        return;
+    }
+
+    useRenderThread = enabled;
+}
+
+
+glm::ivec2 World::GetFrameResolution() const
+{
+    return renderThreadRunning ? frameResolution : window->GetResolution();
+}
+
+
+void World::RunOnRenderThread(const std::function<void()> &command)
+{
+    if (!renderThreadRunning)
+    {
+        command();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(commandMutex);
+    renderCommands.push_back(command);
+}
+
+
 void World::Exit()
 {
     shouldClose = true;
@@ -48,17 +246,209 @@ double World::GetLastFrameTime()
 }
 
 
+bool World::StartCapture(const std::string &path, FrameCapture::Format format)
+{
+    if (!frameCapture) {
+        frameCapture = new FrameCapture();
+    }
+
+    return frameCapture->Start(path, format);
+}
+
+
+void World::StopCapture()
+{
+    if (frameCapture) {
+        frameCapture->Stop();
+    }
+}
+
+
+bool World::IsCapturing() const
+{
+    return frameCapture && frameCapture->IsCapturing();
+}
+
+
 void World::ComputeFrameDeltaTime()
 {
     elapsedTime = Engine::GetElapsedTime();
-    deltaTime = elapsedTime - previousTime;
+    frameTime = elapsedTime - previousTime;
     previousTime = elapsedTime;
+
+    // The benchmarks replay the same simulation whatever the frame rate
+    deltaTime = benchmark ? benchmark->GetTimeStep() : frameTime;
+}
+
+
+void World::EndPhase(Benchmark::Phase phase)
+{
+    // The phases before FRAME_START run on the simulation thread, they are
+    // not timed with the render thread
+    if (benchmark && (phase >= Benchmark::FRAME_START || !renderThreadRunning)) {
+        benchmark->EndPhase(phase);
+    }
+}
+
+
+void World::EnterIdle()
+{
+    AccountCpuTime();
+    idle = true;
+
+    std::cout << (paused ? "Paused" : window->IsIconified() ? "Minimized, idle" : "In the background, idle") << std::endl;
+
+    // The idle frames are drawn here, it starts again with the next step
+    StopRenderThread();
+
+    // A minimized window has no pixels, the frame is drawn when it is shown
+    if (!window->IsIconified()) {
+        DrawLastFrame();
+    }
+}
+
+
+void World::LeaveIdle()
+{
+    AccountCpuTime();
+    idle = false;
+    PrintCpuTime();
+
+    // The copy is only kept while idle
+    ReleaseLastFrame();
+
+    // The time spent idle is not simulated
+    previousTime = Engine::GetElapsedTime();
+    window->ResetFrameTime();
+    if (framePacer) {
+        framePacer->Reset();
+    }
+}
+
+
+void World::IdleUpdate()
+{
+    window->WaitEvents(IDLE_WAIT_SECONDS);
+
+    // The keys still reach the observers, e.g. to resume or exit
+    window->UpdateObservers(false);
+
+    if (window->TakeExposeEvent() && !window->IsIconified() && IsIdle()) {
+        PresentLastFrame();
+    }
+}
+
+
+void World::DrawLastFrame()
+{
+    glm::ivec2 resolution = window->GetResolution();
+    if (resolution.x <= 0 || resolution.y <= 0)
+        return;
+
+    FrameStart();
+    Update(0);
+    FrameEnd();
+
+    if (!lastFrame) {
+        lastFrame = new FrameBuffer();
+    }
+    if (lastFrame->GetResolution() != resolution) {
+        lastFrame->Generate(resolution.x, resolution.y, 1, false, 8);
+    }
+
+    lastFrame->CopyFromDefault(resolution);
+    window->SwapBuffers();
+}
+
+
+void World::PresentLastFrame()
+{
+    glm::ivec2 resolution = window->GetResolution();
+    if (resolution.x <= 0 || resolution.y <= 0)
+        return;
+
+    // Minimized when the World became idle, nothing was kept
+    if (!lastFrame)
+    {
+        DrawLastFrame();
+        return;
+    }
+
+    // Scaled to the new size after a resize
+    lastFrame->CopyToDefault(resolution);
+    window->SwapBuffers();
+}
+
+
+void World::ReleaseLastFrame()
+{
+    if (lastFrame)
+    {
+        lastFrame->Clean();
+        delete lastFrame;
+        lastFrame = nullptr;
+    }
+}
+
+
+void World::AccountCpuTime()
+{
+    double cpu = Benchmark::GetProcessCpuSeconds();
+    double wall = Engine::GetElapsedTime();
+
+    cpuTimes[idle] += cpu - accountedCpu;
+    wallTimes[idle] += wall - accountedWall;
+    accountedCpu = cpu;
+    accountedWall = wall;
+}
+
+
+void World::PrintCpuTime() const
+{
+    if (wallTimes[1] <= 0)
+        return;
+
+    std::cout << "CPU: " << 100 * cpuTimes[0] / std::max(wallTimes[0], 1e-6) << "% of a core over "
+        << wallTimes[0] << " s running, " << 100 * cpuTimes[1] / wallTimes[1] << "% over "
+        << wallTimes[1] << " s idle" << std::endl;
 }
 
+
 void World::LoopUpdate()
+{
+    // Frame boundary of the profiler, also reads the GPU zones of older frames
+    PROFILE_BEGIN_FRAME();
+
+    // Until the frame limit or, rendering late, until just before the vblank
+    if (framePacer)
+    {
+        PROFILE_ZONE("WaitForFrameStart");
+        framePacer->WaitForFrameStart();
+    }
+
+    // Queues the scripted key events of the frame
+    if (benchmark) {
+        benchmark->BeginFrame(window);
+    }
+
+    double inputTime = SimulationStep();
+    if (framePacer) {
+        framePacer->InputSampled(inputTime);
+    }
+
+    RenderFrame(static_cast<float>(deltaTime), frameTime);
+}
+
+
+double World::SimulationStep()
 {
     // Polls and buffers the events
-    window->PollEvents();               // all the events from the window are saved in order to be prelucrated after 
+    {
+        PROFILE_ZONE("PollEvents");
+        window->PollEvents();           // all the events from the window are saved in order to be prelucrated after 
+    }
+    double inputTime = framePacer ? framePacer->Now() : 0;
+    EndPhase(Benchmark::EVENTS);
 
     // Computes frame deltaTime in seconds
     ComputeFrameDeltaTime();                // calculates fps (framerate on this iteration) from the last iteration   
@@ -66,14 +456,223 @@ void World::LoopUpdate()
     // Calls the methods of the instance of InputController in the following order
     // OnWindowResize, OnMouseMove, OnMouseBtnPress, OnMouseBtnRelease, OnMouseScroll, OnKeyPress, OnMouseScroll, OnInputUpdate
     // OnInputUpdate will be called each frame, the other functions are called only if an event is registered
-    window->UpdateObservers();          // prelucrates the events
+    {
+        PROFILE_ZONE("UpdateObservers");
+        window->UpdateObservers();      // prelucrates the events
+    }
+    EndPhase(Benchmark::INPUT);
+
+    {
+        PROFILE_ZONE("Simulate");
+        Simulate(static_cast<float>(deltaTime));
+    }
+    EndPhase(Benchmark::SIMULATE);
+
+    return inputTime;
+}
+
 
+void World::RenderFrame(float deltaTimeSeconds, double frameSeconds)
+{
     // Frame processing
-    FrameStart();                               // updates the variables
-    Update(static_cast<float>(deltaTime));      // prelucrates the frame, drawing commands are executed
-    FrameEnd();                                 // the grid, xoy system
+    {
+        PROFILE_ZONE("Frame");
+        PROFILE_GPU_ZONE("Frame");
+
+        {
+            PROFILE_ZONE("FrameStart");
+            FrameStart();                               // updates the variables
+        }
+        if (renderThreadRunning)
+        {
+            // The state of the step is taken, the next one is simulated while this one is drawn
+            {
+                std::lock_guard<std::mutex> lock(stepMutex);
+                takenSteps = publishedSteps;
+            }
+            stepChanged.notify_all();
+        }
+        EndPhase(Benchmark::FRAME_START);
+        {
+            PROFILE_ZONE("Update");
+            Update(deltaTimeSeconds);                   // prelucrates the frame, drawing commands are executed
+        }
+        EndPhase(Benchmark::UPDATE);
+        {
+            PROFILE_ZONE("FrameEnd");
+            FrameEnd();                                 // the grid, xoy system
+        }
+        EndPhase(Benchmark::FRAME_END);
+    }
+
+    // Queues the copy of the finished frame, it is encoded a few frames later
+    if (IsCapturing())
+    {
+        PROFILE_ZONE("Capture");
+        glm::ivec2 resolution = GetFrameResolution();
+        frameCapture->Capture(resolution.x, resolution.y);
+    }
+    EndPhase(Benchmark::CAPTURE);
 
     // Swap front and back buffers - image will be displayed to the screen
-    window->SwapBuffers();                      // one buffer? flickering, the pixels are modified while the image is shown
+    {
+        PROFILE_ZONE("SwapBuffers");
+        if (framePacer) {
+            framePacer->BeforeSwap();
+        }
+        window->SwapBuffers();                  // one buffer? flickering, the pixels are modified while the image is shown
+        if (framePacer) {
+            framePacer->AfterSwap();
+        }
+    }
+    EndPhase(Benchmark::SWAP);
+
+    // The draw counters and the streamed bytes are counted per frame
+    RenderStats::EndFrame(frameSeconds);
+    StreamBuffer::EndFrame();
+
+    if (benchmark) {
+        benchmark->EndFrame();
+    }
 }                                               // at least 2 buffers:  one already complete on the screen, one prelucrated
-                                                // after the prelucr for the 2nd one is done, swap them 
+                                                // after the prelucr for the 2nd one is done, swap them
+
+
+void World::ThreadedUpdate()
+{
+    if (!renderThread) {
+        StartRenderThread();
+    }
+
+    // Until the render thread took the last step in its FrameStart
+    {
+        PROFILE_ZONE("WaitForRender");
+        std::unique_lock<std::mutex> lock(stepMutex);
+        stepChanged.wait(lock, [this]() { return takenSteps == publishedSteps; });
+    }
+
+    // The benchmark frames are counted by the render thread, the events go by step
+    if (benchmark) {
+        benchmark->QueueInput(window, simulatedSteps);
+    }
+
+    double start = Engine::GetElapsedTime();
+    double inputTime = SimulationStep();
+    simulationSeconds += Engine::GetElapsedTime() - start;
+    simulatedSteps++;
+
+    {
+        std::lock_guard<std::mutex> lock(stepMutex);
+        publishedSteps++;
+        stepInputTime = inputTime;
+        stepResolution = window->GetResolution();
+    }
+    stepChanged.notify_all();
+}
+
+
+void World::RenderLoop()
+{
+    PROFILE_THREAD("Render");
+    window->MakeCurrentContext();
+
+    double previous = Engine::GetElapsedTime();
+    while (true)
+    {
+        PROFILE_BEGIN_FRAME();
+
+        // The simulation waits for the frames, so the limit paces both threads
+        if (framePacer)
+        {
+            PROFILE_ZONE("WaitForFrameStart");
+            framePacer->WaitForFrameStart();
+        }
+
+        // The frame time includes the wait for the step: it is the longer of
+        // the simulation and the drawing
+        if (benchmark) {
+            benchmark->BeginFrame(nullptr);
+        }
+
+        double inputTime = 0;
+        {
+            PROFILE_ZONE("WaitForStep");
+            std::unique_lock<std::mutex> lock(stepMutex);
+            stepChanged.wait(lock, [this]() { return publishedSteps != takenSteps || stopRendering; });
+
+            // The steps published before the stop are still drawn
+            if (publishedSteps == takenSteps)
+                break;
+
+            inputTime = stepInputTime;
+            frameResolution = stepResolution;
+        }
+        if (framePacer) {
+            framePacer->InputSampled(inputTime);
+        }
+
+        RunRenderCommands();
+
+        double now = Engine::GetElapsedTime();
+        double frameSeconds = now - previous;
+        previous = now;
+
+        RenderFrame(static_cast<float>(benchmark ? benchmark->GetTimeStep() : frameSeconds), frameSeconds);
+    }
+
+    window->ReleaseContext();
+}
+
+
+void World::StartRenderThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(stepMutex);
+        publishedSteps = 0;
+        takenSteps = 0;
+        stopRendering = false;
+    }
+    renderThreadRunning = true;
+
+    // GLFW only polls the events on the main thread, so the context moves
+    // to the render thread instead
+    window->ReleaseContext();
+    renderThread = new std::thread(&World::RenderLoop, this);
+}
+
+
+void World::StopRenderThread()
+{
+    if (!renderThread)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(stepMutex);
+        stopRendering = true;
+    }
+    stepChanged.notify_all();
+
+    renderThread->join();
+    delete renderThread;
+    renderThread = nullptr;
+    renderThreadRunning = false;
+
+    window->MakeCurrentContext();
+
+    // The commands queued after its last frame
+    RunRenderCommands();
+}
+
+
+void World::RunRenderCommands()
+{
+    std::vector<std::function<void()>> commands;
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        commands.swap(renderCommands);
+    }
+
+    for (const auto &command : commands) {
+        command();
+    }
+}
@@ -1,32 +1,176 @@
 #pragma once
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "window/input_controller.h"
+#include "benchmark.h"
+#include "frame_pacer.h"
+#include "gpu/frame_buffer.h"
+#include "gpu/frame_capture.h"
 
 
 class World : public InputController
 {
  public:
     World();
-    virtual ~World() {}
+    virtual ~World();
     virtual void Init() {}
     virtual void FrameStart() {}
     virtual void Update(float deltaTimeSeconds) {}
     virtual void FrameEnd() {}
 
+    // Advances the state by a step, after the events of the frame reached
+    // the observers and before FrameStart
+    virtual void Simulate(float deltaTimeSeconds) {}
+
+    // True for the Worlds that can draw on a render thread: the observers
+    // and Simulate do not touch the GL objects, and FrameStart, Update and
+    // FrameEnd only read the state of the last step as published by
+    // Simulate, e.g. through a TripleBuffer, which FrameStart takes
+    virtual bool SupportsRenderThread() const { return false; }
+
     void Run();
+
+    // Runs the frames of a benchmark instead of waiting for the window to
+    // close, then writes its report. False if the script or the report fail.
+    bool RunBenchmark(const Benchmark::Config &config);
+
+    // Paused, Run waits for the window events instead of running frames:
+    // nothing is simulated or drawn, the last frame is presented again when
+    // the window is exposed or resized, and only the key and mouse events
+    // are sent to the observers, e.g. to resume
     void Pause();
+    bool IsPaused() const;
+
+    // The World is also idle while its window is minimized or in the
+    // background, unless this is disabled. Benchmarks are never idle.
+    void SetIdleInBackground(bool idleInBackground);
+    bool IsIdle() const;
+
     void Exit();
 
+    // The frames are split between the thread of Run, which polls the events
+    // and simulates, and a render thread that owns the GL context. The step
+    // after the one being drawn is simulated meanwhile, so a frame takes the
+    // longer of the two instead of their sum. A resize seen in the middle of
+    // a frame applies to the next one. Only for the Worlds that support it;
+    // call it before SetFramePacing, render late is off with it.
+    void SetRenderThread(bool enabled);
+
+    // The resolution to draw the frame at, to be used instead of the one of
+    // the window in FrameStart, Update and FrameEnd. With the render thread
+    // it is the one the step of the frame was simulated at, the window is
+    // resized by the events of the next step meanwhile.
+    glm::ivec2 GetFrameResolution() const;
+
+    // Runs the command on the render thread before its next frame, for the
+    // observers that change the GL objects. At once without the thread.
+    void RunOnRenderThread(const std::function<void()> &command);
+
+    // Paces the frames from now on: frame rate limit, swap mode and render
+    // late, see FramePacer. Without it the frames run as fast as the swap.
+    void SetFramePacing(const FramePacer::Config &config);
+    const FramePacer *GetFramePacer() const;
+
     double GetLastFrameTime();
 
+    // Records every frame after FrameEnd, see FrameCapture
+    bool StartCapture(const std::string &path, FrameCapture::Format format);
+    void StopCapture();
+    bool IsCapturing() const;
+
  private:
     void ComputeFrameDeltaTime();
     void LoopUpdate();
+    void EndPhase(Benchmark::Phase phase);
+
+    // The halves of a frame: the events, the observers and Simulate, then
+    // the drawing, the capture and the swap. SimulationStep returns when the
+    // events were polled, on the clock of the frame pacer.
+    double SimulationStep();
+    void RenderFrame(float deltaTimeSeconds, double frameSeconds);
+
+    // With the render thread, a step of the thread of Run and the loop of
+    // the render thread
+    void ThreadedUpdate();
+    void RenderLoop();
+
+    // Moves the GL context to the render thread and back
+    void StartRenderThread();
+    void StopRenderThread();
+    void RunRenderCommands();
+
+    // Idle frames
+    void EnterIdle();
+    void LeaveIdle();
+    void IdleUpdate();
+
+    // Draws the current state without advancing it and keeps a copy of it
+    void DrawLastFrame();
+    void PresentLastFrame();
+    void ReleaseLastFrame();
+
+    // Adds the time since the last call to the idle or the active totals
+    void AccountCpuTime();
+    void PrintCpuTime() const;
 
  private:
     double previousTime;
     double elapsedTime;
     double deltaTime;
+
+    // Measured, deltaTime is the fixed step during a benchmark
+    double frameTime;
     bool paused;
     bool shouldClose;
+
+    bool idle;
+    bool idleInBackground;
+    FrameBuffer *lastFrame;
+
+    // Process CPU seconds and wall seconds while running frames and while
+    // idle, a core fully used is 1 CPU second per second
+    double cpuTimes[2];
+    double wallTimes[2];
+    double accountedCpu;
+    double accountedWall;
+
+    FrameCapture *frameCapture;
+    Benchmark *benchmark;
+    FramePacer *framePacer;
+
+    bool useRenderThread;
+    std::thread *renderThread;
+
+    // Set before the render thread starts and after it stopped
+    bool renderThreadRunning;
+
+    // Steps published by the simulation and taken by the render thread,
+    // the simulation waits for the render thread to take a step before it
+    // starts the next one. The states themselves are handed over by the
+    // World implementation.
+    std::mutex stepMutex;
+    std::condition_variable stepChanged;
+    unsigned int publishedSteps;
+    unsigned int takenSteps;
+    bool stopRendering;
+
+    // Of the last published step, on the clock of the frame pacer
+    double stepInputTime;
+
+    // The window resolution of the last published step, and the one of the
+    // step being drawn, only used by the render thread
+    glm::ivec2 stepResolution;
+    glm::ivec2 frameResolution;
+
+    // Steps simulated by the thread of Run and its seconds of Simulate
+    unsigned int simulatedSteps;
+    double simulationSeconds;
+
+    std::mutex commandMutex;
+    std::vector<std::function<void()>> renderCommands;
 };
@@ -1,27 +1,115 @@
 ﻿#include "headers/drone_challenge.h"
 #include "headers/literals.h"
 #include "headers/objects3D.h"
+#include "headers/geometry3D.h"
 #include "headers/obstacles.h"
 #include "headers/drone.h"
+#include "headers/impostors.h"
+#include "headers/gpu_culling.h"
+#include "headers/heightfield.h"
+#include "headers/raycast.h"
+#include "headers/lidar.h"
+#include "headers/worker_pool.h"
+#include "headers/multiview.h"
+#include "headers/particles.h"
+#include "headers/gpu_dust.h"
+#include "headers/ground_cover.h"
+#include "headers/world_scale.h"
+
+#include "core/profiler.h"
+#include "core/gpu/mesh_optimizer.h"
+#include "core/gpu/render_stats.h"
 
 #include <vector>
 #include <string>
 #include <iostream>
+#include <chrono>
 
 using namespace m1;
 
+ObstacleSet::ObstacleSet()
+{
+    fieldSeed = 0.0f;
+    heightField = nullptr;
+    version = 0;
+}
+
+ObstacleSet::~ObstacleSet()
+{
+    delete heightField;
+}
+
+DroneSnapshot::DroneSnapshot()
+{
+    dronePos = glm::vec3(0.0f);
+    droneMatrix = glm::mat4(1);
+
+    rightFrontPropellerAngle = 0.0f;
+    rightRearPropellerAngle = 0.0f;
+    leftFrontPropellerAngle = 0.0f;
+    leftRearPropellerAngle = 0.0f;
+
+    packageStatus = PackageStatus::FREE;
+    pickupTime = true;
+    zoneIndex = 0;
+    packageIndex = 0;
+    arrowIndex = 0;
+
+    obstacleVersion = 0;
+}
+
 DroneChallenge::DroneChallenge()
 {
     droneCamera = nullptr;
     miniMapCamera = nullptr;
+    fieldShader = nullptr;
+    miniMapFieldShader = nullptr;
+    geometryPool = nullptr;
+    impostors = nullptr;
+    obstacleCuller = nullptr;
+    useGpuCulling = false;
 
     leftFrontPropellerAngle = RADIANS(0.0f);
     leftRearPropellerAngle = RADIANS(0.0f);
     rightFrontPropellerAngle = RADIANS(0.0f);
     rightRearPropellerAngle = RADIANS(0.0f);
 
-    dronePos = glm::vec3(0.0f, lit::maxObsHeight, lit::fieldZ / 2.0f - 5.0f);
-    fieldSeed = 0.0f;
+    dronePos = glm::vec3(0.0f, lit::maxObsHeight, scale::Get().GetFieldMax().y - 5.0f);
+    drawn = nullptr;
+    uploadedVersion = 0;
+    fieldVersion = 0;
+
+    workerPool = nullptr;
+    rayCaster = nullptr;
+    lidar = nullptr;
+    altimeter = nullptr;
+    useSensors = false;
+
+    fleetViews = nullptr;
+    fleetFieldShader = nullptr;
+    fleetSize = 0;
+    fleetReportTime = 0.0f;
+    fleetFrames = 0;
+    fleetFramesRead = 0;
+    fleetFrameRate = 0.0f;
+    fleetReadRate = 0.0f;
+
+    particleRenderer = nullptr;
+    dust = nullptr;
+    weather = nullptr;
+    gpuDust = nullptr;
+    showWeather = false;
+    dustVisible = 0;
+    dustStepMilliseconds = 0.0;
+    weatherVisible = 0;
+    weatherStepMilliseconds = 0.0;
+
+    groundCover = nullptr;
+    groundCoverCulledShader = nullptr;
+    showGroundCover = true;
+
+    hud = nullptr;
+    showHud = false;
 
     yawAngle = RADIANS(0.0f);
     pitchAngle = RADIANS(0.0f);
@@ -30,8 +118,8 @@ DroneChallenge::DroneChallenge()
     xoyTiltLvl = 0;
     zoneIndex = 0;
 
-    packageIndex = lit::numOfZones;
-    arrowIndex = lit::numOfZones;
+    packageIndex = scale::Get().GetNumOfZones();
+    arrowIndex = scale::Get().GetNumOfZones();
 
     packageStatus = PackageStatus::FREE;
     pickupTime = true;
@@ -39,39 +127,178 @@ DroneChallenge::DroneChallenge()
 
 DroneChallenge::~DroneChallenge()
 {
+    delete impostors;
+    delete fleetViews;
+    delete weather;
+    delete dust;
+    delete gpuDust;
+    delete particleRenderer;
+    delete groundCover;
+    delete hud;
+    delete lidar;
+    delete altimeter;
+    delete rayCaster;
+    delete workerPool;
+    delete obstacleCuller;
+    delete geometryPool;
 }
 
 void DroneChallenge::Init()
 {
+    PROFILE_ZONE("DroneChallenge::Init");
+
+    const scale::WorldScale& world = scale::Get();
+    std::cout << "World scale: " << scale::ToString(world) << std::endl;
+
     droneCamera = new camera::Camera();
     glm::vec3 cameraPos = dronePos - droneCamera->forward * droneCamera->distanceToTarget + glm::vec3(0.0f, 1.0f, 0.0f);
 
     droneCamera->Set(cameraPos, dronePos, glm::vec3(0.0f, 1.0f, 0.0f));
-    droneCamera->SetProjectionMatrix(glm::perspective(lit::fov, window->props.aspectRatio, lit::near, lit::far));
+    droneCamera->SetProjectionMatrix(glm::perspective(lit::fov, window->props.aspectRatio, world.cameraNear, world.cameraFar));
 
     miniMapCamera = new camera::Camera();
     miniMapCamera->Set(glm::vec3(0.0f, 50.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
 
     miniMapCamera->SetProjectionMatrix(glm::ortho(
-        -lit::fieldX / 2.0f, lit::fieldX / 2.0f,
-        -lit::fieldZ / 2.0f, lit::fieldZ / 2.0f,
-        lit::zNear, lit::zFar));
+        world.GetFieldMin().x, world.GetFieldMax().x,
+        world.GetFieldMin().y, world.GetFieldMax().y,
+        world.miniMapNear, world.miniMapFar));
+
+    /* The programs are loaded from the binary cache or compiled by the driver
+    while the meshes are built, their status is only checked after that */
+    double shaderStartTime = Engine::GetElapsedTime();
+    ShaderCache::Stats shaderStats = ShaderCache::GetStats();
+    std::vector<Shader*> startedShaders;
 
     Shader* shader = new Shader("FieldShader");
     shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "VertexShader.glsl"), GL_VERTEX_SHADER);
     shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "FragmentShader.glsl"), GL_FRAGMENT_SHADER);
-    shader->CreateAndLink();
+    shader->StartCompile();
     shaders[shader->GetName()] = shader;
+    startedShaders.push_back(shader);
+
+    /* The minimap is small and seen from above, so it skips the displacement */
+    fieldShader = shader->GetVariant("NOISE_FROM_TEXTURE", false);
+    miniMapFieldShader = shader->GetVariant("NOISE_FROM_TEXTURE LOW_QUALITY", false);
+    startedShaders.push_back(fieldShader);
+    startedShaders.push_back(miniMapFieldShader);
+
+    shader = new Shader("ImpostorBake");
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "ImpostorBake.VS.glsl"), GL_VERTEX_SHADER);
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "ImpostorBake.FS.glsl"), GL_FRAGMENT_SHADER);
+    shader->StartCompile();
+    shaders[shader->GetName()] = shader;
+    startedShaders.push_back(shader);
 
-    treesAndHouses = obstacle::GeneratePositionsAndSizes(lit::numOfObstacles, packagesAndZone);
+    shader = new Shader("Impostor");
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "Impostor.VS.glsl"), GL_VERTEX_SHADER);
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "Impostor.FS.glsl"), GL_FRAGMENT_SHADER);
+    shader->StartCompile();
+    shaders[shader->GetName()] = shader;
+    startedShaders.push_back(shader);
+
+    /* Obstacles by default, the FIELD variant for the field */
+    shader = new Shader("MultiView");
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "MultiView.VS.glsl"), GL_VERTEX_SHADER);
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "MultiView.GS.glsl"), GL_GEOMETRY_SHADER);
+    shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "VertexColor.FS.glsl"), GL_FRAGMENT_SHADER);
+    shader->StartCompile();
+    shaders[shader->GetName()] = shader;
+    startedShaders.push_back(shader);
 
-    Mesh* field = objects3D::CreateField("field", lit::origin);
-    AddMeshToList(field);
+    fleetFieldShader = shader->GetVariant("FIELD", false);
+    startedShaders.push_back(fleetFieldShader);
+
+    shader = new Shader("Particle");
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "Particle.VS.glsl"), GL_VERTEX_SHADER);
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "Particle.FS.glsl"), GL_FRAGMENT_SHADER);
+    shader->StartCompile();
+    shaders[shader->GetName()] = shader;
+    startedShaders.push_back(shader);
 
-    Mesh* treeTrunk = objects3D::CreateTreeTrunk("treeTrunk", lit::origin, lit::darkBrown);
+    /* Tests the clumps itself, the CULLED variant draws the ones kept by GroundCoverCull */
+    shader = new Shader("GroundCover");
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "GroundCover.VS.glsl"), GL_VERTEX_SHADER);
+    shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "GroundCover.FS.glsl"), GL_FRAGMENT_SHADER);
+    shader->StartCompile();
+    shaders[shader->GetName()] = shader;
+    startedShaders.push_back(shader);
+
+    if (culling::ObstacleCuller::IsSupported()) {
+        groundCoverCulledShader = shader->GetVariant("CULLED", false);
+        startedShaders.push_back(groundCoverCulledShader);
+
+        shader = new Shader("GroundCoverCull");
+        shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "GroundCoverCull.CS.glsl"), GL_COMPUTE_SHADER);
+        shader->StartCompile();
+        shaders[shader->GetName()] = shader;
+        startedShaders.push_back(shader);
+
+        shader = new Shader("ObstacleCull");
+        shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "ObstacleCull.CS.glsl"), GL_COMPUTE_SHADER);
+        shader->StartCompile();
+        shaders[shader->GetName()] = shader;
+        startedShaders.push_back(shader);
+
+        shader = new Shader("DustInit");
+        shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "DustInit.CS.glsl"), GL_COMPUTE_SHADER);
+        shader->StartCompile();
+        shaders[shader->GetName()] = shader;
+        startedShaders.push_back(shader);
+
+        shader = new Shader("DustStep");
+        shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "DustStep.CS.glsl"), GL_COMPUTE_SHADER);
+        shader->StartCompile();
+        shaders[shader->GetName()] = shader;
+        startedShaders.push_back(shader);
+
+        shader = new Shader("ObstacleIndirect");
+        shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1, "drone_challenge", "shaders", "ObstacleIndirect.VS.glsl"), GL_VERTEX_SHADER);
+        shader->AddShader(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::SHADERS, "VertexColor.FS.glsl"), GL_FRAGMENT_SHADER);
+        shader->StartCompile();
+        shaders[shader->GetName()] = shader;
+        startedShaders.push_back(shader);
+    }
+
+    /* The generation times are reported with the benchmark, for the scaling sweeps */
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point generationStart = Clock::now();
+    obstacles = CreateObstacleSet();
+
+    Clock::time_point bakeStart = Clock::now();
+    BakeField(*obstacles);
+
+    Clock::time_point meshesStart = Clock::now();
+    Benchmark::SetMetric("generate_obstacles_ms", std::chrono::duration<double, std::milli>(bakeStart - generationStart).count());
+    Benchmark::SetMetric("bake_field_ms", std::chrono::duration<double, std::milli>(meshesStart - bakeStart).count());
+
+    /* Printed once, a Restart bakes another field of the same size */
+    obstacles->heightField->PrintStats();
+
+    /* The sensors cast against the same shapes the drone collides with */
+    workerPool = new workers::WorkerPool();
+    rayCaster = new raycast::RayCaster();
+    rayCaster->Build(obstacles->treesAndHouses, *obstacles->heightField);
+    lidar = new sensor::LidarSensor(sensor::LidarConfig::Sweep());
+    altimeter = new sensor::LidarSensor(sensor::LidarConfig::Altimeter());
+
+    /* All the static meshes are ranges of one vertex and one index buffer. They only
+    use positions and colors, stored as half floats and RGBA8 (12 bytes per vertex). The
+    pool turns away meshes that half floats would move, like the field of a large world,
+    which are then uploaded on their own with 16-bit positions over their bounds, or floats. */
+    VertexLayout poolLayout(VertexLayout::POSITION | VertexLayout::COLOR, VertexLayout::NORMAL | VertexLayout::TEX_COORD,
+        VertexLayout::POSITION_HALF, VertexLayout::COLOR);
+    poolLayout.SetConstants(VertexFormat(lit::origin));
+    geometryPool = new GeometryPool(lit::poolVertices, lit::poolIndices, poolLayout, GL_UNSIGNED_SHORT);
+
+    /* The field has the heights of the set, it is rebuilt by every Restart */
+    UploadField(*obstacles);
+    objects3D::SetGeometryPool(geometryPool);
+
+    Mesh* treeTrunk = objects3D::CreateTreeTrunk("treeTrunk", lit::origin, lit::darkBrown, world.circlePoints);
     AddMeshToList(treeTrunk);
 
-    Mesh* treeCrown = objects3D::CreateTreeCrown("treeCrown", lit::origin, lit::green);
+    Mesh* treeCrown = objects3D::CreateTreeCrown("treeCrown", lit::origin, lit::green, world.circlePoints);
     AddMeshToList(treeCrown);
 
     Mesh* droneBody = objects3D::CreateDroneBody("droneBody", lit::origin, lit::gray);
@@ -97,33 +324,319 @@ void DroneChallenge::Init()
 
     Mesh* indicator = objects3D::CreateTriangle("indicator", lit::origin, lit::lightBrown);
     AddMeshToList(indicator);
+
+    objects3D::SetGeometryPool(nullptr);
+    geometryPool->PrintStats();
+    GeometryPool::Stats poolStats = geometryPool->GetStats();
+    Benchmark::SetMetric("pool_meshes", poolStats.numRanges);
+    Benchmark::SetMetric("pool_vertices", poolStats.usedVertices);
+    Benchmark::SetMetric("pool_indices", poolStats.usedIndices);
+    Benchmark::SetMetric("create_meshes_ms", std::chrono::duration<double, std::milli>(Clock::now() - meshesStart).count());
+
+    for (const auto& mesh : meshes) {
+        mesh.second->GetVertexLayout().PrintStats(mesh.first, (unsigned int)mesh.second->vertices.size());
+    }
+
+    for (Shader* started : startedShaders) {
+        started->CreateAndLink();
+    }
+
+    ShaderCache::Stats newShaderStats = ShaderCache::GetStats();
+    std::cout << "Drone challenge shaders ready in " << 1000 * (Engine::GetElapsedTime() - shaderStartTime) << " ms ("
+        << newShaderStats.loaded - shaderStats.loaded << " programs from the cache, "
+        << newShaderStats.compiled - shaderStats.compiled << " compiled)" << std::endl;
+    ShaderCache::Save();
+
+    /* Far trees and houses are drawn as quads from an atlas baked once and cached on disk */
+    impostors = new impostor::ImpostorRenderer();
+    impostors->Init(PATH_JOIN(window->props.selfDir, "impostor_atlas.cache"), shaders["ImpostorBake"],
+        treeTrunk, treeCrown, houseBody, houseRoof);
+
+    /* With a 4.3 context the obstacles are culled and drawn on the GPU, G toggles it */
+    if (culling::ObstacleCuller::IsSupported()) {
+        obstacleCuller = new culling::ObstacleCuller();
+        obstacleCuller->Init(treeTrunk, treeCrown, houseBody, houseRoof);
+        useGpuCulling = true;
+    }
+
+    /* Every camera of the fleet is a layer of one array framebuffer, drawn in one pass */
+    fleetViews = new multiview::MultiViewRenderer();
+    fleetViews->Init(treeTrunk, treeCrown, houseBody, houseRoof, lit::fleetViewWidth, lit::fleetViewHeight, lit::fleetMaxViews);
+    fleetViews->SetConsumer([this](const multiview::Frame& frame) {
+        fleetFramesRead++;
+    });
+
+    /* Each particle system steps on its own thread while the previous step is drawn.
+    With compute shaders the dust is filled and stepped on the GPU instead, from the
+    same seed as the CPU dust, and only older contexts fill it on the CPU. */
+    particleRenderer = new particles::ParticleRenderer();
+    particleRenderer->Init(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::TEXTURES));
+    if (culling::ObstacleCuller::IsSupported()) {
+        gpuDust = new particles::GpuDust();
+        gpuDust->Init(lit::dustParticles, shaders["DustInit"], lit::dustParticles + particles::DUST);
+    } else {
+        dust = new particles::ParticleSystem(particles::DUST, lit::dustParticles);
+    }
+    weather = new particles::ParticleSystem(particles::RAIN, lit::weatherParticles);
+
+    /* On the GPU culling path the clumps are also culled by a compute shader */
+    groundCover = new groundcover::GroundCover();
+    groundCover->Init(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::TEXTURES), culling::ObstacleCuller::IsSupported(),
+        glm::vec2(world.fieldX, world.fieldZ));
+
+    /* Frame times and counters over the scene, H shows them */
+    glm::ivec2 resolution = window->GetResolution();
+    hud = new gfxc::TextRenderer(window->props.selfDir, resolution.x, resolution.y);
+    hud->Load(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::FONTS, "Hack-Bold.ttf"), 16);
+
+    /* The first frame draws the starting state */
+    UploadObstacles(*obstacles);
+    PublishSnapshot();
 }
 
 void DroneChallenge::FrameStart()
 {
+    /* The last step published by Simulate, a new obstacle set is uploaded before it is drawn */
+    drawn = &snapshots.Read();
+    if (drawn->obstacleVersion != uploadedVersion) {
+        UploadObstacles(*drawn->obstacles);
+    }
+
     glClearColor(lit::backgroundRed, lit::backgroundGreen, lit::backgroundBlue, 1);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glm::ivec2 resolution = window->GetResolution();
+    glm::ivec2 resolution = GetFrameResolution();
     glViewport(0, 0, resolution.x, resolution.y);
 }
 
-void DroneChallenge::Restart()
+std::shared_ptr<ObstacleSet> DroneChallenge::CreateObstacleSet()
+{
+    /* The last reference may be dropped by the simulation, the texture is deleted by the render thread */
+    std::shared_ptr<ObstacleSet> set(new ObstacleSet(), [this](ObstacleSet* old) {
+        RunOnRenderThread([old]() { delete old; });
+    });
+
+    set->treesAndHouses = obstacle::GeneratePositionsAndSizes(scale::Get(), set->packagesAndZone);
+    set->heightField = new heightfield::HeightField();
+    set->version = obstacles ? obstacles->version + 1 : 1;
+    return set;
+}
+
+void DroneChallenge::BakeField(ObstacleSet& set)
+{
+    PROFILE_ZONE("BakeField");
+
+    /* The field mesh has a vertex on every sample and the texel centers are on them too.
+    Inside a cell the mesh is two flat triangles while the collisions are bilinear. They
+    meet on the cell edges and differ most at the center, by a quarter of how far the
+    corners are from a plane. */
+    const scale::WorldScale& world = scale::Get();
+    glm::ivec2 samples = world.GetHeightSamples();
+    set.heightField->Bake(set.fieldSeed, lit::fieldNoiseFrequency, world.GetFieldMin(), world.GetFieldMax(), samples.x, samples.y);
+}
+
+void DroneChallenge::UploadObstacles(ObstacleSet& set)
+{
+    PROFILE_ZONE("UploadObstacles");
+
+    /* The heights are still read by the simulation, the texture and the mesh get copies */
+    set.heightField->Upload();
+    UploadField(set);
+
+    if (obstacleCuller) {
+        obstacleCuller->SetObstacles(set.treesAndHouses);
+    }
+
+    fleetViews->SetObstacles(set.treesAndHouses);
+    fleetViews->SetField(meshes["field"]);
+    uploadedVersion = set.version;
+}
+
+void DroneChallenge::UploadField(const ObstacleSet& set)
 {
-    packagesAndZone.clear();
-    treesAndHouses = obstacle::GeneratePositionsAndSizes(lit::numOfObstacles, packagesAndZone);
-    fieldSeed = obstacle::RandomFloat(0.25f, 2.0f);
+    PROFILE_ZONE("UploadField");
+
+    if (fieldVersion == set.version) {
+        return;
+    }
+
+    /* The field of the last set is not drawn any more. Its range goes back to the pool
+    first, so the new field takes the same place instead of growing the pool. */
+    auto last = meshes.find("field");
+    if (last != meshes.end()) {
+        delete last->second;
+        meshes.erase(last);
+    }
 
-    dronePos = glm::vec3(0.0f, lit::maxObsHeight, lit::fieldZ / 2.0f - 5.0f);
+    const heightfield::HeightField& heights = *set.heightField;
+    objects3D::SetGeometryPool(geometryPool);
+    Mesh* field = objects3D::CreateField("field", lit::origin, glm::vec2(scale::Get().fieldX, scale::Get().fieldZ),
+        glm::ivec2(heights.GetWidth() - 1, heights.GetDepth() - 1), &heights.GetHeights()[0]);
+    objects3D::SetGeometryPool(nullptr);
+
+    AddMeshToList(field);
+    fieldVersion = set.version;
+}
+
+void DroneChallenge::PublishSnapshot()
+{
+    DroneSnapshot& snapshot = snapshots.GetBack();
+
+    snapshot.dronePos = dronePos;
+    snapshot.droneMatrix = drone::GenerateDrone(dronePos, pitchAngle, yawAngle, rollAngle);
+
+    snapshot.rightFrontPropellerAngle = rightFrontPropellerAngle;
+    snapshot.rightRearPropellerAngle = rightRearPropellerAngle;
+    snapshot.leftFrontPropellerAngle = leftFrontPropellerAngle;
+    snapshot.leftRearPropellerAngle = leftRearPropellerAngle;
+
+    snapshot.droneCamera = *droneCamera;
+
+    snapshot.packageStatus = packageStatus;
+    snapshot.pickupTime = pickupTime;
+    snapshot.zoneIndex = zoneIndex;
+    snapshot.packageIndex = packageIndex;
+    snapshot.arrowIndex = arrowIndex;
+
+    snapshot.obstacleVersion = obstacles->version;
+    snapshot.obstacles = obstacles;
+
+    snapshots.Publish();
+}
+
+void DroneChallenge::ScanSensors()
+{
+    glm::mat4 pose = drone::GenerateDrone(dronePos, pitchAngle, yawAngle, rollAngle);
+    lidar->Scan(*rayCaster, pose, workerPool);
+    altimeter->Scan(*rayCaster, pose);
+}
+
+void DroneChallenge::RenderFleetViews(float deltaTimeSeconds)
+{
+    /* The fleet flies circles around the center of the field, each drone looking ahead */
+    std::vector<glm::mat4> viewProjections(fleetSize);
+    glm::mat4 projection = glm::perspective(lit::fov, (float)lit::fleetViewWidth / lit::fleetViewHeight,
+        scale::Get().cameraNear, scale::Get().cameraFar);
+    float time = (float)Engine::GetElapsedTime();
+
+    for (int i = 0; i < fleetSize; i++) {
+        float radius = 5.0f + 15.0f * glm::fract(i * 0.618034f);
+        float angle = RADIANS(360.0f) * i / fleetSize + 0.2f * time;
+        glm::vec3 position(radius * cos(angle), lit::maxObsHeight + 0.5f * (i % 4), radius * sin(angle));
+        glm::vec3 forward(-sin(angle), -0.2f, cos(angle));
+
+        viewProjections[i] = projection * glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    fleetViews->PollReadbacks();
+    fleetViews->Render(viewProjections, fleetFieldShader, shaders["MultiView"], *drawn->obstacles->heightField);
+    fleetViews->RequestReadback();
+    FrameBuffer::BindDefault(GetFrameResolution());
+
+    fleetFrames++;
+    fleetReportTime += deltaTimeSeconds;
+    if (fleetReportTime < 1.0f) {
+        return;
+    }
+
+    /* Shown on the HUD */
+    fleetFrameRate = fleetFrames / fleetReportTime;
+    fleetReadRate = fleetFramesRead / fleetReportTime;
+    fleetReportTime = 0.0f;
+    fleetFrames = 0;
+    fleetFramesRead = 0;
+}
+
+void DroneChallenge::RenderParticles(float deltaTimeSeconds)
+{
+    PROFILE_ZONE("RenderParticles");
+    PROFILE_GPU_ZONE("RenderParticles");
+
+    const camera::Camera& camera = drawn->droneCamera;
+    const heightfield::HeightField& field = *drawn->obstacles->heightField;
+    glm::vec3 dronePos = drawn->dronePos;
+
+    particles::Environment environment;
+    environment.camera = camera.position;
+    environment.viewProjection = camera.GetProjectionMatrix() * camera.GetViewMatrix();
+    environment.wind = lit::weatherWind;
+    environment.groundHeight = field.GetPyramid().GetMinHeight(
+        scale::Get().GetFieldMin(), scale::Get().GetFieldMax());
+
+    /* The rotors only raise dust when the drone is close to the ground below it */
+    float ground = field.Sample(dronePos.x, dronePos.z);
+    environment.washCenter = glm::vec3(dronePos.x, ground, dronePos.z);
+    environment.washStrength = glm::clamp(1.0f - (dronePos.y - ground) / lit::washAltitude, 0.0f, 1.0f);
+
+    /* Draw the last step, then start the next one. The step writes the stats of
+    the system, so they are only read before it starts. On the GPU the step is
+    queued before the draw, which waits for it there. */
+    if (gpuDust) {
+        gpuDust->Simulate(shaders["DustStep"], deltaTimeSeconds, environment);
+        particleRenderer->Render(*gpuDust, shaders["Particle"], camera.GetViewMatrix(), camera.GetProjectionMatrix(),
+            camera.position);
+    } else {
+        dust->Wait();
+        dustVisible = dust->GetNumVisible();
+        dustStepMilliseconds = dust->GetStepMilliseconds();
+        particleRenderer->Render(*dust, shaders["Particle"], camera.GetViewMatrix(), camera.GetProjectionMatrix(),
+            camera.position, lit::weatherWind);
+        dust->Simulate(deltaTimeSeconds, environment);
+    }
+
+    if (showWeather) {
+        weather->Wait();
+        weatherVisible = weather->GetNumVisible();
+        weatherStepMilliseconds = weather->GetStepMilliseconds();
+        particleRenderer->Render(*weather, shaders["Particle"], camera.GetViewMatrix(), camera.GetProjectionMatrix(),
+            camera.position, lit::weatherWind);
+        weather->Simulate(deltaTimeSeconds, environment);
+    }
+}
+
+void DroneChallenge::RenderGroundCover(float deltaTimeSeconds)
+{
+    if (!showGroundCover) {
+        return;
+    }
+
+    PROFILE_ZONE("RenderGroundCover");
+    PROFILE_GPU_ZONE("RenderGroundCover");
+
+    /* The delivery zones come first in packagesAndZone */
+    const ObstacleSet& set = *drawn->obstacles;
+    const camera::Camera& camera = drawn->droneCamera;
+
+    groundcover::Placement placement;
+    placement.field = set.heightField;
+    placement.seed = set.fieldSeed;
+    for (int i = 0; i < scale::Get().GetNumOfZones() && i < (int)set.packagesAndZone.size(); i++) {
+        placement.densePoints.push_back(set.packagesAndZone[i].position);
+    }
+
+    groundCover->Render(placement, shaders["GroundCover"], groundCoverCulledShader, groundCoverCulledShader ? shaders["GroundCoverCull"] : nullptr,
+        useGpuCulling, camera.GetViewMatrix(), camera.GetProjectionMatrix(), camera.position, (float)Engine::GetElapsedTime());
+}
+
+void DroneChallenge::Restart()
+{
+    /* A new set, the render thread may still be drawing the old one */
+    std::shared_ptr<ObstacleSet> set = CreateObstacleSet();
+    set->fieldSeed = obstacle::RandomFloat(0.25f, 2.0f);
+    BakeField(*set);
+    rayCaster->Build(set->treesAndHouses, *set->heightField);
+    obstacles = set;
+
+    dronePos = glm::vec3(0.0f, lit::maxObsHeight, scale::Get().GetFieldMax().y - 5.0f);
     yawAngle = RADIANS(0.0f);
     droneCamera->Update(yawAngle);
 
     zoneIndex = 0;
-    arrowIndex = lit::numOfZones;
-    packageIndex = lit::numOfZones;
+    arrowIndex = scale::Get().GetNumOfZones();
+    packageIndex = scale::Get().GetNumOfZones();
 }
 
-void DroneChallenge::RenderMesh(Mesh* mesh, Shader* shader, camera::Camera* cam, const glm::mat4& modelMatrix) const
+void DroneChallenge::RenderMesh(Mesh* mesh, Shader* shader, const camera::Camera* cam, const glm::mat4& modelMatrix) const
 {
     if (!mesh || !shader || !shader->GetProgramID())
         return;
@@ -131,9 +644,10 @@ void DroneChallenge::RenderMesh(Mesh* mesh, Shader* shader, camera::Camera* cam,
     // Render an object using the specified shader and the specified position
     glUseProgram(shader->program);
 
-    // Bind model matrix
+    // Bind model matrix, with the mapping of packed positions back to object space
+    glm::mat4 model = modelMatrix * mesh->GetVertexLayout().GetPositionTransform();
     GLint loc_model_matrix = glGetUniformLocation(shader->program, "Model");
-    glUniformMatrix4fv(loc_model_matrix, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+    glUniformMatrix4fv(loc_model_matrix, 1, GL_FALSE, glm::value_ptr(model));
 
     // Bind view matrix
     glm::mat4 viewMatrix = cam->GetViewMatrix();
@@ -145,92 +659,145 @@ void DroneChallenge::RenderMesh(Mesh* mesh, Shader* shader, camera::Camera* cam,
     int loc_projection_matrix = glGetUniformLocation(shader->program, "Projection");
     glUniformMatrix4fv(loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
 
-    glUniform1f(glGetUniformLocation(shader->program, "seed"), fieldSeed);
+    glUniform1f(glGetUniformLocation(shader->program, "seed"), drawn->obstacles->fieldSeed);
+    glUniform4fv(glGetUniformLocation(shader->program, "noise_transform"), 1, glm::value_ptr(drawn->obstacles->heightField->GetTextureTransform()));
+    RenderStats::CountProgramBind();
+    RenderStats::CountUniforms(5);
+
+    // Closed meshes and the ones seen only from above skip their back faces
+    if (mesh->SupportsBackFaceCulling()) {
+        glEnable(GL_CULL_FACE);
+    } else {
+        glDisable(GL_CULL_FACE);
+    }
 
-    // Draw the object
+    // Draw the object, meshes outside the pool have an empty range
+    const GeometryRange& range = mesh->GetGeometryRange();
+    GLenum indexType = mesh->GetIndexType();
     glBindVertexArray(mesh->GetBuffers()->m_VAO);
-    glDrawElements(mesh->GetDrawMode(), static_cast<int>(mesh->indices.size()), GL_UNSIGNED_INT, 0);
+    glDrawElementsBaseVertex(mesh->GetDrawMode(), static_cast<int>(mesh->indices.size()), indexType,
+        (void*)(size_t)(mesh_optimizer::GetIndexSize(indexType) * range.firstIndex), range.baseVertex);
+    RenderStats::CountDraw(mesh->GetDrawMode(), mesh->indices.size());
 }
 
-void DroneChallenge::RenderDrone(float deltaTimeSeconds, camera::Camera* cam)
+void DroneChallenge::RenderDrone(float deltaTimeSeconds, const camera::Camera* cam)
 {
-    glm::mat4 droneBodyMatrix = drone::GenerateDrone(dronePos, pitchAngle, yawAngle, rollAngle);
+    const camera::Camera* droneView = &drawn->droneCamera;
+    const glm::mat4& droneBodyMatrix = drawn->droneMatrix;
     RenderMesh(meshes["droneBody"], shaders["VertexColor"], cam, droneBodyMatrix);
 
     const glm::vec3 front{ glm::vec3(0.0f, lit::droneBodyOY + lit::droneBodyOZ, -lit::droneBodyOX / 2.0f + lit::droneBodyOZ / 2.0f) };
-    const glm::vec3 leftFrontPropellerCenter{ objects3D::RotateOY(front, lit::droneAngle) };
-    glm::mat4 modelMatrixLeftFrontPropeller = droneBodyMatrix * drone::GeneratePropeller(leftFrontPropellerCenter, leftFrontPropellerAngle);
-    RenderMesh(meshes["dronePropeller"], shaders["VertexColor"], droneCamera, modelMatrixLeftFrontPropeller);
+    const glm::vec3 leftFrontPropellerCenter{ geometry3D::RotateOY(front, lit::droneAngle) };
+    glm::mat4 modelMatrixLeftFrontPropeller = droneBodyMatrix * drone::GeneratePropeller(leftFrontPropellerCenter, drawn->leftFrontPropellerAngle);
+    RenderMesh(meshes["dronePropeller"], shaders["VertexColor"], droneView, modelMatrixLeftFrontPropeller);
 
     const glm::vec3 left{ glm::vec3(-lit::droneBodyOX / 2.0f + lit::droneBodyOZ / 2.0f, lit::droneBodyOY + lit::droneBodyOZ, 0.0f) };
-    const glm::vec3 leftRearPropellerCenter{ objects3D::RotateOY(left, lit::droneAngle) };
-    glm::mat4 modelMatrixLeftRearPropeller = droneBodyMatrix * drone::GeneratePropeller(leftRearPropellerCenter, leftRearPropellerAngle);
-    RenderMesh(meshes["dronePropeller"], shaders["VertexColor"], droneCamera, modelMatrixLeftRearPropeller);
+    const glm::vec3 leftRearPropellerCenter{ geometry3D::RotateOY(left, lit::droneAngle) };
+    glm::mat4 modelMatrixLeftRearPropeller = droneBodyMatrix * drone::GeneratePropeller(leftRearPropellerCenter, drawn->leftRearPropellerAngle);
+    RenderMesh(meshes["dronePropeller"], shaders["VertexColor"], droneView, modelMatrixLeftRearPropeller);
 
     const glm::vec3 right{ glm::vec3(lit::droneBodyOX / 2.0f - lit::droneBodyOZ / 2.0f, lit::droneBodyOY + lit::droneBodyOZ, 0.0f) };
-    const glm::vec3 rightFrontPropellerCenter{ objects3D::RotateOY(right, lit::droneAngle) };
-    glm::mat4 modelMatrixFrontRearPropeller = droneBodyMatrix * drone::GeneratePropeller(rightFrontPropellerCenter, rightFrontPropellerAngle);
-    RenderMesh(meshes["dronePropeller"], shaders["VertexColor"], droneCamera, modelMatrixFrontRearPropeller);
+    const glm::vec3 rightFrontPropellerCenter{ geometry3D::RotateOY(right, lit::droneAngle) };
+    glm::mat4 modelMatrixFrontRearPropeller = droneBodyMatrix * drone::GeneratePropeller(rightFrontPropellerCenter, drawn->rightFrontPropellerAngle);
+    RenderMesh(meshes["dronePropeller"], shaders["VertexColor"], droneView, modelMatrixFrontRearPropeller);
 
     const glm::vec3 back{ glm::vec3(0.0f, lit::droneBodyOY + lit::droneBodyOZ, lit::droneBodyOX / 2.0f - lit::droneBodyOZ / 2.0f) };
-    const glm::vec3 rightRearPropellerCenter{ objects3D::RotateOY(back, lit::droneAngle) };
-    glm::mat4 modelMatrixRightRearPropeller = droneBodyMatrix * drone::GeneratePropeller(rightRearPropellerCenter, rightRearPropellerAngle);
-    RenderMesh(meshes["dronePropeller"], shaders["VertexColor"], droneCamera, modelMatrixRightRearPropeller);
+    const glm::vec3 rightRearPropellerCenter{ geometry3D::RotateOY(back, lit::droneAngle) };
+    glm::mat4 modelMatrixRightRearPropeller = droneBodyMatrix * drone::GeneratePropeller(rightRearPropellerCenter, drawn->rightRearPropellerAngle);
+    RenderMesh(meshes["dronePropeller"], shaders["VertexColor"], droneView, modelMatrixRightRearPropeller);
 }
 
-void DroneChallenge::RenderObstacles(camera::Camera* cam)
+void DroneChallenge::RenderObstacle(const Obstacle& obstacleInfo, const camera::Camera* cam)
 {
-    for (const auto& obstacleInfo : treesAndHouses) {
-        switch (obstacleInfo.type) {
+    switch (obstacleInfo.type) {
 
-        case ObstacleType::TREE:
-            RenderMesh(meshes["treeTrunk"], shaders["VertexColor"], cam, obstacle::GenerateTree(obstacleInfo).first);
-            RenderMesh(meshes["treeCrown"], shaders["VertexColor"], cam, obstacle::GenerateTree(obstacleInfo).second);
-            break;
+    case ObstacleType::TREE:
+        RenderMesh(meshes["treeTrunk"], shaders["VertexColor"], cam, obstacle::GenerateTree(obstacleInfo).first);
+        RenderMesh(meshes["treeCrown"], shaders["VertexColor"], cam, obstacle::GenerateTree(obstacleInfo).second);
+        break;
 
-        case ObstacleType::HOUSE:
-            RenderMesh(meshes["houseBody"], shaders["VertexColor"], cam, obstacle::GenerateHouse(obstacleInfo));
-            RenderMesh(meshes["houseRoof"], shaders["VertexColor"], cam, obstacle::GenerateHouse(obstacleInfo));
-            break;
+    case ObstacleType::HOUSE:
+        RenderMesh(meshes["houseBody"], shaders["VertexColor"], cam, obstacle::GenerateHouse(obstacleInfo));
+        RenderMesh(meshes["houseRoof"], shaders["VertexColor"], cam, obstacle::GenerateHouse(obstacleInfo));
+        break;
 
-        default:
-            break;
+    default:
+        break;
+    }
+}
+
+void DroneChallenge::RenderObstacles(const camera::Camera* cam)
+{
+    const std::vector<Obstacle>& treesAndHouses = drawn->obstacles->treesAndHouses;
+
+    if (useGpuCulling && obstacleCuller && obstacleCuller->IsReady()) {
+        glEnable(GL_CULL_FACE);
+        obstacleCuller->Render(shaders["ObstacleCull"], shaders["ObstacleIndirect"], cam->GetViewMatrix(), cam->GetProjectionMatrix());
+        return;
+    }
+
+    /* The minimap is orthographic, so it keeps the full meshes */
+    if (cam == miniMapCamera || !impostors || !impostors->IsReady()) {
+        for (const auto& obstacleInfo : treesAndHouses) {
+            RenderObstacle(obstacleInfo, cam);
         }
+        return;
     }
+
+    impostors->Classify(treesAndHouses, cam->position, nearObstacles);
+    for (const Obstacle* obstacleInfo : nearObstacles) {
+        RenderObstacle(*obstacleInfo, cam);
+    }
+
+    glDisable(GL_CULL_FACE);
+    impostors->Render(shaders["Impostor"], cam->GetViewMatrix(), cam->GetProjectionMatrix(), cam->position);
 }
 
-void DroneChallenge::RenderPackages(camera::Camera* cam)
+void DroneChallenge::RenderPackages(const camera::Camera* cam)
 {
-    if (!pickupTime) {
-        RenderMesh(meshes["package"], shaders["VertexColor"], cam, drone::GenerateDrone(dronePos, pitchAngle, yawAngle, rollAngle) *
+    const std::vector<Obstacle>& packagesAndZone = drawn->obstacles->packagesAndZone;
+
+    if (!drawn->pickupTime) {
+        RenderMesh(meshes["package"], shaders["VertexColor"], cam, drawn->droneMatrix *
             transforms3D::Translate(0.0f, -lit::packageSide, 0.0f));
 
-        RenderMesh(meshes["deliveryZone"], shaders["VertexColor"], cam, obstacle::GenerateZone(packagesAndZone[zoneIndex]));
-        RenderMesh(meshes["indicator"], shaders["VertexColor"], droneCamera,
-            drone::GenerateIndicator(dronePos, packagesAndZone[zoneIndex].position));
+        RenderMesh(meshes["deliveryZone"], shaders["VertexColor"], cam, obstacle::GenerateZone(packagesAndZone[drawn->zoneIndex]));
+        RenderMesh(meshes["indicator"], shaders["VertexColor"], &drawn->droneCamera,
+            drone::GenerateIndicator(drawn->dronePos, packagesAndZone[drawn->zoneIndex].position));
 
     } else {
-        RenderMesh(meshes["package"], shaders["VertexColor"], cam, obstacle::GeneratePackage(packagesAndZone[packageIndex]));
+        RenderMesh(meshes["package"], shaders["VertexColor"], cam, obstacle::GeneratePackage(packagesAndZone[drawn->packageIndex]));
     }
 }
 
-void DroneChallenge::RenderScene(float deltaTimeSeconds, camera::Camera* cam)
+void DroneChallenge::RenderScene(float deltaTimeSeconds, const camera::Camera* cam)
 {   
-    RenderMesh(meshes["field"], shaders["FieldShader"], cam, glm::mat4(1));
+    PROFILE_ZONE("RenderScene");
+    PROFILE_GPU_ZONE("RenderScene");
+
+    const std::vector<Obstacle>& packagesAndZone = drawn->obstacles->packagesAndZone;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, drawn->obstacles->heightField->GetTexture());
+    RenderMesh(meshes["field"], cam == miniMapCamera ? miniMapFieldShader : fieldShader, cam, glm::mat4(1));
+    glBindTexture(GL_TEXTURE_2D, 0);
     RenderObstacles(cam);
 
     RenderDrone(deltaTimeSeconds, cam);
-    glm::vec3 targetPos{ glm::vec3(packagesAndZone[arrowIndex].position.x, 1.0f, packagesAndZone[arrowIndex].position.y) };
+    glm::vec3 targetPos{ glm::vec3(packagesAndZone[drawn->arrowIndex].position.x, 1.0f, packagesAndZone[drawn->arrowIndex].position.y) };
 
-    RenderMesh(meshes["arrow"], shaders["VertexColor"], droneCamera, drone::GenerateArrow(dronePos, targetPos));
+    RenderMesh(meshes["arrow"], shaders["VertexColor"], &drawn->droneCamera, drone::GenerateArrow(drawn->dronePos, targetPos));
     RenderPackages(cam);
 }
 
-void DroneChallenge::RenderMinimap(float deltaTimeSeconds, camera::Camera* cam)
+void DroneChallenge::RenderMinimap(float deltaTimeSeconds, const camera::Camera* cam)
 {
+    PROFILE_ZONE("RenderMinimap");
+    PROFILE_GPU_ZONE("RenderMinimap");
+
     glClear(GL_DEPTH_BUFFER_BIT);
 
-    glm::ivec2 resolution = window->GetResolution();
+    glm::ivec2 resolution = GetFrameResolution();
     float miniMapSize = resolution.y * 0.3f;
 
     glViewport(
@@ -243,19 +810,104 @@ void DroneChallenge::RenderMinimap(float deltaTimeSeconds, camera::Camera* cam)
     RenderScene(deltaTimeSeconds, cam);
 }
 
-void DroneChallenge::Update(float deltaTimeSeconds)
+void DroneChallenge::Simulate(float deltaTimeSeconds)
 {
     leftFrontPropellerAngle -= RADIANS(2880.0f) * deltaTimeSeconds;
     leftRearPropellerAngle += RADIANS(2880.0f) * deltaTimeSeconds;
     rightFrontPropellerAngle += RADIANS(2880.0f) * deltaTimeSeconds;
     rightRearPropellerAngle -= RADIANS(2880.0f) * deltaTimeSeconds;
 
-    RenderScene(deltaTimeSeconds, droneCamera);
+    if (useSensors) {
+        ScanSensors();
+    }
+
+    PublishSnapshot();
+}
+
+void DroneChallenge::Update(float deltaTimeSeconds)
+{
+    if (fleetSize > 0) {
+        RenderFleetViews(deltaTimeSeconds);
+    }
+
+    RenderScene(deltaTimeSeconds, &drawn->droneCamera);
+    RenderGroundCover(deltaTimeSeconds);
+    RenderParticles(deltaTimeSeconds);
     RenderMinimap(deltaTimeSeconds, miniMapCamera);
 }
 
 void DroneChallenge::FrameEnd()
 {
+    glDisable(GL_CULL_FACE);
+
+    if (showHud) {
+        RenderHud();
+    }
+}
+
+void DroneChallenge::RenderHud()
+{
+    /* The counters of the frame before, this one is still being drawn */
+    RenderStats::FrameTimes times = RenderStats::GetFrameTimes();
+    const RenderStats::Counters& last = RenderStats::GetLastFrame();
+    RenderStats::Counters average = RenderStats::GetAverage();
+
+    char lines[8][160];
+    int numLines = 3;
+    snprintf(lines[0], sizeof(lines[0]), "%.0f FPS  frame %.2f ms avg  %.2f min  %.2f max  %.2f p99",
+        times.average > 0.0 ? 1000.0 / times.average : 0.0, times.average, times.min, times.max, times.p99);
+    snprintf(lines[1], sizeof(lines[1]), "draws %u  triangles %llu  programs %u  uniforms %u  buffers %llu KB",
+        last.drawCalls, last.triangles, last.programBinds, last.uniformUploads, last.bufferBytes / 1024);
+    snprintf(lines[2], sizeof(lines[2]), "avg of %u frames: draws %u  triangles %llu  buffers %llu KB",
+        times.numFrames, average.drawCalls, average.triangles, average.bufferBytes / 1024);
+
+    /* The latency is measured when the frames are paced, see FramePacer */
+    if (GetFramePacer()) {
+        snprintf(lines[numLines++], sizeof(lines[0]), "%s", GetFramePacer()->ToString().c_str());
+    }
+
+    /* Nothing is read back from the GPU dust, the dead particles are dropped when drawn */
+    int length = gpuDust
+        ? snprintf(lines[numLines], sizeof(lines[0]), "dust %u stepped on the GPU", gpuDust->GetCapacity())
+        : snprintf(lines[numLines], sizeof(lines[0]), "dust %u drawn  step %.2f ms", dustVisible, dustStepMilliseconds);
+    if (showWeather) {
+        length += snprintf(lines[numLines] + length, sizeof(lines[0]) - length, "  weather %u/%u drawn  step %.2f ms",
+            weatherVisible, weather->GetCapacity(), weatherStepMilliseconds);
+    }
+    snprintf(lines[numLines++] + length, sizeof(lines[0]) - length, "  streamed %llu KB",
+        StreamBuffer::GetStats().bytesLastFrame / 1024);
+
+    /* The clumps drawn after the GPU culling are read back a few frames late */
+    if (showGroundCover) {
+        length = snprintf(lines[numLines], sizeof(lines[0]), "ground cover %u tiles  %u clumps tested",
+            groundCover->GetNumTiles(), groundCover->GetNumCandidates());
+        if (useGpuCulling && groundCover->IsComputeReady()) {
+            snprintf(lines[numLines] + length, sizeof(lines[0]) - length, "  %u drawn", groundCover->GetNumCulledClumps());
+        }
+        numLines++;
+    }
+
+    /* A Restart gives the last field back before the new one takes its place */
+    GeometryPool::Stats pool = geometryPool->GetStats();
+    snprintf(lines[numLines++], sizeof(lines[0]), "pool %u meshes  vertices %u/%u  indices %u/%u  %u free blocks",
+        pool.numRanges, pool.usedVertices, pool.maxVertices, pool.usedIndices, pool.maxIndices, pool.freeBlocks);
+
+    if (fleetSize > 0) {
+        snprintf(lines[numLines++], sizeof(lines[0]), "fleet %d views of %dx%d  %.0f frames/s  %.0f read back/s  %u dropped",
+            fleetSize, lit::fleetViewWidth, lit::fleetViewHeight, fleetFrameRate, fleetReadRate,
+            fleetViews->GetDroppedReadbacks());
+    }
+
+    glm::ivec2 resolution = GetFrameResolution();
+    glViewport(0, 0, resolution.x, resolution.y);
+    glDisable(GL_DEPTH_TEST);
+
+    for (int i = 0; i < numLines; i++) {
+        hud->AddText(lines[i], 10.0f, 10.0f + 20.0f * i, 1.0f, glm::vec3(1.0f, 1.0f, 0.6f));
+    }
+    hud->Flush();
+
+    glEnable(GL_DEPTH_TEST);
 }
 
 void DroneChallenge::AngleMovement(glm::vec3& newPos, float deltaTime)
@@ -398,6 +1050,10 @@ void DroneChallenge::AngleMovement(glm::vec3& newPos, float deltaTime)
 
 void DroneChallenge::OnInputUpdate(float deltaTime, int mods)
 {
+    PROFILE_ZONE("OnInputUpdate");
+
+    const std::vector<Obstacle>& packagesAndZone = obstacles->packagesAndZone;
+
     glm::vec3 newPos = dronePos;
     AngleMovement(newPos, deltaTime);
 
@@ -414,11 +1070,11 @@ void DroneChallenge::OnInputUpdate(float deltaTime, int mods)
     }
 
     // Field
-    if (drone::isDroneCollidingWithField(newPos, xoyTiltLvl, fieldSeed, packageStatus)) {
+    if (drone::isDroneCollidingWithField(newPos, xoyTiltLvl, *obstacles->heightField, packageStatus)) {
         return;
     }
 
-    for (const auto& obs : treesAndHouses) {
+    for (const auto& obs : obstacles->treesAndHouses) {
         if (obs.type == ObstacleType::TREE) {
             // TreeTrunk
             if (drone::isDroneCollidingWithCones(newPos, glm::vec3(obs.position.x, lit::treeTrunkHeight * obs.scaleFactor, obs.position.y), xoyTiltLvl, packageStatus)) {
@@ -455,12 +1111,63 @@ void DroneChallenge::OnKeyPress(int key, int mods)
         Restart();
     }
 
+    /* The switches of what is drawn belong to the render thread */
+    if (key == GLFW_KEY_G && obstacleCuller) {
+        RunOnRenderThread([this]() {
+            useGpuCulling = !useGpuCulling;
+            std::cout << "GPU culling " << (useGpuCulling ? "on" : "off") << "\n";
+        });
+    }
+
+    if (key == GLFW_KEY_V && fleetViews) {
+        RunOnRenderThread([this]() {
+            fleetSize = fleetSize == 0 ? 16 : (fleetSize < lit::fleetMaxViews ? 4 * fleetSize : 0);
+            fleetReportTime = 0.0f;
+            fleetFrames = 0;
+            fleetFramesRead = 0;
+            fleetFrameRate = 0.0f;
+            fleetReadRate = 0.0f;
+            std::cout << "Fleet views " << (fleetSize ? std::to_string(fleetSize) : "off") << "\n";
+        });
+    }
+
+    if (key == GLFW_KEY_H) {
+        RunOnRenderThread([this]() { showHud = !showHud; });
+    }
+
+    if (key == GLFW_KEY_C && groundCover) {
+        RunOnRenderThread([this]() {
+            showGroundCover = !showGroundCover;
+            std::cout << "Ground cover " << (showGroundCover ? "on" : "off") << "\n";
+        });
+    }
+
+    if (key == GLFW_KEY_N && weather) {
+        RunOnRenderThread([this]() {
+            if (!showWeather) {
+                weather->SetKind(particles::RAIN);
+                showWeather = true;
+            } else if (weather->GetKind() == particles::RAIN) {
+                weather->SetKind(particles::SNOW);
+            } else {
+                showWeather = false;
+            }
+            std::cout << "Weather " << (showWeather ? (weather->GetKind() == particles::RAIN ? "rain" : "snow") : "off") << "\n";
+        });
+    }
+
+    if (key == GLFW_KEY_L) {
+        useSensors = !useSensors;
+        std::cout << "Sensors " << (useSensors ? "on" : "off") << "\n";
+    }
+
     if (key == GLFW_KEY_SPACE && packageStatus == PackageStatus::COLLIDING) {
         pickupTime = false;
         packageStatus = PackageStatus::ATTACHED;
-        arrowIndex -= lit::numOfZones;
+        arrowIndex -= scale::Get().GetNumOfZones();
     }
     
+    const std::vector<Obstacle>& packagesAndZone = obstacles->packagesAndZone;
     glm::vec3 zonePos{ glm::vec3(packagesAndZone[zoneIndex].position.x, 1.0f, packagesAndZone[zoneIndex].position.y) };
     if (key == GLFW_KEY_SPACE && packageStatus == PackageStatus::ATTACHED && drone::isDroneInTheZone(dronePos, zonePos)) {
         pickupTime = true;
@@ -469,11 +1176,11 @@ void DroneChallenge::OnKeyPress(int key, int mods)
         packageIndex++;
         zoneIndex++;
 
-        arrowIndex += (lit::numOfZones + 1);
+        arrowIndex += (scale::Get().GetNumOfZones() + 1);
 
-        std::cout << "You delivered " << zoneIndex << " package(s) out of " << lit::numOfZones << "!\n";
+        std::cout << "You delivered " << zoneIndex << " package(s) out of " << scale::Get().GetNumOfZones() << "!\n";
 
-        if (zoneIndex == lit::numOfZones) {
+        if (zoneIndex == scale::Get().GetNumOfZones()) {
             std::cout << "Good Job! Game is restarting...\n";
             Restart();
         }
@@ -2,6 +2,7 @@
 #define DRONE_H
 
 #include "transforms3D.h"
+#include "heightfield.h"
 #include "utils/glm_utils.h"
 
 #include <cmath>
@@ -35,19 +36,6 @@ namespace drone
 		return transforms3D::Translate(zonePos.x, 5.0f, zonePos.y) * transforms3D::RotateOY(angle);
 	}
 
-	inline float fieldNoise(glm::vec2 pos, float seed) {
-		glm::vec2 i = glm::floor(pos);
-		glm::vec2 j = glm::fract(pos);
-
-		float a = glm::fract(sin(glm::dot(i, glm::vec2(12.9898f, 78.233f))) * 43758.5453123f + seed);
-		float b = glm::fract(sin(glm::dot(i + glm::vec2(1.0f, 0.0f), glm::vec2(12.9898f, 78.233f))) * 43758.5453123f + seed);
-		float c = glm::fract(sin(glm::dot(i + glm::vec2(0.0f, 1.0f), glm::vec2(12.9898f, 78.233f))) * 43758.5453123f + seed);
-		float d = glm::fract(sin(glm::dot(i + glm::vec2(1.0f, 1.0f), glm::vec2(12.9898f, 78.233f))) * 43758.5453123f + seed);
-
-		glm::vec2 u = j * j * (3.0f - 2.0f * j);
-		return glm::mix(a, b, u.x) + (c - a) * u.y * (1.0f - u.x) + (d - b) * u.x * u.y;
-	}
-
 	inline std::vector<float> DroneAABB(glm::vec3 droneCenter, int xoyTiltLvl, m1::PackageStatus status) {
 		float distToEdge = (lit::droneBodyOX - lit::droneBodyOZ + lit::propellerOX) / 2.0f;
 
@@ -183,30 +171,26 @@ namespace drone
 		return intersectsXOZ && intersectsY;
 	}
 
-	inline bool isDroneCollidingWithField(glm::vec3 droneCenter, int xoyTiltLvl, float fieldSeed, m1::PackageStatus status)
+	inline bool isDroneCollidingWithField(glm::vec3 droneCenter, int xoyTiltLvl, const heightfield::HeightField& field, m1::PackageStatus status)
 	{
 		std::vector<float> droneAABB = DroneAABB(droneCenter, xoyTiltLvl, status);
 		float minXDrone = droneAABB[0], maxXDrone = droneAABB[1];
 		float minYDrone = droneAABB[2];
 		float minZDrone = droneAABB[4], maxZDrone = droneAABB[5];
 
-		bool withinFieldXOZ = (minXDrone >= -lit::fieldX / 2.0f && maxXDrone <= lit::fieldX / 2.0f &&
-			minZDrone >= -lit::fieldZ / 2.0f && maxZDrone <= lit::fieldZ / 2.0f);
+		/* The height field covers the whole field */
+		glm::vec2 fieldMin = field.GetPoint(0, 0);
+		glm::vec2 fieldMax = field.GetPoint(field.GetWidth() - 1, field.GetDepth() - 1);
+
+		bool withinFieldXOZ = (minXDrone >= fieldMin.x && maxXDrone <= fieldMax.x &&
+			minZDrone >= fieldMin.y && maxZDrone <= fieldMax.y);
 
 		if (!withinFieldXOZ) {
 			return true;
 		}
 
-		float y1{ fieldNoise(glm::vec2(minXDrone, minZDrone) * 5.0f, fieldSeed) };
-		float y2{ fieldNoise(glm::vec2(minXDrone, maxZDrone) * 5.0f, fieldSeed) };
-		
-		float y3{ fieldNoise(glm::vec2(maxXDrone, minZDrone) * 5.0f, fieldSeed) };
-		float y4{ fieldNoise(glm::vec2(maxXDrone, maxZDrone) * 5.0f, fieldSeed) };
-
-		float center{ fieldNoise(glm::vec2(droneCenter.x, droneCenter.y) * 5.0f, fieldSeed) };
-		float maxYField{ std::max(center, std::max(y1, std::max(y2, std::max(y3, y4))))};
-
-		return minYDrone < maxYField;
+		/* The whole footprint of the drone is tested, not only its corners */
+		return field.GetPyramid().Intersects(glm::vec2(minXDrone, minZDrone), glm::vec2(maxXDrone, maxZDrone), minYDrone);
 	}
 
 	inline bool isDroneInTheZone(glm::vec3 droneCenter, glm::vec3 deliveryZoneCenter)
@@ -3,6 +3,57 @@
 
 #include "camera.h"
 #include "components/simple_scene.h"
+#include "components/text_renderer.h"
+#include "core/triple_buffer.h"
+
+#include <memory>
+
+namespace impostor
+{
+    class ImpostorRenderer;
+}
+
+namespace culling
+{
+    class ObstacleCuller;
+}
+
+namespace heightfield
+{
+    class HeightField;
+}
+
+namespace workers
+{
+    class WorkerPool;
+}
+
+namespace raycast
+{
+    class RayCaster;
+}
+
+namespace sensor
+{
+    class LidarSensor;
+}
+
+namespace multiview
+{
+    class MultiViewRenderer;
+}
+
+namespace particles
+{
+    class ParticleSystem;
+    class ParticleRenderer;
+    class GpuDust;
+}
+
+namespace groundcover
+{
+    class GroundCover;
+}
 
 namespace m1
 {
@@ -29,6 +80,49 @@ namespace m1
         }
     };
 
+    // The obstacles, the packages and the field of one game. Restart builds a new
+    // set instead of changing the one being drawn, which the render thread uploads
+    // the first time it draws it. The sets are deleted on the render thread, their
+    // field owns a texture.
+    struct ObstacleSet {
+        ObstacleSet();
+        ~ObstacleSet();
+
+        std::vector<Obstacle> treesAndHouses;
+        std::vector<Obstacle> packagesAndZone;
+
+        float fieldSeed;
+        heightfield::HeightField *heightField;
+
+        unsigned int version;
+    };
+
+    // What the render thread draws of a simulation step, published by Simulate
+    struct DroneSnapshot {
+        DroneSnapshot();
+
+        glm::vec3 dronePos;
+        glm::mat4 droneMatrix;
+
+        float rightFrontPropellerAngle;
+        float rightRearPropellerAngle;
+        float leftFrontPropellerAngle;
+        float leftRearPropellerAngle;
+
+        // Third person camera behind the drone
+        camera::Camera droneCamera;
+
+        PackageStatus packageStatus;
+        bool pickupTime;
+        int zoneIndex;
+        int packageIndex;
+        int arrowIndex;
+
+        // Changes with every Restart, the set is uploaded again
+        unsigned int obstacleVersion;
+        std::shared_ptr<ObstacleSet> obstacles;
+    };
+
     class DroneChallenge : public gfxc::SimpleScene
     {
      public:
@@ -38,6 +132,11 @@ namespace m1
         void Init() override;
 
      private:
+        // The observers and Simulate run the game, the frame methods only draw the
+        // last snapshot, so they can be on the render thread
+        void Simulate(float deltaTimeSeconds) override;
+        bool SupportsRenderThread() const override { return true; }
+
         void FrameStart() override;
         void Update(float deltaTimeSeconds) override;
         void FrameEnd() override;
@@ -52,23 +151,55 @@ namespace m1
         void OnWindowResize(int width, int height) override;
 
         void Restart();
+        std::shared_ptr<ObstacleSet> CreateObstacleSet();
+        void BakeField(ObstacleSet& set);
+        void UploadObstacles(ObstacleSet& set);
+        void UploadField(const ObstacleSet& set);
+        void PublishSnapshot();
+        void ScanSensors();
+        void RenderFleetViews(float deltaTimeSeconds);
+        void RenderParticles(float deltaTimeSeconds);
+        void RenderGroundCover(float deltaTimeSeconds);
+        void RenderHud();
         void AngleMovement(glm::vec3& newPos, float deltaTime);
 
-        void RenderMesh(Mesh* mesh, Shader* shader, camera::Camera* cam, const glm::mat4& modelMatrix) const;
-        void RenderDrone(float deltaTimeSeconds, camera::Camera* cam);
+        void RenderMesh(Mesh* mesh, Shader* shader, const camera::Camera* cam, const glm::mat4& modelMatrix) const;
+        void RenderDrone(float deltaTimeSeconds, const camera::Camera* cam);
 
-        void RenderObstacles(camera::Camera* cam);
-        void RenderPackages(camera::Camera* cam);
+        void RenderObstacle(const Obstacle& obstacleInfo, const camera::Camera* cam);
+        void RenderObstacles(const camera::Camera* cam);
+        void RenderPackages(const camera::Camera* cam);
 
-        void RenderScene(float deltaTimeSeconds, camera::Camera* cam);
-        void RenderMinimap(float deltaTimeSeconds, camera::Camera* cam);
+        void RenderScene(float deltaTimeSeconds, const camera::Camera* cam);
+        void RenderMinimap(float deltaTimeSeconds, const camera::Camera* cam);
 
      protected:
         camera::Camera *droneCamera;
         camera::Camera *miniMapCamera;
 
-        std::vector<Obstacle> treesAndHouses;
-        std::vector<Obstacle> packagesAndZone;
+        // Variants of FieldShader for the main view and the minimap
+        Shader *fieldShader;
+        Shader *miniMapFieldShader;
+
+        GeometryPool *geometryPool;
+
+        // The set of the game being simulated, the one drawn is in the snapshot
+        std::shared_ptr<ObstacleSet> obstacles;
+
+        // Written by Simulate and read by FrameStart, the snapshot being drawn stays
+        // valid until the next FrameStart
+        TripleBuffer<DroneSnapshot> snapshots;
+        const DroneSnapshot *drawn;
+        unsigned int uploadedVersion;
+
+        // The set whose heights the field mesh has
+        unsigned int fieldVersion;
+
+        impostor::ImpostorRenderer *impostors;
+        std::vector<const Obstacle*> nearObstacles;
+
+        culling::ObstacleCuller *obstacleCuller;
+        bool useGpuCulling;
 
         float rightFrontPropellerAngle;
         float rightRearPropellerAngle;
@@ -78,9 +209,48 @@ namespace m1
         glm::vec3 dronePos;
         int xoyTiltLvl;
 
-        float fieldSeed;
         PackageStatus packageStatus;
 
+        // Simulated range sensors on the drone, L toggles them
+        workers::WorkerPool *workerPool;
+        raycast::RayCaster *rayCaster;
+        sensor::LidarSensor *lidar;
+        sensor::LidarSensor *altimeter;
+        bool useSensors;
+
+        // Forward cameras of a simulated fleet, V cycles through the fleet sizes
+        multiview::MultiViewRenderer *fleetViews;
+        Shader *fleetFieldShader;
+        int fleetSize;
+        float fleetReportTime;
+        unsigned int fleetFrames;
+        unsigned int fleetFramesRead;
+        // Rates over the last second, shown on the HUD
+        float fleetFrameRate;
+        float fleetReadRate;
+
+        // Rotor wash dust, always on, and the weather, N cycles rain, snow and none
+        particles::ParticleRenderer *particleRenderer;
+        particles::ParticleSystem *dust;
+        particles::ParticleSystem *weather;
+        // Replaces `dust` with a 4.3 context, stepped by a compute shader
+        particles::GpuDust *gpuDust;
+        bool showWeather;
+        // Read between the Wait and the Simulate of each system, shown on the HUD
+        unsigned int dustVisible;
+        double dustStepMilliseconds;
+        unsigned int weatherVisible;
+        double weatherStepMilliseconds;
+
+        // Grass over the field, denser around the delivery zones, C toggles it
+        groundcover::GroundCover *groundCover;
+        Shader *groundCoverCulledShader;
+        bool showGroundCover;
+
+        // Frame times and draw counters of the last frames, H toggles it
+        gfxc::TextRenderer *hud;
+        bool showHud;
+
         float pitchAngle;
         float yawAngle;
         float rollAngle;
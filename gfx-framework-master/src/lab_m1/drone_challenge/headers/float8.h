@@ -0,0 +1,108 @@
+#ifndef FLOAT8_H
+#define FLOAT8_H
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOAT8_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace simd
+{
+	/* Eight floats processed together, as two SSE registers when SSE2 is available
+	and as a plain array otherwise. Comparisons return masks with all bits set in
+	the lanes where they hold, which Select, Any and the bitwise operators take. */
+	struct Float8
+	{
+#ifdef FLOAT8_SSE2
+		__m128 lo, hi;
+
+		Float8() {}
+		Float8(__m128 lo, __m128 hi) : lo(lo), hi(hi) {}
+		Float8(float value) : lo(_mm_set1_ps(value)), hi(_mm_set1_ps(value)) {}
+
+		static Float8 Load(const float* data) { return Float8(_mm_loadu_ps(data), _mm_loadu_ps(data + 4)); }
+		void Store(float* data) const { _mm_storeu_ps(data, lo); _mm_storeu_ps(data + 4, hi); }
+#else
+		float v[8];
+
+		Float8() {}
+		Float8(float value) { for (int i = 0; i < 8; i++) v[i] = value; }
+
+		static Float8 Load(const float* data) { Float8 r; memcpy(r.v, data, sizeof(r.v)); return r; }
+		void Store(float* data) const { memcpy(data, v, sizeof(v)); }
+#endif
+	};
+
+#ifdef FLOAT8_SSE2
+#define FLOAT8_BINARY(name, intrinsic) \
+	inline Float8 name(const Float8& a, const Float8& b) { return Float8(intrinsic(a.lo, b.lo), intrinsic(a.hi, b.hi)); }
+
+	FLOAT8_BINARY(operator+, _mm_add_ps)
+	FLOAT8_BINARY(operator-, _mm_sub_ps)
+	FLOAT8_BINARY(operator*, _mm_mul_ps)
+	FLOAT8_BINARY(operator/, _mm_div_ps)
+	FLOAT8_BINARY(Min, _mm_min_ps)
+	FLOAT8_BINARY(Max, _mm_max_ps)
+	FLOAT8_BINARY(operator<, _mm_cmplt_ps)
+	FLOAT8_BINARY(operator<=, _mm_cmple_ps)
+	FLOAT8_BINARY(operator>, _mm_cmpgt_ps)
+	FLOAT8_BINARY(operator>=, _mm_cmpge_ps)
+	FLOAT8_BINARY(operator&, _mm_and_ps)
+	FLOAT8_BINARY(operator|, _mm_or_ps)
+	FLOAT8_BINARY(AndNot, _mm_andnot_ps)
+#undef FLOAT8_BINARY
+
+	inline Float8 Sqrt(const Float8& a) { return Float8(_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi)); }
+
+	/* Lanes of `a` where the mask is set, lanes of `b` elsewhere */
+	inline Float8 Select(const Float8& mask, const Float8& a, const Float8& b)
+	{
+		return Float8(_mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)),
+			_mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi)));
+	}
+
+	/* One bit per lane, lane 0 in the lowest bit */
+	inline int MoveMask(const Float8& mask) { return _mm_movemask_ps(mask.lo) | (_mm_movemask_ps(mask.hi) << 4); }
+#else
+#define FLOAT8_BINARY(name, expression) \
+	inline Float8 name(const Float8& a, const Float8& b) { Float8 r; for (int i = 0; i < 8; i++) { float x = a.v[i], y = b.v[i]; r.v[i] = (expression); } return r; }
+
+	inline float MaskValue(bool value) { unsigned int bits = value ? 0xFFFFFFFFu : 0u; float f; memcpy(&f, &bits, sizeof(f)); return f; }
+	inline unsigned int Bits(float value) { unsigned int bits; memcpy(&bits, &value, sizeof(bits)); return bits; }
+	inline float FromBits(unsigned int bits) { float f; memcpy(&f, &bits, sizeof(f)); return f; }
+
+	FLOAT8_BINARY(operator+, x + y)
+	FLOAT8_BINARY(operator-, x - y)
+	FLOAT8_BINARY(operator*, x * y)
+	FLOAT8_BINARY(operator/, x / y)
+	FLOAT8_BINARY(Min, y < x ? y : x)
+	FLOAT8_BINARY(Max, y > x ? y : x)
+	FLOAT8_BINARY(operator<, MaskValue(x < y))
+	FLOAT8_BINARY(operator<=, MaskValue(x <= y))
+	FLOAT8_BINARY(operator>, MaskValue(x > y))
+	FLOAT8_BINARY(operator>=, MaskValue(x >= y))
+	FLOAT8_BINARY(operator&, FromBits(Bits(x) & Bits(y)))
+	FLOAT8_BINARY(operator|, FromBits(Bits(x) | Bits(y)))
+	FLOAT8_BINARY(AndNot, FromBits(~Bits(x) & Bits(y)))
+#undef FLOAT8_BINARY
+
+	inline Float8 Sqrt(const Float8& a) { Float8 r; for (int i = 0; i < 8; i++) r.v[i] = std::sqrt(a.v[i]); return r; }
+
+	inline Float8 Select(const Float8& mask, const Float8& a, const Float8& b)
+	{
+		return (mask & a) | AndNot(mask, b);
+	}
+
+	inline int MoveMask(const Float8& mask) { int bits = 0; for (int i = 0; i < 8; i++) bits |= (Bits(mask.v[i]) >> 31) << i; return bits; }
+#endif
+
+	inline bool Any(const Float8& mask) { return MoveMask(mask) != 0; }
+
+	inline Float8 Infinity() { return Float8(std::numeric_limits<float>::infinity()); }
+}
+
+#endif // !FLOAT8_H
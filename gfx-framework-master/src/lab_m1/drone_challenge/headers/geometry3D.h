@@ -0,0 +1,102 @@
+﻿#ifndef GEOMETRY3D_H
+#define GEOMETRY3D_H
+
+#include "literals.h"
+
+#include "core/gpu/vertex_format.h"
+#include "utils/glm_utils.h"
+
+#include <cmath>
+#include <vector>
+
+namespace geometry3D
+{
+	/* Vertices and indices of a mesh, built on the CPU only. objects3D uploads them. */
+	struct Geometry
+	{
+		std::vector<VertexFormat> vertices;
+		std::vector<unsigned int> indices;
+	};
+
+	/* The field is made by a symmetric rectangle of cells.x by cells.y cells. The heights,
+	when given, are the y of the (cells.x + 1) * (cells.y + 1) vertices, row by row. */
+	Geometry CreateField(glm::vec3 startVertex, glm::vec2 size, glm::ivec2 cells, const float* heights = nullptr);
+
+	/* The tree trunk is made by a cylinder. */
+	Geometry CreateTreeTrunk(glm::vec3 baseCenter, glm::vec3 color, int circlePoints);
+
+	/* The tree crown is made by 3 objects, two cone trunks and one cone. */
+	Geometry CreateTreeCrown(glm::vec3 baseCenter, glm::vec3 color, int circlePoints);
+
+	/* The drone body is made by 2 parallelepipeds in a X form and 4 cubes on the margins */
+	Geometry CreateDroneBody(glm::vec3 baseCenter, glm::vec3 color);
+
+	/* The drone propellers are parallelepipeds on the cubes */
+	Geometry CreateDronePropeller(glm::vec3 baseCenter, glm::vec3 color);
+
+	/* The house body obstacle is made by a cube. */
+	Geometry CreateCube(const float side, glm::vec3 color);
+
+	/* The house roof is made by a prism. */
+	Geometry CreateHouseRoof(glm::vec3 color);
+
+	/* The delivery zone, the outline is drawn as a line loop when it is not filled. */
+	Geometry CreateSquare(glm::vec3 center, float length, glm::vec3 color, bool fill);
+
+	/* The arrow path*/
+	Geometry CreateArrow(glm::vec3 center, glm::vec3 color);
+
+	/* Zone indicator */
+	Geometry CreateTriangle(glm::vec3 center, glm::vec3 color);
+
+	inline glm::vec3 RotateOY(glm::vec3 point, float angle) {
+		return { glm::vec3(point.x * cos(angle) + point.z * sin(angle),
+			point.y,
+			-point.x * sin(angle) + point.z * cos(angle)) };
+	}
+
+	/* The vertices for the parallelepiped */
+	inline std::vector<VertexFormat> ParallelepipedVertices(const float length, const float height,
+		const float width, glm::vec3 center, glm::vec3 color) {
+
+		std::vector<glm::vec3> vertices = {
+			{center.x - length, center.y + 0.0f, center.z + width},
+			{center.x + length, center.y + 0.0f, center.z + width},
+			{center.x - length, center.y + height, center.z + width},
+			{center.x + length, center.y + height, center.z + width},
+
+			{center.x - length, center.y + 0.0f, center.z - width},
+			{center.x + length, center.y + 0.0f, center.z - width},
+			{center.x - length, center.y + height, center.z - width},
+			{center.x + length, center.y + height, center.z - width},
+		};
+
+		std::vector<VertexFormat> rotatedVertices;
+		for (const auto& vertex : vertices) {
+			glm::vec3 rotatedPosition = RotateOY(vertex, lit::droneAngle);
+			rotatedVertices.push_back({ rotatedPosition, color });
+		}
+
+		return rotatedVertices;
+	}
+
+	/* The indices for the parallelepiped */
+	inline std::vector<unsigned int> ParallelepipedIndices(unsigned int index) {
+		return {
+			index, index + 1, index + 2,
+			index + 1, index + 3, index + 2,
+			index + 2, index + 3, index + 7,
+			index + 2, index + 7, index + 6,
+			index + 1, index + 7, index + 3,
+			index + 1, index + 5, index + 7,
+			index + 6, index + 7, index + 4,
+			index + 7, index + 5, index + 4,
+			index + 0, index + 4, index + 1,
+			index + 1, index + 4, index + 5,
+			index + 2, index + 6, index + 4,
+			index + 0, index + 2, index + 4,
+		};
+	}
+}
+
+#endif // !GEOMETRY3D_H
@@ -0,0 +1,88 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include "drone_challenge.h"
+
+#include "core/gpu/mesh.h"
+#include "core/gpu/shader.h"
+#include "core/gpu/ssbo.h"
+#include "utils/glm_utils.h"
+
+#include <vector>
+
+namespace culling
+{
+	/* Layout expected by glMultiDrawElementsIndirect */
+	struct DrawElementsIndirectCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	/* Left, right, bottom, top, near and far planes as (normal, distance), normals pointing inside. */
+	inline void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+	{
+		glm::vec4 rowX{ viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0] };
+		glm::vec4 rowY{ viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1] };
+		glm::vec4 rowZ{ viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2] };
+		glm::vec4 rowW{ viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3] };
+
+		planes[0] = rowW + rowX;
+		planes[1] = rowW - rowX;
+		planes[2] = rowW + rowY;
+		planes[3] = rowW - rowY;
+		planes[4] = rowW + rowZ;
+		planes[5] = rowW - rowZ;
+
+		for (int i = 0; i < 6; ++i) {
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+		}
+	}
+
+	/* OpenGL 4.3 path: the obstacles live on the GPU, a compute shader culls them against
+	the frustum and fills the indirect commands, and one multi-draw renders every part. */
+	class ObstacleCuller
+	{
+	 public:
+		ObstacleCuller();
+		~ObstacleCuller();
+
+		/* Needs a 4.3 context and the four meshes allocated in the same geometry pool. */
+		static bool IsSupported();
+		void Init(Mesh* treeTrunk, Mesh* treeCrown, Mesh* houseBody, Mesh* houseRoof);
+
+		/* Uploads all the instances, called only when the obstacles change. */
+		void SetObstacles(const std::vector<m1::Obstacle>& obstacles);
+
+		/* Culls and draws with a constant number of GL calls, whatever the obstacle count. */
+		void Render(Shader* cullShader, Shader* drawShader, const glm::mat4& view, const glm::mat4& projection);
+
+		bool IsReady() const { return VAO != 0; }
+
+	 private:
+		void ResetCommands();
+
+	 private:
+		/* trunk, crown, house body, house roof */
+		static const int numParts = 4;
+		DrawElementsIndirectCommand commands[numParts];
+
+		unsigned int numInstances;
+		unsigned int capacity;
+
+		/* (x, z, scale factor, obstacle type) */
+		SSBO<glm::vec4>* instances;
+
+		/* (x, z, scale factor, part), numParts ranges of capacity entries each */
+		SSBO<glm::vec4>* visible;
+		SSBO<DrawElementsIndirectCommand>* indirect;
+
+		/* Reads the pool buffers, plus the per-instance attribute */
+		GLuint VAO;
+		GLenum indexType;
+	};
+}
+
+#endif // !GPU_CULLING_H
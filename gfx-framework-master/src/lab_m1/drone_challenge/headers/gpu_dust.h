@@ -0,0 +1,50 @@
+#ifndef GPU_DUST_H
+#define GPU_DUST_H
+
+#include "particles.h"
+
+#include "core/gpu/particle_effect.h"
+#include "core/gpu/shader.h"
+#include "utils/glm_utils.h"
+
+namespace particles
+{
+	/* Layout of a particle in DustInit.CS and DustStep.CS, three vec4 as std430 packs them */
+	struct DustParticle {
+		/* Position, and the age over the lifetime while alive, 1 when dead */
+		glm::vec4 position;
+
+		/* Velocity, and the age */
+		glm::vec4 velocity;
+
+		/* Fixed random value, the direction it is blown in, and the lifetime */
+		glm::vec4 random;
+	};
+
+	/* The rotor wash dust of ParticleSystem, kept in a storage buffer and stepped by a
+	compute shader. The particle shader reads the buffer as its instances, the dead ones
+	are dropped in the vertex shader, so nothing comes back to the CPU and the number
+	drawn is not known. Needs a 4.3 context, without one the dust stays on the CPU. */
+	class GpuDust
+	{
+	 public:
+		GpuDust();
+
+		/* Every particle starts dead, written by the init shader from `seed` */
+		void Init(unsigned int capacity, Shader* initShader, unsigned int seed);
+
+		/* Queues a step, the next draw of the buffer waits for it */
+		void Simulate(Shader* stepShader, float deltaTime, const Environment& environment);
+
+		GLuint GetBufferID() const { return effect.GetParticleBuffer()->GetBufferID(); }
+		unsigned int GetCapacity() const { return effect.GetSize(); }
+
+	 private:
+		ParticleEffect<DustParticle> effect;
+
+		float dustGround;
+		float spin;
+	};
+}
+
+#endif // !GPU_DUST_H
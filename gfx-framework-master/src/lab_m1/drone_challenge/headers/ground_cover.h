@@ -0,0 +1,110 @@
+#ifndef GROUND_COVER_H
+#define GROUND_COVER_H
+
+#include "gpu_culling.h"
+#include "heightfield.h"
+
+#include "core/gpu/shader.h"
+#include "core/gpu/ssbo.h"
+#include "core/gpu/stream_buffer.h"
+#include "core/gpu/texture2D.h"
+#include "utils/glm_utils.h"
+
+#include <string>
+#include <vector>
+
+namespace groundcover
+{
+	/* Layout expected by glDrawArraysIndirect */
+	struct DrawArraysIndirectCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint first;
+		GLuint baseInstance;
+	};
+
+	/* What the clumps are placed from, the same every frame until the field changes */
+	struct Placement {
+		const heightfield::HeightField* field;
+		float seed;
+
+		/* Centers of the dense patches, the delivery zones */
+		std::vector<glm::vec2> densePoints;
+	};
+
+	/* Grass billboards over the field, placed procedurally: the field is cut into tiles,
+	and clump k of tile (x, z) gets its position, angle and size from a hash of x, z, k
+	and the field seed, with its height from the baked field texture. Nothing is stored
+	per clump. Clump k only exists where the density is above (k + 0.5) / clumps per
+	tile, so a tile whose density fades with the distance draws a prefix of its clumps.
+
+	The tiles in the frustum are picked on the CPU with the density bound of each one.
+	Without compute shaders every tile is drawn instanced, the tiles grouped by the power
+	of two above their clump count, and the vertex shader drops the clumps that fail the
+	density test. With a 4.3 context a compute shader tests every clump against the
+	density and the frustum and appends the survivors, which one indirect draw renders. */
+	class GroundCover
+	{
+	 public:
+		GroundCover();
+		~GroundCover();
+
+		/* Loads the billboard from the texture directory of the framework. The culled
+		path is only set up when `useCompute` is true. */
+		void Init(const std::string& textureDir, bool useCompute, glm::vec2 fieldSize);
+
+		/* `drawShader` is GroundCover, `culledShader` its CULLED variant. `time` moves the tips in the wind. */
+		void Render(const Placement& placement, Shader* drawShader, Shader* culledShader, Shader* cullShader,
+			bool useCompute, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eyePosition, float time);
+
+		unsigned int GetNumTiles() const { return (unsigned int)tiles.size(); }
+
+		/* Clumps given to the vertex or the compute shader in the last Render */
+		unsigned int GetNumCandidates() const { return numCandidates; }
+
+		/* Clumps that passed the compute culling a few frames ago, 0 on the instanced path */
+		unsigned int GetNumCulledClumps() const { return numCulledClumps; }
+
+		bool IsComputeReady() const { return indirect != nullptr; }
+
+	 private:
+		/* Tiles in the frustum, (tile x, tile z, clumps to test, unused), grouped by bucket */
+		void SelectTiles(const Placement& placement, const glm::mat4& viewProjection, const glm::vec3& eyePosition);
+
+		/* Placement and density uniforms, shared by the instanced draw and the compute culling */
+		void SetPlacementUniforms(Shader* shader, const Placement& placement, const glm::vec3& eyePosition) const;
+
+		/* View, height texture and billboard uniforms of the draws */
+		void SetDrawUniforms(Shader* shader, const Placement& placement, const glm::mat4& view,
+			const glm::mat4& projection, const glm::vec3& eyePosition, float time) const;
+
+		void RenderInstanced(Shader* shader, const StreamBuffer::Allocation& allocation);
+		void RenderCulled(Shader* cullShader, Shader* drawShader, const StreamBuffer::Allocation& allocation,
+			const glm::mat4& viewProjection);
+
+	 private:
+		struct Bucket {
+			unsigned int clumps;
+			unsigned int firstTile;
+			unsigned int numTiles;
+		};
+
+		Texture2D* billboard;
+
+		GLuint VAO;
+		StreamBuffer* stream;
+
+		std::vector<glm::vec4> tiles;
+		std::vector<Bucket> buckets;
+		unsigned int numCandidates;
+
+		/* Compute path, the tiles are bound as a storage buffer from the stream buffer */
+		GLint storageAlignment;
+		GLuint culledVAO;
+		SSBO<glm::vec4>* visible;
+		SSBO<DrawArraysIndirectCommand>* indirect;
+		unsigned int numCulledClumps;
+	};
+}
+
+#endif // !GROUND_COVER_H
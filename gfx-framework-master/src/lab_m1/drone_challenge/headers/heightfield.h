@@ -0,0 +1,131 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include "utils/gl_utils.h"
+#include "utils/glm_utils.h"
+
+#include <vector>
+
+namespace heightfield
+{
+	/* Value noise hash at an integer lattice point, the same as random() in VertexShader.glsl */
+	float LatticeValue(glm::vec2 point, float seed);
+
+	class HeightField;
+
+	/* Min/max heights of the field cells, halved level after level like mipmaps. The
+	bilinear surface of a cell stays between its corner heights, so every node bounds
+	the terrain over the cells below it. */
+	class HeightPyramid
+	{
+	 public:
+		HeightPyramid();
+
+		void Build(const HeightField& field);
+
+		/* Upper bound of the terrain over the XZ rectangle, from at most 2x2 nodes of the
+		first level where the rectangle spans two nodes or less. O(log n), never too low. */
+		float GetMaxHeight(glm::vec2 rectMin, glm::vec2 rectMax) const;
+
+		/* Exact maximum of the terrain over the XZ rectangle. Descends only into the
+		nodes that can still raise the current maximum. */
+		float GetExactMaxHeight(glm::vec2 rectMin, glm::vec2 rectMax) const;
+
+		/* Whether the terrain rises above `height` somewhere inside the XZ rectangle.
+		The conservative bound rejects most queries before the exact descent. */
+		bool Intersects(glm::vec2 rectMin, glm::vec2 rectMax, float height) const;
+
+		/* Lower bound of the terrain, for altitude above ground estimates */
+		float GetMinHeight(glm::vec2 rectMin, glm::vec2 rectMax) const;
+
+		int GetNumLevels() const { return (int)levels.size(); }
+
+		/* Level 0 has the field cells. Node (x, z) of level l covers the cells from
+		x << l to (x + 1) << l, clipped to the field, and the same along z. */
+		int GetLevelWidth(int level) const { return levels[level].width; }
+		int GetLevelDepth(int level) const { return levels[level].depth; }
+
+		/* (min, max) height under a node */
+		glm::vec2 GetNode(int level, int x, int z) const { return levels[level].nodes[(size_t)z * levels[level].width + x]; }
+
+	 private:
+		struct Level {
+			int width;
+			int depth;
+
+			/* (min, max) of every node */
+			std::vector<glm::vec2> nodes;
+		};
+
+		/* Cells covered by the rectangle, false when it misses the field */
+		bool CellRange(glm::vec2 rectMin, glm::vec2 rectMax, glm::ivec2& first, glm::ivec2& last) const;
+		glm::vec2 GetBounds(glm::vec2 rectMin, glm::vec2 rectMax) const;
+
+		float DescendMax(int level, int x, int z, glm::ivec2 first, glm::ivec2 last,
+			glm::vec2 rectMin, glm::vec2 rectMax, float best, float stopAbove) const;
+
+	 private:
+		const HeightField* field;
+		std::vector<Level> levels;
+	};
+
+	/* Heights of the field on a regular grid, baked once per seed. The field vertex
+	shader reads them from the texture and the collisions from the CPU copy, so the
+	terrain that is drawn is the one the drone collides with. */
+	class HeightField
+	{
+	 public:
+		HeightField();
+		~HeightField();
+
+		/* Evaluates the noise at width x depth points spread over [min, max], corners included.
+		The rows are split between the hardware threads and computed 4 samples at a time. */
+		void Bake(float seed, float frequency, glm::vec2 min, glm::vec2 max, int width, int depth);
+
+		/* Copies the heights to the R32F texture, created on the first call */
+		void Upload();
+
+		/* Bilinear height at a world XZ position, clamped to the baked area */
+		float Sample(float x, float z) const;
+
+		/* Bounds of the terrain over XZ rectangles, rebuilt by every Bake */
+		const HeightPyramid& GetPyramid() const { return pyramid; }
+
+		/* World XZ of a grid point */
+		glm::vec2 GetPoint(int x, int z) const { return min + step * glm::vec2(x, z); }
+		glm::vec2 GetSpacing() const { return step; }
+
+		/* Maps world XZ to texture coordinates: uv = xz * transform.xy + transform.zw */
+		glm::vec4 GetTextureTransform() const;
+		GLuint GetTexture() const { return texture; }
+
+		int GetWidth() const { return width; }
+		int GetDepth() const { return depth; }
+		const std::vector<float>& GetHeights() const { return heights; }
+
+		void PrintStats() const;
+
+	 private:
+		void BakeRows(const std::vector<float>& lattice, int latticeWidth, glm::ivec2 latticeMin,
+			float frequency, int firstRow, int lastRow);
+
+	 private:
+		std::vector<float> heights;
+		int width;
+		int depth;
+
+		glm::vec2 min;
+		glm::vec2 step;
+
+		HeightPyramid pyramid;
+
+		GLuint texture;
+		int textureWidth;
+		int textureDepth;
+
+		unsigned int bakeThreads;
+		double bakeMilliseconds;
+	};
+}
+
+#endif // !HEIGHTFIELD_H
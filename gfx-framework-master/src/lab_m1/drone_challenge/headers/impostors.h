@@ -0,0 +1,107 @@
+#ifndef IMPOSTORS_H
+#define IMPOSTORS_H
+
+#include "drone_challenge.h"
+#include "literals.h"
+
+#include "core/gpu/mesh.h"
+#include "core/gpu/shader.h"
+#include "core/gpu/texture2D.h"
+#include "utils/glm_utils.h"
+
+#include <string>
+#include <vector>
+
+namespace impostor
+{
+	/* One baked object: a tree or a house at a fixed scale factor. */
+	struct Archetype {
+		m1::ObstacleType type;
+		float scaleFactor;
+
+		/* Bounding sphere of the object, centered on its vertical axis. */
+		float centerY;
+		float radius;
+	};
+
+	/* Hemi-octahedral mapping of the upper view hemisphere onto [0, 1]^2.
+	The camera never goes under the field, so the lower half is not baked. */
+	inline glm::vec2 EncodeHemiOct(glm::vec3 dir)
+	{
+		dir.y = std::max(dir.y, 0.0f);
+		dir /= (std::abs(dir.x) + std::abs(dir.y) + std::abs(dir.z));
+
+		glm::vec2 oct{ dir.x + dir.z, dir.z - dir.x };
+		return oct * 0.5f + 0.5f;
+	}
+
+	inline glm::vec3 DecodeHemiOct(glm::vec2 uv)
+	{
+		glm::vec2 oct = uv * 2.0f - 1.0f;
+		glm::vec2 xz{ (oct.x - oct.y) * 0.5f, (oct.x + oct.y) * 0.5f };
+
+		return glm::normalize(glm::vec3(xz.x, 1.0f - std::abs(xz.x) - std::abs(xz.y), xz.y));
+	}
+
+	/* Right and up vectors of the plane facing the given view direction. */
+	inline void FrameBasis(glm::vec3 dir, glm::vec3& right, glm::vec3& up)
+	{
+		glm::vec3 side = glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), dir);
+		if (glm::dot(side, side) < 1e-6f) {
+			side = glm::vec3(1.0f, 0.0f, 0.0f);
+		}
+
+		right = glm::normalize(side);
+		up = glm::cross(dir, right);
+	}
+
+	/* The archetypes baked into the atlas, trees first and houses after them. */
+	std::vector<Archetype> CreateArchetypes();
+
+	/* Index of the archetype that best approximates the obstacle. */
+	int ArchetypeIndex(const std::vector<Archetype>& archetypes, const m1::Obstacle& obs);
+
+	class ImpostorRenderer
+	{
+	 public:
+		ImpostorRenderer();
+		~ImpostorRenderer();
+
+		/* Loads the atlas from the cache file or bakes it with offscreen renders and caches it. */
+		void Init(const std::string& cacheFile, Shader* bakeShader, Mesh* treeTrunk, Mesh* treeCrown,
+			Mesh* houseBody, Mesh* houseRoof);
+
+		/* Splits the obstacles into the ones drawn as meshes and the far ones drawn as quads. */
+		void Classify(const std::vector<m1::Obstacle>& obstacles, glm::vec3 eye, std::vector<const m1::Obstacle*>& nearObstacles);
+
+		/* Draws every far obstacle of the last Classify() with one instanced call. */
+		void Render(Shader* shader, const glm::mat4& view, const glm::mat4& projection, glm::vec3 eye) const;
+
+		bool IsReady() const { return atlas != nullptr; }
+		unsigned int GetNumFar() const { return (unsigned int)farInstances.size(); }
+
+	 private:
+		std::string CacheKey() const;
+		bool LoadCache(const std::string& cacheFile, std::vector<unsigned char>& pixels) const;
+		void SaveCache(const std::string& cacheFile, const std::vector<unsigned char>& pixels) const;
+
+		void Bake(Shader* bakeShader, Mesh* treeTrunk, Mesh* treeCrown, Mesh* houseBody, Mesh* houseRoof,
+			std::vector<unsigned char>& pixels) const;
+
+	 private:
+		std::vector<Archetype> archetypes;
+		Texture2D* atlas;
+
+		int atlasWidth;
+		int atlasHeight;
+
+		/* (x, z, archetype index, unused) for every far obstacle */
+		std::vector<glm::vec4> farInstances;
+
+		GLuint VAO;
+		GLuint quadVBO;
+		GLuint instanceVBO;
+	};
+}
+
+#endif // !IMPOSTORS_H
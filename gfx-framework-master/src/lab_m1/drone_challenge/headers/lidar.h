@@ -0,0 +1,67 @@
+#ifndef LIDAR_H
+#define LIDAR_H
+
+#include "raycast.h"
+#include "worker_pool.h"
+
+#include "utils/glm_utils.h"
+
+#include <vector>
+
+namespace sensor
+{
+	/* Beams on a grid of `rows` pitch angles by `columns` yaw angles, in the frame of
+	the drone: forward is -Z and up is +Y, like the camera that follows it */
+	struct LidarConfig {
+		int columns;
+		int rows;
+
+		/* Centered on forward, 360 degrees for a full turn */
+		float horizontalFov;
+		float minPitch;
+		float maxPitch;
+
+		float maxRange;
+		glm::vec3 mountOffset;
+
+		/* Spinning multi-beam sensor on top of the body */
+		static LidarConfig Sweep();
+
+		/* A single beam straight down, for the height above whatever is below */
+		static LidarConfig Altimeter();
+	};
+
+	class LidarSensor
+	{
+	 public:
+		explicit LidarSensor(const LidarConfig& config);
+
+		/* Casts every beam from the drone pose, as given by drone::GenerateDrone */
+		void Scan(const raycast::RayCaster& caster, const glm::mat4& pose, workers::WorkerPool* pool = nullptr);
+
+		/* Range image, rows from the lowest pitch, maxRange where nothing was hit */
+		const std::vector<float>& GetRanges() const { return ranges; }
+		const std::vector<raycast::RayHit>& GetHits() const { return hits; }
+		float GetRange(int row, int column) const { return ranges[(size_t)row * config.columns + column]; }
+
+		float GetMinRange() const;
+		const LidarConfig& GetConfig() const { return config; }
+
+		int GetNumBeams() const { return (int)directions.size(); }
+		double GetScanMilliseconds() const { return scanMilliseconds; }
+
+	 private:
+		LidarConfig config;
+
+		/* Beams in the sensor frame, computed once */
+		std::vector<glm::vec3> directions;
+
+		std::vector<raycast::Ray> rays;
+		std::vector<raycast::RayHit> hits;
+		std::vector<float> ranges;
+
+		double scanMilliseconds;
+	};
+}
+
+#endif // !LIDAR_H
@@ -5,34 +5,29 @@
 
 namespace lit
 {
-	// dimensions
-	constexpr int circlePoints{ 30 };
-	constexpr int numOfObstacles{ 35 };
+	// dimensions, the field size, the counts and the camera planes are in scale::WorldScale
 
-	constexpr int numOfPackages{ 3 };
-	constexpr int numOfZones{ numOfPackages };
+	// the objects are sized after the original field, they keep their size when it grows
+	constexpr int baseField{ 50 };
 
-	constexpr int fieldX{ 50 };
-	constexpr int fieldZ{ 50 };
-
-	constexpr float droneBodyOX{ fieldX / 30.0f };
+	constexpr float droneBodyOX{ baseField / 30.0f };
 	constexpr float droneBodyOY{ 0.15f };
-	constexpr float droneBodyOZ{ fieldZ / 400.0f };
+	constexpr float droneBodyOZ{ baseField / 400.0f };
 
-	constexpr float propellerOX{ fieldX / 100.0f };
+	constexpr float propellerOX{ baseField / 100.0f };
 	constexpr float propellerOY{ 0.05f };
-	constexpr float propellerOZ{ fieldZ / 850.0f };
+	constexpr float propellerOZ{ baseField / 850.0f };
 
 	constexpr float treeTrunkHeight{ 2.0f };
-	constexpr float treeTrunkRadius{ fieldX / 125.0f };
+	constexpr float treeTrunkRadius{ baseField / 125.0f };
 
 	constexpr float treeCrownHeight{ 3.0f };
-	constexpr float treeCrownRadius{ fieldX / 45.0f };
+	constexpr float treeCrownRadius{ baseField / 45.0f };
 
 	constexpr float roofHeight{ 1.25f };
-	constexpr float houseSide{ fieldX / 25.0f };
+	constexpr float houseSide{ baseField / 25.0f };
 
-	constexpr float packageSide{ fieldX / 100.0f };
+	constexpr float packageSide{ baseField / 100.0f };
 	constexpr float squareSide{ 4.0f * packageSide };
 
 	constexpr float maxObsHeight{ lit::treeTrunkHeight * 1.5f + lit::treeCrownHeight };
@@ -41,17 +36,62 @@ namespace lit
 	constexpr float sphereRadius{ (droneBodyOX + propellerOX - droneBodyOZ) / 2.0f };
 
 	constexpr float fov{ RADIANS(60.0f) };
-	constexpr float near{ 0.01f };
-	constexpr float far{ 200.0f };
-
-	constexpr float zNear{ 0.1f };
-	constexpr float zFar{ 100.0f };
 
 	constexpr float arrowHeight{ 2.5f };
 
 	constexpr float indicatorHeight{ 1.5f };
 	constexpr float indicatorBase{ 1.0f };
 
+	// terrain
+	constexpr float fieldNoiseFrequency{ 5.0f };
+	constexpr int heightSamplesPerUnit{ 4 };
+
+	// bound on large fields, the cells of the field per side. The mesh has a vertex on
+	// every height sample, so past it the samples are further apart than 1 / heightSamplesPerUnit
+	constexpr int maxFieldCells{ 1024 };
+
+	// sensors
+	constexpr int lidarColumns{ 1024 };
+	constexpr int lidarRows{ 16 };
+	constexpr float lidarPitch{ RADIANS(15.0f) };
+	constexpr float lidarRange{ 60.0f };
+
+	// fleet views
+	constexpr int fleetViewWidth{ 160 };
+	constexpr int fleetViewHeight{ 120 };
+	constexpr int fleetMaxViews{ 256 };
+	constexpr int readbackSlots{ 3 };
+
+	// particles
+	constexpr unsigned int weatherParticles{ 1 << 18 };
+	constexpr unsigned int dustParticles{ 1 << 14 };
+	constexpr float weatherRadius{ 25.0f };
+	constexpr float weatherHeight{ 15.0f };
+	constexpr float rainSpeed{ 12.0f };
+	constexpr float snowSpeed{ 1.5f };
+	constexpr glm::vec3 weatherWind{ glm::vec3(1.5f, 0.0f, 0.5f) };
+	constexpr float washAltitude{ 4.0f };
+	constexpr float washRadius{ 1.5f };
+
+	// ground cover
+	constexpr float grassTileSize{ 2.0f };
+	constexpr int grassClumpsPerTile{ 512 };
+	constexpr float grassClumpHeight{ 0.35f };
+	constexpr float grassBaseDensity{ 0.3f };
+	constexpr float grassDenseRadius{ 6.0f };
+	constexpr float grassFadeStart{ 8.0f };
+	constexpr float grassFadeEnd{ 35.0f };
+	constexpr int grassMaxDensePoints{ 8 };
+
+	// impostors
+	constexpr int impostorFrames{ 8 };
+	constexpr int impostorTileSize{ 64 };
+	constexpr float impostorDistance{ 30.0f };
+
+	// shared geometry
+	constexpr unsigned int poolVertices{ 1 << 16 };
+	constexpr unsigned int poolIndices{ 1 << 19 };
+
 	// colors
 	constexpr glm::vec3 origin{ glm::vec3(0.0f, 0.0f, 0.0f) };
 	constexpr glm::vec3 green{ glm::vec3(0.0f, 0.75f, 0.0f) };
@@ -0,0 +1,119 @@
+#ifndef MULTIVIEW_H
+#define MULTIVIEW_H
+
+#include "drone_challenge.h"
+#include "heightfield.h"
+
+#include "core/gpu/frame_buffer.h"
+#include "core/gpu/mesh.h"
+#include "core/gpu/shader.h"
+#include "utils/glm_utils.h"
+
+#include <functional>
+#include <vector>
+
+namespace multiview
+{
+	/* The views of one Render, as read back from the GPU */
+	struct Frame {
+		/* Number of the Render call that drew it */
+		unsigned int id;
+
+		int width;
+		int height;
+		int views;
+
+		/* RGBA8, one width x height image per view, rows from the bottom. Only valid
+		during the consumer call. */
+		const unsigned char* pixels;
+	};
+
+	/* Renders the field and the obstacles from many cameras at once, each into its own
+	layer of a GL_TEXTURE_2D_ARRAY framebuffer. Every mesh is drawn once for all the views,
+	instanced per view, and a geometry shader routes the triangles with gl_Layer. */
+	class MultiViewRenderer
+	{
+	 public:
+		MultiViewRenderer();
+		~MultiViewRenderer();
+
+		/* The meshes must be allocated in the same geometry pool */
+		void Init(Mesh* treeTrunk, Mesh* treeCrown, Mesh* houseBody, Mesh* houseRoof,
+			int width, int height, int maxViews);
+
+		/* The field is rebuilt with every obstacle set. It is only drawn when it is in
+		the pool of the obstacles, a large one has buffers of its own. */
+		void SetField(const Mesh* field);
+
+		/* Uploads one (x, z, scale factor, part) instance per obstacle part, the format
+		ObstacleIndirect.VS.glsl reads, grouped by part */
+		void SetObstacles(const std::vector<m1::Obstacle>& obstacles);
+
+		/* Draws every view with 5 instanced draws, whatever the number of views. Leaves
+		the framebuffer bound, like FrameBuffer::Bind. */
+		void Render(const std::vector<glm::mat4>& viewProjections, Shader* fieldShader, Shader* obstacleShader,
+			const heightfield::HeightField& field);
+
+		/* Starts copying the views of the last Render to a pixel buffer. Returns false and
+		drops the frame when every buffer of the ring is still in flight. */
+		bool RequestReadback();
+
+		/* Gives the copies the GPU has finished to the consumer, oldest first, and never
+		waits for the ones still running */
+		void PollReadbacks();
+
+		void SetConsumer(std::function<void(const Frame&)> consumer) { this->consumer = consumer; }
+
+		FrameBuffer* GetFrameBuffer() const { return frameBuffer; }
+		int GetMaxViews() const { return maxViews; }
+		unsigned int GetDroppedReadbacks() const { return droppedReadbacks; }
+
+	 private:
+		struct Readback {
+			GLuint buffer;
+			GLsync fence;
+			unsigned int id;
+			int views;
+		};
+
+		void DrawMesh(const Mesh* mesh, GLsizei instances) const;
+
+	 private:
+		/* trunk, crown, house body, house roof, the part ids of ObstacleIndirect.VS.glsl */
+		static const int numParts = 4;
+
+		FrameBuffer* frameBuffer;
+		int width;
+		int height;
+		int maxViews;
+
+		GeometryPool* pool;
+		const Mesh* fieldMesh;
+		const Mesh* parts[numParts];
+		GLenum indexType;
+
+		/* Reads the pool buffers, plus the per-instance attribute */
+		GLuint VAO;
+		GLuint instanceBuffer;
+		unsigned int partFirst[numParts];
+		unsigned int partCount[numParts];
+
+		/* View-projection matrices, read by the vertex shader as a buffer texture */
+		GLuint viewBuffer;
+		GLuint viewTexture;
+
+		unsigned int frameId;
+		int renderedViews;
+
+		/* Oldest pending copy first */
+		GLuint readFramebuffer;
+		std::vector<Readback> readbacks;
+		unsigned int nextReadback;
+		unsigned int pendingReadbacks;
+		unsigned int droppedReadbacks;
+
+		std::function<void(const Frame&)> consumer;
+	};
+}
+
+#endif // !MULTIVIEW_H
@@ -3,6 +3,7 @@
 
 #include "drone_challenge.h"
 #include "transforms3D.h"
+#include "world_scale.h"
 
 #include "utils/glm_utils.h"
 
@@ -46,7 +47,9 @@ namespace obstacle
 		return transforms3D::Translate(zoneInfo.position.x, 1.0f, zoneInfo.position.y);
 	}
 
-	std::vector<m1::Obstacle> GeneratePositionsAndSizes(int numOfObstacles, std::vector<m1::Obstacle>& packagesAndZone);
+	/* Spreads world.numOfObstacles places over the field, one per area of a grid. The deliveries take
+	some of them and are appended to packagesAndZone, the zones first and then their packages. */
+	std::vector<m1::Obstacle> GeneratePositionsAndSizes(const scale::WorldScale& world, std::vector<m1::Obstacle>& packagesAndZone);
 }
 
 #endif // !OBSTACLE_H
@@ -0,0 +1,148 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "core/gpu/shader.h"
+#include "core/gpu/stream_buffer.h"
+#include "core/gpu/texture2D.h"
+#include "utils/glm_utils.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace particles
+{
+	enum Kind {
+		/* Kicked up from the ground by the rotors when the drone flies low */
+		DUST,
+		RAIN,
+		SNOW
+	};
+
+	class GpuDust;
+
+	/* What the particles react to, gathered on the main thread every frame */
+	struct Environment {
+		glm::vec3 camera;
+
+		/* Particles outside the frustum are simulated but not drawn */
+		glm::mat4 viewProjection;
+		glm::vec3 wind;
+
+		/* Lowest point of the terrain, the weather is recycled below it */
+		float groundHeight;
+
+		/* Ground point under the drone and how hard the rotors blow on it, 0 when too high */
+		glm::vec3 washCenter;
+		float washStrength;
+	};
+
+	/* Particles kept as separate float arrays, stepped 8 at a time with simd::Float8 on a
+	thread of their own. The step of frame N runs while frame N is drawn from the output
+	of frame N - 1, so the main thread only waits when a step takes longer than a frame.
+
+	The weather fills a box that follows the camera: the particles that leave it on one
+	side come back on the other, and the ones that fall out of the bottom start again at
+	the top. The dust lives for a second or two and is only emitted while the drone is
+	close to the ground. */
+	class ParticleSystem
+	{
+	 public:
+		ParticleSystem(Kind kind, unsigned int capacity);
+		~ParticleSystem();
+
+		/* Starts a step on the simulation thread and returns right away */
+		void Simulate(float deltaTime, const Environment& environment);
+
+		/* Waits for the last step. Its output stays valid until the next Simulate. */
+		void Wait();
+
+		/* Rain and snow swap in place, the particles are spread again around the camera */
+		void SetKind(Kind kind);
+		Kind GetKind() const { return kind; }
+
+		/* Position and w per particle in the frustum: the age over the lifetime for the
+		dust, a random value in [0, 1) for the weather */
+		const std::vector<glm::vec4>& GetInstances() const { return instances; }
+		unsigned int GetNumVisible() const { return numVisible; }
+		unsigned int GetCapacity() const { return capacity; }
+
+		double GetStepMilliseconds() const { return stepMilliseconds; }
+
+	 private:
+		void SimulationLoop();
+		void Step(float deltaTime, const Environment& environment);
+
+		void StepWeather(float deltaTime, const Environment& environment);
+		void StepDust(float deltaTime, const Environment& environment);
+
+		/* Spreads the weather over the box around the camera, or kills every dust particle */
+		void Respawn(const glm::vec3& camera);
+
+	 private:
+		Kind kind;
+		unsigned int capacity;
+
+		/* Structure of arrays, `capacity` rounded up to a multiple of 8 */
+		std::vector<float> positionX, positionY, positionZ;
+		std::vector<float> velocityX, velocityY, velocityZ;
+		std::vector<float> age, life;
+
+		/* Fixed per particle: random values and the direction the dust is blown in */
+		std::vector<float> seed, directionX, directionZ;
+
+		std::vector<glm::vec4> instances;
+		unsigned int numVisible;
+
+		bool respawn;
+		glm::vec3 lastCamera;
+		float dustGround;
+		float spin;
+
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable started;
+		std::condition_variable finished;
+		bool pending;
+		bool stopping;
+
+		float stepDeltaTime;
+		Environment stepEnvironment;
+		double stepMilliseconds;
+	};
+
+	/* Draws particle systems as quads facing the camera, one instanced draw per system.
+	The instances are written to a stream buffer, rain is stretched along its fall. */
+	class ParticleRenderer
+	{
+	 public:
+		ParticleRenderer();
+		~ParticleRenderer();
+
+		/* Loads the sprites from the texture directory of the framework */
+		void Init(const std::string& textureDir);
+
+		void Render(const ParticleSystem& system, Shader* shader, const glm::mat4& view,
+			const glm::mat4& projection, const glm::vec3& eyePosition, const glm::vec3& wind);
+
+		/* Draws every particle straight from the storage buffer, the dead ones included */
+		void Render(const GpuDust& dust, Shader* shader, const glm::mat4& view,
+			const glm::mat4& projection, const glm::vec3& eyePosition);
+
+	 private:
+		/* Instances read from `buffer` at `offset`, `stride` bytes apart */
+		void Draw(Kind kind, GLuint buffer, size_t offset, GLsizei stride, unsigned int count, Shader* shader,
+			const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eyePosition, const glm::vec3& wind);
+
+		GLuint VAO;
+		GLuint quadVBO;
+		StreamBuffer* stream;
+
+		/* One per Kind */
+		Texture2D* sprites[3];
+	};
+}
+
+#endif // !PARTICLES_H
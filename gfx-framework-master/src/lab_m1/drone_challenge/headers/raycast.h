@@ -0,0 +1,107 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include "drone_challenge.h"
+#include "heightfield.h"
+#include "worker_pool.h"
+
+#include "utils/glm_utils.h"
+
+#include <vector>
+
+namespace raycast
+{
+	enum HitKind {
+		NONE,
+		FIELD,
+		TRUNK,
+		CROWN,
+		HOUSE,
+		ROOF
+	};
+
+	struct Ray {
+		glm::vec3 origin;
+		/* Unit length, so the hit distances are in world units */
+		glm::vec3 direction;
+		float maxDistance;
+	};
+
+	struct RayHit {
+		/* maxDistance of the ray when nothing was hit */
+		float distance;
+		HitKind kind;
+		/* Index in the obstacles given to Build, -1 for the field */
+		int obstacle;
+	};
+
+	/* Casts rays against the terrain and the obstacles, with the same shapes the drone
+	collides with: cylinder trunks, cone crowns, box houses and pyramid roofs. Rays go
+	8 at a time through a BVH over the obstacles and a quadtree over the height pyramid. */
+	class RayCaster
+	{
+	 public:
+		RayCaster();
+
+		/* Keeps a reference to the field, which has to outlive the caster or be rebuilt with it */
+		void Build(const std::vector<m1::Obstacle>& obstacles, const heightfield::HeightField& field);
+
+		/* Splits the rays in packets of 8 and spreads them over the pool, or runs them
+		on the calling thread without one */
+		void Cast(const std::vector<Ray>& rays, std::vector<RayHit>& hits, workers::WorkerPool* pool = nullptr) const;
+
+		/* Up to 8 rays, best when they start close to each other and point the same way */
+		void CastPacket(const Ray* rays, int count, RayHit* hits) const;
+
+		RayHit Cast(const Ray& ray) const;
+
+		int GetNumShapes() const { return (int)shapes.size(); }
+		int GetNumNodes() const { return (int)nodes.size(); }
+
+		/* Marches along the ray with inside tests, which share nothing with the packets.
+		Slow, it is the reference the checks compare the casts with. */
+		RayHit CastBruteForce(const Ray& ray) const;
+
+	 private:
+		struct Shape {
+			HitKind kind;
+			int obstacle;
+
+			/* Center of the bottom face */
+			glm::vec3 base;
+			/* Radius of the cylinders and cones, half side of the boxes and pyramids */
+			float size;
+			float height;
+
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+		};
+
+		struct Node {
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+
+			/* First shape of a leaf, or the second child of an inner node. The first
+			child of an inner node is the node right after it. */
+			int index;
+			/* 0 for inner nodes */
+			int count;
+		};
+
+		struct Packet;
+
+		void AddShape(HitKind kind, int obstacle, glm::vec3 base, float size, float height);
+		int BuildNode(int first, int count);
+
+		void TraverseShapes(Packet& packet) const;
+		void TraverseField(Packet& packet) const;
+
+	 private:
+		std::vector<Shape> shapes;
+		std::vector<Node> nodes;
+
+		const heightfield::HeightField* field;
+	};
+}
+
+#endif // !RAYCAST_H
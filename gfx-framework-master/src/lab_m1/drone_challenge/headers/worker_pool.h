@@ -0,0 +1,51 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace workers
+{
+	/* Threads started once and reused by every parallel loop, so a loop that
+	runs each frame does not pay for creating threads. */
+	class WorkerPool
+	{
+	 public:
+		/* 0 uses one thread per hardware thread, the calling thread included */
+		explicit WorkerPool(unsigned int numThreads = 0);
+		~WorkerPool();
+
+		/* Calls task(begin, end) over [0, count) in chunks of at most `grain` items and
+		returns when all of them are done. The calling thread takes chunks too. */
+		void ParallelFor(unsigned int count, unsigned int grain, const std::function<void(unsigned int, unsigned int)>& task);
+
+		unsigned int GetNumThreads() const { return (unsigned int)threads.size() + 1; }
+
+	 private:
+		void WorkerLoop();
+		void RunChunks();
+
+	 private:
+		std::vector<std::thread> threads;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+
+		/* The loop being run, valid while `generation` is ahead of a worker's last one */
+		const std::function<void(unsigned int, unsigned int)>* task;
+		unsigned int count;
+		unsigned int grain;
+		std::atomic<unsigned int> next;
+
+		unsigned int generation;
+		unsigned int busyWorkers;
+		bool stopping;
+	};
+}
+
+#endif // !WORKER_POOL_H
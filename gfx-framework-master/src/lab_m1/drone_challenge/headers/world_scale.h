@@ -0,0 +1,70 @@
+#ifndef WORLD_SCALE_H
+#define WORLD_SCALE_H
+
+#include "utils/glm_utils.h"
+
+#include <string>
+
+namespace scale
+{
+	/* The size of the world, set before the game starts from a config file or the
+	command line. The defaults are the original game. The obstacles, the drone and the
+	packages keep their size in lit:: when the field grows. */
+	struct WorldScale
+	{
+		WorldScale();
+
+		int fieldX;
+		int fieldZ;
+		int numOfObstacles;
+
+		/* Every package has its delivery zone */
+		int numOfPackages;
+
+		/* Segments of the cylinders and cones */
+		int circlePoints;
+
+		/* Planes of the drone camera and of the minimap, which looks down from above */
+		float cameraNear;
+		float cameraFar;
+		float miniMapNear;
+		float miniMapFar;
+
+		int GetNumOfZones() const { return numOfPackages; }
+
+		glm::vec2 GetFieldMin() const { return glm::vec2(-fieldX / 2.0f, -fieldZ / 2.0f); }
+		glm::vec2 GetFieldMax() const { return glm::vec2(fieldX / 2.0f, fieldZ / 2.0f); }
+
+		/* Cells of the field per side, lit::heightSamplesPerUnit per unit up to
+		lit::maxFieldCells. The mesh and the height field share this grid, so every
+		vertex sits on a baked height. */
+		glm::ivec2 GetFieldCells() const;
+
+		/* Points of the height field per side, the corners of the field cells */
+		glm::ivec2 GetHeightSamples() const;
+
+		/* Clamps the values the generators cannot use and prints what it changed */
+		void Validate();
+	};
+
+	/* The scale of this run, the defaults until Set is called */
+	const WorldScale& Get();
+	void Set(const WorldScale& scale);
+
+	/* World options, also the keys of the config file without the dashes:
+	--world PATH, --field X Z, --obstacles N, --packages N, --circle-points N,
+	--camera-planes NEAR FAR and --minimap-planes NEAR FAR. Returns false when
+	argv[i] is not one of them or its values are invalid, otherwise moves i to
+	its last value. */
+	bool ParseArgument(int argc, char** argv, int& i, WorldScale& scale);
+
+	/* Reads `key values` lines with `#` comments, e.g. `field 1024 1024` */
+	bool LoadFile(const std::string& path, WorldScale& scale);
+
+	void PrintUsage();
+
+	/* One line with the values, for the logs and the reports */
+	std::string ToString(const WorldScale& scale);
+}
+
+#endif // !WORLD_SCALE_H
@@ -0,0 +1,319 @@
+﻿#include "../headers/geometry3D.h"
+
+#include <utility>
+
+geometry3D::Geometry geometry3D::CreateField(glm::vec3 startVertex, glm::vec2 size, glm::ivec2 cells, const float* heights)
+{
+	std::vector<VertexFormat> vertices;
+	vertices.reserve((size_t)(cells.x + 1) * (cells.y + 1));
+
+	/* Stores all positions in the intervals [-x, x] and [-z, z], cells.x + 1 on each row.
+	The color and vertex normals are assigned in the VertexShader */
+	glm::vec2 cellSize = size / glm::vec2(cells);
+	for (int z = 0; z <= cells.y; ++z) {
+		for (int x = 0; x <= cells.x; ++x) {
+			glm::vec2 point = -size / 2.0f + cellSize * glm::vec2(x, z);
+			float height = heights ? heights[vertices.size()] : 0.0f;
+			glm::vec3 position = startVertex + glm::vec3(point.x, height, point.y);
+			vertices.push_back(VertexFormat(position));
+		}
+	}
+
+	const unsigned int rowVertices = cells.x + 1;
+
+	std::vector<unsigned int> indices;
+	indices.reserve((size_t)cells.x * cells.y * 6);
+	for (unsigned int i = 0; i < cells.y * rowVertices; ++i) {
+		/* The vertices on the right and bottom edges are not
+		the start of a rectangle of the field. */
+		if ((i + 1) % rowVertices == 0) {
+			continue;
+		}
+
+		/* topLeft, bottomLeft, bottomRight */
+		indices.insert(indices.end(), { i, i + rowVertices, i + rowVertices + 1 });
+
+		/* topRight, topLeft, bottomRight */
+		indices.insert(indices.end(), { i + 1, i, i + rowVertices + 1 });
+	}
+
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
+
+geometry3D::Geometry geometry3D::CreateTreeTrunk(glm::vec3 baseCenter, glm::vec3 color, int circlePoints)
+{
+	const unsigned int numPoints = circlePoints;
+	std::vector<VertexFormat> vertices;
+
+	/* The two centers of the circles. */
+	vertices.push_back(VertexFormat(glm::vec3(0, 0, 0), color));
+	vertices.push_back(VertexFormat(glm::vec3(0, lit::treeTrunkHeight, 0), color));
+
+	/* The vertices of the two circles */
+	for (float h = 0.0f; h <= lit::treeTrunkHeight; h += lit::treeTrunkHeight) {
+		for (unsigned int i = 0; i < numPoints; i++) {
+			float angle = 2.0f * glm::pi<float>() * i / numPoints;
+		
+			glm::vec3 circleVertex(
+				lit::treeTrunkRadius * cos(angle),
+				h,
+				lit::treeTrunkRadius * sin(angle));
+
+			vertices.push_back(VertexFormat(circleVertex, color));
+		}
+	}
+
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < numPoints; i++) {
+		/* bottom circle */
+		indices.insert(indices.end(), { 0, 2 + i, 2 + ((i + 1) % numPoints) });
+		
+		/* top circle */
+		indices.insert(indices.end(), { 1, 2 + numPoints + ((i + 1) % numPoints), 2 + numPoints + i });
+
+		/* the triangles connecting the bases */
+		/* topLeft, bottomLeft, bottomRight */
+		indices.insert(indices.end(), { 2 + numPoints + i, 2 + i, 2 + ((i + 1) % numPoints) });
+
+		/* topRight, topLeft, bottomRight */
+		indices.insert(indices.end(), { 2 + numPoints + ((i + 1) % numPoints), 2 + numPoints + i, 2 + ((i + 1) % numPoints) });
+	}
+
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
+
+geometry3D::Geometry geometry3D::CreateTreeCrown(glm::vec3 baseCenter, glm::vec3 color, int circlePoints)
+{
+	const unsigned int numPoints = circlePoints;
+
+	std::vector<VertexFormat> vertices;
+	std::vector<unsigned int> indices;
+
+	float currentHeight = 0.0f;
+
+	/* the first two trunk cones and after them the cone */
+	for (int obj = 0; obj < 3; ++obj) {
+		unsigned int centerIndex = (unsigned int) vertices.size();
+
+		/* circle vertices */
+		for (unsigned int i = 0; i < numPoints; ++i) {
+			float angle = 2.0f * glm::pi<float>() * i / numPoints;
+
+			glm::vec3 center = baseCenter + glm::vec3(
+				lit::treeCrownRadius * cos(angle),
+				currentHeight,
+				lit::treeCrownRadius * sin(angle));
+
+			vertices.push_back(VertexFormat(center, color));
+		}
+
+		glm::vec3 apex = baseCenter + glm::vec3(0.0f, currentHeight + lit::treeCrownHeight / 1.6f, 0.0f);
+		
+		/* the apex */
+		unsigned int apexIndex = (unsigned int) vertices.size();
+		vertices.push_back(VertexFormat(apex, color));
+
+		/* the base, so the crown is closed and can be drawn with back-face culling */
+		unsigned int baseIndex = (unsigned int) vertices.size();
+		vertices.push_back(VertexFormat(baseCenter + glm::vec3(0.0f, currentHeight, 0.0f), color));
+
+		for (unsigned int i = 0; i < numPoints; ++i) {
+			indices.insert(indices.end(), { centerIndex + i, apexIndex, centerIndex + (i + 1) % numPoints});
+			indices.insert(indices.end(), { baseIndex, centerIndex + i, centerIndex + (i + 1) % numPoints });
+		}
+
+		currentHeight += lit::treeCrownHeight / 5.33f;
+	}
+
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
+
+geometry3D::Geometry geometry3D::CreateDroneBody(glm::vec3 baseCenter, glm::vec3 color)
+{
+	std::vector<VertexFormat> vertices;
+
+	/* The two parallelepipeds vertices */
+	auto firstParallVert = ParallelepipedVertices(lit::droneBodyOX / 2.0f, lit::droneBodyOY, lit::droneBodyOZ / 2.0f, baseCenter, color);
+	vertices.insert(vertices.end(), firstParallVert.begin(), firstParallVert.end());
+
+	auto secondParallVert = ParallelepipedVertices(lit::droneBodyOZ / 2.0f, lit::droneBodyOY, lit::droneBodyOX / 2.0f, baseCenter, color);
+	vertices.insert(vertices.end(), secondParallVert.begin(), secondParallVert.end());
+
+	/* The four cubes vertices */
+	glm::vec3 lowerCubeCenter = baseCenter + glm::vec3(0.0f, lit::droneBodyOY, lit::droneBodyOX / 2.0f - lit::droneBodyOZ / 2.0f);
+	auto lowerCubeVert = ParallelepipedVertices(lit::droneBodyOZ / 2.0f, lit::droneBodyOZ, lit::droneBodyOZ / 2.0f, lowerCubeCenter, color);
+	vertices.insert(vertices.end(), lowerCubeVert.begin(), lowerCubeVert.end());
+
+	glm::vec3 leftCubeCenter = baseCenter + glm::vec3(-lit::droneBodyOX / 2.0f + lit::droneBodyOZ / 2.0f, lit::droneBodyOY, 0.0f);
+	auto leftCubeVert = ParallelepipedVertices(lit::droneBodyOZ / 2.0f, lit::droneBodyOZ, lit::droneBodyOZ / 2.0f, leftCubeCenter, color);
+	vertices.insert(vertices.end(), leftCubeVert.begin(), leftCubeVert.end());
+
+	glm::vec3 upperCubeCenter = baseCenter + glm::vec3(0.0f, lit::droneBodyOY, -lit::droneBodyOX / 2.0f + lit::droneBodyOZ / 2.0f);
+	auto upperCubeVert = ParallelepipedVertices(lit::droneBodyOZ / 2.0f, lit::droneBodyOZ, lit::droneBodyOZ / 2.0f, upperCubeCenter, color);
+	vertices.insert(vertices.end(), upperCubeVert.begin(), upperCubeVert.end());
+
+	glm::vec3 rightCubeCenter = baseCenter + glm::vec3(lit::droneBodyOX / 2.0f - lit::droneBodyOZ / 2.0f, lit::droneBodyOY, 0.0f);
+	auto rightCubeVert = ParallelepipedVertices(lit::droneBodyOZ / 2.0f, lit::droneBodyOZ, lit::droneBodyOZ / 2.0f, rightCubeCenter, color);
+	vertices.insert(vertices.end(), rightCubeVert.begin(), rightCubeVert.end());
+
+	std::vector<unsigned int> indices;
+
+	/* The two parallelepipeds indices */
+	auto firstParallInd = ParallelepipedIndices(0);
+	indices.insert(indices.end(), firstParallInd.begin(), firstParallInd.end());
+
+	auto secondParallInd = ParallelepipedIndices(8);
+	indices.insert(indices.end(), secondParallInd.begin(), secondParallInd.end());
+
+	/* The four cubes indices */
+	auto lowerCubeInd = ParallelepipedIndices(16);
+	indices.insert(indices.end(), lowerCubeInd.begin(), lowerCubeInd.end());
+
+	auto leftCubeInd = ParallelepipedIndices(24);
+	indices.insert(indices.end(), leftCubeInd.begin(), leftCubeInd.end());
+
+	auto upperCubeInd = ParallelepipedIndices(32);
+	indices.insert(indices.end(), upperCubeInd.begin(), upperCubeInd.end());
+
+	auto rightCubeInd = ParallelepipedIndices(40);
+	indices.insert(indices.end(), rightCubeInd.begin(), rightCubeInd.end());
+
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
+
+geometry3D::Geometry geometry3D::CreateDronePropeller(glm::vec3 baseCenter, glm::vec3 color)
+{
+	std::vector<VertexFormat> vertices;
+
+	/* The propellers vertices */
+	auto propellerVert = ParallelepipedVertices(lit::propellerOX / 2.0f, lit::propellerOY, lit::propellerOZ / 2.0f, baseCenter, color);
+	vertices.insert(vertices.end(), propellerVert.begin(), propellerVert.end());
+
+	std::vector<unsigned int> indices;
+
+	/* The propeller indices */
+	auto propellerInd = ParallelepipedIndices(0);
+	indices.insert(indices.end(), propellerInd.begin(), propellerInd.end());
+	
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
+
+geometry3D::Geometry geometry3D::CreateCube(const float side, glm::vec3 color)
+{
+	std::vector<VertexFormat> vertices
+	{
+		VertexFormat(glm::vec3(-side / 2.0f, 0, side / 2.0f), color),
+		VertexFormat(glm::vec3(side / 2.0f, 0, side / 2.0f), color),
+		VertexFormat(glm::vec3(-side / 2.0f, side, side / 2.0f), color),
+		VertexFormat(glm::vec3(side / 2.0f, side, side / 2.0f), color),
+		VertexFormat(glm::vec3(-side / 2.0f, 0, -side / 2.0f), color),
+		VertexFormat(glm::vec3(side / 2.0f, 0, -side / 2.0f), color),
+		VertexFormat(glm::vec3(-side / 2.0f, side, -side / 2.0f), color),
+		VertexFormat(glm::vec3(side / 2.0f, side, -side / 2.0f), color),
+	};
+
+	std::vector<unsigned int> indices =
+	{
+		0, 1, 2,
+		1, 3, 2,
+		2, 3, 7,
+		2, 7, 6,
+		1, 7, 3,
+		1, 5, 7,
+		6, 7, 4,
+		7, 5, 4,
+		0, 4, 1,
+		1, 4, 5,
+		2, 6, 4,
+		0, 2, 4,
+	};
+
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
+
+geometry3D::Geometry geometry3D::CreateHouseRoof(glm::vec3 color)
+{
+	const float side = lit::houseSide;
+	const float height = lit::roofHeight;
+
+	std::vector<VertexFormat> vertices
+	{
+		VertexFormat(glm::vec3(-side / 2.0f, side, side / 2.0f), color),
+		VertexFormat(glm::vec3(side / 2.0f, side, side / 2.0f), color),
+		VertexFormat(glm::vec3(-side / 2.0f, side, -side / 2.0f), color),
+		VertexFormat(glm::vec3(side / 2.0f, side, -side / 2.0f), color),
+		VertexFormat(glm::vec3(0, side + height, 0), color) 
+	};
+
+	std::vector<unsigned int> indices =
+	{
+		0, 1, 4,
+		1, 3, 4,
+		3, 2, 4,
+		2, 0, 4,
+
+		/* the base, hidden by the house body but it closes the roof */
+		0, 2, 1,
+		1, 2, 3
+	};
+
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
+
+geometry3D::Geometry geometry3D::CreateSquare(glm::vec3 center, float length, glm::vec3 color, bool fill)
+{
+	std::vector<VertexFormat> vertices =
+	{
+		VertexFormat(center + glm::vec3(-length / 2.0f, 0.0f, -length / 2.0f), color),
+		VertexFormat(center + glm::vec3(-length / 2.0f, 0.0f, length / 2.0f), color),
+		VertexFormat(center + glm::vec3(length / 2.0f, 0.0f, length / 2.0f), color),
+		VertexFormat(center + glm::vec3(length / 2.0f, 0.0f, -length / 2.0f), color)
+	};
+
+	/* Drawn as a line loop when it is not filled */
+	std::vector<unsigned int> indices = { 0, 1, 2, 3 };
+
+	if (fill) {
+		indices.push_back(0);
+		indices.push_back(2);
+	}
+
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
+
+geometry3D::Geometry geometry3D::CreateArrow(glm::vec3 center, glm::vec3 color)
+{
+	std::vector<VertexFormat> vertices = {
+		VertexFormat(center + glm::vec3(0.0f, 0.0f, -1.0f), color),
+		VertexFormat(center + glm::vec3(-0.5f, 0.0f, 0.0f), color),
+		VertexFormat(center + glm::vec3(0.5f, 0.0f, 0.0f), color),
+
+		VertexFormat(center + glm::vec3(-0.2f, 0.0f, 0.0f), color),
+		VertexFormat(center + glm::vec3(0.2f, 0.0f, 0.0f), color),
+		VertexFormat(center + glm::vec3(-0.2f, 0.0f, 1.0f), color),
+		VertexFormat(center + glm::vec3(0.2f, 0.0f, 1.0f), color),
+	};
+
+	std::vector<unsigned int> indices = {
+		0, 1, 2,
+		3, 4, 5,
+		4, 6, 5
+	};
+
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
+
+geometry3D::Geometry geometry3D::CreateTriangle(glm::vec3 center, glm::vec3 color)
+{
+	std::vector<VertexFormat> vertices = {
+		VertexFormat(center + glm::vec3(0.0f, -lit::indicatorHeight / 2.0f, 0.0f), color),
+		VertexFormat(center + glm::vec3(-lit::indicatorBase / 2.0f, lit::indicatorHeight / 2.0f, 0.0f), color),
+		VertexFormat(center + glm::vec3(lit::indicatorBase / 2.0f, lit::indicatorHeight / 2.0f, 0.0f), color)
+	};
+
+	std::vector<unsigned int> indices = {
+		0, 1, 2 
+	};
+
+	return Geometry{ std::move(vertices), std::move(indices) };
+}
@@ -0,0 +1,177 @@
+#include "../headers/gpu_culling.h"
+#include "../headers/literals.h"
+
+#include "core/gpu/render_stats.h"
+#include "utils/memory_utils.h"
+
+#include <algorithm>
+#include <iostream>
+
+/* Must match local_size_x in ObstacleCull.CS.glsl */
+static const unsigned int workGroupSize = 64;
+
+culling::ObstacleCuller::ObstacleCuller()
+{
+	numInstances = 0;
+	capacity = 0;
+
+	instances = nullptr;
+	visible = nullptr;
+	indirect = nullptr;
+
+	VAO = 0;
+	indexType = GL_UNSIGNED_INT;
+
+	memset(commands, 0, sizeof(commands));
+}
+
+culling::ObstacleCuller::~ObstacleCuller()
+{
+	SAFE_FREE(instances);
+	SAFE_FREE(visible);
+	SAFE_FREE(indirect);
+
+	glDeleteVertexArrays(1, &VAO);
+}
+
+bool culling::ObstacleCuller::IsSupported()
+{
+	return GLEW_VERSION_4_3 != 0;
+}
+
+void culling::ObstacleCuller::Init(Mesh* treeTrunk, Mesh* treeCrown, Mesh* houseBody, Mesh* houseRoof)
+{
+	const Mesh* parts[numParts] = { treeTrunk, treeCrown, houseBody, houseRoof };
+	GeometryPool* pool = treeTrunk->GetGeometryPool();
+
+	for (int i = 0; i < numParts; ++i) {
+		if (!pool || parts[i]->GetGeometryPool() != pool) {
+			std::cout << "GPU culling needs the obstacle meshes in one geometry pool\n";
+			return;
+		}
+	}
+
+	/* Every part is already a (firstIndex, baseVertex, count) range of the pool buffers */
+	for (int i = 0; i < numParts; ++i) {
+		const GeometryRange& range = parts[i]->GetGeometryRange();
+
+		commands[i].count = range.numIndices;
+		commands[i].instanceCount = 0;
+		commands[i].firstIndex = range.firstIndex;
+		commands[i].baseVertex = (GLint)range.baseVertex;
+		commands[i].baseInstance = 0;
+	}
+
+	indexType = pool->GetIndexType();
+
+	/* Own VAO over the pool buffers, so the instance attribute does not leak into the pool VAO */
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	pool->SetupVertexAttributes();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->GetIndexBuffer());
+
+	/* Only positions and colors are read, baseInstance would move the constant attributes */
+	glDisableVertexAttribArray(1);
+	glDisableVertexAttribArray(2);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	indirect = new SSBO<DrawElementsIndirectCommand>(numParts);
+	CheckOpenGLError();
+}
+
+void culling::ObstacleCuller::SetObstacles(const std::vector<m1::Obstacle>& obstacles)
+{
+	numInstances = (unsigned int)obstacles.size();
+
+	if (numInstances > capacity) {
+		capacity = std::max(numInstances, 2 * capacity);
+
+		SAFE_FREE(instances);
+		SAFE_FREE(visible);
+
+		instances = new SSBO<glm::vec4>(capacity);
+		visible = new SSBO<glm::vec4>(numParts * capacity);
+
+		/* The compacted instances are read as a per-instance attribute,
+		baseInstance selects the range of every part. */
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, visible->GetBufferID());
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+		glVertexAttribDivisor(4, 1);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	for (int i = 0; i < numParts; ++i) {
+		commands[i].baseInstance = i * capacity;
+	}
+
+	std::vector<glm::vec4> data;
+	data.reserve(numInstances);
+
+	for (const auto& obs : obstacles) {
+		data.push_back(glm::vec4(obs.position.x, obs.position.y, obs.scaleFactor, (float)obs.type));
+	}
+
+	if (!data.empty()) {
+		instances->SetBufferSubData(data.data(), 0, (int)data.size());
+	}
+}
+
+void culling::ObstacleCuller::ResetCommands()
+{
+	for (int i = 0; i < numParts; ++i) {
+		commands[i].instanceCount = 0;
+	}
+
+	indirect->SetBufferSubData(commands, 0, numParts);
+}
+
+void culling::ObstacleCuller::Render(Shader* cullShader, Shader* drawShader, const glm::mat4& view, const glm::mat4& projection)
+{
+	if (!IsReady() || numInstances == 0 || !cullShader->program || !drawShader->program) {
+		return;
+	}
+
+	glm::vec4 planes[6];
+	ExtractFrustumPlanes(projection * view, planes);
+
+	/* Cull and compact */
+	ResetCommands();
+
+	glUseProgram(cullShader->program);
+	glUniform1ui(glGetUniformLocation(cullShader->program, "instance_count"), numInstances);
+	glUniform4fv(glGetUniformLocation(cullShader->program, "frustum_planes"), 6, glm::value_ptr(planes[0]));
+
+	glUniform1f(glGetUniformLocation(cullShader->program, "trunk_height"), lit::treeTrunkHeight);
+	glUniform1f(glGetUniformLocation(cullShader->program, "crown_top"), 2.0f * lit::treeCrownHeight / 5.33f + lit::treeCrownHeight / 1.6f);
+	glUniform1f(glGetUniformLocation(cullShader->program, "crown_radius"), lit::treeCrownRadius);
+	glUniform1f(glGetUniformLocation(cullShader->program, "house_side"), lit::houseSide);
+	glUniform1f(glGetUniformLocation(cullShader->program, "roof_height"), lit::roofHeight);
+
+	instances->BindBuffer(0);
+	visible->BindBuffer(1);
+	indirect->BindBuffer(2);
+
+	glDispatchCompute((numInstances + workGroupSize - 1) / workGroupSize, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+	/* Draw every part of every visible obstacle */
+	glUseProgram(drawShader->program);
+	glUniformMatrix4fv(glGetUniformLocation(drawShader->program, "View"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(drawShader->program, "Projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	glUniform1f(glGetUniformLocation(drawShader->program, "trunk_height"), lit::treeTrunkHeight);
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect->GetBufferID());
+	glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, 0, numParts, 0);
+	RenderStats::CountDraw(GL_TRIANGLES, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+
+	CheckOpenGLError();
+}
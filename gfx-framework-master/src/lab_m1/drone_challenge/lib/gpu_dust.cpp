@@ -0,0 +1,53 @@
+#include "../headers/gpu_dust.h"
+#include "../headers/literals.h"
+
+#include <cmath>
+
+static const unsigned int workGroupSize = 64;
+
+particles::GpuDust::GpuDust()
+{
+	dustGround = 0.0f;
+	spin = 0.0f;
+}
+
+void particles::GpuDust::Init(unsigned int capacity, Shader* initShader, unsigned int seed)
+{
+	effect.Generate(capacity);
+	effect.FillOnGPU(initShader, seed);
+
+	dustGround = 0.0f;
+	spin = 0.0f;
+}
+
+void particles::GpuDust::Simulate(Shader* stepShader, float deltaTime, const Environment& environment)
+{
+	unsigned int capacity = effect.GetSize();
+	if (capacity == 0 || !stepShader || !stepShader->program) {
+		return;
+	}
+
+	/* Kept between the steps like ParticleSystem::StepDust does, so the dust in the air
+	still settles where it was raised once the drone climbs away */
+	bool emitting = environment.washStrength > 0.0f;
+	if (emitting) {
+		dustGround = environment.washCenter.y;
+	}
+	spin = fmod(spin + 2.39996f, RADIANS(360.0f));
+
+	glUseProgram(stepShader->program);
+	glUniform1ui(glGetUniformLocation(stepShader->program, "particle_count"), capacity);
+	glUniform1f(glGetUniformLocation(stepShader->program, "delta_time"), deltaTime);
+	glUniform2f(glGetUniformLocation(stepShader->program, "wash_center"), environment.washCenter.x, environment.washCenter.z);
+	glUniform1f(glGetUniformLocation(stepShader->program, "wash_strength"), environment.washStrength);
+	glUniform1f(glGetUniformLocation(stepShader->program, "wash_radius"), lit::washRadius);
+	glUniform1f(glGetUniformLocation(stepShader->program, "ground"), dustGround);
+	glUniform2f(glGetUniformLocation(stepShader->program, "spin"), cos(spin), sin(spin));
+
+	effect.GetParticleBuffer()->BindBuffer(0);
+	glDispatchCompute((capacity + workGroupSize - 1) / workGroupSize, 1, 1);
+
+	/* The particle shader reads the positions as instanced vertex attributes */
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	glUseProgram(0);
+}
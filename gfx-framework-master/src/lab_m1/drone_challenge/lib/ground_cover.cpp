@@ -0,0 +1,329 @@
+#include "../headers/ground_cover.h"
+#include "../headers/literals.h"
+
+#include "core/gpu/render_stats.h"
+#include "core/managers/texture_manager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+/* Must match local_size_x in GroundCoverCull.CS.glsl */
+static const unsigned int workGroupSize = 64;
+
+/* Least number of clumps drawn per tile instance, fewer buckets for small counts */
+static const unsigned int minBucket = 8;
+
+/* Room above the clumps for the sway */
+static const float swayMargin = 1.3f;
+
+/* Distance from a point to an axis aligned box, 0 inside */
+static float DistanceToBox(const glm::vec3& point, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	return glm::length(glm::max(glm::max(boxMin - point, point - boxMax), glm::vec3(0.0f)));
+}
+
+/* Whether the box is at least partly on the inner side of every plane */
+static bool BoxInFrustum(const glm::vec4 planes[6], const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	for (int i = 0; i < 6; ++i) {
+		glm::vec3 farthest{ planes[i].x > 0.0f ? boxMax.x : boxMin.x,
+			planes[i].y > 0.0f ? boxMax.y : boxMin.y,
+			planes[i].z > 0.0f ? boxMax.z : boxMin.z };
+
+		if (glm::dot(glm::vec3(planes[i]), farthest) + planes[i].w < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+groundcover::GroundCover::GroundCover()
+{
+	billboard = nullptr;
+
+	VAO = 0;
+	stream = nullptr;
+	numCandidates = 0;
+
+	storageAlignment = 1;
+	culledVAO = 0;
+	visible = nullptr;
+	indirect = nullptr;
+	numCulledClumps = 0;
+}
+
+groundcover::GroundCover::~GroundCover()
+{
+	delete stream;
+	delete visible;
+	delete indirect;
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteVertexArrays(1, &culledVAO);
+}
+
+void groundcover::GroundCover::Init(const std::string& textureDir, bool useCompute, glm::vec2 fieldSize)
+{
+	billboard = TextureManager::LoadTexture(textureDir, "grass_bilboard.png");
+
+	/* Only the tiles closer than the fade end have grass, on large fields they are a part of them */
+	int fadeTiles = (int)std::ceil(2.0f * lit::grassFadeEnd / lit::grassTileSize) + 1;
+	int tilesX = std::min((int)std::ceil(fieldSize.x / lit::grassTileSize), fadeTiles);
+	int tilesZ = std::min((int)std::ceil(fieldSize.y / lit::grassTileSize), fadeTiles);
+	unsigned int maxTiles = (unsigned int)(tilesX * tilesZ);
+
+	/* No vertex buffer, the corners come from gl_VertexID. The tile pointer is set per bucket. */
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+
+	/* Room for every tile, plus the storage buffer alignment on the compute path */
+	stream = new StreamBuffer(maxTiles * sizeof(glm::vec4) + 256);
+	tiles.reserve(maxTiles);
+
+	if (useCompute) {
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		storageAlignment = std::max(storageAlignment, (GLint)sizeof(glm::vec4));
+
+		/* Every clump of every tile fits, so the appends never overflow */
+		visible = new SSBO<glm::vec4>(maxTiles * lit::grassClumpsPerTile);
+		indirect = new SSBO<DrawArraysIndirectCommand>(1, true);
+
+		glGenVertexArrays(1, &culledVAO);
+		glBindVertexArray(culledVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, visible->GetBufferID());
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+		glVertexAttribDivisor(1, 1);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	CheckOpenGLError();
+}
+
+void groundcover::GroundCover::SelectTiles(const Placement& placement, const glm::mat4& viewProjection, const glm::vec3& eyePosition)
+{
+	tiles.clear();
+	buckets.clear();
+
+	const heightfield::HeightField& field = *placement.field;
+	const heightfield::HeightPyramid& pyramid = field.GetPyramid();
+
+	glm::vec2 fieldMin = field.GetPoint(0, 0);
+	glm::vec2 fieldMax = field.GetPoint(field.GetWidth() - 1, field.GetDepth() - 1);
+	int tilesX = (int)std::ceil((fieldMax.x - fieldMin.x) / lit::grassTileSize);
+	int tilesZ = (int)std::ceil((fieldMax.y - fieldMin.y) / lit::grassTileSize);
+
+	glm::vec4 planes[6];
+	culling::ExtractFrustumPlanes(viewProjection, planes);
+
+	/* Per bucket tiles, the bucket of 2^i clumps at index i */
+	std::vector<glm::vec4> bucketTiles[32];
+
+	/* The tiles beyond the fade end are skipped without a test */
+	glm::vec2 eye(eyePosition.x, eyePosition.z);
+	glm::ivec2 first = glm::max(glm::ivec2(glm::floor((eye - lit::grassFadeEnd - fieldMin) / lit::grassTileSize)), glm::ivec2(0));
+	glm::ivec2 last = glm::min(glm::ivec2(glm::floor((eye + lit::grassFadeEnd - fieldMin) / lit::grassTileSize)), glm::ivec2(tilesX, tilesZ) - 1);
+
+	for (int z = first.y; z <= last.y; ++z) {
+		for (int x = first.x; x <= last.x; ++x) {
+			glm::vec2 rectMin = fieldMin + glm::vec2(x, z) * lit::grassTileSize;
+			glm::vec2 rectMax = glm::min(rectMin + lit::grassTileSize, fieldMax);
+
+			glm::vec3 boxMin{ rectMin.x, pyramid.GetMinHeight(rectMin, rectMax), rectMin.y };
+			glm::vec3 boxMax{ rectMax.x, pyramid.GetMaxHeight(rectMin, rectMax) + lit::grassClumpHeight * swayMargin, rectMax.y };
+
+			/* Upper bound of the density over the tile, as in density() of the shaders */
+			float fade = 1.0f - glm::smoothstep(lit::grassFadeStart, lit::grassFadeEnd, DistanceToBox(eyePosition, boxMin, boxMax));
+			if (fade <= 0.0f || !BoxInFrustum(planes, boxMin, boxMax)) {
+				continue;
+			}
+
+			float base = lit::grassBaseDensity;
+			for (const glm::vec2& point : placement.densePoints) {
+				glm::vec2 nearest = glm::clamp(point, rectMin, rectMax);
+				if (glm::distance(nearest, point) < lit::grassDenseRadius) {
+					base = 1.0f;
+					break;
+				}
+			}
+
+			unsigned int clumps = std::min((unsigned int)std::ceil(base * fade * lit::grassClumpsPerTile),
+				(unsigned int)lit::grassClumpsPerTile);
+			if (clumps == 0) {
+				continue;
+			}
+
+			int bucket = 0;
+			while ((1u << bucket) < std::max(clumps, minBucket)) {
+				bucket++;
+			}
+			bucketTiles[bucket].push_back(glm::vec4(x, z, clumps, 0.0f));
+		}
+	}
+
+	numCandidates = 0;
+	for (int i = 0; i < 32; ++i) {
+		if (bucketTiles[i].empty()) {
+			continue;
+		}
+
+		Bucket bucket;
+		bucket.clumps = 1u << i;
+		bucket.firstTile = (unsigned int)tiles.size();
+		bucket.numTiles = (unsigned int)bucketTiles[i].size();
+		buckets.push_back(bucket);
+
+		tiles.insert(tiles.end(), bucketTiles[i].begin(), bucketTiles[i].end());
+		numCandidates += bucket.clumps * bucket.numTiles;
+	}
+}
+
+void groundcover::GroundCover::SetPlacementUniforms(Shader* shader, const Placement& placement, const glm::vec3& eyePosition) const
+{
+	GLuint program = shader->program;
+	int numDensePoints = std::min((int)placement.densePoints.size(), lit::grassMaxDensePoints);
+
+	glUniform1f(glGetUniformLocation(program, "seed"), placement.seed);
+	glUniform2fv(glGetUniformLocation(program, "field_min"), 1, glm::value_ptr(placement.field->GetPoint(0, 0)));
+	glUniform1f(glGetUniformLocation(program, "tile_size"), lit::grassTileSize);
+	glUniform1i(glGetUniformLocation(program, "clumps_per_tile"), lit::grassClumpsPerTile);
+	glUniform3fv(glGetUniformLocation(program, "eye_position"), 1, glm::value_ptr(eyePosition));
+
+	if (numDensePoints > 0) {
+		glUniform2fv(glGetUniformLocation(program, "dense_points"), numDensePoints, glm::value_ptr(placement.densePoints[0]));
+	}
+	glUniform1i(glGetUniformLocation(program, "num_dense_points"), numDensePoints);
+	glUniform1f(glGetUniformLocation(program, "base_density"), lit::grassBaseDensity);
+	glUniform1f(glGetUniformLocation(program, "dense_radius"), lit::grassDenseRadius);
+	glUniform1f(glGetUniformLocation(program, "fade_start"), lit::grassFadeStart);
+	glUniform1f(glGetUniformLocation(program, "fade_end"), lit::grassFadeEnd);
+
+	/* Heights baked by heightfield::HeightField, read the same way as by the field */
+	glUniform1f(glGetUniformLocation(program, "clump_height"), lit::grassClumpHeight);
+	glUniform4fv(glGetUniformLocation(program, "noise_transform"), 1, glm::value_ptr(placement.field->GetTextureTransform()));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, placement.field->GetTexture());
+	glUniform1i(glGetUniformLocation(program, "u_texture_0"), 0);
+}
+
+void groundcover::GroundCover::SetDrawUniforms(Shader* shader, const Placement& placement, const glm::mat4& view,
+	const glm::mat4& projection, const glm::vec3& eyePosition, float time) const
+{
+	glUseProgram(shader->program);
+	SetPlacementUniforms(shader, placement, eyePosition);
+
+	glUniformMatrix4fv(glGetUniformLocation(shader->program, "View"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(shader->program, "Projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	glUniform1f(glGetUniformLocation(shader->program, "time"), time);
+
+	billboard->BindToTextureUnit(GL_TEXTURE1);
+	glUniform1i(glGetUniformLocation(shader->program, "billboard"), 1);
+}
+
+void groundcover::GroundCover::Render(const Placement& placement, Shader* drawShader, Shader* culledShader, Shader* cullShader,
+	bool useCompute, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eyePosition, float time)
+{
+	if (!placement.field || !placement.field->GetTexture()) {
+		return;
+	}
+
+	/* The visible count of a few frames ago, for the stats only */
+	if (indirect && indirect->PollReadBuffer()) {
+		numCulledClumps = indirect->GetBuffer()[0].instanceCount;
+	}
+
+	glm::mat4 viewProjection = projection * view;
+	SelectTiles(placement, viewProjection, eyePosition);
+	if (tiles.empty()) {
+		return;
+	}
+
+	bool culled = useCompute && IsComputeReady() && cullShader && cullShader->program && culledShader && culledShader->program;
+	Shader* shader = culled ? culledShader : drawShader;
+	if (!shader || !shader->program) {
+		return;
+	}
+
+	GLsizeiptr size = tiles.size() * sizeof(glm::vec4);
+	StreamBuffer::Allocation allocation = stream->Allocate(size, culled ? storageAlignment : sizeof(glm::vec4));
+	if (!allocation.IsValid()) {
+		return;
+	}
+
+	memcpy(allocation.pointer, tiles.data(), size);
+	stream->Commit(allocation);
+
+	/* Opaque after the alpha test, seen from both sides */
+	glDisable(GL_CULL_FACE);
+
+	if (culled) {
+		glUseProgram(cullShader->program);
+		SetPlacementUniforms(cullShader, placement, eyePosition);
+		SetDrawUniforms(culledShader, placement, view, projection, eyePosition, time);
+		RenderCulled(cullShader, culledShader, allocation, viewProjection);
+	} else {
+		numCulledClumps = 0;
+		SetDrawUniforms(drawShader, placement, view, projection, eyePosition, time);
+		RenderInstanced(drawShader, allocation);
+	}
+
+	glBindVertexArray(0);
+	CheckOpenGLError();
+}
+
+void groundcover::GroundCover::RenderInstanced(Shader* shader, const StreamBuffer::Allocation& allocation)
+{
+	GLint clumpsLocation = glGetUniformLocation(shader->program, "clumps_per_instance");
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, stream->GetBufferID());
+
+	/* Every tile stays for `clumps` instances, one clump each */
+	for (const Bucket& bucket : buckets) {
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4),
+			(void*)(allocation.offset + bucket.firstTile * sizeof(glm::vec4)));
+		glVertexAttribDivisor(1, bucket.clumps);
+		glUniform1i(clumpsLocation, (GLint)bucket.clumps);
+
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 12, (GLsizei)(bucket.numTiles * bucket.clumps));
+		RenderStats::CountDraw(GL_TRIANGLES, 12, bucket.numTiles * bucket.clumps);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void groundcover::GroundCover::RenderCulled(Shader* cullShader, Shader* drawShader, const StreamBuffer::Allocation& allocation,
+	const glm::mat4& viewProjection)
+{
+	DrawArraysIndirectCommand command{ 12, 0, 0, 0 };
+	indirect->SetBufferSubData(&command, 0, 1);
+
+	glm::vec4 planes[6];
+	culling::ExtractFrustumPlanes(viewProjection, planes);
+
+	/* One row of work groups per tile, the threads past its clump count leave at once */
+	glUseProgram(cullShader->program);
+	glUniform4fv(glGetUniformLocation(cullShader->program, "frustum_planes"), 6, glm::value_ptr(planes[0]));
+
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, stream->GetBufferID(), allocation.offset, allocation.size);
+	visible->BindBuffer(1);
+	indirect->BindBuffer(2);
+
+	glDispatchCompute((lit::grassClumpsPerTile + workGroupSize - 1) / workGroupSize, (GLuint)tiles.size(), 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+	glUseProgram(drawShader->program);
+	glBindVertexArray(culledVAO);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect->GetBufferID());
+	glDrawArraysIndirect(GL_TRIANGLES, 0);
+
+	/* The instance count is on the GPU, the last one read back stands in for it */
+	RenderStats::CountDraw(GL_TRIANGLES, 12, numCulledClumps);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	indirect->RequestReadBuffer();
+}
@@ -0,0 +1,427 @@
+#include "../headers/heightfield.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HEIGHTFIELD_SSE2
+#include <emmintrin.h>
+#endif
+
+/* Below this many samples per thread starting the threads costs more than it saves */
+static const int minSamplesPerThread = 1 << 14;
+
+float heightfield::LatticeValue(glm::vec2 point, float seed)
+{
+	glm::vec2 p = point + seed;
+	float value = std::sin(glm::dot(p, glm::vec2(12.9898f, 78.233f))) * 43758.5453123f;
+
+	return value - std::floor(value);
+}
+
+heightfield::HeightField::HeightField()
+{
+	width = 0;
+	depth = 0;
+	min = glm::vec2(0.0f);
+	step = glm::vec2(1.0f);
+
+	texture = 0;
+	textureWidth = 0;
+	textureDepth = 0;
+
+	bakeThreads = 0;
+	bakeMilliseconds = 0.0;
+}
+
+heightfield::HeightField::~HeightField()
+{
+	if (texture) {
+		glDeleteTextures(1, &texture);
+	}
+}
+
+void heightfield::HeightField::Bake(float seed, float frequency, glm::vec2 min, glm::vec2 max, int width, int depth)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	this->width = std::max(width, 2);
+	this->depth = std::max(depth, 2);
+	this->min = min;
+	step = (max - min) / glm::vec2(this->width - 1, this->depth - 1);
+	heights.resize((size_t)this->width * this->depth);
+
+	/* The hash is evaluated once per lattice point instead of four times per sample */
+	glm::ivec2 latticeMin = glm::ivec2(glm::floor(min * frequency));
+	glm::ivec2 latticeMax = glm::ivec2(glm::floor(max * frequency)) + 2;
+	int latticeWidth = latticeMax.x - latticeMin.x + 1;
+	int latticeDepth = latticeMax.y - latticeMin.y + 1;
+
+	std::vector<float> lattice((size_t)latticeWidth * latticeDepth);
+	for (int z = 0; z < latticeDepth; z++) {
+		for (int x = 0; x < latticeWidth; x++) {
+			lattice[(size_t)z * latticeWidth + x] = LatticeValue(glm::vec2(latticeMin.x + x, latticeMin.y + z), seed);
+		}
+	}
+
+	unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	bakeThreads = (unsigned int)glm::clamp((int)(heights.size() / minSamplesPerThread), 1, (int)maxThreads);
+
+	std::vector<std::thread> threads;
+	int rowsPerThread = (this->depth + bakeThreads - 1) / bakeThreads;
+
+	for (unsigned int t = 1; t < bakeThreads; t++) {
+		int firstRow = t * rowsPerThread;
+		int lastRow = std::min(firstRow + rowsPerThread, this->depth);
+
+		if (firstRow < lastRow) {
+			threads.emplace_back(&HeightField::BakeRows, this, std::cref(lattice), latticeWidth, latticeMin,
+				frequency, firstRow, lastRow);
+		}
+	}
+
+	BakeRows(lattice, latticeWidth, latticeMin, frequency, 0, std::min(rowsPerThread, this->depth));
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	bakeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	pyramid.Build(*this);
+}
+
+void heightfield::HeightField::BakeRows(const std::vector<float>& lattice, int latticeWidth, glm::ivec2 latticeMin,
+	float frequency, int firstRow, int lastRow)
+{
+	for (int row = firstRow; row < lastRow; row++) {
+		/* Smoothstep weights along Z are shared by the whole row */
+		float pz = (min.y + row * step.y) * frequency;
+		float fz = pz - std::floor(pz);
+		float uz = fz * fz * (3.0f - 2.0f * fz);
+
+		const float* lattice0 = &lattice[(size_t)((int)std::floor(pz) - latticeMin.y) * latticeWidth];
+		const float* lattice1 = lattice0 + latticeWidth;
+		float* out = &heights[(size_t)row * width];
+		int column = 0;
+
+#ifdef HEIGHTFIELD_SSE2
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 three = _mm_set1_ps(3.0f);
+		const __m128 minX = _mm_set1_ps(min.x);
+		const __m128 stepX = _mm_set1_ps(step.x);
+		const __m128 freq = _mm_set1_ps(frequency);
+		const __m128 vz = _mm_set1_ps(uz);
+		const __m128i offset = _mm_set1_epi32(latticeMin.x);
+
+		for (; column + 4 <= width; column += 4) {
+			__m128 index = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(column), _mm_set_epi32(3, 2, 1, 0)));
+			__m128 px = _mm_mul_ps(_mm_add_ps(minX, _mm_mul_ps(index, stepX)), freq);
+
+			/* floor() as truncation, minus one where truncation rounded negative values up */
+			__m128i cell = _mm_cvttps_epi32(px);
+			__m128 cellF = _mm_cvtepi32_ps(cell);
+			__m128 roundedUp = _mm_cmpgt_ps(cellF, px);
+			cellF = _mm_sub_ps(cellF, _mm_and_ps(roundedUp, one));
+			cell = _mm_cvttps_epi32(cellF);
+
+			__m128 fx = _mm_sub_ps(px, cellF);
+			__m128 ux = _mm_mul_ps(_mm_mul_ps(fx, fx), _mm_sub_ps(three, _mm_mul_ps(two, fx)));
+
+			alignas(16) int cells[4];
+			_mm_store_si128((__m128i*)cells, _mm_sub_epi32(cell, offset));
+
+			__m128 a = _mm_set_ps(lattice0[cells[3]], lattice0[cells[2]], lattice0[cells[1]], lattice0[cells[0]]);
+			__m128 b = _mm_set_ps(lattice0[cells[3] + 1], lattice0[cells[2] + 1], lattice0[cells[1] + 1], lattice0[cells[0] + 1]);
+			__m128 c = _mm_set_ps(lattice1[cells[3]], lattice1[cells[2]], lattice1[cells[1]], lattice1[cells[0]]);
+			__m128 d = _mm_set_ps(lattice1[cells[3] + 1], lattice1[cells[2] + 1], lattice1[cells[1] + 1], lattice1[cells[0] + 1]);
+
+			/* mix(a, b, ux) + (c - a) * uz * (1 - ux) + (d - b) * ux * uz */
+			__m128 h = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), ux));
+			h = _mm_add_ps(h, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(c, a), vz), _mm_sub_ps(one, ux)));
+			h = _mm_add_ps(h, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(d, b), ux), vz));
+
+			_mm_storeu_ps(out + column, h);
+		}
+#endif
+
+		for (; column < width; column++) {
+			float px = (min.x + column * step.x) * frequency;
+			float cellX = std::floor(px);
+			float fx = px - cellX;
+			float ux = fx * fx * (3.0f - 2.0f * fx);
+
+			int cell = (int)cellX - latticeMin.x;
+			float a = lattice0[cell], b = lattice0[cell + 1];
+			float c = lattice1[cell], d = lattice1[cell + 1];
+
+			out[column] = a + (b - a) * ux + (c - a) * uz * (1.0f - ux) + (d - b) * ux * uz;
+		}
+	}
+}
+
+void heightfield::HeightField::Upload()
+{
+	if (heights.empty()) {
+		return;
+	}
+
+	if (!texture) {
+		glGenTextures(1, &texture);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	if (textureWidth == width && textureDepth == depth) {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, depth, GL_RED, GL_FLOAT, heights.data());
+	}
+	else {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, depth, 0, GL_RED, GL_FLOAT, heights.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		textureWidth = width;
+		textureDepth = depth;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	CheckOpenGLError();
+}
+
+float heightfield::HeightField::Sample(float x, float z) const
+{
+	if (heights.empty()) {
+		return 0.0f;
+	}
+
+	float gx = glm::clamp((x - min.x) / step.x, 0.0f, (float)(width - 1));
+	float gz = glm::clamp((z - min.y) / step.y, 0.0f, (float)(depth - 1));
+
+	int x0 = std::min((int)gx, width - 2);
+	int z0 = std::min((int)gz, depth - 2);
+	float fx = gx - x0;
+	float fz = gz - z0;
+
+	const float* row0 = &heights[(size_t)z0 * width + x0];
+	const float* row1 = row0 + width;
+
+	return glm::mix(glm::mix(row0[0], row0[1], fx), glm::mix(row1[0], row1[1], fx), fz);
+}
+
+glm::vec4 heightfield::HeightField::GetTextureTransform() const
+{
+	/* Texel centers are on the baked points */
+	glm::vec2 scale = 1.0f / (step * glm::vec2(width, depth));
+	glm::vec2 offset = 0.5f / glm::vec2(width, depth) - min * scale;
+
+	return glm::vec4(scale, offset);
+}
+
+void heightfield::HeightField::PrintStats() const
+{
+	std::cout << "HeightField: " << width << "x" << depth << " samples baked in " << bakeMilliseconds << " ms on "
+		<< bakeThreads << (bakeThreads == 1 ? " thread" : " threads")
+#ifdef HEIGHTFIELD_SSE2
+		<< " (SSE2)"
+#endif
+		<< ", " << pyramid.GetNumLevels() << " pyramid levels" << std::endl;
+}
+
+heightfield::HeightPyramid::HeightPyramid()
+{
+	field = nullptr;
+}
+
+void heightfield::HeightPyramid::Build(const HeightField& field)
+{
+	this->field = &field;
+	levels.clear();
+
+	const std::vector<float>& heights = field.GetHeights();
+	int width = field.GetWidth();
+
+	Level cells;
+	cells.width = width - 1;
+	cells.depth = field.GetDepth() - 1;
+	cells.nodes.resize((size_t)cells.width * cells.depth);
+
+	for (int z = 0; z < cells.depth; z++) {
+		const float* row0 = &heights[(size_t)z * width];
+		const float* row1 = row0 + width;
+
+		for (int x = 0; x < cells.width; x++) {
+			float low = std::min(std::min(row0[x], row0[x + 1]), std::min(row1[x], row1[x + 1]));
+			float high = std::max(std::max(row0[x], row0[x + 1]), std::max(row1[x], row1[x + 1]));
+			cells.nodes[(size_t)z * cells.width + x] = glm::vec2(low, high);
+		}
+	}
+
+	levels.push_back(std::move(cells));
+
+	/* Odd sizes round up, the last node of a row or column has only one child then */
+	while (levels.back().width > 1 || levels.back().depth > 1) {
+		const Level& child = levels.back();
+
+		Level parent;
+		parent.width = (child.width + 1) / 2;
+		parent.depth = (child.depth + 1) / 2;
+		parent.nodes.resize((size_t)parent.width * parent.depth);
+
+		for (int z = 0; z < parent.depth; z++) {
+			for (int x = 0; x < parent.width; x++) {
+				glm::vec2 bounds = child.nodes[(size_t)(2 * z) * child.width + 2 * x];
+
+				for (int cz = 2 * z; cz < std::min(2 * z + 2, child.depth); cz++) {
+					for (int cx = 2 * x; cx < std::min(2 * x + 2, child.width); cx++) {
+						glm::vec2 node = child.nodes[(size_t)cz * child.width + cx];
+						bounds = glm::vec2(std::min(bounds.x, node.x), std::max(bounds.y, node.y));
+					}
+				}
+
+				parent.nodes[(size_t)z * parent.width + x] = bounds;
+			}
+		}
+
+		levels.push_back(std::move(parent));
+	}
+}
+
+bool heightfield::HeightPyramid::CellRange(glm::vec2 rectMin, glm::vec2 rectMax, glm::ivec2& first, glm::ivec2& last) const
+{
+	if (levels.empty()) {
+		return false;
+	}
+
+	const Level& cells = levels.front();
+	glm::vec2 origin = field->GetPoint(0, 0);
+	glm::vec2 end = field->GetPoint(cells.width, cells.depth);
+
+	if (rectMax.x < origin.x || rectMax.y < origin.y || rectMin.x > end.x || rectMin.y > end.y) {
+		return false;
+	}
+
+	/* One more cell on each side, in case rounding put an edge on the wrong side of a grid line */
+	glm::ivec2 maxCell(cells.width - 1, cells.depth - 1);
+	first = glm::clamp(glm::ivec2(glm::floor((rectMin - origin) / field->GetSpacing())) - 1, glm::ivec2(0), maxCell);
+	last = glm::clamp(glm::ivec2(glm::floor((rectMax - origin) / field->GetSpacing())) + 1, glm::ivec2(0), maxCell);
+
+	return true;
+}
+
+glm::vec2 heightfield::HeightPyramid::GetBounds(glm::vec2 rectMin, glm::vec2 rectMax) const
+{
+	glm::ivec2 first, last;
+	if (!CellRange(rectMin, rectMax, first, last)) {
+		return glm::vec2(0.0f);
+	}
+
+	/* The first level where the range is at most two nodes wide in both directions */
+	int level = 0;
+	while ((last.x >> level) - (first.x >> level) > 1 || (last.y >> level) - (first.y >> level) > 1) {
+		level++;
+	}
+
+	const Level& nodes = levels[level];
+	glm::vec2 bounds(std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+
+	for (int z = first.y >> level; z <= last.y >> level; z++) {
+		for (int x = first.x >> level; x <= last.x >> level; x++) {
+			glm::vec2 node = nodes.nodes[(size_t)z * nodes.width + x];
+			bounds = glm::vec2(std::min(bounds.x, node.x), std::max(bounds.y, node.y));
+		}
+	}
+
+	return bounds;
+}
+
+float heightfield::HeightPyramid::GetMaxHeight(glm::vec2 rectMin, glm::vec2 rectMax) const
+{
+	return GetBounds(rectMin, rectMax).y;
+}
+
+float heightfield::HeightPyramid::GetMinHeight(glm::vec2 rectMin, glm::vec2 rectMax) const
+{
+	return GetBounds(rectMin, rectMax).x;
+}
+
+float heightfield::HeightPyramid::DescendMax(int level, int x, int z, glm::ivec2 first, glm::ivec2 last,
+	glm::vec2 rectMin, glm::vec2 rectMax, float best, float stopAbove) const
+{
+	/* Cells under the node */
+	glm::ivec2 nodeFirst = glm::ivec2(x, z) << level;
+	glm::ivec2 nodeLast = nodeFirst + (1 << level) - 1;
+
+	if (nodeLast.x < first.x || nodeLast.y < first.y || nodeFirst.x > last.x || nodeFirst.y > last.y) {
+		return best;
+	}
+
+	const Level& nodes = levels[level];
+	if (nodes.nodes[(size_t)z * nodes.width + x].y <= best) {
+		return best;
+	}
+
+	if (level == 0) {
+		/* Along each axis the bilinear surface is linear, so its maximum over the
+		part of the rectangle inside the cell is at one of that part's corners */
+		glm::vec2 low = glm::max(rectMin, field->GetPoint(x, z));
+		glm::vec2 high = glm::min(rectMax, field->GetPoint(x + 1, z + 1));
+
+		if (low.x > high.x || low.y > high.y) {
+			return best;
+		}
+
+		float height = std::max(std::max(field->Sample(low.x, low.y), field->Sample(high.x, low.y)),
+			std::max(field->Sample(low.x, high.y), field->Sample(high.x, high.y)));
+
+		return std::max(best, height);
+	}
+
+	const Level& children = levels[level - 1];
+	for (int cz = 2 * z; cz < std::min(2 * z + 2, children.depth); cz++) {
+		for (int cx = 2 * x; cx < std::min(2 * x + 2, children.width); cx++) {
+			best = DescendMax(level - 1, cx, cz, first, last, rectMin, rectMax, best, stopAbove);
+
+			if (best > stopAbove) {
+				return best;
+			}
+		}
+	}
+
+	return best;
+}
+
+float heightfield::HeightPyramid::GetExactMaxHeight(glm::vec2 rectMin, glm::vec2 rectMax) const
+{
+	glm::ivec2 first, last;
+	if (!CellRange(rectMin, rectMax, first, last)) {
+		return 0.0f;
+	}
+
+	int top = (int)levels.size() - 1;
+	return DescendMax(top, 0, 0, first, last, rectMin, rectMax,
+		-std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+}
+
+bool heightfield::HeightPyramid::Intersects(glm::vec2 rectMin, glm::vec2 rectMax, float height) const
+{
+	glm::ivec2 first, last;
+	if (!CellRange(rectMin, rectMax, first, last)) {
+		return false;
+	}
+
+	if (GetMaxHeight(rectMin, rectMax) <= height) {
+		return false;
+	}
+
+	/* Stops at the first cell that rises above the height */
+	int top = (int)levels.size() - 1;
+	return DescendMax(top, 0, 0, first, last, rectMin, rectMax, -std::numeric_limits<float>::max(), height) > height;
+}
@@ -0,0 +1,350 @@
+#include "../headers/impostors.h"
+#include "../headers/obstacles.h"
+#include "../headers/world_scale.h"
+
+#include "core/gpu/frame_buffer.h"
+#include "core/gpu/mesh_optimizer.h"
+#include "core/gpu/render_stats.h"
+#include "utils/memory_utils.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/* Must match MAX_ARCHETYPES in Impostor.VS.glsl */
+static const int maxArchetypes = 16;
+static const char cacheMagic[4] = { 'I', 'M', 'P', 'A' };
+
+std::vector<impostor::Archetype> impostor::CreateArchetypes()
+{
+	std::vector<Archetype> archetypes;
+
+	/* Tree scale factors are drawn from [0.5, 1.5], house ones from [0.85, 1.35]. */
+	const float treeScales[] = { 0.5f, 0.75f, 1.0f, 1.25f, 1.5f };
+	const float houseScales[] = { 0.85f, 1.1f, 1.35f };
+
+	/* The crown is made of three cones, the last one starts at 2 / 5.33 of its height. */
+	const float crownTop = 2.0f * lit::treeCrownHeight / 5.33f + lit::treeCrownHeight / 1.6f;
+
+	for (float s : treeScales) {
+		float height = lit::treeTrunkHeight * s + crownTop;
+		float halfHeight = height / 2.0f;
+
+		archetypes.push_back({ m1::ObstacleType::TREE, s, halfHeight,
+			sqrtf(lit::treeCrownRadius * lit::treeCrownRadius + halfHeight * halfHeight) });
+	}
+
+	for (float s : houseScales) {
+		/* Both the body and the roof are scaled on OY. */
+		float height = (lit::houseSide + lit::roofHeight) * s;
+		float halfHeight = height / 2.0f;
+		float halfDiagonal = lit::houseSide * sqrtf(2.0f) / 2.0f;
+
+		archetypes.push_back({ m1::ObstacleType::HOUSE, s, halfHeight,
+			sqrtf(halfDiagonal * halfDiagonal + halfHeight * halfHeight) });
+	}
+
+	return archetypes;
+}
+
+int impostor::ArchetypeIndex(const std::vector<Archetype>& archetypes, const m1::Obstacle& obs)
+{
+	int best = -1;
+	float bestDiff = 0.0f;
+
+	for (int i = 0; i < (int)archetypes.size(); ++i) {
+		if (archetypes[i].type != obs.type) {
+			continue;
+		}
+
+		float diff = std::abs(archetypes[i].scaleFactor - obs.scaleFactor);
+		if (best < 0 || diff < bestDiff) {
+			best = i;
+			bestDiff = diff;
+		}
+	}
+
+	return best;
+}
+
+impostor::ImpostorRenderer::ImpostorRenderer()
+{
+	atlas = nullptr;
+	atlasWidth = 0;
+	atlasHeight = 0;
+
+	VAO = 0;
+	quadVBO = 0;
+	instanceVBO = 0;
+}
+
+impostor::ImpostorRenderer::~ImpostorRenderer()
+{
+	if (atlas) {
+		GLuint textureID = atlas->GetTextureID();
+		glDeleteTextures(1, &textureID);
+	}
+	SAFE_FREE(atlas);
+
+	glDeleteBuffers(1, &quadVBO);
+	glDeleteBuffers(1, &instanceVBO);
+	glDeleteVertexArrays(1, &VAO);
+}
+
+void impostor::ImpostorRenderer::Init(const std::string& cacheFile, Shader* bakeShader, Mesh* treeTrunk, Mesh* treeCrown,
+	Mesh* houseBody, Mesh* houseRoof)
+{
+	archetypes = CreateArchetypes();
+
+	/* Every archetype owns a square of frames x frames tiles, placed side by side. */
+	atlasWidth = (int)archetypes.size() * lit::impostorFrames * lit::impostorTileSize;
+	atlasHeight = lit::impostorFrames * lit::impostorTileSize;
+
+	std::vector<unsigned char> pixels;
+	if (!LoadCache(cacheFile, pixels)) {
+		std::cout << "Baking impostor atlas (" << atlasWidth << " x " << atlasHeight << ")\n";
+
+		Bake(bakeShader, treeTrunk, treeCrown, houseBody, houseRoof, pixels);
+		SaveCache(cacheFile, pixels);
+	}
+
+	SAFE_FREE(atlas);
+	atlas = new Texture2D();
+	atlas->Create(pixels.data(), atlasWidth, atlasHeight, 4);
+
+	/* The alpha channel holds the depth, so frames must not be filtered into each other. */
+	atlas->SetFiltering(GL_NEAREST, GL_NEAREST);
+	atlas->SetWrappingMode(GL_CLAMP_TO_EDGE);
+
+	/* One quad, stretched and oriented in the vertex shader */
+	const glm::vec2 corners[] = {
+		glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f),
+		glm::vec2(-1.0f, 1.0f), glm::vec2(1.0f, 1.0f)
+	};
+
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	glGenBuffers(1, &quadVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), 0);
+
+	glGenBuffers(1, &instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+	glVertexAttribDivisor(1, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	CheckOpenGLError();
+}
+
+std::string impostor::ImpostorRenderer::CacheKey() const
+{
+	/* Everything that changes the baked pixels */
+	std::ostringstream key;
+	key << "v1 " << lit::impostorFrames << " " << lit::impostorTileSize << " " << scale::Get().circlePoints;
+
+	for (const auto& a : archetypes) {
+		key << " " << a.type << ":" << a.scaleFactor << ":" << a.centerY << ":" << a.radius;
+	}
+
+	key << " " << lit::treeTrunkHeight << " " << lit::treeTrunkRadius << " " << lit::treeCrownHeight << " " << lit::treeCrownRadius
+		<< " " << lit::houseSide << " " << lit::roofHeight;
+
+	return key.str();
+}
+
+bool impostor::ImpostorRenderer::LoadCache(const std::string& cacheFile, std::vector<unsigned char>& pixels) const
+{
+	std::ifstream file(cacheFile.c_str(), std::ios::in | std::ios::binary);
+	if (!file.good()) {
+		return false;
+	}
+
+	char magic[4];
+	uint32_t keySize = 0;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&keySize, sizeof(keySize));
+
+	if (!file.good() || memcmp(magic, cacheMagic, sizeof(magic)) != 0 || keySize > 4096) {
+		return false;
+	}
+
+	std::string key(keySize, '\0');
+	int32_t size[2] = { 0, 0 };
+	file.read(&key[0], keySize);
+	file.read((char*)size, sizeof(size));
+
+	/* A cache baked with other parameters is ignored and overwritten. */
+	if (!file.good() || key != CacheKey() || size[0] != atlasWidth || size[1] != atlasHeight) {
+		return false;
+	}
+
+	pixels.resize((size_t)atlasWidth * atlasHeight * 4);
+	file.read((char*)pixels.data(), pixels.size());
+
+	return (size_t)file.gcount() == pixels.size();
+}
+
+void impostor::ImpostorRenderer::SaveCache(const std::string& cacheFile, const std::vector<unsigned char>& pixels) const
+{
+	std::ofstream file(cacheFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.good()) {
+		std::cout << "Could not write the impostor cache: " << cacheFile << "\n";
+		return;
+	}
+
+	std::string key = CacheKey();
+	uint32_t keySize = (uint32_t)key.size();
+	int32_t size[2] = { atlasWidth, atlasHeight };
+
+	file.write(cacheMagic, sizeof(cacheMagic));
+	file.write((const char*)&keySize, sizeof(keySize));
+	file.write(key.data(), keySize);
+	file.write((const char*)size, sizeof(size));
+	file.write((const char*)pixels.data(), pixels.size());
+}
+
+void impostor::ImpostorRenderer::Bake(Shader* bakeShader, Mesh* treeTrunk, Mesh* treeCrown, Mesh* houseBody, Mesh* houseRoof,
+	std::vector<unsigned char>& pixels) const
+{
+	const int frames = lit::impostorFrames;
+	const int tile = lit::impostorTileSize;
+
+	/* Color in rgb, depth along the view direction in alpha and 0 alpha where nothing is drawn */
+	FrameBuffer frameBuffer;
+	frameBuffer.SetClearColor(glm::vec4(0.0f));
+	frameBuffer.Generate(atlasWidth, atlasHeight, 1, true, 8);
+	frameBuffer.Bind(true);
+
+	glUseProgram(bakeShader->program);
+	GLint centerLocation = bakeShader->GetUniformLocation("impostor_center");
+	GLint radiusLocation = bakeShader->GetUniformLocation("impostor_radius");
+	GLint dirLocation = bakeShader->GetUniformLocation("impostor_dir");
+
+	for (int a = 0; a < (int)archetypes.size(); ++a) {
+		const Archetype& arch = archetypes[a];
+		const glm::vec3 center{ 0.0f, arch.centerY, 0.0f };
+
+		m1::Obstacle obs(glm::vec2(0.0f), arch.scaleFactor, arch.type);
+
+		std::pair<Mesh*, glm::mat4> parts[2];
+		if (arch.type == m1::ObstacleType::TREE) {
+			std::pair<glm::mat4, glm::mat4> tree = obstacle::GenerateTree(obs);
+			parts[0] = { treeTrunk, tree.first };
+			parts[1] = { treeCrown, tree.second };
+		} else {
+			parts[0] = { houseBody, obstacle::GenerateHouse(obs) };
+			parts[1] = { houseRoof, obstacle::GenerateHouse(obs) };
+		}
+
+		glUniform3fv(centerLocation, 1, glm::value_ptr(center));
+		glUniform1f(radiusLocation, arch.radius);
+
+		glm::mat4 projection = glm::ortho(-arch.radius, arch.radius, -arch.radius, arch.radius, arch.radius, 3.0f * arch.radius);
+		glUniformMatrix4fv(bakeShader->loc_projection_matrix, 1, GL_FALSE, glm::value_ptr(projection));
+
+		for (int j = 0; j < frames; ++j) {
+			for (int i = 0; i < frames; ++i) {
+				glm::vec3 dir = DecodeHemiOct(glm::vec2((i + 0.5f) / frames, (j + 0.5f) / frames));
+
+				glm::vec3 right, up;
+				FrameBasis(dir, right, up);
+
+				glm::mat4 view = glm::lookAt(center + dir * (2.0f * arch.radius), center, up);
+				glUniformMatrix4fv(bakeShader->loc_view_matrix, 1, GL_FALSE, glm::value_ptr(view));
+				glUniform3fv(dirLocation, 1, glm::value_ptr(dir));
+
+				glViewport((a * frames + i) * tile, j * tile, tile, tile);
+
+				for (const auto& part : parts) {
+					glm::mat4 model = part.second * part.first->GetVertexLayout().GetPositionTransform();
+					glUniformMatrix4fv(bakeShader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(model));
+					const GeometryRange& range = part.first->GetGeometryRange();
+					GLenum indexType = part.first->GetIndexType();
+					glBindVertexArray(part.first->GetBuffers()->m_VAO);
+					glDrawElementsBaseVertex(part.first->GetDrawMode(), static_cast<int>(part.first->indices.size()), indexType,
+						(void*)(size_t)(mesh_optimizer::GetIndexSize(indexType) * range.firstIndex), range.baseVertex);
+				}
+			}
+		}
+	}
+
+	glBindVertexArray(0);
+
+	pixels.resize((size_t)atlasWidth * atlasHeight * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, atlasWidth, atlasHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	FrameBuffer::BindDefault();
+	frameBuffer.Clean();
+	CheckOpenGLError();
+}
+
+void impostor::ImpostorRenderer::Classify(const std::vector<m1::Obstacle>& obstacles, glm::vec3 eye,
+	std::vector<const m1::Obstacle*>& nearObstacles)
+{
+	const float farDistance2 = lit::impostorDistance * lit::impostorDistance;
+
+	nearObstacles.clear();
+	farInstances.clear();
+
+	for (const auto& obs : obstacles) {
+		glm::vec3 offset = glm::vec3(obs.position.x, 0.0f, obs.position.y) - eye;
+		int index = ArchetypeIndex(archetypes, obs);
+
+		if (index < 0 || glm::dot(offset, offset) < farDistance2) {
+			nearObstacles.push_back(&obs);
+			continue;
+		}
+
+		farInstances.push_back(glm::vec4(obs.position.x, obs.position.y, (float)index, 0.0f));
+	}
+}
+
+void impostor::ImpostorRenderer::Render(Shader* shader, const glm::mat4& view, const glm::mat4& projection, glm::vec3 eye) const
+{
+	if (!atlas || !shader || !shader->program || farInstances.empty()) {
+		return;
+	}
+
+	glUseProgram(shader->program);
+
+	glUniformMatrix4fv(glGetUniformLocation(shader->program, "View"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(shader->program, "Projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	glUniform3fv(glGetUniformLocation(shader->program, "eye_position"), 1, glm::value_ptr(eye));
+
+	float centersY[maxArchetypes] = {};
+	float radii[maxArchetypes] = {};
+	for (int i = 0; i < (int)archetypes.size() && i < maxArchetypes; ++i) {
+		centersY[i] = archetypes[i].centerY;
+		radii[i] = archetypes[i].radius;
+	}
+
+	glUniform1fv(glGetUniformLocation(shader->program, "archetype_center_y"), maxArchetypes, centersY);
+	glUniform1fv(glGetUniformLocation(shader->program, "archetype_radius"), maxArchetypes, radii);
+	glUniform1i(glGetUniformLocation(shader->program, "frames"), lit::impostorFrames);
+	glUniform2f(glGetUniformLocation(shader->program, "atlas_size"), (float)atlasWidth, (float)atlasHeight);
+	glUniform1f(glGetUniformLocation(shader->program, "tile_size"), (float)lit::impostorTileSize);
+
+	atlas->BindToTextureUnit(GL_TEXTURE0);
+	glUniform1i(glGetUniformLocation(shader->program, "atlas"), 0);
+
+	/* Orphan the previous frame's instances instead of waiting for them */
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, farInstances.size() * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, farInstances.size() * sizeof(glm::vec4), farInstances.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(VAO);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)farInstances.size());
+	RenderStats::CountDraw(GL_TRIANGLE_STRIP, 4, farInstances.size());
+	RenderStats::CountBufferBytes(farInstances.size() * sizeof(glm::vec4));
+	glBindVertexArray(0);
+}
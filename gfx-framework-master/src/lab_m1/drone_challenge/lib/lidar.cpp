@@ -0,0 +1,84 @@
+#include "../headers/lidar.h"
+#include "../headers/literals.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+sensor::LidarConfig sensor::LidarConfig::Sweep()
+{
+	LidarConfig config;
+	config.columns = lit::lidarColumns;
+	config.rows = lit::lidarRows;
+	config.horizontalFov = RADIANS(360.0f);
+	config.minPitch = -lit::lidarPitch;
+	config.maxPitch = lit::lidarPitch;
+	config.maxRange = lit::lidarRange;
+	config.mountOffset = glm::vec3(0.0f, 2.0f * lit::droneBodyOY, 0.0f);
+
+	return config;
+}
+
+sensor::LidarConfig sensor::LidarConfig::Altimeter()
+{
+	LidarConfig config;
+	config.columns = 1;
+	config.rows = 1;
+	config.horizontalFov = 0.0f;
+	config.minPitch = RADIANS(-90.0f);
+	config.maxPitch = RADIANS(-90.0f);
+	config.maxRange = lit::lidarRange;
+	config.mountOffset = glm::vec3(0.0f);
+
+	return config;
+}
+
+sensor::LidarSensor::LidarSensor(const LidarConfig& config)
+	: config(config)
+{
+	scanMilliseconds = 0.0;
+
+	/* Consecutive beams share a row, so the packets of 8 hold neighboring beams
+	that mostly go through the same nodes */
+	for (int row = 0; row < config.rows; row++) {
+		float pitch = config.rows > 1 ? glm::mix(config.minPitch, config.maxPitch, (float)row / (config.rows - 1)) : config.minPitch;
+
+		for (int column = 0; column < config.columns; column++) {
+			/* A full turn would repeat the first column at the end */
+			float steps = config.horizontalFov >= RADIANS(360.0f) ? (float)config.columns : (float)std::max(config.columns - 1, 1);
+			float yaw = config.columns > 1 ? -config.horizontalFov / 2.0f + config.horizontalFov * column / steps : 0.0f;
+
+			directions.push_back(glm::vec3(-std::sin(yaw) * std::cos(pitch), std::sin(pitch), -std::cos(yaw) * std::cos(pitch)));
+		}
+	}
+
+	rays.resize(directions.size());
+	ranges.assign(directions.size(), config.maxRange);
+}
+
+void sensor::LidarSensor::Scan(const raycast::RayCaster& caster, const glm::mat4& pose, workers::WorkerPool* pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	glm::mat3 rotation(pose);
+	glm::vec3 origin = glm::vec3(pose * glm::vec4(config.mountOffset, 1.0f));
+
+	for (size_t i = 0; i < directions.size(); i++) {
+		rays[i].origin = origin;
+		rays[i].direction = glm::normalize(rotation * directions[i]);
+		rays[i].maxDistance = config.maxRange;
+	}
+
+	caster.Cast(rays, hits, pool);
+
+	for (size_t i = 0; i < hits.size(); i++) {
+		ranges[i] = hits[i].distance;
+	}
+
+	scanMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+float sensor::LidarSensor::GetMinRange() const
+{
+	return ranges.empty() ? config.maxRange : *std::min_element(ranges.begin(), ranges.end());
+}
@@ -0,0 +1,320 @@
+#include "../headers/multiview.h"
+#include "../headers/literals.h"
+
+#include "core/gpu/mesh_optimizer.h"
+#include "core/gpu/render_stats.h"
+#include "utils/memory_utils.h"
+
+#include <algorithm>
+#include <iostream>
+
+multiview::MultiViewRenderer::MultiViewRenderer()
+{
+	frameBuffer = nullptr;
+	width = 0;
+	height = 0;
+	maxViews = 0;
+
+	pool = nullptr;
+	fieldMesh = nullptr;
+	for (int i = 0; i < numParts; ++i) {
+		parts[i] = nullptr;
+		partFirst[i] = 0;
+		partCount[i] = 0;
+	}
+	indexType = GL_UNSIGNED_INT;
+
+	VAO = 0;
+	instanceBuffer = 0;
+	viewBuffer = 0;
+	viewTexture = 0;
+
+	frameId = 0;
+	renderedViews = 0;
+
+	readFramebuffer = 0;
+	nextReadback = 0;
+	pendingReadbacks = 0;
+	droppedReadbacks = 0;
+}
+
+multiview::MultiViewRenderer::~MultiViewRenderer()
+{
+	for (auto& readback : readbacks) {
+		if (readback.fence) {
+			glDeleteSync(readback.fence);
+		}
+		glDeleteBuffers(1, &readback.buffer);
+	}
+
+	if (frameBuffer) {
+		frameBuffer->Clean();
+	}
+	SAFE_FREE(frameBuffer);
+
+	glDeleteFramebuffers(1, &readFramebuffer);
+	glDeleteTextures(1, &viewTexture);
+	glDeleteBuffers(1, &viewBuffer);
+	glDeleteBuffers(1, &instanceBuffer);
+	glDeleteVertexArrays(1, &VAO);
+}
+
+void multiview::MultiViewRenderer::Init(Mesh* treeTrunk, Mesh* treeCrown, Mesh* houseBody, Mesh* houseRoof,
+	int width, int height, int maxViews)
+{
+	const Mesh* meshes[numParts] = { treeTrunk, treeCrown, houseBody, houseRoof };
+	GeometryPool* pool = treeTrunk->GetGeometryPool();
+
+	for (int i = 0; i < numParts; ++i) {
+		if (!pool || meshes[i]->GetGeometryPool() != pool) {
+			std::cout << "Multi-view rendering needs the meshes in one geometry pool\n";
+			return;
+		}
+		parts[i] = meshes[i];
+	}
+
+	this->pool = pool;
+	indexType = pool->GetIndexType();
+
+	frameBuffer = new FrameBuffer();
+	frameBuffer->GenerateLayered(width, height, maxViews, 1, true, 8);
+	frameBuffer->SetClearColor(glm::vec4(lit::backgroundRed, lit::backgroundGreen, lit::backgroundBlue, 1.0f));
+
+	this->width = width;
+	this->height = height;
+	this->maxViews = (int)frameBuffer->GetNumberOfLayers();
+
+	/* Own VAO over the pool buffers, so the instance attribute does not leak into the pool VAO */
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	pool->SetupVertexAttributes();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->GetIndexBuffer());
+
+	glDisableVertexAttribArray(1);
+	glDisableVertexAttribArray(2);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &instanceBuffer);
+
+	/* 4 RGBA32F texels per matrix */
+	glGenBuffers(1, &viewBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, viewBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, this->maxViews * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+
+	glGenTextures(1, &viewTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, viewTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, viewBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	/* Every slot holds all the views, the copies of a few frames are in flight at once */
+	glGenFramebuffers(1, &readFramebuffer);
+	readbacks.resize(lit::readbackSlots);
+
+	for (auto& readback : readbacks) {
+		glGenBuffers(1, &readback.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4 * this->maxViews, NULL, GL_STREAM_READ);
+
+		readback.fence = 0;
+		readback.id = 0;
+		readback.views = 0;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	CheckOpenGLError();
+}
+
+void multiview::MultiViewRenderer::SetField(const Mesh* field)
+{
+	fieldMesh = pool && field && field->GetGeometryPool() == pool ? field : nullptr;
+}
+
+void multiview::MultiViewRenderer::SetObstacles(const std::vector<m1::Obstacle>& obstacles)
+{
+	if (!VAO) {
+		return;
+	}
+
+	std::vector<glm::vec4> data;
+	data.reserve(2 * obstacles.size());
+
+	for (int part = 0; part < numParts; ++part) {
+		partFirst[part] = (unsigned int)data.size();
+
+		/* Trees have the first two parts, houses the last two */
+		m1::ObstacleType type = part < 2 ? m1::ObstacleType::TREE : m1::ObstacleType::HOUSE;
+		for (const auto& obs : obstacles) {
+			if (obs.type == type) {
+				data.push_back(glm::vec4(obs.position.x, obs.position.y, obs.scaleFactor, (float)part));
+			}
+		}
+
+		partCount[part] = (unsigned int)data.size() - partFirst[part];
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(glm::vec4), data.empty() ? NULL : &data[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void multiview::MultiViewRenderer::DrawMesh(const Mesh* mesh, GLsizei instances) const
+{
+	const GeometryRange& range = mesh->GetGeometryRange();
+
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.numIndices, indexType,
+		(void*)(size_t)(mesh_optimizer::GetIndexSize(indexType) * range.firstIndex), instances, range.baseVertex);
+	RenderStats::CountDraw(GL_TRIANGLES, range.numIndices, instances);
+}
+
+void multiview::MultiViewRenderer::Render(const std::vector<glm::mat4>& viewProjections, Shader* fieldShader, Shader* obstacleShader,
+	const heightfield::HeightField& field)
+{
+	if (!VAO || viewProjections.empty()) {
+		return;
+	}
+
+	int views = std::min((int)viewProjections.size(), maxViews);
+	renderedViews = views;
+	frameId++;
+
+	glBindBuffer(GL_TEXTURE_BUFFER, viewBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, maxViews * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, views * sizeof(glm::mat4), &viewProjections[0]);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	/* Clears every layer at once */
+	frameBuffer->Bind(true);
+	glEnable(GL_DEPTH_TEST);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, viewTexture);
+	glBindVertexArray(VAO);
+
+	if (fieldMesh && fieldShader && fieldShader->program) {
+		glUseProgram(fieldShader->program);
+		glUniform1i(glGetUniformLocation(fieldShader->program, "view_projections"), 1);
+		glUniform1i(glGetUniformLocation(fieldShader->program, "view_count"), views);
+		glUniform1i(glGetUniformLocation(fieldShader->program, "u_texture_0"), 0);
+		glUniform4fv(glGetUniformLocation(fieldShader->program, "noise_transform"), 1, glm::value_ptr(field.GetTextureTransform()));
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, field.GetTexture());
+
+		/* The field has no instance data, one instance per view */
+		glDisableVertexAttribArray(4);
+		DrawMesh(fieldMesh, views);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	if (obstacleShader && obstacleShader->program) {
+		glUseProgram(obstacleShader->program);
+		glUniform1i(glGetUniformLocation(obstacleShader->program, "view_projections"), 1);
+		glUniform1i(glGetUniformLocation(obstacleShader->program, "view_count"), views);
+		glUniform1f(glGetUniformLocation(obstacleShader->program, "trunk_height"), lit::treeTrunkHeight);
+
+		/* Every obstacle is repeated for all the views before the next one */
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		glEnableVertexAttribArray(4);
+		glVertexAttribDivisor(4, views);
+
+		for (int part = 0; part < numParts; ++part) {
+			if (partCount[part] == 0) {
+				continue;
+			}
+
+			glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)(partFirst[part] * sizeof(glm::vec4)));
+			DrawMesh(parts[part], partCount[part] * views);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+	CheckOpenGLError();
+}
+
+bool multiview::MultiViewRenderer::RequestReadback()
+{
+	if (!VAO || renderedViews == 0) {
+		return false;
+	}
+
+	if (pendingReadbacks == readbacks.size()) {
+		droppedReadbacks++;
+		return false;
+	}
+
+	Readback& readback = readbacks[nextReadback];
+	readback.id = frameId;
+	readback.views = renderedViews;
+
+	/* With a pack buffer bound the copies are queued like draws, nothing waits for them */
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	size_t layerSize = (size_t)width * height * 4;
+	for (int layer = 0; layer < renderedViews; layer++) {
+		glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, frameBuffer->GetTextureID(0), 0, layer);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)(layer * layerSize));
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, FrameBuffer::GetDefaultID());
+
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	nextReadback = (nextReadback + 1) % readbacks.size();
+	pendingReadbacks++;
+	CheckOpenGLError();
+
+	return true;
+}
+
+void multiview::MultiViewRenderer::PollReadbacks()
+{
+	while (pendingReadbacks > 0) {
+		Readback& readback = readbacks[(nextReadback + readbacks.size() - pendingReadbacks) % readbacks.size()];
+
+		/* A zero timeout only asks, the copies finish in order so the newer ones are not done either */
+		GLenum status = glClientWaitSync(readback.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			return;
+		}
+
+		glDeleteSync(readback.fence);
+		readback.fence = 0;
+		pendingReadbacks--;
+
+		if (!consumer) {
+			continue;
+		}
+
+		size_t size = (size_t)width * height * 4 * readback.views;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+
+		if (pixels) {
+			Frame frame;
+			frame.id = readback.id;
+			frame.width = width;
+			frame.height = height;
+			frame.views = readback.views;
+			frame.pixels = pixels;
+
+			consumer(frame);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+}
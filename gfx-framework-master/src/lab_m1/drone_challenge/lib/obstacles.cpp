@@ -1,45 +1,74 @@
 ﻿#include "../headers/literals.h"
 #include "../headers/obstacles.h"
 
-std::vector<m1::Obstacle> obstacle::GeneratePositionsAndSizes(int numOfObstacles,
+#include <unordered_map>
+
+std::vector<m1::Obstacle> obstacle::GeneratePositionsAndSizes(const scale::WorldScale& world,
     std::vector<m1::Obstacle>& packagesAndZone)
 {
     srand(static_cast<unsigned int>(time(nullptr)));
     std::vector<m1::Obstacle> obstacles;
 
+    const int numOfObstacles = world.numOfObstacles;
+    const int numOfZones = world.GetNumOfZones();
+    const int numOfDeliveries = std::min(world.numOfPackages + numOfZones, numOfObstacles);
+
     /* Radius of the area occupied by the largest obstacle  */
-    const float maxObstacleRadius = lit::houseSide * sqrtf(2.0f) / 2.0f;
+    const float maxObstacleRadius = lit::houseSide * std::sqrt(2.0f) / 2.0f;
 
     /* The radius of the surface where an obstacle can be placed so that collisions with other obstacles do not occur */
-	const float zoneRadius = std::min(lit::fieldX / (2.0f * std::sqrtf((float) numOfObstacles)),
-        lit::fieldZ / (2.0f * std::sqrtf((float) numOfObstacles)));
+    float zoneRadius = std::min(world.fieldX / (2.0f * std::sqrt((float) numOfObstacles)),
+        world.fieldZ / (2.0f * std::sqrt((float) numOfObstacles)));
 
     /* How many such areas are on ox and oy. */
-	int zonesX = static_cast<int>(lit::fieldX / (2 * zoneRadius));
-	int zonesZ = static_cast<int>(lit::fieldZ / (2 * zoneRadius));
+    int zonesX = std::max(static_cast<int>(world.fieldX / (2 * zoneRadius)), 1);
+    int zonesZ = std::max(static_cast<int>(world.fieldZ / (2 * zoneRadius)), 1);
 
     /* Uniform the field. */
     while (zonesX * zonesZ < numOfObstacles) {
         zonesX < zonesZ ? ++zonesX : ++zonesZ;
     }
 
-    /* Choose 4 random positions for the packages and delivery zone. */
+    /* The areas shrink to cover the field exactly, on crowded fields the obstacles may touch */
+    const glm::vec2 zoneSize(world.fieldX / (float) zonesX, world.fieldZ / (float) zonesZ);
+    zoneRadius = std::min(zoneSize.x, zoneSize.y) / 2.0f;
+    const float maxOffset = std::max(zoneRadius - maxObstacleRadius, 0.0f);
+
+    /* Choose random positions for the packages and delivery zones. */
     std::unordered_set<int> deliveryIndexes;
-    while (deliveryIndexes.size() < (size_t) (lit::numOfPackages + lit::numOfZones)) {
-        deliveryIndexes.insert(RandomInt(0, numOfObstacles - 1));
+    while (deliveryIndexes.size() < (size_t) numOfDeliveries) {
+        deliveryIndexes.insert(std::min(RandomInt(0, numOfObstacles - 1), numOfObstacles - 1));
+    }
+
+    /* The zones come first in packagesAndZone, then the packages, the package i goes to the zone i */
+    std::unordered_map<int, int> deliverySlots;
+    for (int index : deliveryIndexes) {
+        int slot = (int) deliverySlots.size();
+        deliverySlots[index] = slot;
     }
-    std::vector<int> delivery(deliveryIndexes.begin(), deliveryIndexes.end());
+
+    size_t firstDelivery = packagesAndZone.size();
+    packagesAndZone.resize(firstDelivery + numOfDeliveries, m1::Obstacle(glm::vec2(0.0f), 1.0f, m1::ObstacleType::ZONE));
+    obstacles.reserve(numOfObstacles - numOfDeliveries);
 
     for (int i = 0; i < numOfObstacles; ++i) {
         int zoneX = i % zonesX;
-        int zoneZ = i / zonesZ;
+        int zoneZ = i / zonesX;
 
-        float centerX = -lit::fieldX / 2.0f + zoneRadius + 2.0f * zoneRadius * zoneX;
-        float centerZ = -lit::fieldZ / 2.0f + zoneRadius + 2.0f * zoneRadius * zoneZ;
+        float centerX = -world.fieldX / 2.0f + zoneSize.x * (zoneX + 0.5f);
+        float centerZ = -world.fieldZ / 2.0f + zoneSize.y * (zoneZ + 0.5f);
 
         /* Calculates a random position starting from zone center. */
-        float randomOffsetX = RandomFloat(-zoneRadius + maxObstacleRadius, zoneRadius - maxObstacleRadius);
-        float randomOffsetZ = RandomFloat(-zoneRadius + maxObstacleRadius, zoneRadius - maxObstacleRadius);
+        float randomOffsetX = RandomFloat(-maxOffset, maxOffset);
+        float randomOffsetZ = RandomFloat(-maxOffset, maxOffset);
+        glm::vec2 position(centerX + randomOffsetX, centerZ + randomOffsetZ);
+
+        auto delivery = deliverySlots.find(i);
+        if (delivery != deliverySlots.end()) {
+            m1::ObstacleType delivType = delivery->second < numOfZones ? m1::ObstacleType::ZONE : m1::ObstacleType::PACKAGE;
+            packagesAndZone[firstDelivery + delivery->second] = { position, 1.0f, delivType };
+            continue;
+        }
 
         float scaleFactorTree = RandomFloat(0.5f, 1.5f);
         float scaleFactorHouse = RandomFloat(0.85f, 1.35f);
@@ -48,35 +77,7 @@ std::vector<m1::Obstacle> obstacle::GeneratePositionsAndSizes(int numOfObstacles
         m1::ObstacleType obsType = obstacleType <= 0.75f ? m1::ObstacleType::TREE : m1::ObstacleType::HOUSE;
         float scaleFactor = obsType == m1::ObstacleType::HOUSE ? scaleFactorHouse : scaleFactorTree;
 
-        m1::ObstacleType delivType{};
-        
-        bool pushed{ false };
-
-        for (int j = 0; j < (lit::numOfPackages + lit::numOfZones) / 2; ++j) {
-            if (i == delivery[j]) {
-                packagesAndZone.push_back({ glm::vec2(centerX + randomOffsetX, centerZ + randomOffsetZ), 1.0f, m1::ObstacleType::ZONE });
-                pushed = true;
-                break;
-            }
-        }
-
-        if (pushed) {
-            continue;
-        }
-
-        for (int j = (lit::numOfPackages + lit::numOfZones) / 2; j < lit::numOfPackages + lit::numOfZones; ++j) {
-            if (i == delivery[j]) {
-                packagesAndZone.push_back({ glm::vec2(centerX + randomOffsetX, centerZ + randomOffsetZ), 1.0f, m1::ObstacleType::PACKAGE });
-                pushed = true;
-                break;
-            }
-        }
-        
-        if (pushed) {
-            continue;
-        }
-
-        obstacles.push_back({ glm::vec2(centerX + randomOffsetX, centerZ + randomOffsetZ), scaleFactor, obsType });
+        obstacles.push_back({ position, scaleFactor, obsType });
     }
 
 	return obstacles;
@@ -0,0 +1,134 @@
+#include "../headers/particles.h"
+#include "../headers/gpu_dust.h"
+#include "../headers/literals.h"
+
+#include "core/gpu/render_stats.h"
+#include "core/managers/texture_manager.h"
+
+#include <cstddef>
+#include <cstring>
+
+particles::ParticleRenderer::ParticleRenderer()
+{
+	VAO = 0;
+	quadVBO = 0;
+	stream = nullptr;
+
+	for (auto& sprite : sprites) {
+		sprite = nullptr;
+	}
+}
+
+particles::ParticleRenderer::~ParticleRenderer()
+{
+	delete stream;
+	glDeleteBuffers(1, &quadVBO);
+	glDeleteVertexArrays(1, &VAO);
+}
+
+void particles::ParticleRenderer::Init(const std::string& textureDir)
+{
+	/* White shapes on black, the fragment shader turns the brightness into coverage */
+	sprites[DUST] = TextureManager::LoadTexture(textureDir, "particle.png");
+	sprites[RAIN] = TextureManager::LoadTexture(textureDir, "particle2.png");
+	sprites[SNOW] = TextureManager::LoadTexture(textureDir, "snowflake.png");
+
+	/* One quad, stretched and oriented in the vertex shader */
+	const glm::vec2 corners[] = {
+		glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f),
+		glm::vec2(-1.0f, 1.0f), glm::vec2(1.0f, 1.0f)
+	};
+
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	glGenBuffers(1, &quadVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), 0);
+
+	/* The instances are read from the stream buffer, the pointer is set by every Render */
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	CheckOpenGLError();
+
+	stream = new StreamBuffer(lit::weatherParticles * sizeof(glm::vec4));
+}
+
+void particles::ParticleRenderer::Render(const ParticleSystem& system, Shader* shader, const glm::mat4& view,
+	const glm::mat4& projection, const glm::vec3& eyePosition, const glm::vec3& wind)
+{
+	unsigned int count = system.GetNumVisible();
+	if (count == 0 || !shader || !shader->GetProgramID()) {
+		return;
+	}
+
+	StreamBuffer::Allocation allocation = stream->Allocate(count * sizeof(glm::vec4), sizeof(glm::vec4));
+	if (!allocation.IsValid()) {
+		return;
+	}
+
+	memcpy(allocation.pointer, system.GetInstances().data(), allocation.size);
+	stream->Commit(allocation);
+
+	Draw(system.GetKind(), stream->GetBufferID(), allocation.offset, sizeof(glm::vec4), count, shader,
+		view, projection, eyePosition, wind);
+}
+
+void particles::ParticleRenderer::Render(const GpuDust& dust, Shader* shader, const glm::mat4& view,
+	const glm::mat4& projection, const glm::vec3& eyePosition)
+{
+	unsigned int count = dust.GetCapacity();
+	if (count == 0 || !shader || !shader->GetProgramID()) {
+		return;
+	}
+
+	/* The position and its w come first in every particle, the rest is skipped */
+	Draw(DUST, dust.GetBufferID(), offsetof(DustParticle, position), sizeof(DustParticle), count, shader,
+		view, projection, eyePosition, glm::vec3(0.0f));
+}
+
+void particles::ParticleRenderer::Draw(Kind kind, GLuint buffer, size_t offset, GLsizei stride, unsigned int count, Shader* shader,
+	const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eyePosition, const glm::vec3& wind)
+{
+	glm::vec4 tint = kind == DUST ? glm::vec4(0.55f, 0.45f, 0.3f, 0.6f)
+		: (kind == RAIN ? glm::vec4(0.7f, 0.75f, 0.85f, 0.5f) : glm::vec4(1.0f, 1.0f, 1.0f, 0.9f));
+	float size = kind == DUST ? 0.15f : (kind == RAIN ? 0.015f : 0.06f);
+
+	/* Rain is drawn as the distance it falls in about a frame */
+	glm::vec3 streak = kind == RAIN ? (wind - glm::vec3(0.0f, lit::rainSpeed, 0.0f)) * 0.03f : glm::vec3(0.0f);
+
+	glUseProgram(shader->program);
+	glUniformMatrix4fv(glGetUniformLocation(shader->program, "View"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(shader->program, "Projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	glUniform3fv(glGetUniformLocation(shader->program, "eye_position"), 1, glm::value_ptr(eyePosition));
+	glUniform1f(glGetUniformLocation(shader->program, "size"), size);
+	glUniform3fv(glGetUniformLocation(shader->program, "streak"), 1, glm::value_ptr(streak));
+	glUniform4fv(glGetUniformLocation(shader->program, "tint"), 1, glm::value_ptr(tint));
+	glUniform1i(glGetUniformLocation(shader->program, "fade_with_age"), kind == DUST);
+
+	sprites[kind]->BindToTextureUnit(GL_TEXTURE0);
+	glUniform1i(glGetUniformLocation(shader->program, "sprite"), 0);
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	/* Blended over the scene, without hiding each other */
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+	RenderStats::CountDraw(GL_TRIANGLE_STRIP, 4, count);
+
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,332 @@
+#include "../headers/particles.h"
+#include "../headers/float8.h"
+#include "../headers/literals.h"
+
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+using simd::Float8;
+
+/* Clip space slack around the frustum, so the quads at its edges are not cut off */
+static const float frustumMargin = 1.0f;
+
+/* Mask of the lanes inside the frustum of the view-projection matrix, far plane excluded */
+static Float8 InFrustum(const glm::mat4& m, const Float8& x, const Float8& y, const Float8& z)
+{
+	Float8 clipX = x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0];
+	Float8 clipY = x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1];
+	Float8 clipW = x * m[0][3] + y * m[1][3] + z * m[2][3] + m[3][3];
+
+	Float8 limit = clipW + frustumMargin;
+	Float8 zero(0.0f);
+
+	return (clipW > zero) & (clipX <= limit) & (zero - clipX <= limit) & (clipY <= limit) & (zero - clipY <= limit);
+}
+
+/* Appends the lanes of the mask, in order */
+static void Emit(const Float8& mask, const Float8& x, const Float8& y, const Float8& z, const Float8& w,
+	glm::vec4* out, unsigned int& count)
+{
+	int bits = simd::MoveMask(mask);
+	if (!bits) {
+		return;
+	}
+
+	float lanes[4][8];
+	x.Store(lanes[0]);
+	y.Store(lanes[1]);
+	z.Store(lanes[2]);
+	w.Store(lanes[3]);
+
+	for (int lane = 0; lane < 8; lane++) {
+		if (bits & (1 << lane)) {
+			out[count++] = glm::vec4(lanes[0][lane], lanes[1][lane], lanes[2][lane], lanes[3][lane]);
+		}
+	}
+}
+
+particles::ParticleSystem::ParticleSystem(Kind kind, unsigned int capacity)
+{
+	this->kind = kind;
+	this->capacity = (capacity + 7) & ~7u;
+
+	std::vector<float>* arrays[] = { &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ,
+		&age, &life, &seed, &directionX, &directionZ };
+	for (auto array : arrays) {
+		array->assign(this->capacity, 0.0f);
+	}
+
+	instances.resize(this->capacity);
+	numVisible = 0;
+
+	respawn = true;
+	lastCamera = glm::vec3(0.0f);
+	dustGround = 0.0f;
+	spin = 0.0f;
+
+	pending = false;
+	stopping = false;
+	stepDeltaTime = 0.0f;
+	stepMilliseconds = 0.0;
+	stepEnvironment = Environment();
+
+	thread = std::thread(&ParticleSystem::SimulationLoop, this);
+}
+
+particles::ParticleSystem::~ParticleSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	started.notify_one();
+	thread.join();
+}
+
+void particles::ParticleSystem::Simulate(float deltaTime, const Environment& environment)
+{
+	Wait();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stepDeltaTime = deltaTime;
+		stepEnvironment = environment;
+		pending = true;
+	}
+	started.notify_one();
+}
+
+void particles::ParticleSystem::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this] { return !pending; });
+}
+
+void particles::ParticleSystem::SetKind(Kind kind)
+{
+	Wait();
+	this->kind = kind;
+	respawn = true;
+	numVisible = 0;
+}
+
+void particles::ParticleSystem::SimulationLoop()
+{
+	PROFILE_THREAD("Particles");
+
+	while (true) {
+		std::unique_lock<std::mutex> lock(mutex);
+		started.wait(lock, [this] { return pending || stopping; });
+		if (stopping) {
+			return;
+		}
+
+		float deltaTime = stepDeltaTime;
+		Environment environment = stepEnvironment;
+		lock.unlock();
+
+		Step(deltaTime, environment);
+
+		lock.lock();
+		pending = false;
+		lock.unlock();
+		finished.notify_all();
+	}
+}
+
+void particles::ParticleSystem::Step(float deltaTime, const Environment& environment)
+{
+	PROFILE_ZONE("ParticleSystem::Step");
+	auto start = std::chrono::high_resolution_clock::now();
+
+	/* A camera that jumps further than the box would leave the weather behind */
+	if (respawn || (kind != DUST && glm::distance(environment.camera, lastCamera) > lit::weatherRadius)) {
+		Respawn(environment.camera);
+		respawn = false;
+	}
+	lastCamera = environment.camera;
+
+	/* Long frames, like the first one, would throw everything out of the box at once */
+	deltaTime = std::min(deltaTime, 0.1f);
+
+	if (kind == DUST) {
+		StepDust(deltaTime, environment);
+	} else {
+		StepWeather(deltaTime, environment);
+	}
+
+	stepMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void particles::ParticleSystem::Respawn(const glm::vec3& camera)
+{
+	std::minstd_rand random(capacity + kind);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	for (unsigned int i = 0; i < capacity; i++) {
+		seed[i] = unit(random);
+		float angle = RADIANS(360.0f) * unit(random);
+		directionX[i] = cos(angle);
+		directionZ[i] = sin(angle);
+
+		if (kind == DUST) {
+			/* Dead until the rotors blow on the ground */
+			positionX[i] = camera.x;
+			positionY[i] = camera.y;
+			positionZ[i] = camera.z;
+			velocityX[i] = velocityY[i] = velocityZ[i] = 0.0f;
+			age[i] = life[i] = 1.0f;
+			continue;
+		}
+
+		positionX[i] = camera.x + (2.0f * unit(random) - 1.0f) * lit::weatherRadius;
+		positionY[i] = camera.y + (2.0f * unit(random) - 1.0f) * lit::weatherHeight;
+		positionZ[i] = camera.z + (2.0f * unit(random) - 1.0f) * lit::weatherRadius;
+
+		/* Velocities relative to the wind. Snowflakes drift sideways, rain falls straight. */
+		float drift = kind == SNOW ? 0.4f * unit(random) : 0.0f;
+		float speed = kind == SNOW ? lit::snowSpeed * (0.6f + 0.8f * unit(random)) : lit::rainSpeed * (0.8f + 0.4f * unit(random));
+		velocityX[i] = directionX[i] * drift;
+		velocityY[i] = -speed;
+		velocityZ[i] = directionZ[i] * drift;
+
+		age[i] = 0.0f;
+		life[i] = 1.0f;
+	}
+}
+
+void particles::ParticleSystem::StepWeather(float deltaTime, const Environment& environment)
+{
+	const glm::vec3& camera = environment.camera;
+	float top = camera.y + lit::weatherHeight;
+	float bottom = std::max(camera.y - lit::weatherHeight, environment.groundHeight);
+	float span = std::max(top - bottom, 1.0f);
+
+	/* The sideways drift of the snowflakes turns slowly, which makes them sway */
+	float swirl = kind == SNOW ? 1.5f * deltaTime : 0.0f;
+	Float8 swirlCos(cos(swirl)), swirlSin(sin(swirl));
+
+	Float8 dt(deltaTime);
+	Float8 windX(environment.wind.x), windY(environment.wind.y), windZ(environment.wind.z);
+	Float8 cameraX(camera.x), cameraZ(camera.z);
+	Float8 radius(lit::weatherRadius), side(2.0f * lit::weatherRadius), minusRadius(-lit::weatherRadius);
+	Float8 top8(top), bottom8(bottom), span8(span);
+
+	numVisible = 0;
+	for (unsigned int i = 0; i < capacity; i += 8) {
+		Float8 driftX = Float8::Load(&velocityX[i]);
+		Float8 driftZ = Float8::Load(&velocityZ[i]);
+		Float8 vx = driftX * swirlCos - driftZ * swirlSin;
+		Float8 vz = driftX * swirlSin + driftZ * swirlCos;
+		Float8 vy = Float8::Load(&velocityY[i]);
+
+		Float8 x = Float8::Load(&positionX[i]) + (windX + vx) * dt;
+		Float8 y = Float8::Load(&positionY[i]) + (windY + vy) * dt;
+		Float8 z = Float8::Load(&positionZ[i]) + (windZ + vz) * dt;
+
+		/* Out of the box on one side, back in on the other */
+		Float8 relativeX = x - cameraX;
+		x = simd::Select(relativeX > radius, x - side, simd::Select(relativeX < minusRadius, x + side, x));
+		Float8 relativeZ = z - cameraZ;
+		z = simd::Select(relativeZ > radius, z - side, simd::Select(relativeZ < minusRadius, z + side, z));
+		y = simd::Select(y < bottom8, y + span8, simd::Select(y > top8, y - span8, y));
+
+		x.Store(&positionX[i]);
+		y.Store(&positionY[i]);
+		z.Store(&positionZ[i]);
+		vx.Store(&velocityX[i]);
+		vz.Store(&velocityZ[i]);
+
+		Emit(InFrustum(environment.viewProjection, x, y, z), x, y, z, Float8::Load(&seed[i]), instances.data(), numVisible);
+	}
+}
+
+void particles::ParticleSystem::StepDust(float deltaTime, const Environment& environment)
+{
+	bool emitting = environment.washStrength > 0.0f;
+	if (emitting) {
+		dustGround = environment.washCenter.y;
+	}
+
+	/* The spawn directions are turned by the golden angle every step, so the particles
+	that respawn together do not follow the ones before them */
+	spin = fmod(spin + 2.39996f, RADIANS(360.0f));
+	Float8 spinCos(cos(spin)), spinSin(sin(spin));
+
+	Float8 dt(deltaTime);
+	Float8 zero(0.0f), one(1.0f);
+	Float8 damping(std::max(1.0f - 1.5f * deltaTime, 0.0f));
+	Float8 fall(1.5f * deltaTime);
+	Float8 ground(dustGround), bounce(-0.3f);
+
+	Float8 strength(environment.washStrength);
+	Float8 centerX(environment.washCenter.x), centerZ(environment.washCenter.z);
+	Float8 spawnY(dustGround + 0.05f);
+
+	numVisible = 0;
+	for (unsigned int i = 0; i < capacity; i += 8) {
+		Float8 a = Float8::Load(&age[i]) + dt;
+		Float8 l = Float8::Load(&life[i]);
+		Float8 x = Float8::Load(&positionX[i]);
+		Float8 y = Float8::Load(&positionY[i]);
+		Float8 z = Float8::Load(&positionZ[i]);
+		Float8 vx = Float8::Load(&velocityX[i]);
+		Float8 vy = Float8::Load(&velocityY[i]);
+		Float8 vz = Float8::Load(&velocityZ[i]);
+
+		Float8 dead = a >= l;
+		if (emitting && simd::Any(dead)) {
+			/* Blown outwards from a ring under the rotors, and upwards */
+			Float8 s = Float8::Load(&seed[i]);
+			Float8 dx = Float8::Load(&directionX[i]) * spinCos - Float8::Load(&directionZ[i]) * spinSin;
+			Float8 dz = Float8::Load(&directionX[i]) * spinSin + Float8::Load(&directionZ[i]) * spinCos;
+			Float8 ring = Float8(lit::washRadius) * (Float8(0.3f) + Float8(0.7f) * s);
+			Float8 speed = strength * (Float8(2.0f) + Float8(3.0f) * s);
+
+			x = simd::Select(dead, centerX + dx * ring, x);
+			y = simd::Select(dead, spawnY, y);
+			z = simd::Select(dead, centerZ + dz * ring, z);
+			vx = simd::Select(dead, dx * speed, vx);
+			vy = simd::Select(dead, strength * (Float8(0.5f) + Float8(1.5f) * (one - s)), vy);
+			vz = simd::Select(dead, dz * speed, vz);
+
+			/* A short random delay spreads the respawns over the following frames */
+			a = simd::Select(dead, Float8(-0.25f) * s, a);
+			l = simd::Select(dead, Float8(0.8f) + Float8(1.2f) * s, l);
+		}
+
+		Float8 alive = (a >= zero) & (a < l);
+
+		Float8 newVx = vx * damping;
+		Float8 newVy = vy * damping - fall;
+		Float8 newVz = vz * damping;
+		Float8 newX = x + newVx * dt;
+		Float8 newY = y + newVy * dt;
+		Float8 newZ = z + newVz * dt;
+
+		Float8 below = newY < ground;
+		newY = simd::Select(below, ground, newY);
+		newVy = simd::Select(below, newVy * bounce, newVy);
+
+		x = simd::Select(alive, newX, x);
+		y = simd::Select(alive, newY, y);
+		z = simd::Select(alive, newZ, z);
+		vx = simd::Select(alive, newVx, vx);
+		vy = simd::Select(alive, newVy, vy);
+		vz = simd::Select(alive, newVz, vz);
+
+		a.Store(&age[i]);
+		l.Store(&life[i]);
+		x.Store(&positionX[i]);
+		y.Store(&positionY[i]);
+		z.Store(&positionZ[i]);
+		vx.Store(&velocityX[i]);
+		vy.Store(&velocityY[i]);
+		vz.Store(&velocityZ[i]);
+
+		Emit(alive & InFrustum(environment.viewProjection, x, y, z), x, y, z, a / l, instances.data(), numVisible);
+	}
+}
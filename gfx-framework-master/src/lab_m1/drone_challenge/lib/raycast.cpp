@@ -0,0 +1,556 @@
+#include "../headers/raycast.h"
+#include "../headers/float8.h"
+#include "../headers/literals.h"
+
+#include <algorithm>
+#include <cmath>
+
+using simd::Float8;
+using simd::Select;
+
+/* Shapes per BVH leaf */
+static const int maxLeafShapes = 4;
+
+/* Packets taken by a worker at a time */
+static const unsigned int packetsPerTask = 16;
+
+/* Replaces direction components near 0, so the slab tests never compute 0 * inf */
+static const float minDirection = 1e-12f;
+
+/* The rays of a packet in SoA form, with what they hit so far */
+struct raycast::RayCaster::Packet
+{
+	Float8 ox, oy, oz;
+	Float8 dx, dy, dz;
+	Float8 ix, iy, iz;
+
+	/* Closest hit so far, -1 on the padding lanes so nothing ever passes */
+	Float8 best;
+
+	int kind[8];
+	int obstacle[8];
+
+	/* Keeps the lanes of `mask` where t is in [0, best) and records what they hit */
+	void Record(Float8 t, Float8 mask, HitKind hitKind, int hitObstacle)
+	{
+		mask = mask & (t >= Float8(0.0f)) & (t < best);
+
+		int bits = simd::MoveMask(mask);
+		if (bits == 0) {
+			return;
+		}
+
+		best = Select(mask, t, best);
+		for (int i = 0; i < 8; i++) {
+			if (bits & (1 << i)) {
+				kind[i] = hitKind;
+				obstacle[i] = hitObstacle;
+			}
+		}
+	}
+
+	/* Entry distance of the rays into a box, clamped to 0. The mask has the rays that reach
+	it before their closest hit. */
+	Float8 Slab(glm::vec3 boxMin, glm::vec3 boxMax, Float8& mask) const
+	{
+		Float8 tx0 = (Float8(boxMin.x) - ox) * ix, tx1 = (Float8(boxMax.x) - ox) * ix;
+		Float8 ty0 = (Float8(boxMin.y) - oy) * iy, ty1 = (Float8(boxMax.y) - oy) * iy;
+		Float8 tz0 = (Float8(boxMin.z) - oz) * iz, tz1 = (Float8(boxMax.z) - oz) * iz;
+
+		Float8 tNear = simd::Max(simd::Max(simd::Min(tx0, tx1), simd::Min(ty0, ty1)), simd::Max(simd::Min(tz0, tz1), Float8(0.0f)));
+		Float8 tFar = simd::Min(simd::Min(simd::Max(tx0, tx1), simd::Max(ty0, ty1)), simd::Min(simd::Max(tz0, tz1), best));
+
+		mask = tNear <= tFar;
+		return tNear;
+	}
+};
+
+/* Roots of a*t^2 + b*t + c = 0 in the form that stays accurate when a or c is small.
+With a = 0 the second root is the linear one and the first is infinite. Lanes without
+real roots get NaN, which fails every comparison afterwards. */
+static void SolveQuadratic(Float8 a, Float8 b, Float8 c, Float8& t0, Float8& t1)
+{
+	Float8 root = simd::Sqrt(b * b - Float8(4.0f) * a * c);
+	Float8 q = Float8(-0.5f) * Select(b < Float8(0.0f), b - root, b + root);
+
+	t0 = q / a;
+	t1 = c / q;
+}
+
+raycast::RayCaster::RayCaster()
+{
+	field = nullptr;
+}
+
+void raycast::RayCaster::AddShape(HitKind kind, int obstacle, glm::vec3 base, float size, float height)
+{
+	Shape shape;
+	shape.kind = kind;
+	shape.obstacle = obstacle;
+	shape.base = base;
+	shape.size = size;
+	shape.height = height;
+	shape.boundsMin = base - glm::vec3(size, 0.0f, size);
+	shape.boundsMax = base + glm::vec3(size, height, size);
+
+	shapes.push_back(shape);
+}
+
+void raycast::RayCaster::Build(const std::vector<m1::Obstacle>& obstacles, const heightfield::HeightField& field)
+{
+	this->field = &field;
+	shapes.clear();
+	nodes.clear();
+
+	/* The shapes and sizes of drone.h */
+	for (int i = 0; i < (int)obstacles.size(); i++) {
+		const m1::Obstacle& obs = obstacles[i];
+		glm::vec3 base(obs.position.x, 0.0f, obs.position.y);
+
+		if (obs.type == m1::ObstacleType::TREE) {
+			float trunkHeight = lit::treeTrunkHeight * obs.scaleFactor;
+
+			AddShape(TRUNK, i, base, lit::treeTrunkRadius, trunkHeight);
+			AddShape(CROWN, i, base + glm::vec3(0.0f, trunkHeight, 0.0f), lit::treeCrownRadius, lit::treeCrownHeight);
+		}
+		else if (obs.type == m1::ObstacleType::HOUSE) {
+			float bodyHeight = lit::houseSide * obs.scaleFactor;
+
+			AddShape(HOUSE, i, base, lit::houseSide / 2.0f, bodyHeight);
+			AddShape(ROOF, i, base + glm::vec3(0.0f, bodyHeight, 0.0f), lit::houseSide / 2.0f, lit::roofHeight * obs.scaleFactor);
+		}
+	}
+
+	if (!shapes.empty()) {
+		nodes.reserve(2 * shapes.size());
+		BuildNode(0, (int)shapes.size());
+	}
+}
+
+int raycast::RayCaster::BuildNode(int first, int count)
+{
+	int index = (int)nodes.size();
+	nodes.push_back(Node());
+
+	glm::vec3 boundsMin = shapes[first].boundsMin, boundsMax = shapes[first].boundsMax;
+	glm::vec3 centersMin = (boundsMin + boundsMax) * 0.5f, centersMax = centersMin;
+
+	for (int i = first; i < first + count; i++) {
+		glm::vec3 center = (shapes[i].boundsMin + shapes[i].boundsMax) * 0.5f;
+
+		boundsMin = glm::min(boundsMin, shapes[i].boundsMin);
+		boundsMax = glm::max(boundsMax, shapes[i].boundsMax);
+		centersMin = glm::min(centersMin, center);
+		centersMax = glm::max(centersMax, center);
+	}
+
+	nodes[index].boundsMin = boundsMin;
+	nodes[index].boundsMax = boundsMax;
+
+	if (count <= maxLeafShapes) {
+		nodes[index].index = first;
+		nodes[index].count = count;
+		return index;
+	}
+
+	/* The obstacles are spread over the ground, so only X and Z are worth splitting */
+	int axis = (centersMax.x - centersMin.x >= centersMax.z - centersMin.z) ? 0 : 2;
+	int half = count / 2;
+
+	std::nth_element(shapes.begin() + first, shapes.begin() + first + half, shapes.begin() + first + count,
+		[axis](const Shape& a, const Shape& b) {
+			return a.boundsMin[axis] + a.boundsMax[axis] < b.boundsMin[axis] + b.boundsMax[axis];
+		});
+
+	BuildNode(first, half);
+	int second = BuildNode(first + half, count - half);
+
+	nodes[index].index = second;
+	nodes[index].count = 0;
+	return index;
+}
+
+void raycast::RayCaster::TraverseShapes(Packet& packet) const
+{
+	if (nodes.empty()) {
+		return;
+	}
+
+	/* The depth is log2 of the number of shapes, far below this */
+	int stack[64];
+	int size = 0;
+	stack[size++] = 0;
+
+	float dx[8], dy[8], dz[8];
+	packet.dx.Store(dx);
+	packet.dy.Store(dy);
+	packet.dz.Store(dz);
+	glm::vec3 direction(dx[0], dy[0], dz[0]);
+
+	while (size > 0) {
+		int index = stack[--size];
+		const Node& node = nodes[index];
+
+		Float8 mask;
+		packet.Slab(node.boundsMin, node.boundsMax, mask);
+		if (!simd::Any(mask)) {
+			continue;
+		}
+
+		if (node.count == 0) {
+			/* The child closer along the first ray is pushed last, so it is visited first
+			and shortens the rays before the other one is tested */
+			int first = index + 1, second = node.index;
+			glm::vec3 offset = (nodes[second].boundsMin + nodes[second].boundsMax) - (nodes[first].boundsMin + nodes[first].boundsMax);
+
+			if (glm::dot(offset, direction) < 0.0f) {
+				std::swap(first, second);
+			}
+
+			stack[size++] = second;
+			stack[size++] = first;
+			continue;
+		}
+
+		for (int i = node.index; i < node.index + node.count; i++) {
+			const Shape& shape = shapes[i];
+
+			Float8 px = packet.ox - Float8(shape.base.x);
+			Float8 py = packet.oy - Float8(shape.base.y);
+			Float8 pz = packet.oz - Float8(shape.base.z);
+			Float8 size2 = Float8(shape.size * shape.size);
+			Float8 zero(0.0f), height(shape.height);
+
+			if (shape.kind == TRUNK || shape.kind == CROWN) {
+				/* Solved from the point of the rays closest to the base, where the terms are
+				of the size of the shape. From the origin, the squares of far shapes cancel
+				out and grazing rays miss or hit the side by rounding. */
+				Float8 tClosest = zero - (px * packet.dx + py * packet.dy + pz * packet.dz);
+				px = px + packet.dx * tClosest;
+				py = py + packet.dy * tClosest;
+				pz = pz + packet.dz * tClosest;
+
+				/* Trunk: x^2 + z^2 = r^2. Crown: x^2 + z^2 = (k * (h - y))^2, apex at y = h. */
+				float k = shape.kind == CROWN ? shape.size / shape.height : 0.0f;
+				Float8 k2(k * k);
+				Float8 ay = py - height;
+
+				Float8 a = packet.dx * packet.dx + packet.dz * packet.dz - k2 * packet.dy * packet.dy;
+				Float8 b = Float8(2.0f) * (px * packet.dx + pz * packet.dz - k2 * ay * packet.dy);
+				Float8 c = px * px + pz * pz - (shape.kind == CROWN ? k2 * ay * ay : size2);
+
+				Float8 s0, s1;
+				SolveQuadratic(a, b, c, s0, s1);
+
+				Float8 y0 = py + packet.dy * s0, y1 = py + packet.dy * s1;
+				packet.Record(tClosest + s0, (y0 >= zero) & (y0 <= height), shape.kind, shape.obstacle);
+				packet.Record(tClosest + s1, (y1 >= zero) & (y1 <= height), shape.kind, shape.obstacle);
+
+				/* The caps, only the bottom one for the crown */
+				Float8 sBottom = (zero - py) * packet.iy;
+				Float8 xb = px + packet.dx * sBottom, zb = pz + packet.dz * sBottom;
+				packet.Record(tClosest + sBottom, xb * xb + zb * zb <= size2, shape.kind, shape.obstacle);
+
+				if (shape.kind == TRUNK) {
+					Float8 sTop = (height - py) * packet.iy;
+					Float8 xt = px + packet.dx * sTop, zt = pz + packet.dz * sTop;
+					packet.Record(tClosest + sTop, xt * xt + zt * zt <= size2, shape.kind, shape.obstacle);
+				}
+			}
+			else if (shape.kind == HOUSE) {
+				Float8 mask;
+				Float8 t = packet.Slab(shape.boundsMin, shape.boundsMax, mask);
+				packet.Record(t, mask, shape.kind, shape.obstacle);
+			}
+			else {
+				/* Clips the rays with the base and the 4 sides: s * y / h + |x| <= s, the same for z */
+				Float8 tNear = zero, tFar = packet.best;
+				Float8 inside = tNear <= tFar;
+
+				Float8 slope(shape.size / shape.height), side(shape.size);
+				const float signs[4][2] = { { 1.0f, 0.0f }, { -1.0f, 0.0f }, { 0.0f, 1.0f }, { 0.0f, -1.0f } };
+
+				for (int p = 0; p < 5; p++) {
+					Float8 distance, rate;
+					if (p == 4) {
+						distance = zero - py;
+						rate = zero - packet.dy;
+					}
+					else {
+						Float8 sx(signs[p][0]), sz(signs[p][1]);
+						distance = sx * px + sz * pz + slope * py - side;
+						rate = sx * packet.dx + sz * packet.dz + slope * packet.dy;
+					}
+
+					/* The ray enters the half space when the distance decreases, and leaves it otherwise */
+					Float8 t = (zero - distance) / rate;
+					Float8 entering = rate < zero, leaving = rate > zero;
+
+					tNear = Select(entering, simd::Max(tNear, t), tNear);
+					tFar = Select(leaving, simd::Min(tFar, t), tFar);
+					inside = inside & (entering | leaving | (distance <= zero));
+				}
+
+				packet.Record(tNear, inside & (tNear <= tFar), shape.kind, shape.obstacle);
+			}
+		}
+	}
+}
+
+void raycast::RayCaster::TraverseField(Packet& packet) const
+{
+	if (!field || field->GetWidth() < 2) {
+		return;
+	}
+
+	const heightfield::HeightPyramid& pyramid = field->GetPyramid();
+	const std::vector<float>& heights = field->GetHeights();
+	int width = field->GetWidth();
+
+	glm::vec2 origin = field->GetPoint(0, 0);
+	glm::vec2 spacing = field->GetSpacing();
+	int cellsX = pyramid.GetLevelWidth(0);
+	int cellsZ = pyramid.GetLevelDepth(0);
+
+	/* Children of a node in near to far order for the first ray, pushed in reverse */
+	int orderX[2] = { 0, 1 }, orderZ[2] = { 0, 1 };
+	{
+		float dx[8], dz[8];
+		packet.dx.Store(dx);
+		packet.dz.Store(dz);
+		if (dx[0] < 0.0f) std::swap(orderX[0], orderX[1]);
+		if (dz[0] < 0.0f) std::swap(orderZ[0], orderZ[1]);
+	}
+
+	struct Entry {
+		int level;
+		int x;
+		int z;
+	};
+
+	/* 3 children pushed per level at most, plus the one being expanded */
+	Entry stack[4 * 32];
+	int size = 0;
+	stack[size++] = { pyramid.GetNumLevels() - 1, 0, 0 };
+
+	while (size > 0) {
+		Entry entry = stack[--size];
+
+		int firstX = entry.x << entry.level, lastX = std::min((entry.x + 1) << entry.level, cellsX);
+		int firstZ = entry.z << entry.level, lastZ = std::min((entry.z + 1) << entry.level, cellsZ);
+		glm::vec2 bounds = pyramid.GetNode(entry.level, entry.x, entry.z);
+
+		glm::vec2 cornerMin = origin + spacing * glm::vec2(firstX, firstZ);
+		glm::vec2 cornerMax = origin + spacing * glm::vec2(lastX, lastZ);
+
+		Float8 mask;
+		Float8 tEnter = packet.Slab(glm::vec3(cornerMin.x, bounds.x, cornerMin.y), glm::vec3(cornerMax.x, bounds.y, cornerMax.y), mask);
+		if (!simd::Any(mask)) {
+			continue;
+		}
+
+		if (entry.level > 0) {
+			int childWidth = pyramid.GetLevelWidth(entry.level - 1);
+			int childDepth = pyramid.GetLevelDepth(entry.level - 1);
+
+			for (int i = 3; i >= 0; i--) {
+				int x = 2 * entry.x + orderX[i & 1];
+				int z = 2 * entry.z + orderZ[i >> 1];
+
+				if (x < childWidth && z < childDepth) {
+					stack[size++] = { entry.level - 1, x, z };
+				}
+			}
+			continue;
+		}
+
+		/* h(u, v) = a + b * u + c * v + d * u * v over the cell, with u and v in [0, 1] */
+		const float* row0 = &heights[(size_t)entry.z * width + entry.x];
+		const float* row1 = row0 + width;
+		Float8 a(row0[0]), b(row0[1] - row0[0]), c(row1[0] - row0[0]), d(row0[0] - row0[1] - row1[0] + row1[1]);
+
+		Float8 du = packet.dx * Float8(1.0f / spacing.x);
+		Float8 dv = packet.dz * Float8(1.0f / spacing.y);
+
+		/* Height of the ray above the surface from the cell entry: f(s) = fEnter + g1 * s + f2 * s^2.
+		Expanded around the entry and not the ray origin, so that far cells do not subtract
+		large terms. The ray is still above the surface there unless it crossed it before. */
+		Float8 uEnter = (packet.ox + packet.dx * tEnter - Float8(cornerMin.x)) * Float8(1.0f / spacing.x);
+		Float8 vEnter = (packet.oz + packet.dz * tEnter - Float8(cornerMin.y)) * Float8(1.0f / spacing.y);
+		Float8 fEnter = packet.oy + packet.dy * tEnter - (a + b * uEnter + c * vEnter + d * uEnter * vEnter);
+		Float8 g1 = packet.dy - (b * du + c * dv + d * (uEnter * dv + vEnter * du));
+		Float8 f2 = Float8(0.0f) - d * du * dv;
+
+		Float8 tExit = packet.best;
+		{
+			Float8 tx0 = (Float8(cornerMin.x) - packet.ox) * packet.ix, tx1 = (Float8(cornerMax.x) - packet.ox) * packet.ix;
+			Float8 tz0 = (Float8(cornerMin.y) - packet.oz) * packet.iz, tz1 = (Float8(cornerMax.y) - packet.oz) * packet.iz;
+			tExit = simd::Min(tExit, simd::Min(simd::Max(tx0, tx1), simd::Max(tz0, tz1)));
+		}
+
+		Float8 below = fEnter <= Float8(0.0f);
+		packet.Record(tEnter, mask & below, FIELD, -1);
+
+		Float8 s0, s1;
+		SolveQuadratic(f2, g1, fEnter, s0, s1);
+
+		Float8 length = tExit - tEnter;
+		Float8 valid0 = (s0 >= Float8(0.0f)) & (s0 <= length);
+		Float8 valid1 = (s1 >= Float8(0.0f)) & (s1 <= length);
+		Float8 s = Select(valid0, Select(valid1, simd::Min(s0, s1), s0), s1);
+
+		packet.Record(tEnter + s, mask & simd::AndNot(below, valid0 | valid1), FIELD, -1);
+	}
+}
+
+void raycast::RayCaster::CastPacket(const Ray* rays, int count, RayHit* hits) const
+{
+	float ox[8], oy[8], oz[8], dx[8], dy[8], dz[8], ix[8], iy[8], iz[8], best[8];
+
+	for (int i = 0; i < 8; i++) {
+		/* The padding lanes repeat the first ray, so they do not widen the traversal */
+		const Ray& ray = rays[i < count ? i : 0];
+		glm::vec3 direction = ray.direction;
+
+		for (int j = 0; j < 3; j++) {
+			if (std::abs(direction[j]) < minDirection) {
+				direction[j] = direction[j] < 0.0f ? -minDirection : minDirection;
+			}
+		}
+
+		ox[i] = ray.origin.x; oy[i] = ray.origin.y; oz[i] = ray.origin.z;
+		dx[i] = direction.x; dy[i] = direction.y; dz[i] = direction.z;
+		ix[i] = 1.0f / direction.x; iy[i] = 1.0f / direction.y; iz[i] = 1.0f / direction.z;
+		best[i] = i < count ? ray.maxDistance : -1.0f;
+	}
+
+	Packet packet;
+	packet.ox = Float8::Load(ox); packet.oy = Float8::Load(oy); packet.oz = Float8::Load(oz);
+	packet.dx = Float8::Load(dx); packet.dy = Float8::Load(dy); packet.dz = Float8::Load(dz);
+	packet.ix = Float8::Load(ix); packet.iy = Float8::Load(iy); packet.iz = Float8::Load(iz);
+	packet.best = Float8::Load(best);
+
+	for (int i = 0; i < 8; i++) {
+		packet.kind[i] = NONE;
+		packet.obstacle[i] = -1;
+	}
+
+	/* The obstacles first, they are cheaper and cut the rays short for the terrain */
+	TraverseShapes(packet);
+	TraverseField(packet);
+
+	packet.best.Store(best);
+	for (int i = 0; i < count; i++) {
+		hits[i].distance = best[i];
+		hits[i].kind = (HitKind)packet.kind[i];
+		hits[i].obstacle = packet.obstacle[i];
+	}
+}
+
+raycast::RayHit raycast::RayCaster::Cast(const Ray& ray) const
+{
+	RayHit hit;
+	CastPacket(&ray, 1, &hit);
+
+	return hit;
+}
+
+void raycast::RayCaster::Cast(const std::vector<Ray>& rays, std::vector<RayHit>& hits, workers::WorkerPool* pool) const
+{
+	hits.resize(rays.size());
+
+	unsigned int numPackets = (unsigned int)(rays.size() + 7) / 8;
+	auto task = [&](unsigned int first, unsigned int last) {
+		for (unsigned int p = first; p < last; p++) {
+			int count = (int)std::min<size_t>(8, rays.size() - 8 * (size_t)p);
+			CastPacket(&rays[8 * p], count, &hits[8 * p]);
+		}
+	};
+
+	if (pool) {
+		pool->ParallelFor(numPackets, packetsPerTask, task);
+	}
+	else {
+		task(0, numPackets);
+	}
+}
+
+raycast::RayHit raycast::RayCaster::CastBruteForce(const Ray& ray) const
+{
+	/* Marches along the ray with inside tests, which share nothing with the packet code */
+	std::vector<const Shape*> candidates;
+	for (const Shape& shape : shapes) {
+		glm::vec3 t0 = (shape.boundsMin - ray.origin) / ray.direction;
+		glm::vec3 t1 = (shape.boundsMax - ray.origin) / ray.direction;
+		glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+
+		if (std::max(std::max(tMin.x, tMin.y), tMin.z) <= std::min(std::min(tMax.x, tMax.y), tMax.z)) {
+			candidates.push_back(&shape);
+		}
+	}
+
+	glm::vec2 fieldMin = field ? field->GetPoint(0, 0) : glm::vec2(0.0f);
+	glm::vec2 fieldMax = field ? field->GetPoint(field->GetWidth() - 1, field->GetDepth() - 1) : glm::vec2(0.0f);
+
+	auto inside = [&](float t, RayHit& hit) {
+		glm::vec3 point = ray.origin + ray.direction * t;
+
+		if (field && field->GetWidth() >= 2 && point.x >= fieldMin.x && point.x <= fieldMax.x &&
+			point.z >= fieldMin.y && point.z <= fieldMax.y && point.y <= field->Sample(point.x, point.z)) {
+			hit.kind = FIELD;
+			hit.obstacle = -1;
+			return true;
+		}
+
+		for (const Shape* shape : candidates) {
+			glm::vec3 p = point - shape->base;
+			if (p.y < 0.0f || p.y > shape->height) {
+				continue;
+			}
+
+			float taper = (shape->kind == CROWN || shape->kind == ROOF) ? 1.0f - p.y / shape->height : 1.0f;
+			float extent = shape->size * taper;
+			bool round = shape->kind == TRUNK || shape->kind == CROWN;
+
+			if (round ? p.x * p.x + p.z * p.z <= extent * extent : std::abs(p.x) <= extent && std::abs(p.z) <= extent) {
+				hit.kind = shape->kind;
+				hit.obstacle = shape->obstacle;
+				return true;
+			}
+		}
+
+		return false;
+	};
+
+	const float step = 0.005f;
+
+	RayHit hit;
+	hit.distance = ray.maxDistance;
+	hit.kind = NONE;
+	hit.obstacle = -1;
+
+	for (float t = 0.0f; t <= ray.maxDistance; t += step) {
+		if (!inside(t, hit)) {
+			continue;
+		}
+
+		float low = std::max(t - step, 0.0f), high = t;
+		for (int i = 0; i < 20 && t > 0.0f; i++) {
+			float middle = 0.5f * (low + high);
+			RayHit unused;
+
+			if (inside(middle, unused)) {
+				high = middle;
+			}
+			else {
+				low = middle;
+			}
+		}
+
+		inside(high, hit);
+		hit.distance = high;
+		break;
+	}
+
+	return hit;
+}
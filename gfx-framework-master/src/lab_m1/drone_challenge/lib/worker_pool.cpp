@@ -0,0 +1,112 @@
+#include "../headers/worker_pool.h"
+
+#include "core/profiler.h"
+
+#include <algorithm>
+
+workers::WorkerPool::WorkerPool(unsigned int numThreads)
+{
+	task = nullptr;
+	count = 0;
+	grain = 1;
+	next = 0;
+	generation = 0;
+	busyWorkers = 0;
+	stopping = false;
+
+	if (numThreads == 0) {
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	for (unsigned int i = 1; i < numThreads; i++) {
+		threads.emplace_back(&WorkerPool::WorkerLoop, this);
+	}
+}
+
+workers::WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_all();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void workers::WorkerPool::ParallelFor(unsigned int count, unsigned int grain, const std::function<void(unsigned int, unsigned int)>& task)
+{
+	if (count == 0) {
+		return;
+	}
+
+	grain = std::max(grain, 1u);
+
+	/* Not worth waking anyone for a single chunk */
+	if (threads.empty() || count <= grain) {
+		task(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		this->count = count;
+		this->grain = grain;
+		next = 0;
+		busyWorkers = (unsigned int)threads.size();
+		generation++;
+	}
+
+	wake.notify_all();
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return busyWorkers == 0; });
+	this->task = nullptr;
+}
+
+void workers::WorkerPool::WorkerLoop()
+{
+	PROFILE_THREAD("Worker");
+	unsigned int seenGeneration = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+
+			if (stopping) {
+				return;
+			}
+
+			seenGeneration = generation;
+		}
+
+		{
+			PROFILE_ZONE("WorkerPool::RunChunks");
+			RunChunks();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busyWorkers--;
+		}
+
+		done.notify_one();
+	}
+}
+
+void workers::WorkerPool::RunChunks()
+{
+	while (true) {
+		unsigned int begin = next.fetch_add(grain);
+		if (begin >= count) {
+			return;
+		}
+
+		(*task)(begin, std::min(begin + grain, count));
+	}
+}
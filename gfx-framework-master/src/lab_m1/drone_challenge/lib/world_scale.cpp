@@ -0,0 +1,205 @@
+#include "../headers/world_scale.h"
+#include "../headers/literals.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+/* The scale of this run */
+static scale::WorldScale current;
+
+/* Whole numbers only, `12abc` is rejected */
+static bool ReadInt(const char* text, int& value)
+{
+	char* end = nullptr;
+	errno = 0;
+	long number = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || errno == ERANGE || number < 0 || number > (1 << 30)) {
+		return false;
+	}
+
+	value = (int)number;
+	return true;
+}
+
+static bool ReadFloat(const char* text, float& value)
+{
+	char* end = nullptr;
+	double number = strtod(text, &end);
+	if (end == text || *end != '\0' || !(number > 0.0)) {
+		return false;
+	}
+
+	value = (float)number;
+	return true;
+}
+
+scale::WorldScale::WorldScale()
+{
+	fieldX = 50;
+	fieldZ = 50;
+	numOfObstacles = 35;
+	numOfPackages = 3;
+	circlePoints = 30;
+
+	cameraNear = 0.01f;
+	cameraFar = 200.0f;
+	miniMapNear = 0.1f;
+	miniMapFar = 100.0f;
+}
+
+glm::ivec2 scale::WorldScale::GetFieldCells() const
+{
+	return glm::min(glm::ivec2(fieldX, fieldZ) * lit::heightSamplesPerUnit, glm::ivec2(lit::maxFieldCells));
+}
+
+glm::ivec2 scale::WorldScale::GetHeightSamples() const
+{
+	return GetFieldCells() + 1;
+}
+
+void scale::WorldScale::Validate()
+{
+	WorldScale original = *this;
+
+	/* The drone starts 5 units inside the field */
+	fieldX = glm::clamp(fieldX, 16, 65536);
+	fieldZ = glm::clamp(fieldZ, 16, 65536);
+
+	numOfPackages = glm::clamp(numOfPackages, 1, 1024);
+
+	/* The packages and the zones take the place of obstacles */
+	numOfObstacles = glm::clamp(numOfObstacles, 2 * numOfPackages, 1 << 24);
+
+	circlePoints = glm::clamp(circlePoints, 3, 1024);
+
+	cameraFar = std::max(cameraFar, 2.0f * cameraNear);
+	miniMapFar = std::max(miniMapFar, 2.0f * miniMapNear);
+
+	if (ToString(original) != ToString(*this)) {
+		std::cout << "World scale: " << ToString(original) << " changed to " << ToString(*this) << std::endl;
+	}
+}
+
+const scale::WorldScale& scale::Get()
+{
+	return current;
+}
+
+void scale::Set(const WorldScale& scale)
+{
+	current = scale;
+	current.Validate();
+}
+
+bool scale::ParseArgument(int argc, char** argv, int& i, WorldScale& scale)
+{
+	const char* option = argv[i];
+	int values = argc - i - 1;
+
+	if (!strcmp(option, "--world") && values >= 1) {
+		if (!LoadFile(argv[i + 1], scale)) {
+			return false;
+		}
+		i += 1;
+	} else if (!strcmp(option, "--field") && values >= 2) {
+		if (!ReadInt(argv[i + 1], scale.fieldX) || !ReadInt(argv[i + 2], scale.fieldZ)) {
+			return false;
+		}
+		i += 2;
+	} else if (!strcmp(option, "--obstacles") && values >= 1) {
+		if (!ReadInt(argv[i + 1], scale.numOfObstacles)) {
+			return false;
+		}
+		i += 1;
+	} else if (!strcmp(option, "--packages") && values >= 1) {
+		if (!ReadInt(argv[i + 1], scale.numOfPackages)) {
+			return false;
+		}
+		i += 1;
+	} else if (!strcmp(option, "--circle-points") && values >= 1) {
+		if (!ReadInt(argv[i + 1], scale.circlePoints)) {
+			return false;
+		}
+		i += 1;
+	} else if (!strcmp(option, "--camera-planes") && values >= 2) {
+		if (!ReadFloat(argv[i + 1], scale.cameraNear) || !ReadFloat(argv[i + 2], scale.cameraFar)) {
+			return false;
+		}
+		i += 2;
+	} else if (!strcmp(option, "--minimap-planes") && values >= 2) {
+		if (!ReadFloat(argv[i + 1], scale.miniMapNear) || !ReadFloat(argv[i + 2], scale.miniMapFar)) {
+			return false;
+		}
+		i += 2;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+bool scale::LoadFile(const std::string& path, WorldScale& scale)
+{
+	std::ifstream file(path);
+	if (!file) {
+		std::cout << "World scale: cannot read " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	for (unsigned int lineNumber = 1; std::getline(file, line); lineNumber++) {
+		line = line.substr(0, line.find('#'));
+
+		/* The line is parsed as its command line option, `field 100 100` as `--field 100 100` */
+		std::istringstream words(line);
+		std::vector<std::string> tokens;
+		for (std::string word; words >> word; ) {
+			tokens.push_back(tokens.empty() ? "--" + word : word);
+		}
+
+		if (tokens.empty()) {
+			continue;
+		}
+
+		std::vector<char*> arguments;
+		for (std::string& token : tokens) {
+			arguments.push_back(&token[0]);
+		}
+
+		int i = 0;
+		bool nested = tokens[0] == "--world";
+		if (nested || !ParseArgument((int)arguments.size(), arguments.data(), i, scale) || i + 1 != (int)arguments.size()) {
+			std::cout << "World scale: " << path << ":" << lineNumber << ": invalid line `" << line << "`" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void scale::PrintUsage()
+{
+	std::cout <<
+		"  --world PATH         world options from a file, one `key values` per line, e.g. `field 1024 1024`\n"
+		"  --field X Z          size of the field, default 50 50\n"
+		"  --obstacles N        trees and houses, default 35\n"
+		"  --packages N         packages to deliver, each with its zone, default 3\n"
+		"  --circle-points N    segments of the trees, default 30\n"
+		"  --camera-planes N F  near and far planes of the drone camera, default 0.01 200\n"
+		"  --minimap-planes N F near and far planes of the minimap, default 0.1 100\n";
+}
+
+std::string scale::ToString(const WorldScale& scale)
+{
+	std::ostringstream text;
+	text << "field " << scale.fieldX << "x" << scale.fieldZ << ", " << scale.numOfObstacles << " obstacles, "
+		<< scale.numOfPackages << " packages, " << scale.circlePoints << " circle points, camera planes "
+		<< scale.cameraNear << " " << scale.cameraFar << ", minimap planes " << scale.miniMapNear << " " << scale.miniMapFar;
+	return text.str();
+}
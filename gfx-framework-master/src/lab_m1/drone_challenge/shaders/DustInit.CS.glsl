@@ -0,0 +1,49 @@
+#version 430
+
+layout(local_size_x = 64) in;
+
+struct Particle {
+    vec4 position;    // x, y, z, age over lifetime, 1 when dead
+    vec4 velocity;    // x, y, z, age
+    vec4 random;      // fixed random value, direction x and z, lifetime
+};
+
+layout(std430, binding = 0) writeonly buffer Particles {
+    Particle particles[];
+};
+
+// Uniform properties
+uniform uint seed;
+uniform uint particle_count;
+
+// PCG hash of one word, well mixed in every bit
+uint Hash(uint value)
+{
+    uint state = value * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// In [0, 1), from the 24 high bits so every value is a float
+float Random(inout uint state)
+{
+    state = Hash(state);
+    return float(state >> 8u) / 16777216.0f;
+}
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= particle_count) {
+        return;
+    }
+
+    uint state = Hash(i + Hash(seed));
+    float value = Random(state);
+    float angle = radians(360.0f) * Random(state);
+
+    // Dead until the rotors blow on the ground, like ParticleSystem::Respawn
+    particles[i].position = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    particles[i].velocity = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    particles[i].random = vec4(value, cos(angle), sin(angle), 1.0f);
+}
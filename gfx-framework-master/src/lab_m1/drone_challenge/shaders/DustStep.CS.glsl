@@ -0,0 +1,75 @@
+#version 430
+
+layout(local_size_x = 64) in;
+
+struct Particle {
+    vec4 position;    // x, y, z, age over lifetime, 1 when dead
+    vec4 velocity;    // x, y, z, age
+    vec4 random;      // fixed random value, direction x and z, lifetime
+};
+
+layout(std430, binding = 0) buffer Particles {
+    Particle particles[];
+};
+
+// Uniform properties
+uniform uint particle_count;
+uniform float delta_time;
+
+// Ground point under the drone, how hard the rotors blow on it, 0 when too high
+uniform vec2 wash_center;
+uniform float wash_strength;
+uniform float wash_radius;
+
+// Where the dust lands, the height of the last wash center
+uniform float ground;
+
+// Cosine and sine of the turn of the spawn directions, the golden angle every step
+uniform vec2 spin;
+
+// The same step as ParticleSystem::StepDust, one particle per invocation
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= particle_count) {
+        return;
+    }
+
+    Particle particle = particles[i];
+    vec3 position = particle.position.xyz;
+    vec3 velocity = particle.velocity.xyz;
+    float age = particle.velocity.w + delta_time;
+    float life = particle.random.w;
+
+    if (wash_strength > 0.0f && age >= life) {
+        // Blown outwards from a ring under the rotors, and upwards
+        float s = particle.random.x;
+        vec2 direction = vec2(particle.random.y * spin.x - particle.random.z * spin.y,
+            particle.random.y * spin.y + particle.random.z * spin.x);
+        float ring = wash_radius * (0.3f + 0.7f * s);
+        float speed = wash_strength * (2.0f + 3.0f * s);
+
+        position = vec3(wash_center.x + direction.x * ring, ground + 0.05f, wash_center.y + direction.y * ring);
+        velocity = vec3(direction.x * speed, wash_strength * (0.5f + 1.5f * (1.0f - s)), direction.y * speed);
+
+        // A short random delay spreads the respawns over the following frames
+        age = -0.25f * s;
+        life = 0.8f + 1.2f * s;
+    }
+
+    bool alive = age >= 0.0f && age < life;
+    if (alive) {
+        velocity *= max(1.0f - 1.5f * delta_time, 0.0f);
+        velocity.y -= 1.5f * delta_time;
+        position += velocity * delta_time;
+
+        if (position.y < ground) {
+            position.y = ground;
+            velocity.y *= -0.3f;
+        }
+    }
+
+    particles[i].position = vec4(position, alive ? age / life : 1.0f);
+    particles[i].velocity = vec4(velocity, age);
+    particles[i].random.w = life;
+}
@@ -0,0 +1,22 @@
+#version 330
+
+// Input
+in vec2 tex_coord;
+in float shade;
+
+// Uniform properties
+uniform sampler2D billboard;
+
+// Output
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+    // Alpha tested, so the clumps need no sorting
+    vec4 texel = texture(billboard, tex_coord);
+    if (texel.a < 0.5f) {
+        discard;
+    }
+
+    out_color = vec4(texel.rgb * shade, 1.0f);
+}
@@ -0,0 +1,117 @@
+#version 330
+#pragma features CULLED
+
+// CULLED   draws the clumps kept by GroundCoverCull.CS.glsl instead of testing them here
+
+// Input
+#ifdef CULLED
+layout(location = 1) in vec4 clump;    // x, z, angle, scale
+#else
+layout(location = 1) in vec4 tile;     // tile x, tile z, clumps to test, unused
+#endif
+
+// Uniform properties
+uniform mat4 View;
+uniform mat4 Projection;
+uniform vec3 eye_position;
+uniform float time;
+uniform float clump_height;
+
+// uv = xz * noise_transform.xy + noise_transform.zw
+uniform sampler2D u_texture_0;
+uniform vec4 noise_transform;
+
+#ifndef CULLED
+uniform float seed;
+uniform vec2 field_min;
+uniform float tile_size;
+uniform int clumps_per_tile;
+// Every tile of the draw is repeated for this many instances
+uniform int clumps_per_instance;
+
+uniform vec2 dense_points[8];
+uniform int num_dense_points;
+uniform float base_density;
+uniform float dense_radius;
+uniform float fade_start;
+uniform float fade_end;
+#endif
+
+// Output
+out vec2 tex_coord;
+out float shade;
+
+#ifndef CULLED
+uint hash (uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float random (inout uint state) {
+    state = hash(state);
+    return float(state >> 8) / 16777216.0f;
+}
+
+float density (vec3 position) {
+    float base = base_density;
+    for (int i = 0; i < num_dense_points; ++i) {
+        base = max(base, 1.0f - smoothstep(dense_radius * 0.5f, dense_radius, distance(position.xz, dense_points[i])));
+    }
+    return base * (1.0f - smoothstep(fade_start, fade_end, distance(position, eye_position)));
+}
+
+// Same as GroundCoverCull.CS.glsl: x, z, angle, scale, zero scale when the clump is dropped
+vec4 place_clump (vec2 tile_index, uint k) {
+    uint state = hash(hash(floatBitsToUint(seed) ^ uint(tile_index.x)) ^ (uint(tile_index.y) << 16)) + k;
+    vec2 xz = field_min + (tile_index + vec2(random(state), random(state))) * tile_size;
+    float angle = random(state) * 3.14159265f;
+    float scale = 0.7f + 0.6f * random(state);
+
+    vec3 position = vec3(xz.x, textureLod(u_texture_0, xz * noise_transform.xy + noise_transform.zw, 0.0f).r, xz.y);
+    float threshold = (float(k) + 0.5f) / float(clumps_per_tile);
+
+    // Clumps close to their threshold shrink, so the density changes without popping
+    return vec4(xz, angle, scale * clamp((density(position) - threshold) * 10.0f, 0.0f, 1.0f));
+}
+#endif
+
+void main()
+{
+#ifdef CULLED
+    vec4 placed = clump;
+#else
+    uint k = uint(gl_InstanceID % clumps_per_instance);
+    vec4 placed = k < uint(tile.z) ? place_clump(tile.xy, k) : vec4(0.0f);
+#endif
+
+    // Dropped clumps collapse to a point outside the clip volume
+    if (placed.w <= 0.0f) {
+        gl_Position = vec4(2.0f, 2.0f, 2.0f, 1.0f);
+        tex_coord = vec2(0.0f);
+        shade = 0.0f;
+        return;
+    }
+
+    // Two crossed quads of two triangles each
+    const vec2 corners[6] = vec2[6](vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(1.0f, 1.0f),
+                                    vec2(0.0f, 0.0f), vec2(1.0f, 1.0f), vec2(0.0f, 1.0f));
+    vec2 corner = corners[gl_VertexID % 6];
+    float angle = placed.z + float(gl_VertexID / 6) * 1.57079633f;
+    float height = clump_height * placed.w;
+
+    vec3 base = vec3(placed.x, textureLod(u_texture_0, placed.xy * noise_transform.xy + noise_transform.zw, 0.0f).r, placed.y);
+    vec3 position = base + vec3(cos(angle), 0.0f, sin(angle)) * (corner.x - 0.5f) * height + vec3(0.0f, corner.y * height, 0.0f);
+
+    // Only the tips move in the wind
+    float sway = sin(time * 2.0f + placed.x * 0.7f + placed.y * 0.5f) * 0.15f * height;
+    position.xz += corner.y * vec2(sway, sway * 0.5f);
+
+    tex_coord = vec2(corner.x, corner.y);
+    shade = mix(0.45f, 1.0f, corner.y);
+
+    gl_Position = Projection * View * vec4(position, 1.0f);
+}
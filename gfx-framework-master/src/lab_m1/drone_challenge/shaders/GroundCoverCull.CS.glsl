@@ -0,0 +1,102 @@
+#version 430
+
+layout(local_size_x = 64) in;
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+};
+
+// tile x, tile z, clumps to test, unused; one work group row per tile
+layout(std430, binding = 0) readonly buffer Tiles {
+    vec4 tiles[];
+};
+
+// x, z, angle, scale
+layout(std430, binding = 1) writeonly buffer Visible {
+    vec4 visible[];
+};
+
+layout(std430, binding = 2) buffer Command {
+    DrawCommand command;
+};
+
+// Uniform properties
+uniform vec4 frustum_planes[6];
+uniform float clump_height;
+
+uniform sampler2D u_texture_0;
+uniform vec4 noise_transform;
+
+uniform float seed;
+uniform vec2 field_min;
+uniform float tile_size;
+uniform int clumps_per_tile;
+uniform vec3 eye_position;
+
+uniform vec2 dense_points[8];
+uniform int num_dense_points;
+uniform float base_density;
+uniform float dense_radius;
+uniform float fade_start;
+uniform float fade_end;
+
+uint hash (uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float random (inout uint state) {
+    state = hash(state);
+    return float(state >> 8) / 16777216.0f;
+}
+
+float density (vec3 position) {
+    float base = base_density;
+    for (int i = 0; i < num_dense_points; ++i) {
+        base = max(base, 1.0f - smoothstep(dense_radius * 0.5f, dense_radius, distance(position.xz, dense_points[i])));
+    }
+    return base * (1.0f - smoothstep(fade_start, fade_end, distance(position, eye_position)));
+}
+
+void main()
+{
+    vec4 tile = tiles[gl_WorkGroupID.y];
+    uint k = gl_GlobalInvocationID.x;
+    if (k >= uint(tile.z)) {
+        return;
+    }
+
+    // Same placement as GroundCover.VS.glsl
+    uint state = hash(hash(floatBitsToUint(seed) ^ uint(tile.x)) ^ (uint(tile.y) << 16)) + k;
+    vec2 xz = field_min + (tile.xy + vec2(random(state), random(state))) * tile_size;
+    float angle = random(state) * 3.14159265f;
+    float scale = 0.7f + 0.6f * random(state);
+
+    vec3 position = vec3(xz.x, textureLod(u_texture_0, xz * noise_transform.xy + noise_transform.zw, 0.0f).r, xz.y);
+    float threshold = (float(k) + 0.5f) / float(clumps_per_tile);
+    scale *= clamp((density(position) - threshold) * 10.0f, 0.0f, 1.0f);
+    if (scale <= 0.0f) {
+        return;
+    }
+
+    // Bounding sphere of the two quads, with room for the sway
+    float height = clump_height * scale;
+    vec3 center = position + vec3(0.0f, height * 0.5f, 0.0f);
+    float radius = height * 0.9f;
+
+    for (int i = 0; i < 6; ++i) {
+        if (dot(frustum_planes[i].xyz, center) + frustum_planes[i].w < -radius) {
+            return;
+        }
+    }
+
+    uint slot = atomicAdd(command.instanceCount, 1u);
+    visible[slot] = vec4(xz, angle, scale);
+}
@@ -0,0 +1,32 @@
+#version 330
+
+// Input
+in vec3 world_position;
+in vec2 tex_coord;
+flat in vec3 frame_dir;
+flat in float radius;
+
+// Uniform properties
+uniform mat4 View;
+uniform mat4 Projection;
+uniform sampler2D atlas;
+
+// Output
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+    vec4 texel = texture(atlas, tex_coord);
+    if (texel.a < 0.5f / 255.0f) {
+        discard;
+    }
+
+    // Move the fragment from the quad plane to the baked surface
+    float depth = (texel.a * 255.0f - 1.0f) / 254.0f;
+    vec3 surface = world_position + frame_dir * (radius - 2.0f * radius * depth);
+
+    vec4 clip = Projection * View * vec4(surface, 1.0f);
+    gl_FragDepth = (clip.z / clip.w) * 0.5f + 0.5f;
+
+    out_color = vec4(texel.rgb, 1);
+}
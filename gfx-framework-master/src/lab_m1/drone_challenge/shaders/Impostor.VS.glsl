@@ -0,0 +1,64 @@
+#version 330
+
+#define MAX_ARCHETYPES 16
+
+// Input
+layout(location = 0) in vec2 corner;
+layout(location = 1) in vec4 instance;    // x, z, archetype index, unused
+
+// Uniform properties
+uniform mat4 View;
+uniform mat4 Projection;
+uniform vec3 eye_position;
+
+uniform float archetype_center_y[MAX_ARCHETYPES];
+uniform float archetype_radius[MAX_ARCHETYPES];
+
+uniform int frames;
+uniform vec2 atlas_size;
+uniform float tile_size;
+
+// Output
+out vec3 world_position;
+out vec2 tex_coord;
+flat out vec3 frame_dir;
+flat out float radius;
+
+vec2 encodeHemiOct(vec3 dir) {
+    dir.y = max(dir.y, 0.0f);
+    dir /= (abs(dir.x) + abs(dir.y) + abs(dir.z));
+
+    return vec2(dir.x + dir.z, dir.z - dir.x) * 0.5f + 0.5f;
+}
+
+vec3 decodeHemiOct(vec2 uv) {
+    vec2 oct = uv * 2.0f - 1.0f;
+    vec2 xz = vec2(oct.x - oct.y, oct.x + oct.y) * 0.5f;
+
+    return normalize(vec3(xz.x, 1.0f - abs(xz.x) - abs(xz.y), xz.y));
+}
+
+void main()
+{
+    int archetype = int(instance.z);
+    radius = archetype_radius[archetype];
+
+    vec3 center = vec3(instance.x, archetype_center_y[archetype], instance.y);
+
+    // The baked frame closest to the current view direction
+    vec2 uv = encodeHemiOct(normalize(eye_position - center));
+    vec2 frame = clamp(floor(uv * float(frames)), vec2(0.0f), vec2(float(frames - 1)));
+    frame_dir = decodeHemiOct((frame + 0.5f) / float(frames));
+
+    // Same basis as the bake camera
+    vec3 side = cross(vec3(0.0f, 1.0f, 0.0f), frame_dir);
+    vec3 right = dot(side, side) < 1e-6f ? vec3(1.0f, 0.0f, 0.0f) : normalize(side);
+    vec3 up = cross(frame_dir, right);
+
+    world_position = center + (corner.x * right + corner.y * up) * radius;
+
+    vec2 tile = vec2(float(archetype * frames) + frame.x, frame.y);
+    tex_coord = (tile + corner * 0.5f + 0.5f) * tile_size / atlas_size;
+
+    gl_Position = Projection * View * vec4(world_position, 1.0f);
+}
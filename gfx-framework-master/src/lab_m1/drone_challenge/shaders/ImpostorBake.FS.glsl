@@ -0,0 +1,23 @@
+#version 330
+
+// Input
+in vec3 world_position;
+in vec3 frag_color;
+
+// Uniform properties
+uniform vec3 impostor_center;
+uniform vec3 impostor_dir;
+uniform float impostor_radius;
+
+// Output
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+    // Distance from the bake camera, 0 at the near side of the bounding sphere
+    float offset = dot(world_position - impostor_center, impostor_dir);
+    float depth = clamp((impostor_radius - offset) / (2.0f * impostor_radius), 0.0f, 1.0f);
+
+    // Alpha 0 is kept for the empty texels
+    out_color = vec4(frag_color, (1.0f + 254.0f * depth) / 255.0f);
+}
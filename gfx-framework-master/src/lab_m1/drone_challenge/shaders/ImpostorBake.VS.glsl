@@ -0,0 +1,24 @@
+#version 330
+
+// Input
+layout(location = 0) in vec3 v_position;
+layout(location = 3) in vec3 v_color;
+
+// Uniform properties
+uniform mat4 Model;
+uniform mat4 View;
+uniform mat4 Projection;
+
+// Output
+out vec3 world_position;
+out vec3 frag_color;
+
+void main()
+{
+    vec4 world = Model * vec4(v_position, 1.0f);
+
+    world_position = world.xyz;
+    frag_color = v_color;
+
+    gl_Position = Projection * View * world;
+}
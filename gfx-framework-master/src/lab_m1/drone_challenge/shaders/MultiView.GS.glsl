@@ -0,0 +1,25 @@
+#version 330
+
+// Sends every triangle to the layer of its view
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+// Input
+in vec3 vs_color[];
+flat in int vs_layer[];
+
+// Output
+out vec3 frag_color;
+
+void main()
+{
+    for (int i = 0; i < 3; i++) {
+        gl_Layer = vs_layer[i];
+        frag_color = vs_color[i];
+        gl_Position = gl_in[i].gl_Position;
+        EmitVertex();
+    }
+
+    EndPrimitive();
+}
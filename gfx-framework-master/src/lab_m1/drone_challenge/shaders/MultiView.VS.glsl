@@ -0,0 +1,68 @@
+#version 330
+#pragma features FIELD
+
+// Draws a scene once per view into the layers of an array framebuffer, the
+// view of every instance is picked here and written to gl_Layer by MultiView.GS.glsl
+// FIELD   draws the field mesh once per view instead of the obstacle parts
+
+// Input
+layout(location = 0) in vec3 v_position;
+layout(location = 3) in vec3 v_color;
+layout(location = 4) in vec4 instance;    // x, z, scale factor, part
+
+// Uniform properties
+// view_count view-projection matrices, one column per texel
+uniform samplerBuffer view_projections;
+uniform int view_count;
+
+#ifdef FIELD
+uniform sampler2D u_texture_0;
+// uv = xz * noise_transform.xy + noise_transform.zw
+uniform vec4 noise_transform;
+#else
+uniform float trunk_height;
+#endif
+
+// Output
+out vec3 vs_color;
+flat out int vs_layer;
+
+const int CROWN = 1;
+
+mat4 view_projection(int view)
+{
+    return mat4(texelFetch(view_projections, 4 * view),
+                texelFetch(view_projections, 4 * view + 1),
+                texelFetch(view_projections, 4 * view + 2),
+                texelFetch(view_projections, 4 * view + 3));
+}
+
+void main()
+{
+    vec3 position = v_position;
+
+#ifdef FIELD
+    // One instance per view, the colors of VertexShader.glsl and FragmentShader.glsl. The
+    // mesh already has the heights.
+    vs_layer = gl_InstanceID;
+
+    float noise_value = textureLod(u_texture_0, position.xz * noise_transform.xy + noise_transform.zw, 0.0f).r;
+    vs_color = mix(vec3(0.65f, 0.32f, 0.17f), vec3(0.0f, 0.5f, 0.0f), noise_value);
+#else
+    // view_count instances per obstacle part, the attribute divisor is view_count
+    vs_layer = gl_InstanceID % view_count;
+
+    // Same transforms as ObstacleIndirect.VS.glsl
+    float scale = instance.z;
+    if (int(instance.w) == CROWN) {
+        position.y += trunk_height * scale;
+    } else {
+        position.y *= scale;
+    }
+
+    position += vec3(instance.x, 0.0f, instance.y);
+    vs_color = v_color;
+#endif
+
+    gl_Position = view_projection(vs_layer) * vec4(position, 1.0f);
+}
@@ -0,0 +1,69 @@
+#version 430
+
+layout(local_size_x = 64) in;
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+// x, z, scale factor, obstacle type
+layout(std430, binding = 0) readonly buffer Instances {
+    vec4 instances[];
+};
+
+// x, z, scale factor, part
+layout(std430, binding = 1) writeonly buffer Visible {
+    vec4 visible[];
+};
+
+// trunk, crown, house body, house roof
+layout(std430, binding = 2) buffer Commands {
+    DrawCommand commands[];
+};
+
+// Uniform properties
+uniform uint instance_count;
+uniform vec4 frustum_planes[6];
+
+uniform float trunk_height;
+uniform float crown_top;
+uniform float crown_radius;
+uniform float house_side;
+uniform float roof_height;
+
+const int TREE = 0;
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= instance_count) {
+        return;
+    }
+
+    vec4 obstacle = instances[id];
+    float scale = obstacle.z;
+    bool isTree = int(obstacle.w) == TREE;
+
+    // Bounding sphere around the whole obstacle
+    float height = isTree ? trunk_height * scale + crown_top : (house_side + roof_height) * scale;
+    float halfWidth = isTree ? crown_radius : house_side * 0.70710678f;
+
+    vec3 center = vec3(obstacle.x, height * 0.5f, obstacle.y);
+    float radius = length(vec2(halfWidth, height * 0.5f));
+
+    for (int i = 0; i < 6; ++i) {
+        if (dot(frustum_planes[i].xyz, center) + frustum_planes[i].w < -radius) {
+            return;
+        }
+    }
+
+    uint firstPart = isTree ? 0u : 2u;
+    for (uint part = firstPart; part < firstPart + 2u; ++part) {
+        uint slot = atomicAdd(commands[part].instanceCount, 1u);
+        visible[commands[part].baseInstance + slot] = vec4(obstacle.xyz, float(part));
+    }
+}
@@ -0,0 +1,32 @@
+#version 330
+
+// Input
+layout(location = 0) in vec3 v_position;
+layout(location = 3) in vec3 v_color;
+layout(location = 4) in vec4 instance;    // x, z, scale factor, part
+
+// Uniform properties
+uniform mat4 View;
+uniform mat4 Projection;
+uniform float trunk_height;
+
+// Output
+out vec3 frag_color;
+
+const int CROWN = 1;
+
+void main()
+{
+    float scale = instance.z;
+    vec3 position = v_position;
+
+    // Same transforms as obstacle::GenerateTree and obstacle::GenerateHouse
+    if (int(instance.w) == CROWN) {
+        position.y += trunk_height * scale;
+    } else {
+        position.y *= scale;
+    }
+
+    frag_color = v_color;
+    gl_Position = Projection * View * vec4(position + vec3(instance.x, 0.0f, instance.y), 1.0f);
+}
@@ -0,0 +1,24 @@
+#version 330
+
+// Input
+in vec2 tex_coord;
+in float alpha;
+
+// Uniform properties
+uniform sampler2D sprite;
+uniform vec4 tint;
+
+// Output
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+    // The sprites are white shapes on black without an alpha channel
+    vec3 texel = texture(sprite, tex_coord).rgb;
+    float coverage = max(texel.r, max(texel.g, texel.b)) * tint.a * alpha;
+    if (coverage < 1.0f / 255.0f) {
+        discard;
+    }
+
+    out_color = vec4(tint.rgb, coverage);
+}
@@ -0,0 +1,50 @@
+#version 330
+
+// Input
+layout(location = 0) in vec2 corner;
+layout(location = 1) in vec4 instance;    // x, y, z, age over lifetime or random value
+
+// Uniform properties
+uniform mat4 View;
+uniform mat4 Projection;
+uniform vec3 eye_position;
+
+uniform float size;
+// World space half length of a rain streak, zero for round particles
+uniform vec3 streak;
+uniform int fade_with_age;
+
+// Output
+out vec2 tex_coord;
+out float alpha;
+
+void main()
+{
+    // The dust stepped on the GPU keeps its dead particles in the buffer, behind the far plane
+    if (fade_with_age != 0 && instance.w >= 1.0f) {
+        gl_Position = vec4(0.0f, 0.0f, 2.0f, 1.0f);
+        tex_coord = vec2(0.0f);
+        alpha = 0.0f;
+        return;
+    }
+
+    vec3 center = instance.xyz;
+    vec3 right, up;
+
+    if (dot(streak, streak) > 0.0f) {
+        // A thin quad along the fall, turned towards the camera
+        vec3 side = cross(streak, eye_position - center);
+        right = dot(side, side) > 1e-8f ? normalize(side) * size : vec3(size, 0.0f, 0.0f);
+        up = streak;
+    } else {
+        // The rows of the view matrix are the camera axes, the dust grows as it spreads
+        float scale = size * (0.75f + 0.5f * instance.w);
+        right = vec3(View[0][0], View[1][0], View[2][0]) * scale;
+        up = vec3(View[0][1], View[1][1], View[2][1]) * scale;
+    }
+
+    alpha = fade_with_age != 0 ? 1.0f - instance.w : 0.6f + 0.4f * instance.w;
+    tex_coord = corner * 0.5f + 0.5f;
+
+    gl_Position = Projection * View * vec4(center + corner.x * right + corner.y * up, 1.0f);
+}
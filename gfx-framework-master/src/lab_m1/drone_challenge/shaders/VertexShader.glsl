@@ -1,4 +1,10 @@
 #version 330
+#pragma features FIELD_NOISE NOISE_FROM_TEXTURE LOW_QUALITY
+
+// FIELD_NOISE          evaluates the value noise for every vertex
+// NOISE_FROM_TEXTURE   reads the heights baked by heightfield::HeightField instead, for
+//                      the colors only: the field mesh has them in its vertices
+// LOW_QUALITY          for small top-down views: flat, linear interpolation
 
 // Input
 layout(location = 0) in vec3 position;
@@ -9,6 +15,12 @@ uniform mat4 View;
 uniform mat4 Projection;
 uniform float seed;
 
+#ifdef NOISE_FROM_TEXTURE
+uniform sampler2D u_texture_0;
+// uv = xz * noise_transform.xy + noise_transform.zw
+uniform vec4 noise_transform;
+#endif
+
 // Output
 out float noise_value;
 
@@ -25,20 +37,39 @@ float noise (in vec2 pos) {
     float c = random(i + vec2(0.0f, 1.0f) + seed);
     float d = random(i + vec2(1.0f, 1.0f) + seed);
 
+#ifdef LOW_QUALITY
+    vec2 u = j;
+#else
     vec2 u = j * j * (3.0f - 2.0f * j);
+#endif
     
     return mix(a, b, u.x) +
             (c - a) * u.y * (1.0f - u.x) +
             (d - b) * u.x * u.y;
 }
 
+float field_noise (in vec2 pos) {
+	const float frequency = 5.0f;
+
+#if defined(NOISE_FROM_TEXTURE)
+	return textureLod(u_texture_0, pos * noise_transform.xy + noise_transform.zw, 0.0f).r;
+#elif defined(FIELD_NOISE)
+	return noise(pos * frequency);
+#else
+	return 0.0f;
+#endif
+}
+
 void main()
 {
-	const float frequency = 5.0f;
-	noise_value = noise(position.xz * frequency);
+	noise_value = field_noise(position.xz);
 
 	vec3 new_pos = position;
+#if defined(LOW_QUALITY)
+    new_pos.y = 0.0f;
+#elif !defined(NOISE_FROM_TEXTURE)
     new_pos.y += noise_value; 
+#endif
 
 	gl_Position = Projection * View * Model * vec4(new_pos, 1.0f);
 }
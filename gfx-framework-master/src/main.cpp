@@ -1,11 +1,17 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <iostream>
 
 #include "core/engine.h"
+#include "core/gpu/render_stats.h"
 #include "components/simple_scene.h"
 
 #if defined(WITH_LAB_M1)
 #   include "lab_m1/lab_list.h"
+#   include "lab_m1/drone_challenge/headers/world_scale.h"
 #endif
 
 #if defined(WITH_LAB_M2)
@@ -30,25 +36,147 @@ std::string GetParentDir(const std::string &filePath)
 }
 
 
+void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+        "  --headless           no window, draw offscreen (surfaceless EGL without a display)\n"
+        "  --resolution WxH     default 1920x1080\n"
+        "  --benchmark          replay a flight with vsync off and write a JSON report\n"
+        "  --frames N           measured frames of the benchmark, default 1000\n"
+        "  --warmup N           frames run before them, default 60\n"
+        "  --input PATH         key script of the benchmark, default the drone challenge flight\n"
+        "  --report PATH        default benchmark.json next to the executable\n"
+        "  --stats-csv PATH     write the counters of every frame on exit\n"
+        "  --no-idle            keep running frames while the window is minimized or in the background\n"
+        "  --vsync MODE         on, off or adaptive (late frames tear), default on, off for benchmarks\n"
+        "  --fps N              limit the frame rate\n"
+        "  --render-late        with the vsync, poll the input just before the vblank\n"
+        "  --late-margin MS     of render late before the predicted vblank, default 1\n"
+        "  --render-thread      draw on a second thread while the next step is simulated\n";
+
+#if defined(WITH_LAB_M1)
+    scale::PrintUsage();
+#endif
+}
+
+
 int main(int argc, char **argv)
 {
     // Create a window property structure
     WindowProperties wp;
     wp.resolution = glm::ivec2(1920, 1080);
     wp.vSync = true;
+    wp.glVersion = glm::ivec2(4, 3);
     wp.selfDir = GetParentDir(std::string(argv[0]));
 
+    bool runBenchmark = false;
+    bool idleInBackground = true;
+    bool renderThread = false;
+
+    // The World only paces its frames when one of the pacing options is set
+    bool pace = false;
+    bool vSyncSet = false;
+    FramePacer::Config pacing;
+    Benchmark::Config benchmark;
+    benchmark.inputPath = PATH_JOIN(wp.selfDir, SOURCE_PATH::M1, "drone_challenge", "benchmark_flight.txt");
+    benchmark.reportPath = PATH_JOIN(wp.selfDir, "benchmark.json");
+    std::string statsCsvPath;
+
+#if defined(WITH_LAB_M1)
+    scale::WorldScale worldScale;
+#endif
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--headless")) {
+            wp.headless = true;
+        } else if (!strcmp(argv[i], "--benchmark")) {
+            runBenchmark = true;
+        } else if (!strcmp(argv[i], "--no-idle")) {
+            idleInBackground = false;
+        } else if (!strcmp(argv[i], "--render-thread")) {
+            renderThread = true;
+        } else if (!strcmp(argv[i], "--vsync") && hasValue
+            && (!strcmp(argv[i + 1], "on") || !strcmp(argv[i + 1], "off") || !strcmp(argv[i + 1], "adaptive"))) {
+            i++;
+            pacing.swapMode = !strcmp(argv[i], "on") ? FramePacer::SWAP_VSYNC
+                : !strcmp(argv[i], "off") ? FramePacer::SWAP_IMMEDIATE : FramePacer::SWAP_ADAPTIVE;
+            pace = vSyncSet = true;
+        } else if (!strcmp(argv[i], "--fps") && hasValue) {
+            pacing.targetFps = std::max(0.0, atof(argv[++i]));
+            pace = true;
+        } else if (!strcmp(argv[i], "--render-late")) {
+            pacing.renderLate = true;
+            pace = true;
+        } else if (!strcmp(argv[i], "--late-margin") && hasValue) {
+            pacing.lateMarginMilliseconds = std::max(0.0, atof(argv[++i]));
+            pace = true;
+        } else if (!strcmp(argv[i], "--resolution") && hasValue
+            && sscanf(argv[i + 1], "%dx%d", &wp.resolution.x, &wp.resolution.y) == 2) {
+            i++;
+        } else if (!strcmp(argv[i], "--frames") && hasValue) {
+            benchmark.frames = static_cast<unsigned int>(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--warmup") && hasValue) {
+            benchmark.warmupFrames = static_cast<unsigned int>(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--input") && hasValue) {
+            benchmark.inputPath = argv[++i];
+        } else if (!strcmp(argv[i], "--report") && hasValue) {
+            benchmark.reportPath = argv[++i];
+        } else if (!strcmp(argv[i], "--stats-csv") && hasValue) {
+            statsCsvPath = argv[++i];
+#if defined(WITH_LAB_M1)
+        } else if (scale::ParseArgument(argc, argv, i, worldScale)) {
+            // The world options and their values
+#endif
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Frames as fast as the GPU draws them
+    if (runBenchmark && !vSyncSet) {
+        pacing.swapMode = FramePacer::SWAP_IMMEDIATE;
+    }
+    wp.vSync = pacing.swapMode != FramePacer::SWAP_IMMEDIATE;
+
     // Init the Engine and create a new window with the defined properties
     (void)Engine::Init(wp);
 
+#if defined(WITH_LAB_M1)
+    // The drone challenge generates its world at this scale
+    scale::Set(worldScale);
+#endif
+
+    // Every frame is kept until the World writes them when it is destroyed
+    if (!statsCsvPath.empty()) {
+        RenderStats::EnableCsv(statsCsvPath);
+    }
+
     // Create a new 3D world and start running it
     World *world = new m1::DroneChallenge();
 
     world->Init();
-    world->Run();
+    world->SetIdleInBackground(idleInBackground);
+    world->SetRenderThread(renderThread);
+    if (pace) {
+        world->SetFramePacing(pacing);
+    }
+
+    int status = 0;
+    if (runBenchmark) {
+        status = world->RunBenchmark(benchmark) ? 0 : 1;
+    } else {
+        world->Run();
+    }
+
+    // The world releases its GPU resources and writes its stats while the context is current
+    delete world;
 
     // Signals to the Engine to release the OpenGL context
     Engine::Exit();
 
-    return 0;
+    return status;
 }
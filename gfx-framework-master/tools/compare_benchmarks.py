@@ -0,0 +1,83 @@
+import sys
+import json
+import argparse
+
+
+class RET:
+    OK = 0
+    FAIL = 1
+
+
+def make_parser():
+    parser = argparse.ArgumentParser(
+        description="Compares two JSON results of GFXBenchmarks, e.g. of two commits.")
+
+    parser.add_argument("baseline", type=str,
+        help="Results of the reference commit.")
+    parser.add_argument("contender", type=str,
+        help="Results of the commit to compare.")
+    parser.add_argument("-t", "--threshold", type=float, default=5.0,
+        help="Changes of ns/op above this percentage are marked, 5 by default.")
+    parser.add_argument("--fail-on-regression", action="store_true",
+        help="Exit with an error when a benchmark is slower by more than the threshold.")
+
+    return parser.parse_args()
+
+
+def load_results(path):
+    with open(path, "r") as fi:
+        data = json.load(fi)
+
+    return data["context"], {b["name"]: b for b in data["benchmarks"]}
+
+
+def compare_benchmarks(baseline_path, contender_path, threshold, fail_on_regression):
+    try:
+        baseline_context, baseline = load_results(baseline_path)
+        contender_context, contender = load_results(contender_path)
+
+    except Exception as e:
+        print("Cannot read the results: ", str(e))
+        return RET.FAIL
+
+    for key in ["build", "compiler", "threads"]:
+        if baseline_context.get(key) != contender_context.get(key):
+            print("Warning: the %s differs, %s and %s" % (key, baseline_context.get(key), contender_context.get(key)))
+
+    print("%-44s %14s %14s %9s" % ("Benchmark", "base ns/op", "new ns/op", "change"))
+    print("-" * 84)
+
+    regressions = 0
+    for name, result in contender.items():
+        if name not in baseline:
+            print("%-44s %14s %14.2f %9s" % (name, "-", result["ns_per_op"], "new"))
+            continue
+
+        before = baseline[name]["ns_per_op"]
+        after = result["ns_per_op"]
+        change = (after - before) / before * 100.0 if before > 0 else 0.0
+
+        # The spread of the repetitions, changes within it are noise
+        noise = max(baseline[name]["max_ns_per_op"] - baseline[name]["min_ns_per_op"],
+                    result["max_ns_per_op"] - result["min_ns_per_op"])
+        marker = ""
+        if abs(change) > threshold and abs(after - before) > noise:
+            marker = "  slower" if change > 0 else "  faster"
+            regressions += change > 0
+
+        print("%-44s %14.2f %14.2f %+8.1f%%%s" % (name, before, after, change, marker))
+
+    for name in baseline:
+        if name not in contender:
+            print("%-44s %14.2f %14s %9s" % (name, baseline[name]["ns_per_op"], "-", "removed"))
+
+    print("")
+    print("%d of %d benchmarks slower by more than %.1f%%" % (regressions, len(contender), threshold))
+
+    return RET.FAIL if fail_on_regression and regressions > 0 else RET.OK
+
+
+if __name__ == "__main__":
+    args = make_parser()
+    ret = compare_benchmarks(args.baseline, args.contender, args.threshold, args.fail_on_regression)
+    sys.exit(ret)
@@ -0,0 +1,129 @@
+import os
+import sys
+import csv
+import json
+import argparse
+import tempfile
+import subprocess
+
+
+class RET:
+    OK = 0
+    FAIL = 1
+
+
+FIELDS = [50, 128, 512, 2048, 8192]
+OBSTACLES = [35, 1000, 10000, 100000, 1000000]
+
+METRICS = ["generate_obstacles_ms", "bake_field_ms", "create_meshes_ms"]
+FRAME_STATS = ["avg", "p50", "p95", "p99", "max"]
+
+
+def int_list(text):
+    return [int(value) for value in text.split(",") if value]
+
+
+def make_parser():
+    parser = argparse.ArgumentParser(
+        description="Runs the drone challenge benchmark over a grid of world scales and writes one CSV row per run.")
+
+    parser.add_argument("executable", type=str,
+        help="The GFXFramework executable.")
+    parser.add_argument("-o", "--out", type=str, default="scaling.csv",
+        help="The CSV file, scaling.csv by default.")
+    parser.add_argument("--fields", type=int_list, default=FIELDS,
+        help="Field sizes, comma separated, 50,128,512,2048,8192 by default.")
+    parser.add_argument("--obstacles", type=int_list, default=OBSTACLES,
+        help="Obstacle counts, comma separated, 35,1000,10000,100000,1000000 by default.")
+    parser.add_argument("--frames", type=int, default=300,
+        help="Measured frames of every run, 300 by default.")
+    parser.add_argument("--warmup", type=int, default=30,
+        help="Frames before them, 30 by default.")
+    parser.add_argument("--input", type=str, default=None,
+        help="Key script of the flight, the one of the executable by default.")
+    parser.add_argument("--timeout", type=float, default=600.0,
+        help="Seconds after which a run is stopped, 600 by default.")
+    parser.add_argument("--window", action="store_true",
+        help="Run with a window instead of headless.")
+
+    return parser.parse_args()
+
+
+def run_point(args, field, obstacles, report_path):
+    command = [args.executable, "--benchmark",
+               "--frames", str(args.frames), "--warmup", str(args.warmup),
+               "--field", str(field), str(field), "--obstacles", str(obstacles),
+               "--report", report_path]
+    if not args.window:
+        command.append("--headless")
+    if args.input:
+        command += ["--input", args.input]
+
+    row = {"field": field, "obstacles": obstacles}
+
+    try:
+        process = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=args.timeout)
+    except subprocess.TimeoutExpired:
+        row["status"] = "timeout"
+        return row
+
+    if process.returncode != 0 or not os.path.isfile(report_path):
+        row["status"] = "exit %d" % process.returncode
+        return row
+
+    with open(report_path, "r") as fi:
+        report = json.load(fi)
+
+    row["status"] = "ok"
+    row["peak_memory_mb"] = report.get("peak_memory_mb", "")
+    for metric in METRICS:
+        row[metric] = report.get("metrics", {}).get(metric, "")
+    for stat in FRAME_STATS:
+        row["frame_%s_ms" % stat] = report["frame_ms"][stat]
+    row["fps"] = report["fps"]
+    return row
+
+
+def scaling_sweep(args):
+    if not os.path.isfile(args.executable):
+        print("Cannot find the executable", args.executable)
+        return RET.FAIL
+
+    columns = (["field", "obstacles", "status", "peak_memory_mb"] + METRICS
+               + ["frame_%s_ms" % stat for stat in FRAME_STATS] + ["fps"])
+
+    handle, report_path = tempfile.mkstemp(suffix=".json")
+    os.close(handle)
+
+    failures = 0
+    with open(args.out, "w", newline="") as fo:
+        writer = csv.DictWriter(fo, fieldnames=columns)
+        writer.writeheader()
+
+        for field in args.fields:
+            for obstacles in args.obstacles:
+                # A failed run must not leave the report of the previous one
+                if os.path.isfile(report_path):
+                    os.remove(report_path)
+
+                row = run_point(args, field, obstacles, report_path)
+                writer.writerow(row)
+                fo.flush()
+
+                failures += row["status"] != "ok"
+                print("field %5d, %7d obstacles: %s" % (field, obstacles,
+                    row["status"] if row["status"] != "ok" else "%.2f ms p50, %.1f MB" % (row["frame_p50_ms"], row["peak_memory_mb"])))
+
+    if os.path.isfile(report_path):
+        os.remove(report_path)
+
+    print("")
+    print("%d runs written to %s, %d failed" % (len(args.fields) * len(args.obstacles), args.out, failures))
+
+    return RET.FAIL if failures > 0 else RET.OK
+
+
+if __name__ == "__main__":
+    args = make_parser()
+    ret = scaling_sweep(args)
+    sys.exit(ret)